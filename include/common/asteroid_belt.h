@@ -0,0 +1,119 @@
+#ifndef ASTEROID_BELT_H
+#define ASTEROID_BELT_H
+
+#include <glad/glad.h>
+
+#include <cmath>
+#include <random>
+#include <vector>
+
+#include "orbit.h"
+
+// Renders many small bodies as point sprites whose positions are evaluated entirely in the vertex shader.
+// The orbital elements are uploaded once into a static buffer, so the per-frame CPU cost is a single draw call.
+class AsteroidBelt {
+public:
+    unsigned int VAO = 0;
+    unsigned int VBO = 0;
+    GLsizei count = 0;
+
+    // uploads the orbital elements into the static vertex buffer (replaces any previous upload)
+    void upload(const OrbitalElements &elements) {
+        count = static_cast<GLsizei>(elements.count());
+
+        // interleave into two vec4 attributes per body
+        std::vector<float> data(elements.count() * 8);
+        for (size_t i = 0; i < elements.count(); i++) {
+            float *v = &data[i * 8];
+            v[0] = elements.semiMajorAxis[i];
+            v[1] = elements.eccentricity[i];
+            v[2] = elements.inclination[i];
+            v[3] = elements.meanMotion[i];
+            v[4] = elements.ascendingNode[i];
+            v[5] = elements.perihelion[i];
+            v[6] = elements.meanAnomaly[i];
+            v[7] = elements.size[i];
+        }
+
+        if (VAO == 0) {
+            glGenVertexArrays(1, &VAO);
+            glGenBuffers(1, &VBO);
+        }
+        glBindVertexArray(VAO);
+        glBindBuffer(GL_ARRAY_BUFFER, VBO);
+        glBufferData(GL_ARRAY_BUFFER, (GLsizeiptr) (data.size() * sizeof(float)), data.data(), GL_STATIC_DRAW);
+
+        // semi-major axis, eccentricity, inclination, mean motion
+        glVertexAttribPointer(0, 4, GL_FLOAT, GL_FALSE, 8 * sizeof(float), (void *) nullptr);
+        glEnableVertexAttribArray(0);
+        // ascending node, argument of perihelion, mean anomaly at epoch, size
+        glVertexAttribPointer(1, 4, GL_FLOAT, GL_FALSE, 8 * sizeof(float), (void *) (4 * sizeof(float)));
+        glEnableVertexAttribArray(1);
+
+        glBindVertexArray(0);
+        glBindBuffer(GL_ARRAY_BUFFER, 0);
+    }
+
+    // draws every body as one point (shader must already be in use with time/view/projection set)
+    void draw() const {
+        if (count == 0) return;
+        glEnable(GL_PROGRAM_POINT_SIZE);
+        glBindVertexArray(VAO);
+        glDrawArrays(GL_POINTS, 0, count);
+        glBindVertexArray(0);
+        glDisable(GL_PROGRAM_POINT_SIZE);
+    }
+
+    void release() {
+        glDeleteVertexArrays(1, &VAO);
+        glDeleteBuffers(1, &VBO);
+        VAO = VBO = 0;
+        count = 0;
+    }
+};
+
+// appends a synthetic main belt between mars and jupiter (with the main Kirkwood gaps left empty)
+inline void generateMainBelt(OrbitalElements &elements, size_t count, unsigned int seed = 1) {
+    std::mt19937 rng(seed);
+    std::uniform_real_distribution<float> axis(2.1f, 3.3f);
+    std::uniform_real_distribution<float> angle(0.0f, (float) ORBIT_TWO_PI);
+    std::normal_distribution<float> incl(0.0f, 0.14f); // ~8 degrees
+    std::uniform_real_distribution<float> ecc(0.0f, 0.25f);
+    std::uniform_real_distribution<float> size(0.5f, 1.5f);
+
+    const float gaps[] = {2.50f, 2.82f, 2.95f}; // 3:1, 5:2 and 7:3 resonances with jupiter
+
+    elements.reserve(elements.count() + count);
+    for (size_t i = 0; i < count; i++) {
+        float a;
+        bool inGap;
+        do {
+            a = axis(rng);
+            inGap = false;
+            for (float gap: gaps) {
+                if (std::fabs(a - gap) < 0.02f) inGap = true;
+            }
+        } while (inGap);
+        elements.add(a, ecc(rng), std::fabs(incl(rng)), angle(rng), angle(rng), angle(rng), size(rng));
+    }
+}
+
+// appends a synthetic kuiper belt beyond neptune (plutinos at the 3:2 resonance plus the classical belt)
+inline void generateKuiperBelt(OrbitalElements &elements, size_t count, unsigned int seed = 2) {
+    std::mt19937 rng(seed);
+    std::uniform_real_distribution<float> classical(42.0f, 48.0f);
+    std::normal_distribution<float> plutino(39.4f, 0.3f);
+    std::uniform_real_distribution<float> angle(0.0f, (float) ORBIT_TWO_PI);
+    std::normal_distribution<float> incl(0.0f, 0.2f); // ~11 degrees
+    std::uniform_real_distribution<float> ecc(0.0f, 0.2f);
+    std::uniform_real_distribution<float> size(1.0f, 2.0f);
+    std::uniform_int_distribution<int> family(0, 3);
+
+    elements.reserve(elements.count() + count);
+    for (size_t i = 0; i < count; i++) {
+        float a = family(rng) == 0 ? plutino(rng) : classical(rng);
+        elements.add(a, ecc(rng), std::fabs(incl(rng)), angle(rng), angle(rng), angle(rng), size(rng));
+    }
+}
+
+#endif
@@ -0,0 +1,571 @@
+#ifndef ATMOSPHERE_H
+#define ATMOSPHERE_H
+
+#include <glad/glad.h>
+
+#include <glm/glm.hpp>
+
+#include <algorithm>
+#include <cmath>
+#include <cstdint>
+#include <cstdio>
+#include <cstring>
+#include <fstream>
+#include <random>
+#include <string>
+#include <vector>
+
+#include "mapped_file.h"
+#include "parallel.h"
+
+// Precomputed atmospheric scattering (Bruneton and Neyret): the light scattered along a view ray through a spherical
+// atmosphere only depends on the altitude of the viewer, the zenith angles of the view and of the sun and the angle
+// between the view and the sun. It is computed once into lookup tables, and atmosphereFragment.glsl reads it with a
+// few texture fetches per fragment instead of marching every ray:
+// - transmittance: light left after crossing the atmosphere from a point to its top (altitude, view zenith)
+// - scattering: light scattered towards a point by the whole ray (the four parameters packed into a 3D texture),
+//   rayleigh in rgb and single mie in alpha (its color is extrapolated from the rayleigh one)
+// - irradiance: light of the sky on the ground (altitude, sun zenith), for the twilight on the night side
+//
+// The higher scattering orders are not iterated like in the paper but approximated by an isotropic term (Hillaire):
+// a small table holds the light scattered any number of times at each altitude and sun angle, and its share along
+// the ray is added to the rayleigh channel. The tables take a few seconds spread over every core, so they are cached
+// in a binary file that is reused while the parameters of the atmosphere are the same.
+// see more at: https://ebruneton.github.io/precomputed_atmospheric_scattering/
+// and at: https://sebh.github.io/publications/egsr2020.pdf
+
+const uint32_t ATMOSPHERE_CACHE_MAGIC = 0x4f4d5441; // "ATMO"
+const uint32_t ATMOSPHERE_CACHE_VERSION = 1;
+const float ATMOSPHERE_PI = 3.14159265f;
+
+// sizes of the tables (the same as atmosphereFragment.glsl)
+const int TRANSMITTANCE_WIDTH = 256; ///< view zenith angles of the transmittance table
+const int TRANSMITTANCE_HEIGHT = 64; ///< altitudes of the transmittance table
+const int SCATTERING_R_SIZE = 32; ///< altitudes of the scattering table
+const int SCATTERING_MU_SIZE = 128; ///< view zenith angles of the scattering table (half of them towards the ground)
+const int SCATTERING_MU_S_SIZE = 32; ///< sun zenith angles of the scattering table
+const int SCATTERING_NU_SIZE = 8; ///< angles between the view and the sun of the scattering table
+const int IRRADIANCE_WIDTH = 64; ///< sun zenith angles of the irradiance table
+const int IRRADIANCE_HEIGHT = 16; ///< altitudes of the irradiance table
+const int MULTIPLE_SCATTERING_SIZE = 32; ///< sun zenith angles and altitudes of the multiple scattering table
+
+const int SCATTERING_WIDTH = SCATTERING_NU_SIZE * SCATTERING_MU_S_SIZE; ///< width of the 3D scattering texture
+
+// Physical description of an atmosphere: lengths in km, coefficients per km at the wavelengths of red, green and
+// blue (only floats, so it can be compared and cached byte by byte)
+struct AtmosphereParameters {
+    glm::vec3 solarIrradiance; // at the top of the atmosphere
+    float sunAngularRadius; // radians
+    float bottomRadius; // radius of the ground
+    float topRadius; // radius of the top of the atmosphere
+    glm::vec3 rayleighScattering; // molecules, at the ground
+    float rayleighScaleHeight; // altitude where the density of the molecules falls by 1/e
+    float mieScattering; // aerosols (grey), at the ground
+    float mieExtinction;
+    float mieScaleHeight;
+    float miePhaseG; // asymmetry of the Cornette-Shanks phase function
+    glm::vec3 absorptionExtinction; // absorbing layer (ozone), at its peak
+    float absorptionCenter; // altitude of the peak of the absorbing layer
+    float absorptionWidth; // half width of the absorbing layer (its density falls linearly to 0)
+    float groundAlbedo;
+    float muSMin; // cosine of the largest sun zenith angle of the tables
+};
+
+// the earth's atmosphere of the reference implementation (sun and ozone included)
+inline AtmosphereParameters earthAtmosphere() {
+    AtmosphereParameters atmosphere{};
+    atmosphere.solarIrradiance = glm::vec3(1.474f, 1.8504f, 1.91198f);
+    atmosphere.sunAngularRadius = 0.004675f;
+    atmosphere.bottomRadius = 6360.0f;
+    atmosphere.topRadius = 6420.0f;
+    atmosphere.rayleighScattering = glm::vec3(0.005802f, 0.013558f, 0.0331f);
+    atmosphere.rayleighScaleHeight = 8.0f;
+    atmosphere.mieScattering = 0.003996f;
+    atmosphere.mieExtinction = 0.00444f;
+    atmosphere.mieScaleHeight = 1.2f;
+    atmosphere.miePhaseG = 0.8f;
+    atmosphere.absorptionExtinction = glm::vec3(0.00065f, 0.001881f, 0.000085f);
+    atmosphere.absorptionCenter = 25.0f;
+    atmosphere.absorptionWidth = 15.0f;
+    atmosphere.groundAlbedo = 0.1f;
+    atmosphere.muSMin = -0.2f; // the sun 102 degrees from the zenith, the end of the twilight
+    return atmosphere;
+}
+
+// Header of the cache, followed by the transmittance, scattering and irradiance tables (floats)
+struct AtmosphereCacheHeader {
+    uint32_t magic;
+    uint32_t version;
+    AtmosphereParameters parameters; // atmosphere the tables were computed for
+};
+
+// Lookup tables of an atmosphere, computed on the CPU (texel centers and parameterization of the reference
+// implementation, so the shader samples them with the same formulas)
+class AtmosphereTables {
+public:
+    AtmosphereParameters parameters{};
+    std::vector<float> transmittance; // rgb, TRANSMITTANCE_WIDTH x TRANSMITTANCE_HEIGHT
+    std::vector<float> scattering; // rgba, SCATTERING_WIDTH x SCATTERING_MU_SIZE x SCATTERING_R_SIZE
+    std::vector<float> irradiance; // rgb, IRRADIANCE_WIDTH x IRRADIANCE_HEIGHT
+
+    // loads the tables from the cache if they were computed for the same atmosphere, otherwise computes them on
+    // every core and writes the cache
+    void build(const char *cachePath, const AtmosphereParameters &atmosphere) {
+        if (loadCache(cachePath, atmosphere)) return;
+        compute(atmosphere);
+        saveCache(cachePath);
+    }
+
+    void compute(const AtmosphereParameters &atmosphere) {
+        parameters = atmosphere;
+
+        transmittance.assign((size_t) TRANSMITTANCE_WIDTH * TRANSMITTANCE_HEIGHT * 3, 0.0f);
+        parallelFor(TRANSMITTANCE_HEIGHT, [this](size_t begin, size_t end, unsigned int) {
+            for (size_t y = begin; y < end; y++) {
+                for (int x = 0; x < TRANSMITTANCE_WIDTH; x++) {
+                    float r, mu;
+                    transmittanceRMu((x + 0.5f) / TRANSMITTANCE_WIDTH, (y + 0.5f) / TRANSMITTANCE_HEIGHT, r, mu);
+                    store(transmittance, (y * TRANSMITTANCE_WIDTH + x) * 3, computeTransmittanceToTop(r, mu));
+                }
+            }
+        });
+
+        // the multiple scattering needs the transmittance, the scattering and the irradiance need both
+        multiple.assign((size_t) MULTIPLE_SCATTERING_SIZE * MULTIPLE_SCATTERING_SIZE, glm::vec3(0.0f));
+        parallelFor(MULTIPLE_SCATTERING_SIZE, [this](size_t begin, size_t end, unsigned int) {
+            for (size_t y = begin; y < end; y++) {
+                for (int x = 0; x < MULTIPLE_SCATTERING_SIZE; x++) {
+                    float muS = 2.0f * (x + 0.5f) / MULTIPLE_SCATTERING_SIZE - 1.0f;
+                    float r = parameters.bottomRadius + (parameters.topRadius - parameters.bottomRadius) *
+                                                        (y + 0.5f) / MULTIPLE_SCATTERING_SIZE;
+                    multiple[y * MULTIPLE_SCATTERING_SIZE + x] = computeMultipleScattering(r, muS);
+                }
+            }
+        });
+
+        // one task per row of the 3D texture (altitude and view zenith angle)
+        scattering.assign((size_t) SCATTERING_WIDTH * SCATTERING_MU_SIZE * SCATTERING_R_SIZE * 4, 0.0f);
+        parallelFor((size_t) SCATTERING_MU_SIZE * SCATTERING_R_SIZE, [this](size_t begin, size_t end, unsigned int) {
+            for (size_t row = begin; row < end; row++) {
+                for (int x = 0; x < SCATTERING_WIDTH; x++) {
+                    float r, mu, muS, nu;
+                    bool ground;
+                    scatteringRMuMuSNu(x, (int) (row % SCATTERING_MU_SIZE), (int) (row / SCATTERING_MU_SIZE), r, mu,
+                                       muS, nu, ground);
+                    glm::vec3 rayleigh, mie, multipleScattering;
+                    computeScattering(r, mu, muS, nu, ground, rayleigh, mie, multipleScattering);
+                    // the shader multiplies the rayleigh channel by the rayleigh phase function
+                    rayleigh += multipleScattering / rayleighPhase(nu);
+                    size_t index = (row * SCATTERING_WIDTH + x) * 4;
+                    store(scattering, index, rayleigh);
+                    scattering[index + 3] = mie.x;
+                }
+            }
+        });
+
+        irradiance.assign((size_t) IRRADIANCE_WIDTH * IRRADIANCE_HEIGHT * 3, 0.0f);
+        parallelFor(IRRADIANCE_HEIGHT, [this](size_t begin, size_t end, unsigned int) {
+            for (size_t y = begin; y < end; y++) {
+                for (int x = 0; x < IRRADIANCE_WIDTH; x++) {
+                    float r = parameters.bottomRadius + (parameters.topRadius - parameters.bottomRadius) *
+                                                        unitFromCoord((y + 0.5f) / IRRADIANCE_HEIGHT, IRRADIANCE_HEIGHT);
+                    float muS = clampCosine(2.0f * unitFromCoord((x + 0.5f) / IRRADIANCE_WIDTH, IRRADIANCE_WIDTH) - 1.0f);
+                    store(irradiance, (y * IRRADIANCE_WIDTH + x) * 3, computeSkyIrradiance(r, muS));
+                }
+            }
+        });
+        multiple.clear();
+    }
+
+private:
+    std::vector<glm::vec3> multiple; // light scattered two or more times (per unit of solar irradiance)
+
+    bool loadCache(const char *cachePath, const AtmosphereParameters &atmosphere) {
+        MappedFile cache(cachePath);
+        transmittance.resize((size_t) TRANSMITTANCE_WIDTH * TRANSMITTANCE_HEIGHT * 3);
+        scattering.resize((size_t) SCATTERING_WIDTH * SCATTERING_MU_SIZE * SCATTERING_R_SIZE * 4);
+        irradiance.resize((size_t) IRRADIANCE_WIDTH * IRRADIANCE_HEIGHT * 3);
+        size_t floats = transmittance.size() + scattering.size() + irradiance.size();
+        if (cache.size() != sizeof(AtmosphereCacheHeader) + floats * sizeof(float)) return false;
+
+        AtmosphereCacheHeader header{};
+        std::memcpy(&header, cache.data(), sizeof(header));
+        if (header.magic != ATMOSPHERE_CACHE_MAGIC || header.version != ATMOSPHERE_CACHE_VERSION ||
+            std::memcmp(&header.parameters, &atmosphere, sizeof(AtmosphereParameters)) != 0)
+            return false;
+
+        parameters = atmosphere;
+        const char *data = cache.data() + sizeof(header);
+        for (std::vector<float> *table: {&transmittance, &scattering, &irradiance}) {
+            std::memcpy(table->data(), data, table->size() * sizeof(float));
+            data += table->size() * sizeof(float);
+        }
+        return true;
+    }
+
+    // writes the tables to a file of its own and renames it over the cache, so the other processes that compute
+    // them at the same time (the workers of a video) never map a partly written cache
+    void saveCache(const char *cachePath) const {
+        std::string tempPath = std::string(cachePath) + "." + std::to_string(std::random_device()()) + ".tmp";
+        {
+            std::ofstream cache(tempPath, std::ios::binary | std::ios::trunc);
+            if (!cache) return;
+            AtmosphereCacheHeader header = {ATMOSPHERE_CACHE_MAGIC, ATMOSPHERE_CACHE_VERSION, parameters};
+            cache.write((const char *) &header, sizeof(header));
+            for (const std::vector<float> *table: {&transmittance, &scattering, &irradiance}) {
+                cache.write((const char *) table->data(), (std::streamsize) (table->size() * sizeof(float)));
+            }
+            if (!cache.flush()) {
+                cache.close();
+                std::remove(tempPath.c_str());
+                return;
+            }
+        }
+#ifdef _WIN32
+        std::remove(cachePath); // rename does not replace files on Windows (fails while another process maps it)
+#endif
+        if (std::rename(tempPath.c_str(), cachePath) != 0) std::remove(tempPath.c_str());
+    }
+
+    static void store(std::vector<float> &table, size_t index, glm::vec3 value) {
+        table[index] = value.x;
+        table[index + 1] = value.y;
+        table[index + 2] = value.z;
+    }
+
+    static float clampCosine(float mu) {
+        return std::min(std::max(mu, -1.0f), 1.0f);
+    }
+
+    static float safeSqrt(float a) {
+        return std::sqrt(std::max(a, 0.0f));
+    }
+
+    // texture coordinate of x in [0, 1] that maps 0 and 1 to the centers of the first and last texels
+    static float coordFromUnit(float x, int size) {
+        return 0.5f / (float) size + x * (1.0f - 1.0f / (float) size);
+    }
+
+    static float unitFromCoord(float u, int size) {
+        return (u - 0.5f / (float) size) / (1.0f - 1.0f / (float) size);
+    }
+
+    static float rayleighPhase(float nu) {
+        return 3.0f / (16.0f * ATMOSPHERE_PI) * (1.0f + nu * nu);
+    }
+
+    float miePhase(float nu) const {
+        float g = parameters.miePhaseG;
+        float k = 3.0f / (8.0f * ATMOSPHERE_PI) * (1.0f - g * g) / (2.0f + g * g);
+        return k * (1.0f + nu * nu) / std::pow(1.0f + g * g - 2.0f * g * nu, 1.5f);
+    }
+
+    float clampRadius(float r) const {
+        return std::min(std::max(r, parameters.bottomRadius), parameters.topRadius);
+    }
+
+    // distance from a point at radius r to the top of the atmosphere, along a ray with zenith angle cosine mu
+    float distanceToTop(float r, float mu) const {
+        float top = parameters.topRadius;
+        return std::max(-r * mu + safeSqrt(r * r * (mu * mu - 1.0f) + top * top), 0.0f);
+    }
+
+    float distanceToBottom(float r, float mu) const {
+        float bottom = parameters.bottomRadius;
+        return std::max(-r * mu - safeSqrt(r * r * (mu * mu - 1.0f) + bottom * bottom), 0.0f);
+    }
+
+    bool intersectsGround(float r, float mu) const {
+        float bottom = parameters.bottomRadius;
+        return mu < 0.0f && r * r * (mu * mu - 1.0f) + bottom * bottom >= 0.0f;
+    }
+
+    // densities of the molecules, the aerosols and the absorbing layer (1 at their reference altitude)
+    glm::vec3 densities(float altitude) const {
+        return glm::vec3(std::exp(-altitude / parameters.rayleighScaleHeight),
+                         std::exp(-altitude / parameters.mieScaleHeight),
+                         std::max(1.0f - std::abs(altitude - parameters.absorptionCenter) / parameters.absorptionWidth,
+                                  0.0f));
+    }
+
+    glm::vec3 extinction(glm::vec3 density) const {
+        return parameters.rayleighScattering * density.x + glm::vec3(parameters.mieExtinction * density.y) +
+               parameters.absorptionExtinction * density.z;
+    }
+
+    glm::vec3 scatteringCoefficient(glm::vec3 density) const {
+        return parameters.rayleighScattering * density.x + glm::vec3(parameters.mieScattering * density.y);
+    }
+
+    // inverse of the transmittance texture coordinates
+    void transmittanceRMu(float u, float v, float &r, float &mu) const {
+        float bottom = parameters.bottomRadius, top = parameters.topRadius;
+        float horizon = std::sqrt(top * top - bottom * bottom); // distance to the top along the horizon of the ground
+        float rho = horizon * unitFromCoord(v, TRANSMITTANCE_HEIGHT); // distance to the horizon of the ground
+        r = std::sqrt(rho * rho + bottom * bottom);
+        float dMin = top - r, dMax = rho + horizon;
+        float d = dMin + unitFromCoord(u, TRANSMITTANCE_WIDTH) * (dMax - dMin);
+        mu = d == 0.0f ? 1.0f : clampCosine((horizon * horizon - rho * rho - d * d) / (2.0f * r * d));
+    }
+
+    // integrates the optical depth of the ray to the top of the atmosphere (trapezoidal rule)
+    glm::vec3 computeTransmittanceToTop(float r, float mu) const {
+        const int samples = 500;
+        float dx = distanceToTop(r, mu) / (float) samples;
+        glm::vec3 opticalDepth(0.0f);
+        for (int i = 0; i <= samples; i++) {
+            float d = (float) i * dx;
+            float altitude = std::sqrt(d * d + 2.0f * r * mu * d + r * r) - parameters.bottomRadius;
+            float weight = i == 0 || i == samples ? 0.5f : 1.0f;
+            opticalDepth += extinction(densities(altitude)) * (weight * dx);
+        }
+        return glm::exp(-opticalDepth);
+    }
+
+    // bilinear lookup of the transmittance table (like the GPU)
+    glm::vec3 transmittanceToTop(float r, float mu) const {
+        float bottom = parameters.bottomRadius, top = parameters.topRadius;
+        float horizon = std::sqrt(top * top - bottom * bottom);
+        float rho = safeSqrt(r * r - bottom * bottom);
+        float d = distanceToTop(r, mu), dMin = top - r, dMax = rho + horizon;
+        float u = coordFromUnit((d - dMin) / (dMax - dMin), TRANSMITTANCE_WIDTH);
+        float v = coordFromUnit(rho / horizon, TRANSMITTANCE_HEIGHT);
+        return bilinear(transmittance, TRANSMITTANCE_WIDTH, TRANSMITTANCE_HEIGHT, u, v);
+    }
+
+    static glm::vec3 bilinear(const std::vector<float> &table, int width, int height, float u, float v) {
+        float x = u * (float) width - 0.5f, y = v * (float) height - 0.5f;
+        float fx = std::floor(x), fy = std::floor(y);
+        int x0 = std::min(std::max((int) fx, 0), width - 1), x1 = std::min(std::max((int) fx + 1, 0), width - 1);
+        int y0 = std::min(std::max((int) fy, 0), height - 1), y1 = std::min(std::max((int) fy + 1, 0), height - 1);
+        float tx = x - fx, ty = y - fy;
+        auto texel = [&](int i, int j) {
+            const float *t = &table[((size_t) j * width + i) * 3];
+            return glm::vec3(t[0], t[1], t[2]);
+        };
+        return (texel(x0, y0) * (1.0f - tx) + texel(x1, y0) * tx) * (1.0f - ty) +
+               (texel(x0, y1) * (1.0f - tx) + texel(x1, y1) * tx) * ty;
+    }
+
+    // transmittance between a point and the point at distance d along the ray (the ratio of two table lookups,
+    // both upwards so they never cross the ground)
+    glm::vec3 transmittanceAlong(float r, float mu, float d, bool ground) const {
+        float rd = clampRadius(std::sqrt(d * d + 2.0f * r * mu * d + r * r));
+        float muD = clampCosine((r * mu + d) / rd);
+        if (ground) return glm::min(transmittanceToTop(rd, -muD) / transmittanceToTop(r, -mu), glm::vec3(1.0f));
+        return glm::min(transmittanceToTop(r, mu) / transmittanceToTop(rd, muD), glm::vec3(1.0f));
+    }
+
+    // transmittance of the sun light, with the part of its disc above the horizon
+    glm::vec3 transmittanceToSun(float r, float muS) const {
+        float sinHorizon = parameters.bottomRadius / r;
+        float cosHorizon = -safeSqrt(1.0f - sinHorizon * sinHorizon);
+        float edge = sinHorizon * parameters.sunAngularRadius;
+        float x = std::min(std::max((muS - cosHorizon + edge) / (2.0f * edge), 0.0f), 1.0f);
+        return transmittanceToTop(r, muS) * (x * x * (3.0f - 2.0f * x));
+    }
+
+    // inverse of the scattering texture coordinates of a texel
+    void scatteringRMuMuSNu(int x, int y, int z, float &r, float &mu, float &muS, float &nu, bool &ground) const {
+        float bottom = parameters.bottomRadius, top = parameters.topRadius;
+        float horizon = std::sqrt(top * top - bottom * bottom);
+        float uNu = (float) (x / SCATTERING_MU_S_SIZE) / (float) (SCATTERING_NU_SIZE - 1);
+        float uMuS = ((float) (x % SCATTERING_MU_S_SIZE) + 0.5f) / SCATTERING_MU_S_SIZE;
+        float uMu = (y + 0.5f) / SCATTERING_MU_SIZE;
+        float uR = (z + 0.5f) / SCATTERING_R_SIZE;
+
+        float rho = horizon * unitFromCoord(uR, SCATTERING_R_SIZE);
+        r = std::sqrt(rho * rho + bottom * bottom);
+        if (uMu < 0.5f) { // rays towards the ground (lower half of the texture)
+            float dMin = r - bottom, dMax = rho;
+            float d = dMin + (dMax - dMin) * unitFromCoord(1.0f - 2.0f * uMu, SCATTERING_MU_SIZE / 2);
+            mu = d == 0.0f ? -1.0f : clampCosine(-(rho * rho + d * d) / (2.0f * r * d));
+            ground = true;
+        } else {
+            float dMin = top - r, dMax = rho + horizon;
+            float d = dMin + (dMax - dMin) * unitFromCoord(2.0f * uMu - 1.0f, SCATTERING_MU_SIZE / 2);
+            mu = d == 0.0f ? 1.0f : clampCosine((horizon * horizon - rho * rho - d * d) / (2.0f * r * d));
+            ground = false;
+        }
+
+        float xMuS = unitFromCoord(uMuS, SCATTERING_MU_S_SIZE);
+        float dMin = top - bottom, dMax = horizon;
+        float limit = (distanceToTop(bottom, parameters.muSMin) - dMin) / (dMax - dMin);
+        float a = (limit - xMuS * limit) / (1.0f + xMuS * limit);
+        float d = dMin + std::min(a, limit) * (dMax - dMin);
+        muS = d == 0.0f ? 1.0f : clampCosine((horizon * horizon - d * d) / (2.0f * bottom * d));
+
+        // only the angles possible between both directions
+        float spread = std::sqrt((1.0f - mu * mu) * (1.0f - muS * muS));
+        nu = std::min(std::max(2.0f * uNu - 1.0f, mu * muS - spread), mu * muS + spread);
+    }
+
+    // bilinear lookup of the multiple scattering table
+    glm::vec3 multipleScattering(float r, float muS) const {
+        float x = (muS + 1.0f) * 0.5f * MULTIPLE_SCATTERING_SIZE - 0.5f;
+        float y = (r - parameters.bottomRadius) / (parameters.topRadius - parameters.bottomRadius) *
+                  MULTIPLE_SCATTERING_SIZE - 0.5f;
+        float fx = std::floor(x), fy = std::floor(y);
+        int last = MULTIPLE_SCATTERING_SIZE - 1;
+        int x0 = std::min(std::max((int) fx, 0), last), x1 = std::min(std::max((int) fx + 1, 0), last);
+        int y0 = std::min(std::max((int) fy, 0), last), y1 = std::min(std::max((int) fy + 1, 0), last);
+        float tx = x - fx, ty = y - fy;
+        auto texel = [&](int i, int j) { return multiple[j * MULTIPLE_SCATTERING_SIZE + i]; };
+        return (texel(x0, y0) * (1.0f - tx) + texel(x1, y0) * tx) * (1.0f - ty) +
+               (texel(x0, y1) * (1.0f - tx) + texel(x1, y1) * tx) * ty;
+    }
+
+    // light scattered two or more times towards a point, isotropic and per unit of solar irradiance: the light
+    // scattered once towards the point from every direction, over one minus the part of it scattered again
+    glm::vec3 computeMultipleScattering(float r, float muS) const {
+        const int directions = 8; // zenith and azimuth steps over the sphere
+        const int samples = 20;
+        const float isotropicPhase = 1.0f / (4.0f * ATMOSPHERE_PI);
+        glm::vec3 sun(safeSqrt(1.0f - muS * muS), 0.0f, muS);
+        glm::vec3 luminance(0.0f), transfer(0.0f);
+        for (int i = 0; i < directions; i++) {
+            float mu = 1.0f - 2.0f * (i + 0.5f) / directions; // uniform over the sphere
+            for (int j = 0; j < directions; j++) {
+                float phi = 2.0f * ATMOSPHERE_PI * (j + 0.5f) / directions;
+                glm::vec3 direction(std::cos(phi) * safeSqrt(1.0f - mu * mu), std::sin(phi) * safeSqrt(1.0f - mu * mu), mu);
+                float nu = glm::dot(direction, sun);
+                bool ground = intersectsGround(r, mu);
+                float length = ground ? distanceToBottom(r, mu) : distanceToTop(r, mu);
+                float dt = length / (float) samples;
+                glm::vec3 throughput(1.0f);
+                for (int s = 0; s < samples; s++) {
+                    float t = (s + 0.5f) * dt;
+                    float rs = clampRadius(std::sqrt(t * t + 2.0f * r * mu * t + r * r));
+                    float muSs = clampCosine((r * muS + t * nu) / rs);
+                    glm::vec3 density = densities(rs - parameters.bottomRadius);
+                    glm::vec3 sigmaT = extinction(density);
+                    glm::vec3 segment = glm::exp(-sigmaT * dt);
+                    // scattered light over the segment, with a constant extinction
+                    glm::vec3 scattered = (glm::vec3(1.0f) - segment) * scatteringCoefficient(density) / sigmaT;
+                    luminance += throughput * scattered * transmittanceToSun(rs, muSs) * isotropicPhase;
+                    transfer += throughput * scattered;
+                    throughput *= segment;
+                }
+                if (ground) { // the ground reflects the sun light (lambertian)
+                    float muSg = clampCosine((r * muS + length * nu) / parameters.bottomRadius);
+                    luminance += throughput * transmittanceToSun(parameters.bottomRadius, muSg) *
+                                 (parameters.groundAlbedo / ATMOSPHERE_PI * std::max(muSg, 0.0f));
+                }
+            }
+        }
+        float count = (float) (directions * directions);
+        luminance /= count;
+        transfer /= count;
+        return luminance / (glm::vec3(1.0f) - transfer);
+    }
+
+    // light scattered towards a point by the ray up to the nearest boundary of the atmosphere (trapezoidal rule):
+    // single rayleigh and mie without their phase functions, and the multiple scattering (isotropic)
+    void computeScattering(float r, float mu, float muS, float nu, bool ground, glm::vec3 &rayleigh, glm::vec3 &mie,
+                           glm::vec3 &multipleScattered) const {
+        const int samples = 50;
+        float dx = (ground ? distanceToBottom(r, mu) : distanceToTop(r, mu)) / (float) samples;
+        rayleigh = mie = multipleScattered = glm::vec3(0.0f);
+        for (int i = 0; i <= samples; i++) {
+            float d = (float) i * dx;
+            float rd = clampRadius(std::sqrt(d * d + 2.0f * r * mu * d + r * r));
+            float muSd = clampCosine((r * muS + d * nu) / rd);
+            glm::vec3 density = densities(rd - parameters.bottomRadius);
+            glm::vec3 view = transmittanceAlong(r, mu, d, ground);
+            glm::vec3 sun = view * transmittanceToSun(rd, muSd);
+            float weight = i == 0 || i == samples ? 0.5f : 1.0f;
+            rayleigh += sun * (density.x * weight);
+            mie += sun * (density.y * weight);
+            multipleScattered += view * scatteringCoefficient(density) * multipleScattering(rd, muSd) * weight;
+        }
+        rayleigh *= parameters.solarIrradiance * parameters.rayleighScattering * dx;
+        mie *= parameters.solarIrradiance * (parameters.mieScattering * dx);
+        multipleScattered *= parameters.solarIrradiance * dx;
+    }
+
+    // light of the sky on a horizontal surface (the integral of the sky over the upper hemisphere)
+    glm::vec3 computeSkyIrradiance(float r, float muS) const {
+        const int zenithSteps = 8;
+        const int azimuthSteps = 16;
+        float dTheta = 0.5f * ATMOSPHERE_PI / zenithSteps, dPhi = 2.0f * ATMOSPHERE_PI / azimuthSteps;
+        glm::vec3 sun(safeSqrt(1.0f - muS * muS), 0.0f, muS);
+        glm::vec3 result(0.0f);
+        for (int j = 0; j < zenithSteps; j++) {
+            float theta = (j + 0.5f) * dTheta;
+            for (int i = 0; i < azimuthSteps; i++) {
+                float phi = (i + 0.5f) * dPhi;
+                glm::vec3 direction(std::cos(phi) * std::sin(theta), std::sin(phi) * std::sin(theta), std::cos(theta));
+                float nu = glm::dot(direction, sun);
+                glm::vec3 rayleigh, mie, multipleScattered;
+                computeScattering(r, direction.z, muS, nu, false, rayleigh, mie, multipleScattered);
+                glm::vec3 radiance = rayleigh * rayleighPhase(nu) + mie * miePhase(nu) + multipleScattered;
+                result += radiance * (direction.z * std::sin(theta) * dTheta * dPhi);
+            }
+        }
+        return result;
+    }
+};
+
+// Textures of the lookup tables (transmittance, scattering and irradiance on consecutive texture units)
+class AtmosphereTextures {
+public:
+    unsigned int transmittance = 0;
+    unsigned int scattering = 0;
+    unsigned int irradiance = 0;
+
+    void create(const AtmosphereTables &tables) {
+        transmittance = createTexture2D(TRANSMITTANCE_WIDTH, TRANSMITTANCE_HEIGHT, tables.transmittance);
+        irradiance = createTexture2D(IRRADIANCE_WIDTH, IRRADIANCE_HEIGHT, tables.irradiance);
+
+        // half floats are enough for the radiance (8 MB instead of 16 MB)
+        glGenTextures(1, &scattering);
+        glBindTexture(GL_TEXTURE_3D, scattering);
+        glTexImage3D(GL_TEXTURE_3D, 0, GL_RGBA16F, SCATTERING_WIDTH, SCATTERING_MU_SIZE, SCATTERING_R_SIZE, 0, GL_RGBA,
+                     GL_FLOAT, tables.scattering.data());
+        glTexParameteri(GL_TEXTURE_3D, GL_TEXTURE_MIN_FILTER, GL_LINEAR);
+        glTexParameteri(GL_TEXTURE_3D, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
+        glTexParameteri(GL_TEXTURE_3D, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_EDGE);
+        glTexParameteri(GL_TEXTURE_3D, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_EDGE);
+        glTexParameteri(GL_TEXTURE_3D, GL_TEXTURE_WRAP_R, GL_CLAMP_TO_EDGE);
+        glBindTexture(GL_TEXTURE_3D, 0);
+    }
+
+    bool ready() const {
+        return scattering != 0;
+    }
+
+    // binds the tables to unit first, first + 1 and first + 2
+    void bind(unsigned int first) const {
+        glActiveTexture(GL_TEXTURE0 + first);
+        glBindTexture(GL_TEXTURE_2D, transmittance);
+        glActiveTexture(GL_TEXTURE0 + first + 1);
+        glBindTexture(GL_TEXTURE_3D, scattering);
+        glActiveTexture(GL_TEXTURE0 + first + 2);
+        glBindTexture(GL_TEXTURE_2D, irradiance);
+        glActiveTexture(GL_TEXTURE0);
+    }
+
+    void release() {
+        glDeleteTextures(1, &transmittance);
+        glDeleteTextures(1, &scattering);
+        glDeleteTextures(1, &irradiance);
+        transmittance = scattering = irradiance = 0;
+    }
+
+private:
+    // rgb float texture (the transmittance needs the precision of floats near the horizon)
+    static unsigned int createTexture2D(int width, int height, const std::vector<float> &data) {
+        unsigned int texture;
+        glGenTextures(1, &texture);
+        glBindTexture(GL_TEXTURE_2D, texture);
+        glTexImage2D(GL_TEXTURE_2D, 0, GL_RGB32F, width, height, 0, GL_RGB, GL_FLOAT, data.data());
+        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_LINEAR);
+        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
+        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_EDGE);
+        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_EDGE);
+        glBindTexture(GL_TEXTURE_2D, 0);
+        return texture;
+    }
+};
+
+#endif
@@ -0,0 +1,29 @@
+#ifndef BRIGHT_STAR_CATALOG_H
+#define BRIGHT_STAR_CATALOG_H
+
+#include <cstdint>
+
+// On-disk catalog of the bright star background, written by tools/build_star_octree.cpp --bright from the HYG
+// database and drawn by bright_stars.h.
+//
+// Every star takes 8 bytes: its direction as three normalized shorts, its apparent magnitude in tenths and its B-V
+// color index in fiftieths, so the ~120,000 stars visible with binoculars take about 1 MB.
+//
+// File layout: BrightStarsHeader, then count BrightStar records.
+
+const uint32_t BRIGHT_STARS_MAGIC = 0x52545342; // "BSTR"
+const uint32_t BRIGHT_STARS_VERSION = 1;
+
+struct BrightStarsHeader {
+    uint32_t magic;
+    uint32_t version;
+    uint64_t count;
+};
+
+struct BrightStar {
+    int16_t direction[3]; // heliocentric equatorial unit vector (normalized to 32767)
+    int8_t magnitude; // apparent magnitude (tenths)
+    int8_t color; // B-V color index (fiftieths)
+};
+
+#endif
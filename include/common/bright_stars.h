@@ -0,0 +1,122 @@
+#ifndef BRIGHT_STARS_H
+#define BRIGHT_STARS_H
+
+#include <glad/glad.h>
+
+#include <glm/glm.hpp>
+
+#include <algorithm>
+#include <cmath>
+#include <cstdint>
+#include <cstring>
+#include <random>
+#include <vector>
+
+#include "bright_star_catalog.h"
+#include "mapped_file.h"
+#include "star_octree.h"
+
+// Background of the stars seen from the solar system, drawn as point sprites instead of sampled from cubemaps.
+//
+// The catalog (see bright_star_catalog.h) stores about 120,000 stars visible with binoculars in about 1 MB. Stars
+// are expanded at load time into the StarPoint layout of the star octree (a direction 10 parsecs away, where
+// absolute and apparent magnitudes are the same), so both backgrounds share starVertex.glsl. Without a catalog a
+// synthetic sky is generated.
+
+// star drawn by starVertex.glsl in the given direction with an apparent magnitude and color index
+inline StarPoint brightStarPoint(glm::vec3 direction, float magnitude, float color) {
+    direction = glm::normalize(direction) * 10.0f; // at 10 parsecs absolute magnitude is apparent magnitude
+    return {direction.x, direction.y, direction.z, (int16_t) std::lround(magnitude * 1000.0f),
+            (int16_t) std::lround(color * 1000.0f)};
+}
+
+// reads a catalog into stars (replacing its content), returns false if it does not exist or is invalid
+inline bool loadBrightStars(const char *path, std::vector<StarPoint> &stars) {
+    MappedFile catalog(path);
+    if (catalog.size() < sizeof(BrightStarsHeader)) return false;
+    BrightStarsHeader header{};
+    std::memcpy(&header, catalog.data(), sizeof(header));
+    if (header.magic != BRIGHT_STARS_MAGIC || header.version != BRIGHT_STARS_VERSION ||
+        catalog.size() != sizeof(header) + header.count * sizeof(BrightStar))
+        return false;
+
+    stars.resize(header.count);
+    const char *data = catalog.data() + sizeof(header);
+    for (size_t i = 0; i < header.count; i++) {
+        BrightStar star{};
+        std::memcpy(&star, data + i * sizeof(BrightStar), sizeof(star));
+        glm::vec3 direction = glm::vec3(star.direction[0], star.direction[1], star.direction[2]);
+        stars[i] = brightStarPoint(direction, (float) star.magnitude / 10.0f, (float) star.color / 50.0f);
+    }
+    return true;
+}
+
+// fills stars with a synthetic sky down to a limiting magnitude: counts grow about 10^(0.5 m) per magnitude and
+// most stars crowd the galactic plane
+inline void generateBrightStars(std::vector<StarPoint> &stars, size_t count, float limit, unsigned int seed = 5) {
+    // galactic to equatorial rotation (J2000, columns are the galactic axes in equatorial coordinates)
+    const glm::mat3 galacticToEquatorial(glm::vec3(-0.0548755604f, -0.8734370902f, -0.4838350155f),
+                                         glm::vec3(0.4941094279f, -0.4448296300f, 0.7469822445f),
+                                         glm::vec3(-0.8676661490f, -0.1980763734f, 0.4559837762f));
+    std::mt19937 rng(seed);
+    std::uniform_real_distribution<float> unit(0.0f, 1.0f);
+    std::normal_distribution<float> latitudeJitter(0.0f, 0.25f); // radians
+    std::normal_distribution<float> colorJitter(0.7f, 0.45f);
+
+    stars.clear();
+    stars.reserve(count);
+    for (size_t i = 0; i < count; i++) {
+        float longitude = (float) ORBIT_TWO_PI * unit(rng);
+        float latitude = unit(rng) < 0.6f ? latitudeJitter(rng) : std::asin(2.0f * unit(rng) - 1.0f);
+        glm::vec3 galactic = glm::vec3(std::cos(latitude) * std::cos(longitude),
+                                       std::cos(latitude) * std::sin(longitude), std::sin(latitude));
+        float magnitude = limit + 2.0f * std::log10(std::max(unit(rng), 1e-6f)); // inverse of 10^(0.5 m)
+        float color = std::fmin(std::fmax(colorJitter(rng), -0.3f), 2.0f);
+        stars.push_back(brightStarPoint(galacticToEquatorial * galactic, magnitude, color));
+    }
+}
+
+class BrightStarField {
+public:
+    unsigned int VAO = 0;
+    unsigned int VBO = 0;
+    GLsizei count = 0;
+
+    void create(const std::vector<StarPoint> &stars) {
+        count = (GLsizei) stars.size();
+        glGenVertexArrays(1, &VAO);
+        glGenBuffers(1, &VBO);
+        glBindVertexArray(VAO);
+        glBindBuffer(GL_ARRAY_BUFFER, VBO);
+        glBufferData(GL_ARRAY_BUFFER, (GLsizeiptr) (stars.size() * sizeof(StarPoint)), stars.data(),
+                     GL_STATIC_DRAW);
+
+        // direction (10 parsecs), apparent magnitude and color index (thousandths), as in star_streamer.h
+        glVertexAttribPointer(0, 3, GL_FLOAT, GL_FALSE, sizeof(StarPoint), (void *) nullptr);
+        glEnableVertexAttribArray(0);
+        glVertexAttribPointer(1, 2, GL_SHORT, GL_FALSE, sizeof(StarPoint), (void *) (3 * sizeof(float)));
+        glEnableVertexAttribArray(1);
+        glBindVertexArray(0);
+        glBindBuffer(GL_ARRAY_BUFFER, 0);
+    }
+
+    // draws every star as an additive point sprite (shader must already be in use)
+    void draw() const {
+        glEnable(GL_PROGRAM_POINT_SIZE);
+        glBlendFunc(GL_SRC_ALPHA, GL_ONE);
+        glBindVertexArray(VAO);
+        glDrawArrays(GL_POINTS, 0, count);
+        glBindVertexArray(0);
+        glBlendFunc(GL_SRC_ALPHA, GL_ONE_MINUS_SRC_ALPHA);
+        glDisable(GL_PROGRAM_POINT_SIZE);
+    }
+
+    void release() {
+        glDeleteVertexArrays(1, &VAO);
+        glDeleteBuffers(1, &VBO);
+        VAO = VBO = 0;
+        count = 0;
+    }
+};
+
+#endif
@@ -28,8 +28,8 @@ const float ZOOM = 45.0f;
 // An abstract camera class that processes input and calculates the corresponding Euler Angles, Vectors and Matrices for use in OpenGL
 class Camera {
 public:
-    // camera Attributes
-    glm::vec3 Position;
+    // camera Attributes (position in double precision, see GetRotationMatrix)
+    glm::dvec3 Position;
     glm::vec3 Front;
     glm::vec3 Up;
     glm::vec3 Right;
@@ -43,7 +43,7 @@ public:
     float Zoom;
 
     // constructor with vectors
-    Camera(glm::vec3 position = glm::vec3(0.0f, 0.0f, 0.0f), glm::vec3 up = glm::vec3(0.0f, 1.0f, 0.0f),
+    Camera(glm::dvec3 position = glm::dvec3(0.0, 0.0, 0.0), glm::vec3 up = glm::vec3(0.0f, 1.0f, 0.0f),
            float yaw = YAW, float pitch = PITCH) : Front(glm::vec3(0.0f, 0.0f, -1.0f)), MovementSpeed(SPEED),
                                                    MouseSensitivity(SENSITIVITY), Zoom(ZOOM) {
         Position = position;
@@ -56,7 +56,7 @@ public:
     // constructor with scalar values
     Camera(float posX, float posY, float posZ, float upX, float upY, float upZ, float yaw, float pitch) : Front(
             glm::vec3(0.0f, 0.0f, -1.0f)), MovementSpeed(SPEED), MouseSensitivity(SENSITIVITY), Zoom(ZOOM) {
-        Position = glm::vec3(posX, posY, posZ);
+        Position = glm::dvec3(posX, posY, posZ);
         WorldUp = glm::vec3(upX, upY, upZ);
         Yaw = yaw;
         Pitch = pitch;
@@ -65,24 +65,31 @@ public:
 
     // returns the view matrix calculated using Euler Angles and the LookAt Matrix
     glm::mat4 GetViewMatrix() const {
-        return glm::lookAt(Position, Position + Front, Up);
+        glm::vec3 position = glm::vec3(Position);
+        return glm::lookAt(position, position + Front, Up);
+    }
+
+    // returns the view matrix of a camera at the origin: the translation is applied to every model matrix in
+    // double precision instead, so large world coordinates do not lose float precision
+    glm::mat4 GetRotationMatrix() const {
+        return glm::lookAt(glm::vec3(0.0f), Front, Up);
     }
 
     // processes input received from any keyboard-like input system. Accepts input parameter in the form of camera defined ENUM (to abstract it from windowing systems)
     void ProcessKeyboard(Camera_Movement direction, float deltaTime) {
-        float velocity = MovementSpeed * deltaTime;
+        double velocity = MovementSpeed * deltaTime;
         if (direction == FORWARD)
-            Position += Front * velocity;
+            Position += glm::dvec3(Front) * velocity;
         if (direction == BACKWARD)
-            Position -= Front * velocity;
+            Position -= glm::dvec3(Front) * velocity;
         if (direction == LEFT)
-            Position -= Right * velocity;
+            Position -= glm::dvec3(Right) * velocity;
         if (direction == RIGHT)
-            Position += Right * velocity;
+            Position += glm::dvec3(Right) * velocity;
         if (direction == UPWARD)
-            Position += Up * velocity;
+            Position += glm::dvec3(Up) * velocity;
         if (direction == DOWNWARD)
-            Position -= Up * velocity;
+            Position -= glm::dvec3(Up) * velocity;
     }
 
     // processes input received from a mouse input system. Expects the offset value in both the x and y direction.
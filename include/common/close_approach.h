@@ -0,0 +1,302 @@
+#ifndef CLOSE_APPROACH_H
+#define CLOSE_APPROACH_H
+
+#include <algorithm>
+#include <cmath>
+#include <cstdint>
+#include <mutex>
+#include <vector>
+
+#include "orbit.h"
+#include "parallel.h"
+#include "propagator.h"
+
+// Close-approach screening over a time window:
+// 1. positions of every body are sampled at fixed steps (batch propagator)
+// 2. each sample is binned into a uniform 3D spatial hash whose cells are big enough that a pair closer than the
+//    threshold anywhere within half a step of the sample must fall into neighbouring cells
+// 3. pairs in neighbouring cells are kept when their linearised relative motion comes within the threshold
+//    (plus a bound on the curvature of both orbits) during that half step
+// 4. candidate pairs are refined with a Brent minimisation of their distance around the samples
+// Steps are processed in parallel, so the cost is O(steps * N) instead of O(steps * N^2).
+
+const size_t NO_TARGET = SIZE_MAX; ///< screen every pair instead of pairs with one target body
+
+// One close approach between two bodies
+struct CloseApproach {
+    size_t first; ///< index of the first body (the target when screening against one)
+    size_t second; ///< index of the second body
+    double time; ///< scene time of the minimum distance
+    double distance; ///< minimum distance (AU)
+};
+
+// distance (AU) between two bodies at the given scene time
+inline double bodyDistance(const OrbitalElements &el, size_t a, size_t b, double time) {
+    double pa[3], pb[3];
+    orbitPosition(el, a, time, pa);
+    orbitPosition(el, b, time, pb);
+    return std::sqrt((pa[0] - pb[0]) * (pa[0] - pb[0]) + (pa[1] - pb[1]) * (pa[1] - pb[1]) +
+                     (pa[2] - pb[2]) * (pa[2] - pb[2]));
+}
+
+// Brent's method for the minimum of f in [low, high] (x to a relative tolerance)
+// see more at: https://en.wikipedia.org/wiki/Brent%27s_method
+template<typename Function>
+void brentMinimum(Function f, double low, double high, double &x, double &fx, double tolerance = 1e-8) {
+    const double golden = 0.3819660112501051;
+
+    x = low + golden * (high - low);
+    fx = f(x);
+    double w = x, v = x, fw = fx, fv = fx;
+    double d = 0.0, e = 0.0;
+
+    for (int iteration = 0; iteration < 100; iteration++) {
+        double middle = 0.5 * (low + high);
+        double tol1 = tolerance * std::fabs(x) + 1e-12, tol2 = 2.0 * tol1;
+        if (std::fabs(x - middle) <= tol2 - 0.5 * (high - low)) break;
+
+        bool golden_step = true;
+        if (std::fabs(e) > tol1) { // try a parabolic fit through x, w and v
+            double r = (x - w) * (fx - fv);
+            double q = (x - v) * (fx - fw);
+            double p = (x - v) * q - (x - w) * r;
+            q = 2.0 * (q - r);
+            if (q > 0.0) p = -p;
+            q = std::fabs(q);
+            if (std::fabs(p) < std::fabs(0.5 * q * e) && p > q * (low - x) && p < q * (high - x)) {
+                e = d;
+                d = p / q;
+                double u = x + d;
+                if (u - low < tol2 || high - u < tol2) d = middle > x ? tol1 : -tol1;
+                golden_step = false;
+            }
+        }
+        if (golden_step) {
+            e = (x >= middle ? low : high) - x;
+            d = golden * e;
+        }
+
+        double u = std::fabs(d) >= tol1 ? x + d : x + (d > 0.0 ? tol1 : -tol1);
+        double fu = f(u);
+        if (fu <= fx) {
+            if (u >= x) low = x;
+            else high = x;
+            v = w, fv = fw;
+            w = x, fw = fx;
+            x = u, fx = fu;
+        } else {
+            if (u < x) low = u;
+            else high = u;
+            if (fu <= fw || w == x) {
+                v = w, fv = fw;
+                w = u, fw = fu;
+            } else if (fu <= fv || v == x || v == w) {
+                v = u, fv = fu;
+            }
+        }
+    }
+}
+
+// minimum distance between two bodies in [low, high]
+inline void minimumDistance(const OrbitalElements &el, size_t a, size_t b, double low, double high,
+                            double &time, double &distance) {
+    brentMinimum([&](double t) { return bodyDistance(el, a, b, t); }, low, high, time, distance);
+}
+
+// fastest heliocentric speed (AU per scene second) of any body, reached at perihelion
+inline double maximumSpeed(const OrbitalElements &el) {
+    double speed = 0.0;
+    for (size_t i = 0; i < el.count(); i++) {
+        double e = el.eccentricity[i];
+        speed = std::max(speed, (double) el.meanMotion[i] * el.semiMajorAxis[i] * std::sqrt((1.0 + e) / (1.0 - e)));
+    }
+    return speed;
+}
+
+// closest perihelion distance (AU) of any body, where the sun pulls the hardest
+inline double minimumPerihelion(const OrbitalElements &el) {
+    double perihelion = HUGE_VAL;
+    for (size_t i = 0; i < el.count(); i++) {
+        perihelion = std::min(perihelion, (double) el.semiMajorAxis[i] * (1.0 - el.eccentricity[i]));
+    }
+    return perihelion;
+}
+
+// Uniform spatial hash of one position sample (counting sort of bodies into hashed cells)
+struct SpatialHash {
+    double cellSize = 1.0;
+    std::vector<int64_t> cellX, cellY, cellZ; // cell of each body
+    std::vector<uint32_t> start; // first entry of each bucket in bodies (bucket count + 1 entries)
+    std::vector<uint32_t> bodies; // body indices grouped by bucket
+    uint64_t mask = 0; // bucket count - 1 (power of two)
+
+    static uint64_t hash(int64_t x, int64_t y, int64_t z) {
+        return ((uint64_t) x * 73856093u) ^ ((uint64_t) y * 19349663u) ^ ((uint64_t) z * 83492791u);
+    }
+
+    size_t bucket(int64_t x, int64_t y, int64_t z) const {
+        return (size_t) (hash(x, y, z) & mask);
+    }
+
+    void build(const StateVectors &positions, double size) {
+        size_t n = positions.count();
+        cellSize = size;
+        cellX.resize(n);
+        cellY.resize(n);
+        cellZ.resize(n);
+        size_t buckets = 1;
+        while (buckets < 2 * n) buckets *= 2;
+        mask = buckets - 1;
+        start.assign(buckets + 1, 0);
+        bodies.resize(n);
+
+        // count bodies per bucket, prefix sum and scatter
+        std::vector<uint32_t> bucketOf(n);
+        for (size_t i = 0; i < n; i++) {
+            cellX[i] = (int64_t) std::floor(positions.x[i] / cellSize);
+            cellY[i] = (int64_t) std::floor(positions.y[i] / cellSize);
+            cellZ[i] = (int64_t) std::floor(positions.z[i] / cellSize);
+            bucketOf[i] = (uint32_t) bucket(cellX[i], cellY[i], cellZ[i]);
+            start[bucketOf[i] + 1]++;
+        }
+        for (size_t b = 1; b < start.size(); b++) start[b] += start[b - 1];
+        std::vector<uint32_t> fill(start.begin(), start.end() - 1);
+        for (size_t i = 0; i < n; i++) bodies[fill[bucketOf[i]]++] = (uint32_t) i;
+    }
+
+    // calls fn(j) for every body j in the cell (dx, dy, dz) away from body i (bucket collisions are filtered out)
+    template<typename Function>
+    void cell(size_t i, int64_t dx, int64_t dy, int64_t dz, Function &fn) const {
+        int64_t x = cellX[i] + dx, y = cellY[i] + dy, z = cellZ[i] + dz;
+        size_t b = bucket(x, y, z);
+        for (uint32_t k = start[b]; k < start[b + 1]; k++) {
+            uint32_t j = bodies[k];
+            if (cellX[j] == x && cellY[j] == y && cellZ[j] == z) fn(j);
+        }
+    }
+
+    // calls fn(j) for every body j in the 27 cells around body i
+    template<typename Function>
+    void neighbours(size_t i, Function fn) const {
+        for (int64_t dx = -1; dx <= 1; dx++) {
+            for (int64_t dy = -1; dy <= 1; dy++) {
+                for (int64_t dz = -1; dz <= 1; dz++) cell(i, dx, dy, dz, fn);
+            }
+        }
+    }
+
+    // calls fn(j) for the bodies in the own cell of body i and in the 13 cells "after" it, so that every pair of
+    // neighbouring bodies is visited from exactly one side (fn must still skip j <= i in the own cell)
+    template<typename Function>
+    void forwardNeighbours(size_t i, Function fn) const {
+        for (int64_t dx = -1; dx <= 1; dx++) {
+            for (int64_t dy = -1; dy <= 1; dy++) {
+                for (int64_t dz = -1; dz <= 1; dz++) {
+                    if (dx * 9 + dy * 3 + dz >= 0) cell(i, dx, dy, dz, fn);
+                }
+            }
+        }
+    }
+};
+
+// finds every pair of bodies (or every body against target) closer than threshold (AU) in [start, end]
+// step: sampling interval in scene time; returned events are sorted by time, one per pair and encounter
+inline std::vector<CloseApproach> screenCloseApproaches(const OrbitalElements &el, double start, double end,
+                                                        double step, double threshold, size_t target = NO_TARGET,
+                                                        unsigned int threads = 0) {
+    size_t steps = (size_t) std::ceil((end - start) / step) + 1;
+
+    // two bodies closer than threshold within half a step of a sample are at most this far apart at the sample
+    double half = 0.5 * step;
+    double reach = threshold + maximumSpeed(el) * step;
+
+    // how far both bodies can drift from straight-line motion within half a step (GM = 1 AU^3/s^2 in scene time)
+    double perihelion = minimumPerihelion(el);
+    double margin = threshold + half * half / (perihelion * perihelion);
+
+    // candidate pairs found at each sample (pair and sample index)
+    struct Candidate {
+        uint32_t first, second;
+        size_t sample;
+    };
+    std::vector<Candidate> candidates;
+    std::mutex candidatesMutex;
+
+    parallelFor(steps, [&](size_t first, size_t last, unsigned int) {
+        StateVectors positions;
+        SpatialHash grid;
+        std::vector<Candidate> found;
+        for (size_t k = first; k < last; k++) {
+            double time = std::min(start + (double) k * step, end);
+            propagateOrbits(el, time, positions, 0, 1);
+            grid.build(positions, reach);
+
+            // closest distance of the linearised relative motion within half a step of the sample
+            auto test = [&](size_t i, size_t j) {
+                double dx = positions.x[i] - positions.x[j];
+                double dy = positions.y[i] - positions.y[j];
+                double dz = positions.z[i] - positions.z[j];
+                double ux = positions.vx[i] - positions.vx[j];
+                double uy = positions.vy[i] - positions.vy[j];
+                double uz = positions.vz[i] - positions.vz[j];
+                double speed2 = ux * ux + uy * uy + uz * uz;
+                double t = speed2 > 0.0 ? -(dx * ux + dy * uy + dz * uz) / speed2 : 0.0;
+                t = std::max(-half, std::min(half, t));
+                dx += ux * t, dy += uy * t, dz += uz * t;
+                if (dx * dx + dy * dy + dz * dz < margin * margin) found.push_back({(uint32_t) i, (uint32_t) j, k});
+            };
+            if (target != NO_TARGET) {
+                grid.neighbours(target, [&](size_t j) { if (j != target) test(target, j); });
+            } else {
+                for (size_t i = 0; i < el.count(); i++) {
+                    grid.forwardNeighbours(i, [&](size_t j) {
+                        if (grid.cellX[j] != grid.cellX[i] || grid.cellY[j] != grid.cellY[i] ||
+                            grid.cellZ[j] != grid.cellZ[i]) test(std::min(i, j), std::max(i, j));
+                        else if (j > i) test(i, j);
+                    });
+                }
+            }
+        }
+        std::lock_guard<std::mutex> lock(candidatesMutex);
+        candidates.insert(candidates.end(), found.begin(), found.end());
+    }, threads);
+
+    // consecutive samples of the same pair belong to one encounter
+    std::sort(candidates.begin(), candidates.end(), [](const Candidate &a, const Candidate &b) {
+        if (a.first != b.first) return a.first < b.first;
+        if (a.second != b.second) return a.second < b.second;
+        return a.sample < b.sample;
+    });
+    std::vector<std::pair<Candidate, size_t>> encounters; // first sample and last sample of each encounter
+    for (const Candidate &c: candidates) {
+        if (!encounters.empty() && encounters.back().first.first == c.first &&
+            encounters.back().first.second == c.second && c.sample <= encounters.back().second + 1)
+            encounters.back().second = c.sample;
+        else
+            encounters.push_back({c, c.sample});
+    }
+
+    // refine each encounter with a minimum-distance search around its samples
+    std::vector<CloseApproach> events;
+    std::mutex eventsMutex;
+    parallelFor(encounters.size(), [&](size_t first, size_t last, unsigned int) {
+        std::vector<CloseApproach> refined;
+        for (size_t k = first; k < last; k++) {
+            const Candidate &c = encounters[k].first;
+            double low = std::max(start, start + ((double) c.sample - 0.5) * step);
+            double high = std::min(end, start + ((double) encounters[k].second + 0.5) * step);
+            double time, distance;
+            minimumDistance(el, c.first, c.second, low, high, time, distance);
+            if (distance < threshold) refined.push_back({c.first, c.second, time, distance});
+        }
+        std::lock_guard<std::mutex> lock(eventsMutex);
+        events.insert(events.end(), refined.begin(), refined.end());
+    }, threads);
+
+    std::sort(events.begin(), events.end(), [](const CloseApproach &a, const CloseApproach &b) {
+        return a.time < b.time;
+    });
+    return events;
+}
+
+#endif
@@ -0,0 +1,103 @@
+#ifndef COMET_TAIL_H
+#define COMET_TAIL_H
+
+#include <glad/glad.h>
+
+#include <glm/glm.hpp>
+
+#include <vector>
+
+#include "orbit.h"
+
+// Dust and ion tails of comets as particles that live entirely on the GPU.
+//
+// Particles are kept in two vertex buffers used as ping-pong: every frame a vertex only program (see
+// cometUpdateVertex.glsl) reads one buffer and writes the next state of every particle into the other with
+// transform feedback, with the rasterizer disabled. Particles are emitted at the nucleus and pushed away from the
+// sun by radiation pressure (inverse square, strong for ions and weak for dust); each one is respawned when its
+// lifetime runs out, so the buffers never change size and the CPU only issues the feedback pass and the draw.
+//
+// Each particle is two vec4: position and birth time (scene time), velocity and lifetime.
+
+const int COMET_MAX = 4; ///< comets sharing one particle system (NOTE: keep in sync with cometUpdateVertex.glsl)
+
+class CometTail {
+public:
+    unsigned int VAO[2] = {0, 0};
+    unsigned int VBO[2] = {0, 0};
+    GLsizei count = 0;
+
+    // allocates both buffers; every particle starts dead, so the first update spawns it at its nucleus
+    void create(GLsizei particles) {
+        count = particles;
+        std::vector<glm::vec4> data(2 * (size_t) particles, glm::vec4(0.0f, 0.0f, 0.0f, 1.0f));
+        for (GLsizei i = 0; i < particles; i++) data[2 * i].w = -1e30f; // birth time that never matches
+
+        glGenVertexArrays(2, VAO);
+        glGenBuffers(2, VBO);
+        for (int k = 0; k < 2; k++) {
+            glBindVertexArray(VAO[k]);
+            glBindBuffer(GL_ARRAY_BUFFER, VBO[k]);
+            glBufferData(GL_ARRAY_BUFFER, (GLsizeiptr) (data.size() * sizeof(glm::vec4)), data.data(),
+                         GL_DYNAMIC_COPY);
+
+            // position and birth time, velocity and lifetime
+            glVertexAttribPointer(0, 4, GL_FLOAT, GL_FALSE, 2 * sizeof(glm::vec4), (void *) nullptr);
+            glEnableVertexAttribArray(0);
+            glVertexAttribPointer(1, 4, GL_FLOAT, GL_FALSE, 2 * sizeof(glm::vec4), (void *) sizeof(glm::vec4));
+            glEnableVertexAttribArray(1);
+        }
+        glBindVertexArray(0);
+        glBindBuffer(GL_ARRAY_BUFFER, 0);
+    }
+
+    // advances every particle by one step (update shader must already be in use with its uniforms set)
+    void update() {
+        glEnable(GL_RASTERIZER_DISCARD);
+        glBindVertexArray(VAO[current]);
+        glBindBufferBase(GL_TRANSFORM_FEEDBACK_BUFFER, 0, VBO[1 - current]);
+        glBeginTransformFeedback(GL_POINTS);
+        glDrawArrays(GL_POINTS, 0, count);
+        glEndTransformFeedback();
+        glBindBufferBase(GL_TRANSFORM_FEEDBACK_BUFFER, 0, 0);
+        glBindVertexArray(0);
+        glDisable(GL_RASTERIZER_DISCARD);
+        current = 1 - current;
+    }
+
+    // draws the latest state as additive point sprites (shader must already be in use)
+    void draw() const {
+        glEnable(GL_PROGRAM_POINT_SIZE);
+        glDepthMask(GL_FALSE); // the tails are translucent and never hide each other
+        glBlendFunc(GL_SRC_ALPHA, GL_ONE);
+        glBindVertexArray(VAO[current]);
+        glDrawArrays(GL_POINTS, 0, count);
+        glBindVertexArray(0);
+        glBlendFunc(GL_SRC_ALPHA, GL_ONE_MINUS_SRC_ALPHA);
+        glDepthMask(GL_TRUE);
+        glDisable(GL_PROGRAM_POINT_SIZE);
+    }
+
+    void release() {
+        glDeleteVertexArrays(2, VAO);
+        glDeleteBuffers(2, VBO);
+        VAO[0] = VAO[1] = VBO[0] = VBO[1] = 0;
+        count = 0;
+    }
+
+private:
+    int current = 0; // buffer holding the latest state
+};
+
+// names of the comets appended by addPeriodicComets
+const char *const COMET_NAMES[] = {"2P/Encke", "1P/Halley"};
+
+// appends the periodic comets shown by the scene (J2000 ecliptic elements, mean anomaly at J2000)
+// see more at: https://ssd.jpl.nasa.gov/tools/sbdb_lookup.html
+inline void addPeriodicComets(OrbitalElements &elements) {
+    const float deg = (float) (ORBIT_PI / 180.0);
+    elements.add(2.215f, 0.8483f, 11.78f * deg, 334.57f * deg, 186.54f * deg, 284.7f * deg); // 2P/Encke
+    elements.add(17.83f, 0.9671f, 162.26f * deg, 58.42f * deg, 111.33f * deg, 66.4f * deg); // 1P/Halley
+}
+
+#endif
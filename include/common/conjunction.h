@@ -0,0 +1,252 @@
+#ifndef CONJUNCTION_H
+#define CONJUNCTION_H
+
+#include <algorithm>
+#include <cmath>
+#include <cstdint>
+#include <mutex>
+#include <vector>
+
+#include "close_approach.h"
+#include "parallel.h"
+#include "sgp4.h"
+
+// Conjunction screening of an earth satellite catalog over a time window:
+// 1. apogee/perigee filter: satellites whose altitude band (over the whole window) overlaps no other band are
+//    dropped, and pairs with disjoint bands are skipped later on
+// 2. positions and velocities are sampled at fixed steps (batch SGP4); around each sample every satellite gets the
+//    axis-aligned box swept by its straight-line motion within half a step, padded by the threshold and the
+//    gravitational curvature of the path
+// 3. sweep-and-prune along x (the order from the previous sample is insertion-sorted, which is almost linear since
+//    satellites barely move between samples) yields the pairs whose boxes overlap on all three axes; they are kept
+//    when their linearised relative motion comes within the padded threshold
+// 4. consecutive samples of a pair are merged into one encounter whose time of closest approach (TCA) is refined
+//    with a Brent minimisation of the distance given by the scalar reference propagator
+// Samples are split into contiguous blocks per worker: the memory used is a few arrays per satellite and worker
+// plus the candidate pairs, whatever the length of the window.
+
+const double CONJUNCTION_BAND_MARGIN = 30.0; ///< km added to the altitude bands for short period terms
+const double EARTH_MU = 398600.8; ///< km^3/s^2 (WGS-72)
+
+// One predicted conjunction between two satellites
+struct SatelliteConjunction {
+    size_t first; ///< index of the first satellite (the lower index)
+    size_t second; ///< index of the second satellite
+    double time; ///< time of closest approach (days since J2000)
+    double distance; ///< miss distance (km)
+    double speed; ///< relative speed at the time of closest approach (km/s)
+};
+
+// distance (km) between two satellites at the given time (days since J2000), infinite if either has decayed
+inline double satelliteDistance(const Sgp4Batch &batch, size_t a, size_t b, double days) {
+    double pa[3], pb[3], velocity[3];
+    if (!sgp4Reference(batch, a, days, pa, velocity) || !sgp4Reference(batch, b, days, pb, velocity))
+        return HUGE_VAL;
+    return std::sqrt((pa[0] - pb[0]) * (pa[0] - pb[0]) + (pa[1] - pb[1]) * (pa[1] - pb[1]) +
+                     (pa[2] - pb[2]) * (pa[2] - pb[2]));
+}
+
+// radius band (km) a satellite can reach within [first, last] (days since J2000): perigee and apogee of the mean
+// orbit at both ends of the window (the semi-major axis only decays), widened by CONJUNCTION_BAND_MARGIN
+inline void satelliteBand(const Sgp4Batch &b, size_t i, double first, double last, double &low, double &high) {
+    double e = b[SGP4_ECCO][i];
+    low = HUGE_VAL;
+    high = 0.0;
+    for (double days: {first, last}) {
+        double t = (days - b[SGP4_EPOCH][i]) * 1440.0;
+        double tempa = 1.0 - b[SGP4_CC1][i] * t - b[SGP4_D2][i] * t * t - b[SGP4_D3][i] * t * t * t -
+                       b[SGP4_D4][i] * t * t * t * t;
+        double a = b[SGP4_AO][i] * tempa * tempa * SGP4_EARTH_RADIUS;
+        double tempe = b[SGP4_BSTAR][i] * b[SGP4_CC4][i] * t;
+        double em = std::min(std::max(e - tempe, 0.0), 0.999);
+        low = std::min(low, a * (1.0 - em));
+        high = std::max(high, a * (1.0 + em));
+    }
+    low -= CONJUNCTION_BAND_MARGIN;
+    high += CONJUNCTION_BAND_MARGIN;
+}
+
+// finds every pair of satellites closer than threshold (km) in [start, start + days] (days since J2000)
+// step: sampling interval in seconds; returned conjunctions are sorted by time, one per pair and encounter
+inline std::vector<SatelliteConjunction> screenConjunctions(const Sgp4Batch &batch, double start, double days,
+                                                            double threshold, double step = 30.0,
+                                                            unsigned int threads = 0) {
+    double end = start + days;
+    double stepDays = step / 86400.0;
+    size_t steps = (size_t) std::ceil(days / stepDays) + 1;
+
+    // 1. apogee/perigee filter
+    std::vector<double> low(batch.count()), high(batch.count());
+    std::vector<uint32_t> byPerigee;
+    for (size_t i = 0; i < batch.count(); i++) {
+        satelliteBand(batch, i, start, end, low[i], high[i]);
+        if (high[i] > SGP4_EARTH_RADIUS) byPerigee.push_back((uint32_t) i); // decayed before the window
+    }
+    std::sort(byPerigee.begin(), byPerigee.end(), [&](uint32_t a, uint32_t b) { return low[a] < low[b]; });
+    // a band is kept when it overlaps the highest apogee below it or the next perigee above it
+    std::vector<bool> screened(batch.count(), false);
+    double reach = -HUGE_VAL; // highest apogee among the bands sorted before
+    for (size_t k = 0; k < byPerigee.size(); k++) {
+        uint32_t i = byPerigee[k];
+        bool below = low[i] - threshold <= reach;
+        bool above = k + 1 < byPerigee.size() && low[byPerigee[k + 1]] - threshold <= high[i];
+        screened[i] = below || above;
+        reach = std::max(reach, high[i]);
+    }
+    std::vector<uint32_t> bodies;
+    double perigee = HUGE_VAL;
+    for (size_t i = 0; i < batch.count(); i++) {
+        if (!screened[i]) continue;
+        bodies.push_back((uint32_t) i);
+        perigee = std::min(perigee, std::max(low[i], SGP4_EARTH_RADIUS));
+    }
+    if (bodies.size() < 2) return {};
+
+    // how far two satellites can drift from straight-line motion within half a step
+    double half = 0.5 * step;
+    double margin = threshold + EARTH_MU / (perigee * perigee) * half * half;
+
+    struct Candidate {
+        uint32_t first, second;
+        size_t sample;
+    };
+    struct Box { // gathered in sweep order so the inner loop reads memory sequentially
+        float minX, maxX, minY, maxY, minZ, maxZ;
+    };
+    std::vector<Candidate> candidates;
+    std::mutex candidatesMutex;
+
+    // coefficients of the screened satellites only, so every sample propagates just them (position m of the states
+    // is the satellite bodies[m])
+    Sgp4Batch screenedBatch;
+    screenedBatch.resize(bodies.size());
+    for (size_t m = 0; m < bodies.size(); m++) {
+        for (int f = 0; f < SGP4_FIELD_COUNT; f++) screenedBatch.field[f][m] = batch.field[f][bodies[m]];
+        screenedBatch.simple[m] = batch.simple[bodies[m]];
+        screenedBatch.deepSpace[m] = batch.deepSpace[bodies[m]];
+    }
+
+    // 2-3. sampled sweep-and-prune: the time samples are split in one block per core, each block propagating and
+    // sweeping its samples on its own worker (so the propagation of a sample runs on that worker alone)
+    parallelFor(steps, [&](size_t first, size_t last, unsigned int) {
+        StateVectors states;
+        std::vector<uint32_t> order(bodies.size()); // positions in bodies, sorted by the lower x bound
+        for (size_t k = 0; k < order.size(); k++) order[k] = (uint32_t) k;
+        std::vector<double> minX(bodies.size()), maxX(bodies.size()), minY(bodies.size()), maxY(bodies.size());
+        std::vector<double> minZ(bodies.size()), maxZ(bodies.size());
+        std::vector<Box> sorted(bodies.size());
+        std::vector<Candidate> found;
+
+        for (size_t k = first; k < last; k++) {
+            double time = std::min(start + (double) k * stepDays, end);
+            propagateSatellites(screenedBatch, time, states, 0, 1);
+
+            // boxes swept by the straight-line motion within half a step
+            double pad = 0.5 * margin;
+            for (size_t m = 0; m < bodies.size(); m++) {
+                double x0 = states.x[m] - states.vx[m] * half, x1 = states.x[m] + states.vx[m] * half;
+                double y0 = states.y[m] - states.vy[m] * half, y1 = states.y[m] + states.vy[m] * half;
+                double z0 = states.z[m] - states.vz[m] * half, z1 = states.z[m] + states.vz[m] * half;
+                minX[m] = std::min(x0, x1) - pad, maxX[m] = std::max(x0, x1) + pad;
+                minY[m] = std::min(y0, y1) - pad, maxY[m] = std::max(y0, y1) + pad;
+                minZ[m] = std::min(z0, z1) - pad, maxZ[m] = std::max(z0, z1) + pad;
+                if (!(minX[m] <= maxX[m])) minX[m] = HUGE_VAL, maxX[m] = -HUGE_VAL; // NaN once decayed: never overlaps
+            }
+
+            // insertion sort of the previous order (a full sort for the first sample of the block)
+            if (k == first) {
+                std::sort(order.begin(), order.end(), [&](uint32_t a, uint32_t b) { return minX[a] < minX[b]; });
+            }
+            for (size_t m = 1; m < order.size(); m++) {
+                uint32_t value = order[m];
+                size_t n = m;
+                while (n > 0 && minX[order[n - 1]] > minX[value]) {
+                    order[n] = order[n - 1];
+                    n--;
+                }
+                order[n] = value;
+            }
+            for (size_t m = 0; m < order.size(); m++) {
+                uint32_t p = order[m];
+                sorted[m] = {(float) minX[p], (float) maxX[p], (float) minY[p], (float) maxY[p], (float) minZ[p],
+                             (float) maxZ[p]};
+            }
+
+            // sweep: every box is compared with the following ones until they start after it ends
+            for (size_t m = 0; m < order.size(); m++) {
+                const Box &a = sorted[m];
+                for (size_t n = m + 1; n < order.size() && sorted[n].minX <= a.maxX; n++) {
+                    const Box &b = sorted[n];
+                    if (b.minY > a.maxY || a.minY > b.maxY || b.minZ > a.maxZ || a.minZ > b.maxZ) continue;
+                    uint32_t p = order[m], q = order[n];
+                    uint32_t i = bodies[p], j = bodies[q];
+                    if (low[j] > high[i] + threshold || low[i] > high[j] + threshold) continue;
+
+                    // closest distance of the linearised relative motion within half a step of the sample
+                    double dx = states.x[p] - states.x[q], dy = states.y[p] - states.y[q];
+                    double dz = states.z[p] - states.z[q];
+                    double ux = states.vx[p] - states.vx[q], uy = states.vy[p] - states.vy[q];
+                    double uz = states.vz[p] - states.vz[q];
+                    double speed2 = ux * ux + uy * uy + uz * uz;
+                    double t = speed2 > 0.0 ? -(dx * ux + dy * uy + dz * uz) / speed2 : 0.0;
+                    t = std::max(-half, std::min(half, t));
+                    dx += ux * t, dy += uy * t, dz += uz * t;
+                    if (dx * dx + dy * dy + dz * dz < margin * margin) {
+                        found.push_back({std::min(i, j), std::max(i, j), k});
+                    }
+                }
+            }
+        }
+        std::lock_guard<std::mutex> lock(candidatesMutex);
+        candidates.insert(candidates.end(), found.begin(), found.end());
+    }, threads);
+
+    // 4. consecutive samples of the same pair belong to one encounter
+    std::sort(candidates.begin(), candidates.end(), [](const Candidate &a, const Candidate &b) {
+        if (a.first != b.first) return a.first < b.first;
+        if (a.second != b.second) return a.second < b.second;
+        return a.sample < b.sample;
+    });
+    std::vector<std::pair<Candidate, size_t>> encounters; // first sample and last sample of each encounter
+    for (const Candidate &c: candidates) {
+        if (!encounters.empty() && encounters.back().first.first == c.first &&
+            encounters.back().first.second == c.second && c.sample <= encounters.back().second + 1)
+            encounters.back().second = c.sample;
+        else
+            encounters.push_back({c, c.sample});
+    }
+
+    // time of closest approach of each encounter (searched in seconds from the window start for precision)
+    std::vector<SatelliteConjunction> conjunctions;
+    std::mutex conjunctionsMutex;
+    parallelFor(encounters.size(), [&](size_t first, size_t last, unsigned int) {
+        std::vector<SatelliteConjunction> refined;
+        for (size_t k = first; k < last; k++) {
+            const Candidate &c = encounters[k].first;
+            double lowTime = std::max(0.0, ((double) c.sample - 0.5) * step);
+            double highTime = std::min(days * 86400.0, ((double) encounters[k].second + 0.5) * step);
+            double seconds, distance;
+            brentMinimum([&](double s) { return satelliteDistance(batch, c.first, c.second, start + s / 86400.0); },
+                         lowTime, highTime, seconds, distance, 1e-10);
+            if (distance >= threshold) continue;
+
+            double time = start + seconds / 86400.0;
+            double pa[3], pb[3], va[3], vb[3];
+            sgp4Reference(batch, c.first, time, pa, va);
+            sgp4Reference(batch, c.second, time, pb, vb);
+            double speed = std::sqrt((va[0] - vb[0]) * (va[0] - vb[0]) + (va[1] - vb[1]) * (va[1] - vb[1]) +
+                                     (va[2] - vb[2]) * (va[2] - vb[2]));
+            refined.push_back({c.first, c.second, time, distance, speed});
+        }
+        std::lock_guard<std::mutex> lock(conjunctionsMutex);
+        conjunctions.insert(conjunctions.end(), refined.begin(), refined.end());
+    }, threads);
+
+    std::sort(conjunctions.begin(), conjunctions.end(), [](const SatelliteConjunction &a,
+                                                           const SatelliteConjunction &b) {
+        return a.time < b.time;
+    });
+    return conjunctions;
+}
+
+#endif
@@ -0,0 +1,107 @@
+#ifndef CUBEMAP_LOADER_H
+#define CUBEMAP_LOADER_H
+
+#include <glad/glad.h>
+
+#include <chrono>
+#include <future>
+#include <iostream>
+
+#ifndef STBI_INCLUDE_STB_IMAGE_H // the implementation part of stb_image.h cannot be included twice
+#include "stb_image.h"
+#endif
+
+// Cubemaps decoded on a background thread.
+//
+// Decoding the six faces of a 4096 x 4096 skybox takes seconds, which froze the window every time the skybox was
+// switched. CubeMapLoader decodes the faces with std::async and uploads them on the first frame they are ready;
+// meanwhile the caller draws a fallback (the low resolution nebula). A skybox that is no longer shown is deleted,
+// since a 4096 x 4096 cubemap takes about 400 MB. A decode that finishes after the skybox was switched away is
+// discarded.
+// see more at: https://learnopengl.com/Advanced-OpenGL/Cubemaps
+
+/// decoded faces of a cubemap (+x, -x, +y, -y, +z, -z)
+struct CubeMapFaces {
+    int width[6] = {};
+    int height[6] = {};
+    int channels[6] = {};
+    unsigned char *data[6] = {};
+};
+
+// decodes the six faces (any thread; a face that fails to load is left null)
+inline CubeMapFaces decodeCubeMap(const char *const *paths) {
+    CubeMapFaces faces;
+    stbi_set_flip_vertically_on_load_thread(true);
+    for (int i = 0; i < 6; i++) {
+        faces.data[i] = stbi_load(paths[i], &faces.width[i], &faces.height[i], &faces.channels[i], 0);
+        if (faces.data[i] == nullptr) std::cerr << "CubeMap texture failed to load at path: " << paths[i] << std::endl;
+    }
+    return faces;
+}
+
+// frees the pixels of decoded faces
+inline void freeCubeMap(CubeMapFaces &faces) {
+    for (unsigned char *&data: faces.data) {
+        stbi_image_free(data);
+        data = nullptr;
+    }
+}
+
+// creates the cubemap texture of decoded faces (GL thread)
+inline unsigned int uploadCubeMap(const CubeMapFaces &faces) {
+    unsigned int textureID;
+    glGenTextures(1, &textureID);
+    glBindTexture(GL_TEXTURE_CUBE_MAP, textureID);
+    for (unsigned int i = 0; i < 6; i++) {
+        if (faces.data[i] == nullptr) continue;
+        GLint format = GL_RGB; // JPG image requires GL_RGB
+        if (faces.channels[i] == 1) format = GL_RED;
+        else if (faces.channels[i] == 4) format = GL_RGBA; // PNG image requires GL_RGBA
+        glTexImage2D(GL_TEXTURE_CUBE_MAP_POSITIVE_X + i, 0, format, faces.width[i], faces.height[i], 0, format,
+                     GL_UNSIGNED_BYTE, faces.data[i]);
+    }
+    glTexParameteri(GL_TEXTURE_CUBE_MAP, GL_TEXTURE_MIN_FILTER, GL_LINEAR);
+    glTexParameteri(GL_TEXTURE_CUBE_MAP, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
+    glTexParameteri(GL_TEXTURE_CUBE_MAP, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_EDGE);
+    glTexParameteri(GL_TEXTURE_CUBE_MAP, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_EDGE);
+    glTexParameteri(GL_TEXTURE_CUBE_MAP, GL_TEXTURE_WRAP_R, GL_CLAMP_TO_EDGE);
+    return textureID;
+}
+
+class CubeMapLoader {
+public:
+    unsigned int ID = 0; ///< cubemap texture, 0 until it is uploaded
+
+    explicit CubeMapLoader(const char *const *facePaths) : paths(facePaths) {}
+
+    // loads the cubemap while it is wanted and deletes it otherwise; with wait, blocks until it is uploaded (video
+    // frames and poster tiles must not show the fallback)
+    void update(bool wanted, bool wait) {
+        if (!wanted && ID != 0) {
+            glDeleteTextures(1, &ID);
+            ID = 0;
+        }
+        if (wanted && ID == 0 && !decoding.valid()) decoding = std::async(std::launch::async, decodeCubeMap, paths);
+        if (!decoding.valid()) return;
+        if (!(wanted && wait) && decoding.wait_for(std::chrono::seconds(0)) != std::future_status::ready) return;
+
+        CubeMapFaces faces = decoding.get();
+        if (wanted) ID = uploadCubeMap(faces);
+        freeCubeMap(faces);
+    }
+
+    void release() {
+        if (decoding.valid()) {
+            CubeMapFaces faces = decoding.get();
+            freeCubeMap(faces);
+        }
+        glDeleteTextures(1, &ID);
+        ID = 0;
+    }
+
+private:
+    const char *const *paths;
+    std::future<CubeMapFaces> decoding;
+};
+
+#endif
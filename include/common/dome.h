@@ -0,0 +1,139 @@
+#ifndef DOME_H
+#define DOME_H
+
+#include <glad/glad.h>
+
+#include <glm/glm.hpp>
+#include <glm/gtc/matrix_transform.hpp>
+
+#include <cmath>
+
+// Fulldome output: the scene is rendered into a cube map around the camera and warped into a square fisheye image
+// (the "dome master" of planetarium projectors, equidistant: the distance from the center of the image is the angle
+// from the camera's forward direction, the rim is the horizon of the dome).
+//
+// The faces are layers of one framebuffer, so each object is drawn once: a geometry shader (dome*Geometry.glsl)
+// copies every primitive into the faces it covers, setting gl_Layer and applying the face's projection and view.
+// Objects are submitted in the camera's view space (projection set to the identity), so the faces are the same
+// every frame. A sphere is only sent to the faces it may cover (domeFaceMask) and each copy of a primitive outside
+// the side planes of its face is dropped, so a planet usually reaches one face. The warp is one full-screen pass
+// that samples the cube map at the direction of each pixel and composites the skybox behind the scene.
+// see more at: https://paulbourke.net/dome/fisheye/
+// and at: https://learnopengl.com/Advanced-Lighting/Shadows/Point-Shadows
+
+const int DOME_FACE_SIZE = 2048; ///< pixels of a cube face (enough for a 4096x4096 dome master)
+const float DOME_APERTURE = 180.0f; ///< field of view of the dome master (degrees, at most 180)
+const int DOME_BEHIND_FACE = 4; ///< layer of the face behind the camera (+Z), never seen with a dome of 180 degrees
+const int DOME_ALL_FACES = 0x3f & ~(1 << DOME_BEHIND_FACE); ///< mask of every face seen
+
+// forward and up directions of each face in view space, in the order of the cube map layers (+X, -X, +Y, -Y, +Z,
+// -Z), with the orientation expected by cube map sampling
+const glm::vec3 DOME_FACE_FORWARD[6] = {glm::vec3(1.0f, 0.0f, 0.0f), glm::vec3(-1.0f, 0.0f, 0.0f),
+                                        glm::vec3(0.0f, 1.0f, 0.0f), glm::vec3(0.0f, -1.0f, 0.0f),
+                                        glm::vec3(0.0f, 0.0f, 1.0f), glm::vec3(0.0f, 0.0f, -1.0f)};
+const glm::vec3 DOME_FACE_UP[6] = {glm::vec3(0.0f, -1.0f, 0.0f), glm::vec3(0.0f, -1.0f, 0.0f),
+                                   glm::vec3(0.0f, 0.0f, 1.0f), glm::vec3(0.0f, 0.0f, -1.0f),
+                                   glm::vec3(0.0f, -1.0f, 0.0f), glm::vec3(0.0f, -1.0f, 0.0f)};
+
+// projection * view of each face from the camera's view space (faceProjection has a field of view of 90 degrees)
+inline void domeFaceMatrices(const glm::mat4 &faceProjection, glm::mat4 matrices[6]) {
+    for (int face = 0; face < 6; face++) {
+        matrices[face] = faceProjection * glm::lookAt(glm::vec3(0.0f), DOME_FACE_FORWARD[face], DOME_FACE_UP[face]);
+    }
+}
+
+// faces that a sphere (center in view space) may cover: it must be inside the four side planes of a face
+inline int domeFaceMask(glm::vec3 center, float radius) {
+    const float inverseSqrt2 = 0.70710678f;
+    int mask = 0;
+    for (int face = 0; face < 6; face++) {
+        if (face == DOME_BEHIND_FACE) continue;
+        glm::vec3 forward = DOME_FACE_FORWARD[face], up = DOME_FACE_UP[face];
+        glm::vec3 side = glm::cross(forward, up);
+        float f = glm::dot(center, forward), s = glm::dot(center, side), u = glm::dot(center, up);
+        // distances to the planes through the camera with normals (forward -+ side) / sqrt(2) and the same with up
+        float limit = -radius / inverseSqrt2;
+        if (f - s >= limit && f + s >= limit && f - u >= limit && f + u >= limit) mask |= 1 << face;
+    }
+    return mask;
+}
+
+// cube map target of the dome faces (color and depth layered) and the warp into the dome master
+class DomeTarget {
+public:
+    unsigned int FBO = 0;
+    unsigned int colorCube = 0;
+    int size = 0;
+
+    // creates the cube maps of the faces, returns false if the framebuffer is incomplete
+    bool create(int faceSize) {
+        size = faceSize;
+        glGenTextures(1, &colorCube);
+        glBindTexture(GL_TEXTURE_CUBE_MAP, colorCube);
+        for (int face = 0; face < 6; face++) {
+            glTexImage2D(GL_TEXTURE_CUBE_MAP_POSITIVE_X + face, 0, GL_RGBA8, size, size, 0, GL_RGBA, GL_UNSIGNED_BYTE,
+                         nullptr);
+        }
+        setCubeParameters(GL_LINEAR);
+        glGenTextures(1, &depthCube);
+        glBindTexture(GL_TEXTURE_CUBE_MAP, depthCube);
+        for (int face = 0; face < 6; face++) {
+            glTexImage2D(GL_TEXTURE_CUBE_MAP_POSITIVE_X + face, 0, GL_DEPTH_COMPONENT32F, size, size, 0,
+                         GL_DEPTH_COMPONENT, GL_FLOAT, nullptr);
+        }
+        setCubeParameters(GL_NEAREST);
+        glBindTexture(GL_TEXTURE_CUBE_MAP, 0);
+        glEnable(GL_TEXTURE_CUBE_MAP_SEAMLESS); // no seams between the faces in the warp
+
+        // every face is a layer of the same framebuffer (selected by gl_Layer)
+        glGenFramebuffers(1, &FBO);
+        glBindFramebuffer(GL_FRAMEBUFFER, FBO);
+        glFramebufferTexture(GL_FRAMEBUFFER, GL_COLOR_ATTACHMENT0, colorCube, 0);
+        glFramebufferTexture(GL_FRAMEBUFFER, GL_DEPTH_ATTACHMENT, depthCube, 0);
+        bool complete = glCheckFramebufferStatus(GL_FRAMEBUFFER) == GL_FRAMEBUFFER_COMPLETE;
+        glBindFramebuffer(GL_FRAMEBUFFER, 0);
+
+        glGenVertexArrays(1, &warpVAO); // the warp's triangle has no attributes
+        return complete;
+    }
+
+    // redirects rendering into every face and clears them (alpha 0 where nothing is drawn, for the skybox)
+    void bind() const {
+        glBindFramebuffer(GL_FRAMEBUFFER, FBO);
+        glViewport(0, 0, size, size);
+        glClearColor(0.0f, 0.0f, 0.0f, 0.0f);
+        glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT);
+    }
+
+    // draws the dome master over the current viewport (warp shader must already be in use, the scene on unit 0)
+    void drawWarp() const {
+        glActiveTexture(GL_TEXTURE0);
+        glBindTexture(GL_TEXTURE_CUBE_MAP, colorCube);
+        glBindVertexArray(warpVAO);
+        glDrawArrays(GL_TRIANGLES, 0, 3);
+        glBindVertexArray(0);
+    }
+
+    void release() {
+        glDeleteFramebuffers(1, &FBO);
+        glDeleteTextures(1, &colorCube);
+        glDeleteTextures(1, &depthCube);
+        glDeleteVertexArrays(1, &warpVAO);
+        FBO = colorCube = depthCube = warpVAO = 0;
+        size = 0;
+    }
+
+private:
+    unsigned int depthCube = 0;
+    unsigned int warpVAO = 0;
+
+    static void setCubeParameters(GLint filter) {
+        glTexParameteri(GL_TEXTURE_CUBE_MAP, GL_TEXTURE_MIN_FILTER, filter);
+        glTexParameteri(GL_TEXTURE_CUBE_MAP, GL_TEXTURE_MAG_FILTER, filter);
+        glTexParameteri(GL_TEXTURE_CUBE_MAP, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_EDGE);
+        glTexParameteri(GL_TEXTURE_CUBE_MAP, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_EDGE);
+        glTexParameteri(GL_TEXTURE_CUBE_MAP, GL_TEXTURE_WRAP_R, GL_CLAMP_TO_EDGE);
+    }
+};
+
+#endif
@@ -0,0 +1,96 @@
+#ifndef ECLIPSE_H
+#define ECLIPSE_H
+
+#include <glad/glad.h>
+
+#include <glm/glm.hpp>
+
+#include <cmath>
+#include <vector>
+
+// Eclipses without shadow maps: every body is a sphere lit by a spherical sun, so the part of the sun's disc that
+// an occluder hides from a point has a closed form (two discs of known angular radii and separation).
+// planetFragment.glsl evaluates it for a few occluders per fragment, with a smooth penumbra between full overlap
+// and no overlap, and scales the direct light by the visible part of the disc.
+//
+// The occluders are uploaded once per frame into a uniform block: only the bodies that may shadow another one this
+// frame, so usually none or two (the earth and the moon around an eclipse). Each receiver gets a mask of the
+// occluders whose penumbra cone may reach it, so the shader skips the others with a uniform branch.
+// see more at: https://en.wikipedia.org/wiki/Circular_segment (overlap of two discs)
+
+const int MAX_OCCLUDERS = 8; ///< occluders per frame (same as planetFragment.glsl)
+const unsigned int OCCLUDER_BINDING = 0; ///< uniform buffer binding point of the Occluders block
+
+class EclipseOccluders {
+public:
+    unsigned int UBO = 0;
+
+    void create() {
+        glGenBuffers(1, &UBO);
+        glBindBuffer(GL_UNIFORM_BUFFER, UBO);
+        glBufferData(GL_UNIFORM_BUFFER, MAX_OCCLUDERS * sizeof(glm::vec4), nullptr, GL_DYNAMIC_DRAW);
+        glBindBuffer(GL_UNIFORM_BUFFER, 0);
+        glBindBufferBase(GL_UNIFORM_BUFFER, OCCLUDER_BINDING, UBO);
+    }
+
+    // links the Occluders block of a shader program to the buffer
+    static void bindBlock(unsigned int program) {
+        unsigned int index = glGetUniformBlockIndex(program, "Occluders");
+        if (index != GL_INVALID_INDEX) glUniformBlockBinding(program, index, OCCLUDER_BINDING);
+    }
+
+    // selects the bodies (center and radius, all in the same frame) that may shadow one another from the light and
+    // uploads them; mask(i) is then the occluders of body i
+    void update(glm::vec3 light, float lightRadius, const std::vector<glm::vec4> &bodies) {
+        masks.assign(bodies.size(), 0);
+        occluders.clear();
+        std::vector<int> slot(bodies.size(), -1); // occluder slot of each body
+        for (size_t r = 0; r < bodies.size(); r++) {
+            for (size_t o = 0; o < bodies.size(); o++) {
+                if (o == r || !reaches(light, lightRadius, bodies[o], bodies[r])) continue;
+                if (slot[o] < 0) {
+                    if (occluders.size() == (size_t) MAX_OCCLUDERS) continue;
+                    slot[o] = (int) occluders.size();
+                    occluders.push_back(bodies[o]);
+                }
+                masks[r] |= 1u << slot[o];
+            }
+        }
+        if (occluders.empty()) return;
+        glBindBuffer(GL_UNIFORM_BUFFER, UBO);
+        glBufferSubData(GL_UNIFORM_BUFFER, 0, (GLsizeiptr) (occluders.size() * sizeof(glm::vec4)), occluders.data());
+        glBindBuffer(GL_UNIFORM_BUFFER, 0);
+    }
+
+    // occluders that may shadow a body (bit i: slot i of the block)
+    int mask(size_t body) const {
+        return body < masks.size() ? (int) masks[body] : 0;
+    }
+
+    void release() {
+        glDeleteBuffers(1, &UBO);
+        UBO = 0;
+    }
+
+private:
+    std::vector<glm::vec4> occluders; // uploaded this frame
+    std::vector<unsigned int> masks; // occluders of each body
+
+    // checks if the penumbra cone of an occluder may reach a receiver: the occluder is between the light and the
+    // receiver and the receiver is close enough to the axis from the light through the occluder
+    static bool reaches(glm::vec3 light, float lightRadius, glm::vec4 occluder, glm::vec4 receiver) {
+        glm::vec3 axis = glm::vec3(occluder) - light;
+        float occluderDistance = glm::length(axis);
+        if (occluderDistance <= lightRadius + occluder.w) return false;
+        axis /= occluderDistance;
+        glm::vec3 offset = glm::vec3(receiver) - light;
+        float along = glm::dot(offset, axis); // distance of the receiver along the axis
+        if (along + receiver.w <= occluderDistance) return false; // in front of the occluder
+        float across = glm::length(offset - along * axis);
+        // the penumbra widens by (light radius + occluder radius) / occluder distance per unit behind the occluder
+        float penumbra = occluder.w + (along - occluderDistance) * (lightRadius + occluder.w) / occluderDistance;
+        return across <= penumbra + receiver.w;
+    }
+};
+
+#endif
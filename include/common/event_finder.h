@@ -0,0 +1,213 @@
+#ifndef EVENT_FINDER_H
+#define EVENT_FINDER_H
+
+#include <algorithm>
+#include <cmath>
+#include <mutex>
+#include <vector>
+
+#include "parallel.h"
+
+// Planetary event search for bodies on circular, coplanar orbits around the sun (as animated by planetCreator).
+// Every event is a root of an angular function of time (geocentric longitude differences and the derivative of
+// the elongation). Each function is sampled coarsely, every sign change is refined with Brent's method and the
+// time span is split into windows searched in parallel.
+
+const double EVENT_PI = 3.14159265358979323846;
+const int EVENT_SAMPLES_PER_PERIOD = 64; ///< coarse samples per orbital period of the fastest body
+
+// Circular orbit in the ecliptic plane: heliocentric longitude = angularSpeed * time
+struct CircularOrbit {
+    double angularSpeed; ///< radians per scene second
+    double radius; ///< orbit radius
+};
+
+enum PlanetEventType {
+    EVENT_CONJUNCTION, ///< two planets at the same geocentric longitude
+    EVENT_OPPOSITION, ///< outer planet opposite to the sun
+    EVENT_SOLAR_CONJUNCTION, ///< outer planet behind the sun
+    EVENT_INFERIOR_CONJUNCTION, ///< inner planet between the earth and the sun
+    EVENT_SUPERIOR_CONJUNCTION, ///< inner planet behind the sun
+    EVENT_GREATEST_EAST_ELONGATION, ///< inner planet furthest east of the sun (evening sky)
+    EVENT_GREATEST_WEST_ELONGATION ///< inner planet furthest west of the sun (morning sky)
+};
+
+// One event found by findPlanetEvents
+struct PlanetEvent {
+    double time; ///< scene time of the event
+    PlanetEventType type;
+    unsigned int first; ///< planet the event is about
+    unsigned int second; ///< other planet of a conjunction (same as first otherwise)
+    double angle; ///< elongation from the sun at the event (radians)
+};
+
+// wraps an angle to [-PI, PI)
+inline double wrapAngle(double angle) {
+    return angle - 2.0 * EVENT_PI * std::floor((angle + EVENT_PI) / (2.0 * EVENT_PI));
+}
+
+// Brent's method for a root of f in [a, b] where f(a) and f(b) have opposite signs
+// see more at: https://en.wikipedia.org/wiki/Brent%27s_method
+template<typename Function>
+double brentRoot(Function f, double a, double b, double fa, double fb, double tolerance = 1e-10) {
+    double c = a, fc = fa, d = b - a, e = d;
+    for (int iteration = 0; iteration < 100; iteration++) {
+        if ((fb > 0.0) == (fc > 0.0)) { // keep the root between b and c
+            c = a, fc = fa;
+            d = e = b - a;
+        }
+        if (std::fabs(fc) < std::fabs(fb)) {
+            a = b, b = c, c = a;
+            fa = fb, fb = fc, fc = fa;
+        }
+        double tol = 2.0 * 1e-16 * std::fabs(b) + 0.5 * tolerance;
+        double middle = 0.5 * (c - b);
+        if (std::fabs(middle) <= tol || fb == 0.0) return b;
+
+        if (std::fabs(e) >= tol && std::fabs(fa) > std::fabs(fb)) { // inverse quadratic interpolation or secant
+            double s = fb / fa, p, q;
+            if (a == c) {
+                p = 2.0 * middle * s;
+                q = 1.0 - s;
+            } else {
+                double r = fb / fc;
+                q = fa / fc;
+                p = s * (2.0 * middle * q * (q - r) - (b - a) * (r - 1.0));
+                q = (q - 1.0) * (r - 1.0) * (s - 1.0);
+            }
+            if (p > 0.0) q = -q;
+            else p = -p;
+            if (2.0 * p < std::min(3.0 * middle * q - std::fabs(tol * q), std::fabs(e * q))) {
+                e = d;
+                d = p / q;
+            } else { // bisection
+                d = middle;
+                e = d;
+            }
+        } else {
+            d = middle;
+            e = d;
+        }
+        a = b, fa = fb;
+        b += std::fabs(d) > tol ? d : (middle > 0.0 ? tol : -tol);
+        fb = f(b);
+    }
+    return b;
+}
+
+// Geometry of a set of circular orbits seen from one of them (the earth)
+struct PlanetarySky {
+    std::vector<CircularOrbit> orbits;
+    size_t earth;
+
+    // heliocentric position in the ecliptic plane
+    void position(size_t i, double time, double &x, double &y) const {
+        double longitude = orbits[i].angularSpeed * time;
+        x = orbits[i].radius * std::cos(longitude);
+        y = orbits[i].radius * std::sin(longitude);
+    }
+
+    // geocentric ecliptic longitude of a planet, or of the sun when i == earth
+    double longitude(size_t i, double time) const {
+        double ex, ey, px = 0.0, py = 0.0;
+        position(earth, time, ex, ey);
+        if (i != earth) position(i, time, px, py);
+        return std::atan2(py - ey, px - ex);
+    }
+
+    // signed elongation of a planet from the sun (positive east of the sun)
+    double elongation(size_t i, double time) const {
+        return wrapAngle(longitude(i, time) - longitude(earth, time));
+    }
+};
+
+// finds the roots of f in [start, end] sampled with the given step; with wrapped angles only the crossings
+// through zero are roots (jumps across +-PI are skipped)
+template<typename Function, typename Emit>
+void findRoots(Function f, double start, double end, double step, bool wrapped, Emit emit) {
+    double t0 = start, f0 = f(t0);
+    while (t0 < end) {
+        double t1 = std::min(t0 + step, end), f1 = f(t1);
+        bool crossing = (f0 < 0.0 && f1 >= 0.0) || (f0 > 0.0 && f1 <= 0.0);
+        if (crossing && (!wrapped || std::fabs(f0 - f1) < EVENT_PI)) {
+            emit(f1 == 0.0 ? t1 : brentRoot(f, t0, t1, f0, f1));
+        }
+        t0 = t1, f0 = f1;
+    }
+}
+
+// finds every event in [start, end) sorted by time
+inline std::vector<PlanetEvent> findPlanetEvents(const std::vector<CircularOrbit> &orbits, size_t earth,
+                                                 double start, double end, unsigned int threads = 0) {
+    PlanetarySky sky = {orbits, earth};
+
+    // coarse step: a fraction of the shortest period, of the earth's orbit included
+    double fastest = 0.0;
+    for (const CircularOrbit &orbit: orbits) fastest = std::max(fastest, std::fabs(orbit.angularSpeed));
+    double step = 2.0 * EVENT_PI / (fastest * EVENT_SAMPLES_PER_PERIOD);
+    double h = step * 1e-3; // derivative step for the elongation extrema
+
+    // one window per chunk of ~1000 steps (or one per worker if that is more)
+    size_t windows = std::max<size_t>(workerCount(), (size_t) ((end - start) / (step * 1000.0)) + 1);
+    double windowLength = (end - start) / (double) windows;
+
+    std::vector<PlanetEvent> events;
+    std::mutex eventsMutex;
+
+    parallelFor(windows, [&](size_t first, size_t last, unsigned int) {
+        std::vector<PlanetEvent> found;
+        for (size_t w = first; w < last; w++) {
+            double a = start + windowLength * (double) w;
+            double b = w + 1 == windows ? end : a + windowLength;
+
+            // each root is owned by the window its time falls in (half-open), so shared ends are not doubled
+            auto add = [&](double time, PlanetEventType type, size_t p, size_t q) {
+                if (time < a || time >= b) return;
+                found.push_back({time, type, (unsigned int) p, (unsigned int) q, std::fabs(sky.elongation(p, time))});
+            };
+
+            for (size_t p = 0; p < orbits.size(); p++) {
+                if (p == earth) continue;
+                bool inner = orbits[p].radius < orbits[earth].radius;
+
+                // sun events: elongation crosses 0 (conjunction) or PI (opposition)
+                findRoots([&](double t) { return sky.elongation(p, t); }, a, b, step, true, [&](double t) {
+                    // an inner planet is between the earth and the sun when it is closer to the earth than the sun is
+                    double ex, ey, px, py;
+                    sky.position(earth, t, ex, ey);
+                    sky.position(p, t, px, py);
+                    bool near = (px - ex) * (px - ex) + (py - ey) * (py - ey) < ex * ex + ey * ey;
+                    if (!inner) add(t, EVENT_SOLAR_CONJUNCTION, p, p);
+                    else add(t, near ? EVENT_INFERIOR_CONJUNCTION : EVENT_SUPERIOR_CONJUNCTION, p, p);
+                });
+                if (!inner) {
+                    findRoots([&](double t) { return wrapAngle(sky.elongation(p, t) + EVENT_PI); }, a, b, step, true,
+                              [&](double t) { add(t, EVENT_OPPOSITION, p, p); });
+                } else {
+                    // greatest elongations: the elongation stops growing (east) or shrinking (west)
+                    auto rate = [&](double t) { return wrapAngle(sky.elongation(p, t + h) - sky.elongation(p, t - h)); };
+                    findRoots(rate, a, b, step, false, [&](double t) {
+                        bool east = sky.elongation(p, t) > 0.0;
+                        add(t, east ? EVENT_GREATEST_EAST_ELONGATION : EVENT_GREATEST_WEST_ELONGATION, p, p);
+                    });
+                }
+
+                // conjunctions with the other planets
+                for (size_t q = p + 1; q < orbits.size(); q++) {
+                    if (q == earth) continue;
+                    findRoots([&](double t) { return wrapAngle(sky.longitude(p, t) - sky.longitude(q, t)); }, a, b,
+                              step, true, [&](double t) { add(t, EVENT_CONJUNCTION, p, q); });
+                }
+            }
+        }
+        std::lock_guard<std::mutex> lock(eventsMutex);
+        events.insert(events.end(), found.begin(), found.end());
+    }, threads);
+
+    std::sort(events.begin(), events.end(), [](const PlanetEvent &x, const PlanetEvent &y) {
+        return x.time < y.time;
+    });
+    return events;
+}
+
+#endif
@@ -0,0 +1,237 @@
+#ifndef HORIZON_H
+#define HORIZON_H
+
+#include <glad/glad.h>
+
+#include <glm/glm.hpp>
+
+#include <algorithm>
+#include <cmath>
+#include <cstdint>
+#include <cstring>
+#include <vector>
+
+#include "orbit.h"
+#include "parallel.h"
+#include "star_octree.h"
+
+// Sky seen by an observer standing on the earth, in horizon coordinates.
+//
+// Every direction is kept in the J2000 equatorial frame and brought to the observer's horizon by one 3x3 matrix per
+// frame, the product of three rotations:
+// - precession from J2000 to the mean equator and equinox of date (IAU 1976)
+// - the earth's rotation by the local mean sidereal time (greenwich mean sidereal time plus the longitude)
+// - the tilt of the observer's horizon by the latitude
+// The horizon frame has the scene's axes (x east, y zenith, z south), so cameras look around it unchanged.
+// Nutation, aberration, refraction and the difference between UT and TT are ignored: the sky is right to a fraction
+// of a degree, which is what a planetarium view needs.
+//
+// Stars are transformed in batch: their directions are stored as structure of arrays, so the matrix product over a
+// block of stars vectorizes, large catalogs are split over the workers, and the stars below the horizon are dropped
+// while the visible ones are packed for the vertex buffer.
+// see more at: https://en.wikipedia.org/wiki/Horizontal_coordinate_system
+
+const double EARTH_RADIUS_KM = 6378.137; ///< equatorial radius of the earth
+const double KM_PER_AU = 149597870.7;
+const size_t HORIZON_BLOCK = 256; ///< stars transformed before they are culled and packed (stays in L1 cache)
+const size_t HORIZON_STARS_PER_WORKER = 32768; ///< fewer stars per worker cost more in threads than they save
+
+// rotation from J2000 equatorial coordinates to the mean equator and equinox of date (days since J2000)
+// see more at: https://ui.adsabs.harvard.edu/abs/1977A&A....58....1L
+inline glm::dmat3 precessionMatrix(double days) {
+    double t = days / 36525.0; // julian centuries
+    const double arcsec = ORBIT_PI / 180.0 / 3600.0;
+    double zeta = ((0.017998 * t + 0.30188) * t + 2306.2181) * t * arcsec;
+    double z = ((0.018203 * t + 1.09468) * t + 2306.2181) * t * arcsec;
+    double theta = ((-0.041833 * t - 0.42665) * t + 2004.3109) * t * arcsec;
+    double cz = std::cos(zeta), sz = std::sin(zeta);
+    double cZ = std::cos(z), sZ = std::sin(z);
+    double ct = std::cos(theta), st = std::sin(theta);
+
+    // Rz(-z) * Ry(theta) * Rz(-zeta), column by column
+    return glm::dmat3(glm::dvec3(cz * ct * cZ - sz * sZ, cz * ct * sZ + sz * cZ, cz * st),
+                      glm::dvec3(-sz * ct * cZ - cz * sZ, -sz * ct * sZ + cz * cZ, -sz * st),
+                      glm::dvec3(-st * cZ, -st * sZ, ct));
+}
+
+// greenwich mean sidereal time (radians) at the given days since J2000 (UT)
+// see more at: https://aa.usno.navy.mil/faq/GAST
+inline double greenwichSiderealTime(double days) {
+    double t = days / 36525.0;
+    double degrees = 280.46061837 + 360.98564736629 * days + (0.000387933 - t / 38710000.0) * t * t;
+    double angle = std::fmod(degrees, 360.0) * ORBIT_PI / 180.0;
+    return angle < 0.0 ? angle + ORBIT_TWO_PI : angle;
+}
+
+// rotation from J2000 equatorial coordinates to the horizon (x east, y zenith, z south) of an observer at the given
+// latitude and east longitude (radians) and days since J2000
+inline glm::dmat3 horizonMatrix(double days, double latitude, double longitude) {
+    double sidereal = greenwichSiderealTime(days) + longitude;
+    double cs = std::cos(sidereal), ss = std::sin(sidereal);
+    double cl = std::cos(latitude), sl = std::sin(latitude);
+
+    // equator of date to the local meridian (x: meridian on the equator, y: east, z: north pole)
+    glm::dmat3 earthRotation(glm::dvec3(cs, -ss, 0.0), glm::dvec3(ss, cs, 0.0), glm::dvec3(0.0, 0.0, 1.0));
+
+    // meridian to horizon: east, zenith and south are the rows of this matrix (given column by column)
+    glm::dmat3 horizon(glm::dvec3(0.0, cl, sl), glm::dvec3(1.0, 0.0, 0.0), glm::dvec3(0.0, sl, -cl));
+    return horizon * earthRotation * precessionMatrix(days);
+}
+
+// altitude and azimuth (radians, azimuth from the north towards the east) of a horizon direction
+inline glm::dvec2 altitudeAzimuth(glm::dvec3 direction) {
+    direction = glm::normalize(direction);
+    double azimuth = std::atan2(direction.x, -direction.z);
+    return {std::asin(direction.y), azimuth < 0.0 ? azimuth + ORBIT_TWO_PI : azimuth};
+}
+
+// J2000 ecliptic to J2000 equatorial coordinates
+inline glm::dvec3 eclipticToEquatorial(const double position[3]) {
+    double c = std::cos(J2000_OBLIQUITY), s = std::sin(J2000_OBLIQUITY);
+    return {position[0], c * position[1] - s * position[2], s * position[1] + c * position[2]};
+}
+
+// geocentric J2000 equatorial position of the moon (km) at the given days since J2000, good to about 0.3 degrees
+// (low precision formulas of the Astronomical Almanac)
+inline glm::dvec3 lunarPosition(double days) {
+    double t = days / 36525.0;
+    const double deg = ORBIT_PI / 180.0;
+    auto term = [&](double amplitude, double phase, double rate) {
+        return amplitude * std::sin((phase + rate * t) * deg);
+    };
+    auto cosTerm = [&](double amplitude, double phase, double rate) {
+        return amplitude * std::cos((phase + rate * t) * deg);
+    };
+
+    // ecliptic longitude, latitude and horizontal parallax of date (degrees)
+    double longitude = 218.32 + 481267.881 * t + term(6.29, 135.0, 477198.87) - term(1.27, 259.3, -413335.36) +
+                       term(0.66, 235.7, 890534.22) + term(0.21, 269.9, 954397.74) - term(0.19, 357.5, 35999.05) -
+                       term(0.11, 186.5, 966404.03);
+    double latitude = term(5.13, 93.3, 483202.02) + term(0.28, 228.2, 960400.89) - term(0.28, 318.3, 6003.15) -
+                      term(0.17, 217.6, -407332.21);
+    double parallax = 0.9508 + cosTerm(0.0518, 135.0, 477198.87) + cosTerm(0.0095, 259.3, -413335.36) +
+                      cosTerm(0.0078, 235.7, 890534.22) + cosTerm(0.0028, 269.9, 954397.74);
+    double distance = EARTH_RADIUS_KM / std::sin(parallax * deg);
+
+    double ecliptic[3] = {distance * std::cos(latitude * deg) * std::cos(std::fmod(longitude, 360.0) * deg),
+                          distance * std::cos(latitude * deg) * std::sin(std::fmod(longitude, 360.0) * deg),
+                          distance * std::sin(latitude * deg)};
+    // of date, so brought back to J2000 (the obliquity barely moves in a century)
+    return glm::transpose(precessionMatrix(days)) * eclipticToEquatorial(ecliptic);
+}
+
+// transforms count directions by m (structure of arrays); the loop has no branch so it vectorizes
+inline void transformDirections(const glm::mat3 &m, const float *x, const float *y, const float *z, size_t count,
+                                float *outX, float *outY, float *outZ) {
+    const float m00 = m[0][0], m01 = m[1][0], m02 = m[2][0];
+    const float m10 = m[0][1], m11 = m[1][1], m12 = m[2][1];
+    const float m20 = m[0][2], m21 = m[1][2], m22 = m[2][2];
+    for (size_t i = 0; i < count; i++) {
+        outX[i] = m00 * x[i] + m01 * y[i] + m02 * z[i];
+        outY[i] = m10 * x[i] + m11 * y[i] + m12 * z[i];
+        outZ[i] = m20 * x[i] + m21 * y[i] + m22 * z[i];
+    }
+}
+
+// Stars of a catalog above the observer's horizon, drawn by starVertex.glsl with an identity equatorialToScene
+class HorizonStars {
+public:
+    unsigned int VAO = 0;
+    unsigned int VBO = 0;
+
+    // keeps the directions of the stars (StarPoint positions, any distance) and allocates the vertex buffer
+    void create(const std::vector<StarPoint> &stars) {
+        size_t count = stars.size();
+        x.resize(count);
+        y.resize(count);
+        z.resize(count);
+        magnitude.resize(count);
+        color.resize(count);
+        for (size_t i = 0; i < count; i++) {
+            glm::vec3 direction = glm::normalize(glm::vec3(stars[i].x, stars[i].y, stars[i].z));
+            x[i] = direction.x;
+            y[i] = direction.y;
+            z[i] = direction.z;
+            magnitude[i] = stars[i].magnitude;
+            color[i] = stars[i].color;
+        }
+        visible.resize(count);
+
+        glGenVertexArrays(1, &VAO);
+        glGenBuffers(1, &VBO);
+        glBindVertexArray(VAO);
+        glBindBuffer(GL_ARRAY_BUFFER, VBO);
+        glBufferData(GL_ARRAY_BUFFER, (GLsizeiptr) (count * sizeof(StarPoint)), nullptr, GL_STREAM_DRAW);
+
+        // horizon direction (10 parsecs), apparent magnitude and color index (thousandths), as in bright_stars.h
+        glVertexAttribPointer(0, 3, GL_FLOAT, GL_FALSE, sizeof(StarPoint), (void *) nullptr);
+        glEnableVertexAttribArray(0);
+        glVertexAttribPointer(1, 2, GL_SHORT, GL_FALSE, sizeof(StarPoint), (void *) (3 * sizeof(float)));
+        glEnableVertexAttribArray(1);
+        glBindVertexArray(0);
+        glBindBuffer(GL_ARRAY_BUFFER, 0);
+    }
+
+    // brings every star to the horizon with toHorizon (see horizonMatrix), keeps those above it and uploads them
+    void update(const glm::mat3 &toHorizon) {
+        size_t count = x.size();
+        size_t workers = std::max<size_t>(std::min<size_t>(workerCount(), count / HORIZON_STARS_PER_WORKER), 1);
+        packed.assign(workers, 0);
+        size_t chunk = (count + workers - 1) / workers;
+
+        parallelFor(count, [&](size_t begin, size_t end, unsigned int worker) {
+            float hx[HORIZON_BLOCK], hy[HORIZON_BLOCK], hz[HORIZON_BLOCK];
+            size_t written = begin; // each worker packs its stars at the start of its own range
+            for (size_t block = begin; block < end; block += HORIZON_BLOCK) {
+                size_t n = std::min(HORIZON_BLOCK, end - block);
+                transformDirections(toHorizon, &x[block], &y[block], &z[block], n, hx, hy, hz);
+                for (size_t i = 0; i < n; i++) { // every star is written, only those above the horizon are kept
+                    visible[written] = {hx[i] * 10.0f, hy[i] * 10.0f, hz[i] * 10.0f, magnitude[block + i],
+                                        color[block + i]};
+                    written += hy[i] >= 0.0f; // no branch to mispredict on a random sky
+                }
+            }
+            packed[worker] = written - begin;
+        }, (unsigned int) workers);
+
+        // close the gaps between the ranges of the workers
+        visibleCount = packed[0];
+        for (size_t w = 1; w < workers; w++) {
+            std::memmove(&visible[visibleCount], &visible[w * chunk], packed[w] * sizeof(StarPoint));
+            visibleCount += packed[w];
+        }
+
+        glBindBuffer(GL_ARRAY_BUFFER, VBO);
+        glBufferData(GL_ARRAY_BUFFER, (GLsizeiptr) (x.size() * sizeof(StarPoint)), nullptr, GL_STREAM_DRAW);
+        glBufferSubData(GL_ARRAY_BUFFER, 0, (GLsizeiptr) (visibleCount * sizeof(StarPoint)), visible.data());
+        glBindBuffer(GL_ARRAY_BUFFER, 0);
+    }
+
+    // draws the stars above the horizon as additive point sprites (shader must already be in use)
+    void draw() const {
+        if (visibleCount == 0) return;
+        glEnable(GL_PROGRAM_POINT_SIZE);
+        glBlendFunc(GL_SRC_ALPHA, GL_ONE);
+        glBindVertexArray(VAO);
+        glDrawArrays(GL_POINTS, 0, (GLsizei) visibleCount);
+        glBindVertexArray(0);
+        glBlendFunc(GL_SRC_ALPHA, GL_ONE_MINUS_SRC_ALPHA);
+        glDisable(GL_PROGRAM_POINT_SIZE);
+    }
+
+    void release() {
+        glDeleteVertexArrays(1, &VAO);
+        glDeleteBuffers(1, &VBO);
+        VAO = VBO = 0;
+    }
+
+private:
+    std::vector<float> x, y, z; // J2000 equatorial unit directions
+    std::vector<int16_t> magnitude; // apparent magnitude (thousandths)
+    std::vector<int16_t> color; // B-V color index (thousandths)
+    std::vector<StarPoint> visible; // stars above the horizon (packed by update)
+    std::vector<size_t> packed; // stars kept by each worker
+    size_t visibleCount = 0;
+};
+
+#endif
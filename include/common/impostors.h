@@ -0,0 +1,238 @@
+#ifndef IMPOSTORS_H
+#define IMPOSTORS_H
+
+#include <glad/glad.h>
+
+#include <glm/glm.hpp>
+
+#include <algorithm>
+#include <cmath>
+#include <cstddef>
+#include <vector>
+
+// Impostors of the bodies that cover only a few pixels: instead of the sphere mesh and the planet shader, such a
+// body is one quad facing the camera whose fragments look up its lit surface in a tile of an atlas.
+//
+// A tile holds the whole sphere in an octahedral map: each texel is a direction from the center of the body (the
+// unit octahedron unfolded onto a square, see impostorBakeFragment.glsl), shaded there as planetFragment.glsl
+// would for the position of the light and the camera when it was baked. impostorFragment.glsl turns each pixel of
+// the quad into the normal of the sphere under it and reads that direction, so the silhouette is exact from any
+// side. A tile is baked again when it is older than IMPOSTOR_MAX_AGE or the direction of the camera or of the light
+// seen from the body (which also turns with the body) moved by more than IMPOSTOR_MAX_ANGLE; the most outdated
+// tiles go first, at most IMPOSTOR_REFRESHES per frame, and a body never baked is drawn in full until its turn.
+// see more at: https://jcgt.org/published/0003/02/01/ (octahedral maps)
+
+const int IMPOSTOR_TILE_SIZE = 64; ///< texels on the side of a tile (the same as the impostor shaders)
+const int IMPOSTOR_ATLAS_TILES = 16; ///< tiles on the side of the atlas (bodies with an impostor at most)
+const float IMPOSTOR_MAX_RADIUS = 16.0f; ///< bodies whose radius spans fewer pixels than this are impostors
+const float IMPOSTOR_MAX_AGE = 0.25f; ///< seconds after which a tile is baked again anyway
+const float IMPOSTOR_MAX_ANGLE = 2.0f; ///< change in degrees of the direction of the camera or light that rebakes
+const int IMPOSTOR_REFRESHES = 4; ///< tiles baked per frame at most
+
+/// body that may be drawn as an impostor (positions relative to the camera)
+struct ImpostorBody {
+    glm::vec3 center;
+    float radius;
+    glm::mat3 rotation; // orientation of the body (its texture is mapped like the sphere of renderSphere)
+    unsigned int texture; // diffuse texture
+    int occluderMask; // occluders that may shadow it (see eclipse.h)
+    bool eligible; // false to always draw the body in full
+};
+
+class ImpostorCache {
+public:
+    unsigned int atlasTexture = 0;
+    unsigned int FBO = 0;
+    unsigned int VAO = 0;
+    unsigned int VBO = 0;
+
+    // creates the atlas, its framebuffer and the buffer of the quads, returns false if the framebuffer is incomplete
+    bool create() {
+        int side = IMPOSTOR_ATLAS_TILES * IMPOSTOR_TILE_SIZE;
+        glGenTextures(1, &atlasTexture);
+        glBindTexture(GL_TEXTURE_2D, atlasTexture);
+        glTexImage2D(GL_TEXTURE_2D, 0, GL_RGBA8, side, side, 0, GL_RGBA, GL_UNSIGNED_BYTE, nullptr);
+        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAX_LEVEL, 0);
+        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_EDGE);
+        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_EDGE);
+        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_LINEAR);
+        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
+        glBindTexture(GL_TEXTURE_2D, 0);
+
+        glGenFramebuffers(1, &FBO);
+        glBindFramebuffer(GL_FRAMEBUFFER, FBO);
+        glFramebufferTexture2D(GL_FRAMEBUFFER, GL_COLOR_ATTACHMENT0, GL_TEXTURE_2D, atlasTexture, 0);
+        bool complete = glCheckFramebufferStatus(GL_FRAMEBUFFER) == GL_FRAMEBUFFER_COMPLETE;
+        glBindFramebuffer(GL_FRAMEBUFFER, 0);
+
+        // one instance per impostor: center and radius, then the tile (the corners come from gl_VertexID)
+        glGenVertexArrays(1, &VAO);
+        glGenBuffers(1, &VBO);
+        glBindVertexArray(VAO);
+        glBindBuffer(GL_ARRAY_BUFFER, VBO);
+        glBufferData(GL_ARRAY_BUFFER, (GLsizeiptr) (IMPOSTOR_ATLAS_TILES * IMPOSTOR_ATLAS_TILES * sizeof(Instance)),
+                     nullptr, GL_STREAM_DRAW);
+        glVertexAttribPointer(0, 4, GL_FLOAT, GL_FALSE, sizeof(Instance), (void *) nullptr);
+        glEnableVertexAttribArray(0);
+        glVertexAttribDivisor(0, 1);
+        glVertexAttribPointer(1, 1, GL_FLOAT, GL_FALSE, sizeof(Instance), (void *) offsetof(Instance, tile));
+        glEnableVertexAttribArray(1);
+        glVertexAttribDivisor(1, 1);
+        glBindVertexArray(0);
+        glBindBuffer(GL_ARRAY_BUFFER, 0);
+
+        glGenVertexArrays(1, &bakeVAO); // the baking triangle has no attributes
+        if (!complete) release();
+        return complete;
+    }
+
+    // selects the bodies drawn as impostors this frame and bakes the most outdated of their tiles; the light uniforms
+    // of the bake program must already be set (light is its position, time the real time in seconds)
+    void update(const std::vector<ImpostorBody> &bodies, glm::vec3 light, float pixelsPerRadian, double time,
+                unsigned int bakeProgram) {
+        impostor.assign(bodies.size(), false);
+        instances.clear();
+        if (FBO == 0) return;
+        size_t count = std::min(bodies.size(), (size_t) IMPOSTOR_ATLAS_TILES * IMPOSTOR_ATLAS_TILES);
+        tiles.resize(count);
+
+        std::vector<std::pair<float, size_t>> outdated; // the most outdated first
+        for (size_t i = 0; i < count; i++) {
+            const ImpostorBody &body = bodies[i];
+            float distance = glm::length(body.center);
+            if (!body.eligible || distance <= body.radius ||
+                body.radius / distance * pixelsPerRadian > IMPOSTOR_MAX_RADIUS) {
+                continue;
+            }
+            glm::mat3 toBody = glm::transpose(body.rotation);
+            Tile &tile = tiles[i];
+            glm::vec3 view = toBody * (-body.center / distance);
+            glm::vec3 lightDirection = toBody * glm::normalize(light - body.center);
+            float staleness = 1e30f; // never baked
+            if (tile.baked) {
+                staleness = std::max({(float) (time - tile.time) / IMPOSTOR_MAX_AGE,
+                                      angleBetween(view, tile.view) / IMPOSTOR_MAX_ANGLE,
+                                      angleBetween(lightDirection, tile.light) / IMPOSTOR_MAX_ANGLE});
+            }
+            if (staleness >= 1.0f) outdated.emplace_back(staleness, i);
+            impostor[i] = tile.baked; // an outdated tile is still drawn until it is baked again
+            tile.pendingView = view;
+            tile.pendingLight = lightDirection;
+        }
+        std::sort(outdated.begin(), outdated.end(), [](const auto &a, const auto &b) {
+            return a.first > b.first;
+        });
+        if (outdated.size() > (size_t) IMPOSTOR_REFRESHES) outdated.resize(IMPOSTOR_REFRESHES);
+        if (!outdated.empty()) bake(bodies, outdated, time, bakeProgram);
+
+        for (size_t i = 0; i < count; i++) {
+            if (impostor[i]) instances.push_back({glm::vec4(bodies[i].center, bodies[i].radius), (float) i});
+        }
+    }
+
+    // checks if a body is drawn as an impostor this frame (and not as a sphere)
+    bool isImpostor(size_t body) const {
+        return body < impostor.size() && impostor[body];
+    }
+
+    // draws the quads of every impostor (the shader must already be in use), the atlas bound to texture unit 0
+    void draw() const {
+        if (instances.empty()) return;
+        glBindBuffer(GL_ARRAY_BUFFER, VBO);
+        glBufferSubData(GL_ARRAY_BUFFER, 0, (GLsizeiptr) (instances.size() * sizeof(Instance)), instances.data());
+        glBindBuffer(GL_ARRAY_BUFFER, 0);
+        glActiveTexture(GL_TEXTURE0);
+        glBindTexture(GL_TEXTURE_2D, atlasTexture);
+        glBindVertexArray(VAO);
+        glDrawArraysInstanced(GL_TRIANGLE_STRIP, 0, 4, (GLsizei) instances.size());
+        glBindVertexArray(0);
+    }
+
+    void release() {
+        glDeleteTextures(1, &atlasTexture);
+        glDeleteFramebuffers(1, &FBO);
+        glDeleteVertexArrays(1, &VAO);
+        glDeleteBuffers(1, &VBO);
+        glDeleteVertexArrays(1, &bakeVAO);
+        atlasTexture = FBO = VAO = VBO = bakeVAO = 0;
+        tiles.clear();
+        impostor.clear();
+        instances.clear();
+    }
+
+private:
+    // quad of an impostor (see impostorVertex.glsl)
+    struct Instance {
+        glm::vec4 sphere; // center and radius
+        float tile;
+    };
+
+    // tile of a body, with the directions (in the body's frame) of the camera and the light when it was baked
+    struct Tile {
+        bool baked = false;
+        double time = 0.0;
+        glm::vec3 view{0.0f};
+        glm::vec3 light{0.0f};
+        glm::vec3 pendingView{0.0f}; // directions of this frame
+        glm::vec3 pendingLight{0.0f};
+    };
+
+    unsigned int bakeVAO = 0;
+    std::vector<Tile> tiles; // tile of each body (body i has tile i of the atlas)
+    std::vector<bool> impostor; // bodies drawn as impostors this frame
+    std::vector<Instance> instances;
+
+    // angle in degrees between two unit vectors
+    static float angleBetween(glm::vec3 a, glm::vec3 b) {
+        return glm::degrees(std::atan2(glm::length(glm::cross(a, b)), glm::dot(a, b)));
+    }
+
+    // renders the lit surfaces of some bodies into their tiles with impostorBakeFragment.glsl
+    void bake(const std::vector<ImpostorBody> &bodies, const std::vector<std::pair<float, size_t>> &outdated,
+              double time, unsigned int program) {
+        GLint previousFramebuffer, previousViewport[4];
+        glGetIntegerv(GL_FRAMEBUFFER_BINDING, &previousFramebuffer);
+        glGetIntegerv(GL_VIEWPORT, previousViewport);
+        GLboolean depthTest = glIsEnabled(GL_DEPTH_TEST), blend = glIsEnabled(GL_BLEND);
+        glDisable(GL_DEPTH_TEST);
+        glDisable(GL_BLEND);
+        glBindFramebuffer(GL_FRAMEBUFFER, FBO);
+        glUseProgram(program);
+        GLint tileOrigin = glGetUniformLocation(program, "tileOrigin");
+        GLint center = glGetUniformLocation(program, "center");
+        GLint radius = glGetUniformLocation(program, "radius");
+        GLint toBody = glGetUniformLocation(program, "toBody");
+        GLint occluderMask = glGetUniformLocation(program, "occluderMask");
+        glActiveTexture(GL_TEXTURE0);
+        glBindVertexArray(bakeVAO);
+        for (const auto &entry: outdated) {
+            size_t i = entry.second;
+            const ImpostorBody &body = bodies[i];
+            int x = (int) (i % IMPOSTOR_ATLAS_TILES) * IMPOSTOR_TILE_SIZE;
+            int y = (int) (i / IMPOSTOR_ATLAS_TILES) * IMPOSTOR_TILE_SIZE;
+            glViewport(x, y, IMPOSTOR_TILE_SIZE, IMPOSTOR_TILE_SIZE);
+            glUniform2f(tileOrigin, (float) x, (float) y);
+            glUniform3fv(center, 1, &body.center[0]);
+            glUniform1f(radius, body.radius);
+            glm::mat3 inverse = glm::transpose(body.rotation);
+            glUniformMatrix3fv(toBody, 1, GL_FALSE, &inverse[0][0]);
+            glUniform1i(occluderMask, body.occluderMask);
+            glBindTexture(GL_TEXTURE_2D, body.texture);
+            glDrawArrays(GL_TRIANGLES, 0, 3);
+
+            Tile &tile = tiles[i];
+            tile.baked = true;
+            tile.time = time;
+            tile.view = tile.pendingView;
+            tile.light = tile.pendingLight;
+            impostor[i] = true;
+        }
+        glBindVertexArray(0);
+        glBindFramebuffer(GL_FRAMEBUFFER, (GLuint) previousFramebuffer);
+        glViewport(previousViewport[0], previousViewport[1], previousViewport[2], previousViewport[3]);
+        if (depthTest) glEnable(GL_DEPTH_TEST);
+        if (blend) glEnable(GL_BLEND);
+    }
+};
+
+#endif
@@ -0,0 +1,183 @@
+#ifndef LABELS_H
+#define LABELS_H
+
+#include <glm/glm.hpp>
+
+#include <algorithm>
+#include <cmath>
+#include <utility>
+#include <vector>
+
+// Screen-space layout of body labels that never overlap, for thousands of candidates per frame.
+//
+// Every frame the label anchors are projected in one pass, the candidates are ranked by priority and the labels are
+// placed greedily from the most important one: each label tries four sides of its anchor and takes the first whose
+// rectangle overlaps nothing placed before. Placed rectangles are kept in a uniform grid of screen cells, so each
+// test only looks at the few labels in the cells it covers. At most LABEL_MAX labels fit on screen anyway, so only
+// that many candidates are selected (in linear time) and sorted.
+//
+// Labels shown in the previous frame get a priority bonus and try their previous side first, and every label fades
+// in and out over LABEL_FADE_TIME, so small changes in the ranking do not make labels pop from frame to frame.
+
+const int LABEL_MAX = 256; ///< labels placed per frame at most
+const float LABEL_CELL_SIZE = 64.0f; ///< side of a cell of the screen grid (pixels)
+const float LABEL_MARGIN = 6.0f; ///< distance between a label and its anchor (pixels)
+const float LABEL_FADE_TIME = 0.25f; ///< seconds for a label to fade in or out
+const float LABEL_KEEP_BONUS = 1.5f; ///< priority factor of the labels shown in the previous frame
+
+// label drawn this frame: bottom left corner of its rectangle in screen pixels (origin at the bottom left of the
+// screen) and opacity
+struct ScreenLabel {
+    float x;
+    float y;
+    float alpha;
+    unsigned int label;
+};
+
+class LabelLayout {
+public:
+    // sets the screen size and the size in pixels of every label (widths of the texts and height of a line)
+    void create(float screenWidth, float screenHeight, const std::vector<float> &labelWidths, float labelHeight) {
+        width = screenWidth;
+        height = screenHeight;
+        widths = labelWidths;
+        lineHeight = labelHeight;
+        alphas.assign(widths.size(), 0.0f);
+        previousSides.assign(widths.size(), 0);
+        columns = (int) std::ceil(width / LABEL_CELL_SIZE);
+        rows = (int) std::ceil(height / LABEL_CELL_SIZE);
+        cells.resize((size_t) columns * rows);
+    }
+
+    // places the labels of this frame: anchors are camera relative positions (xyz) with a priority (w, 0 or less
+    // hides the label), viewProjection is projection * view and deltaTime the real seconds of the frame
+    const std::vector<ScreenLabel> &place(const std::vector<glm::vec4> &anchors, const glm::mat4 &viewProjection,
+                                          float deltaTime) {
+        size_t count = std::min(anchors.size(), widths.size());
+        screen.resize(count);
+        candidates.clear();
+
+        // project every anchor, keeping the ones in front of the camera and on screen
+        for (size_t i = 0; i < count; i++) {
+            glm::vec4 clip = viewProjection * glm::vec4(glm::vec3(anchors[i]), 1.0f);
+            screen[i] = glm::vec2(-1.0f);
+            if (clip.w <= 0.0f) continue;
+            glm::vec2 point = (glm::vec2(clip.x, clip.y) / clip.w * 0.5f + 0.5f) * glm::vec2(width, height);
+            if (point.x < 0.0f || point.x >= width || point.y < 0.0f || point.y >= height) continue;
+            screen[i] = point;
+            if (anchors[i].w <= 0.0f) continue;
+            float priority = anchors[i].w * (alphas[i] > 0.0f ? LABEL_KEEP_BONUS : 1.0f);
+            candidates.emplace_back(priority, (unsigned int) i);
+        }
+
+        // the LABEL_MAX most important candidates, most important first
+        auto byPriority = [](const Candidate &a, const Candidate &b) { return a.first > b.first; };
+        if (candidates.size() > (size_t) LABEL_MAX) {
+            std::nth_element(candidates.begin(), candidates.begin() + LABEL_MAX, candidates.end(), byPriority);
+            candidates.resize(LABEL_MAX);
+        }
+        std::sort(candidates.begin(), candidates.end(), byPriority);
+
+        // greedy placement against the labels already in the grid
+        std::fill(cells.begin(), cells.end(), -1);
+        rectangles.clear();
+        next.clear();
+        placed.assign(count, false);
+        for (const Candidate &candidate: candidates) {
+            unsigned int i = candidate.second;
+            for (int attempt = 0; attempt < 4; attempt++) {
+                int side = (previousSides[i] + attempt) % 4; // the previous side first
+                glm::vec4 rectangle = labelRectangle(i, side);
+                if (rectangle.x < 0.0f || rectangle.z > width || rectangle.y < 0.0f || rectangle.w > height) continue;
+                if (overlaps(rectangle)) continue;
+                insert(rectangle);
+                placed[i] = true;
+                previousSides[i] = (unsigned char) side;
+                break;
+            }
+        }
+
+        // fade the labels in and out, fading ones stay where they were while their anchor is on screen
+        result.clear();
+        float fade = deltaTime / LABEL_FADE_TIME;
+        for (size_t i = 0; i < count; i++) {
+            alphas[i] = placed[i] ? std::min(alphas[i] + fade, 1.0f) : std::max(alphas[i] - fade, 0.0f);
+            if (alphas[i] <= 0.0f || screen[i].x < 0.0f) continue;
+            glm::vec4 rectangle = labelRectangle((unsigned int) i, previousSides[i]);
+            result.push_back({rectangle.x, rectangle.y, alphas[i], (unsigned int) i});
+        }
+        for (size_t i = count; i < alphas.size(); i++) alphas[i] = 0.0f;
+        return result;
+    }
+
+private:
+    typedef std::pair<float, unsigned int> Candidate; // priority and label
+
+    float width = 0.0f;
+    float height = 0.0f;
+    float lineHeight = 0.0f;
+    std::vector<float> widths; // text width of each label
+    std::vector<float> alphas; // opacity of each label (0 when hidden)
+    std::vector<unsigned char> previousSides; // side of its anchor where each label was last placed
+    std::vector<glm::vec2> screen; // projected anchors of this frame (negative when off screen)
+    std::vector<Candidate> candidates;
+    std::vector<bool> placed;
+    std::vector<ScreenLabel> result;
+
+    int columns = 0;
+    int rows = 0;
+    std::vector<int> cells; // first rectangle of each grid cell (-1 when empty)
+    std::vector<glm::vec4> rectangles; // placed rectangles (min x, min y, max x, max y), one entry per cell
+    std::vector<int> next; // next rectangle in the same cell
+
+    // rectangle of a label on one side of its anchor: right, left, above, below
+    glm::vec4 labelRectangle(unsigned int label, int side) const {
+        glm::vec2 anchor = screen[label];
+        float w = widths[label];
+        glm::vec2 corner;
+        if (side == 0) corner = glm::vec2(anchor.x + LABEL_MARGIN, anchor.y - lineHeight / 2.0f);
+        else if (side == 1) corner = glm::vec2(anchor.x - LABEL_MARGIN - w, anchor.y - lineHeight / 2.0f);
+        else if (side == 2) corner = glm::vec2(anchor.x - w / 2.0f, anchor.y + LABEL_MARGIN);
+        else corner = glm::vec2(anchor.x - w / 2.0f, anchor.y - LABEL_MARGIN - lineHeight);
+        return glm::vec4(corner, corner + glm::vec2(w, lineHeight));
+    }
+
+    // grid cells covered by a rectangle
+    void cellRange(const glm::vec4 &rectangle, int &x0, int &y0, int &x1, int &y1) const {
+        x0 = std::max((int) (rectangle.x / LABEL_CELL_SIZE), 0);
+        y0 = std::max((int) (rectangle.y / LABEL_CELL_SIZE), 0);
+        x1 = std::min((int) (rectangle.z / LABEL_CELL_SIZE), columns - 1);
+        y1 = std::min((int) (rectangle.w / LABEL_CELL_SIZE), rows - 1);
+    }
+
+    bool overlaps(const glm::vec4 &rectangle) const {
+        int x0, y0, x1, y1;
+        cellRange(rectangle, x0, y0, x1, y1);
+        for (int y = y0; y <= y1; y++) {
+            for (int x = x0; x <= x1; x++) {
+                for (int k = cells[(size_t) y * columns + x]; k >= 0; k = next[k]) {
+                    const glm::vec4 &other = rectangles[k];
+                    if (rectangle.x < other.z && other.x < rectangle.z && rectangle.y < other.w &&
+                        other.y < rectangle.w)
+                        return true;
+                }
+            }
+        }
+        return false;
+    }
+
+    void insert(const glm::vec4 &rectangle) {
+        int x0, y0, x1, y1;
+        cellRange(rectangle, x0, y0, x1, y1);
+        for (int y = y0; y <= y1; y++) {
+            for (int x = x0; x <= x1; x++) {
+                int &head = cells[(size_t) y * columns + x];
+                rectangles.push_back(rectangle);
+                next.push_back(head);
+                head = (int) rectangles.size() - 1;
+            }
+        }
+    }
+};
+
+#endif
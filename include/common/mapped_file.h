@@ -0,0 +1,119 @@
+#ifndef MAPPED_FILE_H
+#define MAPPED_FILE_H
+
+#include <algorithm>
+#include <cstddef>
+
+#ifdef _WIN32
+#define WIN32_LEAN_AND_MEAN
+#define NOMINMAX
+#include <windows.h>
+#else
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+// Read-only memory mapping of a whole file (the pages are loaded by the OS on demand)
+class MappedFile {
+public:
+    MappedFile() = default;
+
+    explicit MappedFile(const char *path, bool readAhead = true) {
+        open(path, readAhead);
+    }
+
+    MappedFile(const MappedFile &) = delete;
+
+    MappedFile &operator=(const MappedFile &) = delete;
+
+    ~MappedFile() {
+        close();
+    }
+
+    // maps the file (asking the OS to start reading all of it if readAhead is set), returns false if it does not
+    // exist or cannot be mapped
+    bool open(const char *path, bool readAhead = true) {
+        close();
+#ifdef _WIN32
+        file = CreateFileA(path, GENERIC_READ, FILE_SHARE_READ, nullptr, OPEN_EXISTING, FILE_ATTRIBUTE_NORMAL, nullptr);
+        if (file == INVALID_HANDLE_VALUE) return false;
+        LARGE_INTEGER fileSize;
+        GetFileSizeEx(file, &fileSize);
+        length = (size_t) fileSize.QuadPart;
+        if (length == 0) return true;
+        mapping = CreateFileMappingA(file, nullptr, PAGE_READONLY, 0, 0, nullptr);
+        if (mapping == nullptr) {
+            close();
+            return false;
+        }
+        bytes = (const char *) MapViewOfFile(mapping, FILE_MAP_READ, 0, 0, 0);
+#else
+        fd = ::open(path, O_RDONLY);
+        if (fd < 0) return false;
+        struct stat info{};
+        fstat(fd, &info);
+        length = (size_t) info.st_size;
+        if (length == 0) return true;
+        void *address = mmap(nullptr, length, PROT_READ, MAP_PRIVATE, fd, 0);
+        if (address == MAP_FAILED) {
+            close();
+            return false;
+        }
+        bytes = (const char *) address;
+        if (readAhead) madvise(address, length, MADV_WILLNEED);
+#endif
+        return bytes != nullptr;
+    }
+
+    // asks the OS to start reading a range of the file in background (no effect on Windows)
+    void prefetch(size_t offset, size_t count) const {
+#ifndef _WIN32
+        if (bytes == nullptr || offset >= length) return;
+        auto page = (size_t) sysconf(_SC_PAGESIZE);
+        size_t begin = offset / page * page;
+        size_t end = std::min(offset + count, length);
+        madvise((void *) (bytes + begin), end - begin, MADV_WILLNEED);
+#else
+        (void) offset;
+        (void) count;
+#endif
+    }
+
+    void close() {
+#ifdef _WIN32
+        if (bytes) UnmapViewOfFile(bytes);
+        if (mapping) CloseHandle(mapping);
+        if (file != INVALID_HANDLE_VALUE) CloseHandle(file);
+        mapping = nullptr;
+        file = INVALID_HANDLE_VALUE;
+#else
+        if (bytes) munmap((void *) bytes, length);
+        if (fd >= 0) ::close(fd);
+        fd = -1;
+#endif
+        bytes = nullptr;
+        length = 0;
+    }
+
+    const char *data() const {
+        return bytes;
+    }
+
+    size_t size() const {
+        return length;
+    }
+
+private:
+    const char *bytes = nullptr;
+    size_t length = 0;
+#ifdef _WIN32
+    HANDLE file = INVALID_HANDLE_VALUE;
+    HANDLE mapping = nullptr;
+#else
+    int fd = -1;
+#endif
+};
+
+#endif
@@ -0,0 +1,225 @@
+#ifndef MPCORB_H
+#define MPCORB_H
+
+#include <charconv>
+#include <cmath>
+#include <cstdint>
+#include <cstdio>
+#include <cstring>
+#include <fstream>
+#include <random>
+#include <string>
+#include <sys/stat.h>
+#include <vector>
+
+#include "mapped_file.h"
+#include "orbit.h"
+#include "parallel.h"
+
+// Parser for the Minor Planet Center orbit catalog (MPCORB.DAT fixed-width format)
+// see more at: https://minorplanetcenter.net/iau/info/MPOrbitFormat.html
+//
+// The catalog is memory mapped, split into line-aligned chunks parsed in parallel and the resulting
+// orbital elements are cached in a binary sidecar (<path>.bin) that is reused while the catalog is unchanged.
+
+const uint32_t MPCORB_CACHE_MAGIC = 0x42524f4d; // "MORB"
+const uint32_t MPCORB_CACHE_VERSION = 1;
+const int MPCORB_MIN_LINE = 103; // lines shorter than this cannot hold the semi-major axis
+
+// Header of the binary sidecar, followed by the eight element arrays (count floats each)
+struct MpcorbCacheHeader {
+    uint32_t magic;
+    uint32_t version;
+    uint64_t count;
+    uint64_t sourceSize; // size of the catalog the cache was built from
+    int64_t sourceTime; // modification time of the catalog the cache was built from
+};
+
+// parses a fixed-width numeric field (1-based inclusive columns as in the MPC documentation)
+inline bool mpcorbField(const char *line, int first, int last, double &value) {
+    const char *begin = line + first - 1;
+    const char *end = line + last;
+    while (begin < end && *begin == ' ') begin++;
+    while (end > begin && end[-1] == ' ') end--;
+    if (begin == end) return false;
+    return std::from_chars(begin, end, value).ec == std::errc();
+}
+
+// decodes one character of a packed date (1-9, then A = 10 ... V = 31)
+inline int mpcorbPackedDigit(char c) {
+    if (c >= '0' && c <= '9') return c - '0';
+    if (c >= 'A' && c <= 'V') return c - 'A' + 10;
+    return -1;
+}
+
+// converts a packed epoch such as "K24AH" (2024-10-17) into a julian date (0 if invalid)
+inline double mpcorbEpoch(const char *packed) {
+    int century = packed[0] - 'I' + 18; // I = 1800s, J = 1900s, K = 2000s
+    int year = century * 100 + (packed[1] - '0') * 10 + (packed[2] - '0');
+    int month = mpcorbPackedDigit(packed[3]);
+    int day = mpcorbPackedDigit(packed[4]);
+    if (century < 18 || century > 21 || month < 1 || month > 12 || day < 1) return 0.0;
+
+    // julian date at 0h TT of the gregorian calendar date
+    // see more at: https://aa.usno.navy.mil/faq/JD_formula
+    int a = (14 - month) / 12;
+    int y = year + 4800 - a;
+    int m = month + 12 * a - 3;
+    long jdn = day + (153 * m + 2) / 5 + 365L * y + y / 4 - y / 100 + y / 400 - 32045;
+    return (double) jdn - 0.5;
+}
+
+// parses one catalog line, returns false for header or malformed lines
+inline bool mpcorbParseLine(const char *line, size_t length, OrbitalElements &elements) {
+    if (length < MPCORB_MIN_LINE) return false;
+
+    double h, m, peri, node, incl, e, n, a;
+    if (!mpcorbField(line, 27, 35, m) || !mpcorbField(line, 38, 46, peri) || !mpcorbField(line, 49, 57, node) ||
+        !mpcorbField(line, 60, 68, incl) || !mpcorbField(line, 71, 79, e) || !mpcorbField(line, 81, 91, n) ||
+        !mpcorbField(line, 93, 103, a))
+        return false;
+    if (!mpcorbField(line, 9, 13, h)) h = 16.0; // absolute magnitude is missing for some objects
+    if (e >= 1.0 || a <= 0.0) return false;
+
+    double epoch = mpcorbEpoch(line + 20);
+    if (epoch == 0.0) return false;
+
+    const double degree = ORBIT_PI / 180.0;
+    double meanMotion = n * degree; // radians per day
+
+    // refer the mean anomaly to J2000 (scene time 0)
+    double m0 = std::fmod(m * degree - meanMotion * (epoch - J2000_JD), ORBIT_TWO_PI);
+    if (m0 < 0.0) m0 += ORBIT_TWO_PI;
+
+    // brighter objects (lower absolute magnitude) are drawn bigger
+    float size = std::fmin(std::fmax(1.0f + (16.0f - (float) h) * 0.15f, 0.5f), 3.0f);
+
+    elements.add((float) a, (float) e, (float) (incl * degree), (float) (node * degree), (float) (peri * degree),
+                 (float) m0, size, (float) (meanMotion / SCENE_SECONDS_PER_DAY));
+    return true;
+}
+
+// parses a whole catalog already in memory, splitting it into line-aligned chunks processed in parallel
+inline void mpcorbParse(const char *data, size_t size, OrbitalElements &elements) {
+    // data lines start after the dashed separator line (files without a header start at once)
+    size_t start = 0;
+    std::string head(data, std::min<size_t>(size, 65536));
+    size_t dashes = head.find("\n-----");
+    if (dashes != std::string::npos) {
+        size_t eol = head.find('\n', dashes + 1);
+        start = eol == std::string::npos ? size : eol + 1;
+    }
+
+    unsigned int workers = workerCount();
+    std::vector<OrbitalElements> chunks(workers);
+    size_t body = size - start;
+
+    parallelFor(workers, [&](size_t first, size_t last, unsigned int) {
+        for (size_t c = first; c < last; c++) {
+            // chunk boundaries are moved forward to the start of the next line
+            size_t begin = start + body * c / workers;
+            size_t end = start + body * (c + 1) / workers;
+            if (c > 0) {
+                while (begin < size && data[begin - 1] != '\n') begin++;
+            }
+            while (end < size && data[end - 1] != '\n') end++;
+
+            OrbitalElements &out = chunks[c];
+            out.reserve((end - begin) / 200 + 1); // lines are 203 characters long
+            while (begin < end) {
+                const char *line = data + begin;
+                const char *eol = (const char *) std::memchr(line, '\n', end - begin);
+                size_t length = eol ? (size_t) (eol - line) : end - begin;
+                mpcorbParseLine(line, length, out);
+                begin += length + 1;
+            }
+        }
+    }, workers);
+
+    // concatenate the chunks in file order
+    size_t total = elements.count();
+    for (const OrbitalElements &chunk: chunks) total += chunk.count();
+    elements.reserve(total);
+    for (const OrbitalElements &chunk: chunks) elements.append(chunk);
+}
+
+// the eight element arrays in the order they are stored in the sidecar
+inline std::vector<float> *mpcorbArrays(OrbitalElements &elements, int index) {
+    std::vector<float> *arrays[] = {
+            &elements.semiMajorAxis, &elements.eccentricity, &elements.inclination, &elements.ascendingNode,
+            &elements.perihelion, &elements.meanAnomaly, &elements.meanMotion, &elements.size
+    };
+    return arrays[index];
+}
+
+// reads the binary sidecar if it was built from a catalog with the given size and modification time
+inline bool mpcorbLoadCache(const std::string &cachePath, uint64_t sourceSize, int64_t sourceTime,
+                            OrbitalElements &elements) {
+    MappedFile cache(cachePath.c_str());
+    if (cache.size() < sizeof(MpcorbCacheHeader)) return false;
+
+    MpcorbCacheHeader header{};
+    std::memcpy(&header, cache.data(), sizeof(header));
+    if (header.magic != MPCORB_CACHE_MAGIC || header.version != MPCORB_CACHE_VERSION ||
+        header.sourceSize != sourceSize || header.sourceTime != sourceTime ||
+        cache.size() != sizeof(header) + header.count * 8 * sizeof(float))
+        return false;
+
+    elements.resize(header.count);
+    const char *data = cache.data() + sizeof(header);
+    for (int k = 0; k < 8; k++) {
+        std::memcpy(mpcorbArrays(elements, k)->data(), data, header.count * sizeof(float));
+        data += header.count * sizeof(float);
+    }
+    return true;
+}
+
+// writes the binary sidecar for a parsed catalog to a file of its own and renames it over the sidecar, so the other
+// processes that parse the catalog at the same time (the workers of a video) never map a partly written sidecar
+inline void mpcorbSaveCache(const std::string &cachePath, uint64_t sourceSize, int64_t sourceTime,
+                            OrbitalElements &elements) {
+    std::string tempPath = cachePath + "." + std::to_string(std::random_device()()) + ".tmp";
+    {
+        std::ofstream cache(tempPath, std::ios::binary | std::ios::trunc);
+        if (!cache) return;
+        MpcorbCacheHeader header = {MPCORB_CACHE_MAGIC, MPCORB_CACHE_VERSION, elements.count(), sourceSize,
+                                    sourceTime};
+        cache.write((const char *) &header, sizeof(header));
+        for (int k = 0; k < 8; k++) {
+            cache.write((const char *) mpcorbArrays(elements, k)->data(),
+                        (std::streamsize) (elements.count() * sizeof(float)));
+        }
+        if (!cache.flush()) {
+            cache.close();
+            std::remove(tempPath.c_str());
+            return;
+        }
+    }
+#ifdef _WIN32
+    std::remove(cachePath.c_str()); // rename does not replace files on Windows (fails while another process maps it)
+#endif
+    if (std::rename(tempPath.c_str(), cachePath.c_str()) != 0) std::remove(tempPath.c_str());
+}
+
+// loads a catalog into elements (replacing its content), using the binary sidecar when it is up to date
+// returns false if the catalog does not exist or contains no valid orbit
+inline bool loadMpcorb(const char *path, OrbitalElements &elements) {
+    struct stat info{};
+    if (stat(path, &info) != 0) return false;
+    uint64_t sourceSize = (uint64_t) info.st_size;
+    int64_t sourceTime = (int64_t) info.st_mtime;
+    std::string cachePath = std::string(path) + ".bin";
+
+    elements.clear();
+    if (mpcorbLoadCache(cachePath, sourceSize, sourceTime, elements)) return true;
+
+    MappedFile catalog(path);
+    if (catalog.data() == nullptr) return false;
+    mpcorbParse(catalog.data(), catalog.size(), elements);
+    if (elements.count() == 0) return false;
+
+    mpcorbSaveCache(cachePath, sourceSize, sourceTime, elements);
+    return true;
+}
+
+#endif
@@ -0,0 +1,193 @@
+#ifndef ORBIT_H
+#define ORBIT_H
+
+#include <cmath>
+#include <cstddef>
+#include <vector>
+
+// Orbit conventions shared by every body that is not animated by planetCreator:
+// - semi-major axes are stored in astronomical units (AU) and squeezed into scene units by sceneDistance()
+// - time is scene time: one Earth year lasts 2*PI seconds (planetProp[2].translation = 1.0 rad/s)
+//   and scene time 0 is the J2000 epoch (catalog mean anomalies are referred to it)
+// - ecliptic (X, Y, Z) maps to scene (z, x, y), so the ecliptic plane is the scene's xz plane
+const double ORBIT_PI = 3.14159265358979323846;
+const double ORBIT_TWO_PI = 2.0 * ORBIT_PI;
+const double DAYS_PER_YEAR = 365.25;
+const double SCENE_SECONDS_PER_DAY = ORBIT_TWO_PI / DAYS_PER_YEAR;
+const double J2000_JD = 2451545.0; // julian date of the J2000 epoch
+const double J2000_OBLIQUITY = 23.4392911 * ORBIT_PI / 180.0; // obliquity of the ecliptic at J2000 (radians)
+const double AU_PER_PARSEC = 206264.806;
+
+// Planet distances in AU and their compressed distance in scene units (see planetProp[].distance)
+// NOTE: keep in sync with sceneDistance() in asteroidVertex.glsl
+const int DISTANCE_KNOTS = 9;
+const float AU_KNOTS[DISTANCE_KNOTS] = {0.0f, 0.39f, 0.72f, 1.0f, 1.52f, 5.2f, 9.54f, 19.2f, 30.1f};
+const float SCENE_KNOTS[DISTANCE_KNOTS] = {1.0f, 2.0f, 3.0f, 4.0f, 5.0f, 6.0f, 7.0f, 8.0f, 9.0f};
+
+// True scale mode: one scene unit is ten earth radii, so the earth keeps its compressed radius (0.1)
+const double TRUE_SCALE_KM = 63781.35; ///< kilometres per scene unit
+const double TRUE_SCALE_AU = 149597870.7 / TRUE_SCALE_KM; ///< scene units per AU
+
+// Keplerian elements of many bodies in structure-of-arrays layout
+struct OrbitalElements {
+    std::vector<float> semiMajorAxis; // AU
+    std::vector<float> eccentricity;
+    std::vector<float> inclination; // radians
+    std::vector<float> ascendingNode; // longitude of the ascending node (radians)
+    std::vector<float> perihelion; // argument of perihelion (radians)
+    std::vector<float> meanAnomaly; // mean anomaly at scene time 0 (radians)
+    std::vector<float> meanMotion; // radians per scene second
+    std::vector<float> size; // relative point size (absolute magnitude based)
+
+    size_t count() const {
+        return semiMajorAxis.size();
+    }
+
+    void reserve(size_t n) {
+        semiMajorAxis.reserve(n);
+        eccentricity.reserve(n);
+        inclination.reserve(n);
+        ascendingNode.reserve(n);
+        perihelion.reserve(n);
+        meanAnomaly.reserve(n);
+        meanMotion.reserve(n);
+        size.reserve(n);
+    }
+
+    void resize(size_t n) {
+        semiMajorAxis.resize(n);
+        eccentricity.resize(n);
+        inclination.resize(n);
+        ascendingNode.resize(n);
+        perihelion.resize(n);
+        meanAnomaly.resize(n);
+        meanMotion.resize(n);
+        size.resize(n);
+    }
+
+    void clear() {
+        resize(0);
+    }
+
+    // appends every body of another table
+    void append(const OrbitalElements &other) {
+        semiMajorAxis.insert(semiMajorAxis.end(), other.semiMajorAxis.begin(), other.semiMajorAxis.end());
+        eccentricity.insert(eccentricity.end(), other.eccentricity.begin(), other.eccentricity.end());
+        inclination.insert(inclination.end(), other.inclination.begin(), other.inclination.end());
+        ascendingNode.insert(ascendingNode.end(), other.ascendingNode.begin(), other.ascendingNode.end());
+        perihelion.insert(perihelion.end(), other.perihelion.begin(), other.perihelion.end());
+        meanAnomaly.insert(meanAnomaly.end(), other.meanAnomaly.begin(), other.meanAnomaly.end());
+        meanMotion.insert(meanMotion.end(), other.meanMotion.begin(), other.meanMotion.end());
+        size.insert(size.end(), other.size.begin(), other.size.end());
+    }
+
+    // appends one body; mean motion follows Kepler's third law in scene time when not given
+    void add(float a, float e, float i, float node, float peri, float m0, float size_ = 1.0f, float n = 0.0f) {
+        semiMajorAxis.push_back(a);
+        eccentricity.push_back(e);
+        inclination.push_back(i);
+        ascendingNode.push_back(node);
+        perihelion.push_back(peri);
+        meanAnomaly.push_back(m0);
+        meanMotion.push_back(n > 0.0f ? n : keplerMeanMotion(a));
+        size.push_back(size_);
+    }
+
+    // mean motion (radians per scene second) of an orbit with semi-major axis a (AU) around the sun
+    static float keplerMeanMotion(float a) {
+        return 1.0f / (a * std::sqrt(a)); // the earth (1 AU) moves 1 rad/s in scene time
+    }
+};
+
+// Heliocentric ecliptic state vectors in structure-of-arrays layout (AU and AU per scene second)
+struct StateVectors {
+    std::vector<double> x, y, z;
+    std::vector<double> vx, vy, vz;
+
+    size_t count() const {
+        return x.size();
+    }
+
+    void resize(size_t n) {
+        x.resize(n);
+        y.resize(n);
+        z.resize(n);
+        vx.resize(n);
+        vy.resize(n);
+        vz.resize(n);
+    }
+};
+
+// maps a heliocentric distance in AU to the compressed scene distance
+inline float sceneDistance(float au) {
+    for (int k = 1; k < DISTANCE_KNOTS; k++) {
+        if (au < AU_KNOTS[k] || k == DISTANCE_KNOTS - 1) {
+            float t = (au - AU_KNOTS[k - 1]) / (AU_KNOTS[k] - AU_KNOTS[k - 1]);
+            return SCENE_KNOTS[k - 1] + t * (SCENE_KNOTS[k] - SCENE_KNOTS[k - 1]);
+        }
+    }
+    return SCENE_KNOTS[DISTANCE_KNOTS - 1];
+}
+
+// solves Kepler's equation M = E - e*sin(E) for the eccentric anomaly with a fixed number of Newton-Raphson steps
+inline double keplerSolve(double meanAnomaly, double e, int iterations = 5) {
+    double E = meanAnomaly + e * std::sin(meanAnomaly);
+    for (int k = 0; k < iterations; k++) {
+        E -= (E - e * std::sin(E) - meanAnomaly) / (1.0 - e * std::cos(E));
+    }
+    return E;
+}
+
+// heliocentric ecliptic position (AU) of body i at the given scene time
+inline void orbitPosition(const OrbitalElements &el, size_t i, double time, double out[3]) {
+    double e = el.eccentricity[i];
+    double M = std::fmod(el.meanAnomaly[i] + el.meanMotion[i] * time, ORBIT_TWO_PI);
+    double E = keplerSolve(M, e);
+
+    // position in the orbital plane (perihelion along +x)
+    double a = el.semiMajorAxis[i];
+    double px = a * (std::cos(E) - e);
+    double py = a * std::sqrt(1.0 - e * e) * std::sin(E);
+
+    // rotate by argument of perihelion, inclination and ascending node
+    double w = el.perihelion[i], inc = el.inclination[i], node = el.ascendingNode[i];
+    double cw = std::cos(w), sw = std::sin(w);
+    double ci = std::cos(inc), si = std::sin(inc);
+    double cn = std::cos(node), sn = std::sin(node);
+    double x = px * cw - py * sw;
+    double y = px * sw + py * cw;
+    out[0] = x * cn - y * ci * sn;
+    out[1] = x * sn + y * ci * cn;
+    out[2] = y * si;
+}
+
+// appends the planets from mercury to neptune (the earth is the earth-moon barycenter) with their mean J2000
+// elements, or only the planet of the given index (0 for mercury); positions are good to a few arcminutes
+// between 1800 and 2050
+// see more at: https://ssd.jpl.nasa.gov/planets/approx_pos.html
+inline void addPlanetElements(OrbitalElements &elements, int planetIndex = -1) {
+    // semi-major axis (AU), eccentricity, inclination, mean longitude, longitude of perihelion, ascending node
+    // (degrees) and mean longitude rate (degrees per julian century)
+    const double table[8][7] = {
+            {0.38709927, 0.20563593, 7.00497902, 252.25032350, 77.45779628, 48.33076593, 149472.67411175},
+            {0.72333566, 0.00677672, 3.39467605, 181.97909950, 131.60246718, 76.67984255, 58517.81538729},
+            {1.00000261, 0.01671123, -0.00001531, 100.46457166, 102.93768193, 0.0, 35999.37244981},
+            {1.52371034, 0.09339410, 1.84969142, -4.55343205, -23.94362959, 49.55953891, 19140.30268499},
+            {5.20288700, 0.04838624, 1.30439695, 34.39644051, 14.72847983, 100.47390909, 3034.74612775},
+            {9.53667594, 0.05386179, 2.48599187, 49.95424423, 92.59887831, 113.66242448, 1222.49362201},
+            {19.18916464, 0.04725744, 0.77263783, 313.23810451, 170.95427630, 74.01692503, 428.48202785},
+            {30.06992276, 0.00859048, 1.77004347, -55.12002969, 44.96476227, 131.78422574, 218.45945325}
+    };
+    const double deg = ORBIT_PI / 180.0;
+    for (int p = 0; p < 8; p++) {
+        if (planetIndex >= 0 && p != planetIndex) continue;
+        const double *planet = table[p];
+        double node = planet[5] * deg, perihelion = planet[4] * deg;
+        double meanMotion = planet[6] * deg / (36525.0 * SCENE_SECONDS_PER_DAY); // radians per scene second
+        elements.add((float) planet[0], (float) planet[1], (float) (planet[2] * deg), (float) node,
+                     (float) (perihelion - node), (float) std::fmod(planet[3] * deg - perihelion, ORBIT_TWO_PI),
+                     1.0f, (float) meanMotion);
+    }
+}
+
+#endif
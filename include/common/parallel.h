@@ -0,0 +1,145 @@
+#ifndef PARALLEL_H
+#define PARALLEL_H
+
+#include <algorithm>
+#include <condition_variable>
+#include <cstddef>
+#include <functional>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+// Parallel loops over a persistent pool of worker threads.
+//
+// The pool is started on the first parallelFor and lives until the program exits, so per-frame callers (orbit and
+// satellite propagation, the BVH refit, the horizon star pack) only pay for waking the workers, not for creating
+// and joining threads. The pool runs one loop at a time: a loop started from another thread while it is busy gets
+// threads of its own (the old behavior, fine for the batch work of the tools and the background tasks), and a loop
+// nested in a parallelFor runs on the calling worker, since every core is already busy with the outer one.
+
+// number of worker threads to use (at least one)
+inline unsigned int workerCount() {
+    unsigned int n = std::thread::hardware_concurrency();
+    return n == 0 ? 1 : n;
+}
+
+// true on the threads running a parallelFor range (the workers of the pool and the caller while it waits)
+inline bool &insideParallelFor() {
+    thread_local bool inside = false;
+    return inside;
+}
+
+class WorkerPool {
+public:
+    // the pool shared by every parallelFor (workerCount() - 1 threads, the caller being the last one)
+    static WorkerPool &instance() {
+        static WorkerPool pool(workerCount() - 1);
+        return pool;
+    }
+
+    // threads of the pool
+    unsigned int size() const {
+        return (unsigned int) threads.size();
+    }
+
+    // calls task(w) for every w in [1, workers) on the pool and task(0) on the calling thread, returns false without
+    // calling anything if the pool is running a task of another thread or has too few threads
+    bool run(unsigned int workers, const std::function<void(unsigned int)> &task) {
+        if (workers > size() + 1) return false;
+        std::unique_lock<std::mutex> owner(busy, std::try_to_lock);
+        if (!owner.owns_lock()) return false;
+
+        {
+            std::lock_guard<std::mutex> lock(mutex);
+            current = &task;
+            jobs = workers;
+            pending = workers - 1;
+            generation++;
+        }
+        wake.notify_all();
+
+        insideParallelFor() = true;
+        task(0);
+        insideParallelFor() = false;
+
+        std::unique_lock<std::mutex> lock(mutex);
+        done.wait(lock, [this] { return pending == 0; });
+        current = nullptr;
+        return true;
+    }
+
+    WorkerPool(const WorkerPool &) = delete;
+    WorkerPool &operator=(const WorkerPool &) = delete;
+
+    ~WorkerPool() {
+        {
+            std::lock_guard<std::mutex> lock(mutex);
+            stopping = true;
+        }
+        wake.notify_all();
+        for (std::thread &thread: threads) thread.join();
+    }
+
+private:
+    explicit WorkerPool(unsigned int count) {
+        threads.reserve(count);
+        for (unsigned int w = 1; w <= count; w++) threads.emplace_back(&WorkerPool::loop, this, w);
+    }
+
+    // body of the worker w: runs its share of every task until the pool is destroyed
+    void loop(unsigned int w) {
+        insideParallelFor() = true;
+        unsigned long long seen = 0;
+        std::unique_lock<std::mutex> lock(mutex);
+        while (true) {
+            wake.wait(lock, [&] { return stopping || generation != seen; });
+            if (stopping) return;
+            seen = generation;
+            if (w >= jobs) continue; // not needed for this task
+
+            const std::function<void(unsigned int)> *task = current;
+            lock.unlock();
+            (*task)(w);
+            lock.lock();
+            if (--pending == 0) done.notify_one();
+        }
+    }
+
+    std::vector<std::thread> threads;
+    std::mutex busy; // held by the thread whose task is running
+    std::mutex mutex; // guards the task and the counters below
+    std::condition_variable wake, done;
+    const std::function<void(unsigned int)> *current = nullptr;
+    unsigned int jobs = 0; // workers of the running task, the caller included
+    unsigned int pending = 0; // workers of the pool still running their share
+    unsigned long long generation = 0; // tasks started so far
+    bool stopping = false;
+};
+
+// splits [0, count) into one contiguous range per worker and calls fn(begin, end, worker) on each of them
+// fn runs on the calling thread for the first range; returns once every range has been processed
+template<typename Function>
+void parallelFor(size_t count, Function fn, unsigned int workers = 0) {
+    if (workers == 0) workers = workerCount();
+    workers = (unsigned int) std::min<size_t>(workers, std::max<size_t>(count, 1));
+    if (workers == 1 || insideParallelFor()) {
+        fn(0, count, 0u);
+        return;
+    }
+
+    size_t chunk = (count + workers - 1) / workers;
+    auto range = [&](unsigned int w) {
+        size_t begin = std::min(count, w * chunk);
+        fn(begin, std::min(count, begin + chunk), w);
+    };
+    if (WorkerPool::instance().run(workers, range)) return;
+
+    std::vector<std::thread> threads;
+    threads.reserve(workers - 1);
+    for (unsigned int w = 1; w < workers; w++) threads.emplace_back(range, w);
+    range(0);
+
+    for (std::thread &thread: threads) thread.join();
+}
+
+#endif
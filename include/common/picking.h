@@ -0,0 +1,160 @@
+#ifndef PICKING_H
+#define PICKING_H
+
+#include <glm/glm.hpp>
+
+#include <algorithm>
+#include <cmath>
+#include <vector>
+
+#include "parallel.h"
+
+// Picking of bodies with a ray from the camera, answered on the CPU so the GPU pipeline is never stalled by a
+// read back. Bodies are bounding spheres (center and radius in scene units) in a bounding volume hierarchy whose
+// topology is built once; when the bodies move, the boxes are refit bottom-up in O(N) and the tree is only rebuilt
+// when refitting has made it noticeably worse. Points that are drawn with a size in pixels (asteroids, satellites)
+// get a tolerance cone around the ray, so they can be picked at any distance.
+
+const unsigned int BVH_LEAF_SIZE = 4; ///< spheres per leaf
+const float BVH_REBUILD_FACTOR = 2.0f; ///< rebuild when the refit tree's cost grows past this factor
+
+class SphereBvh {
+public:
+    // builds the hierarchy over the spheres (xyz center, w radius) with median splits along the longest axis
+    void build(const std::vector<glm::vec4> &spheres) {
+        order.resize(spheres.size());
+        for (unsigned int i = 0; i < order.size(); i++) order[i] = i;
+        nodes.clear();
+        nodes.reserve(2 * spheres.size() / BVH_LEAF_SIZE + 1);
+        nodes.push_back({glm::vec3(0.0f), 0, glm::vec3(0.0f), (unsigned int) spheres.size()});
+
+        std::vector<unsigned int> stack = {0};
+        while (!stack.empty()) {
+            unsigned int index = stack.back();
+            stack.pop_back();
+            unsigned int first = nodes[index].first, count = nodes[index].count;
+            fitLeaf(nodes[index], spheres);
+            if (count <= BVH_LEAF_SIZE) continue;
+
+            // split the centers at the median of the longest axis
+            glm::vec3 extent = nodes[index].max - nodes[index].min;
+            int axis = extent.x > extent.y ? (extent.x > extent.z ? 0 : 2) : (extent.y > extent.z ? 1 : 2);
+            unsigned int half = count / 2;
+            std::nth_element(order.begin() + first, order.begin() + first + half, order.begin() + first + count,
+                             [&spheres, axis](unsigned int a, unsigned int b) {
+                                 return spheres[a][axis] < spheres[b][axis];
+                             });
+
+            // children are stored next to each other after their parent, so refit can go backwards
+            auto left = (unsigned int) nodes.size();
+            nodes.push_back({glm::vec3(0.0f), first, glm::vec3(0.0f), half});
+            nodes.push_back({glm::vec3(0.0f), first + half, glm::vec3(0.0f), count - half});
+            nodes[index].first = left;
+            nodes[index].count = 0;
+            stack.push_back(left);
+            stack.push_back(left + 1);
+        }
+        builtCost = cost();
+    }
+
+    // moves the boxes to the new sphere positions (same spheres as the last build), rebuilding if needed
+    void refit(const std::vector<glm::vec4> &spheres) {
+        if (spheres.size() != order.size() || nodes.empty()) {
+            build(spheres);
+            return;
+        }
+        // leaves in parallel, then inner nodes from the last one (children are always stored after their parent)
+        parallelFor(nodes.size(), [this, &spheres](size_t begin, size_t end, unsigned int) {
+            for (size_t k = begin; k < end; k++) {
+                if (nodes[k].count > 0) fitLeaf(nodes[k], spheres);
+            }
+        });
+        for (size_t k = nodes.size(); k-- > 0;) {
+            BvhNode &node = nodes[k];
+            if (node.count > 0) continue;
+            node.min = glm::min(nodes[node.first].min, nodes[node.first + 1].min);
+            node.max = glm::max(nodes[node.first].max, nodes[node.first + 1].max);
+        }
+        if (cost() > BVH_REBUILD_FACTOR * builtCost) build(spheres);
+    }
+
+    // nearest sphere hit by the ray (unit direction) or -1; spheres are widened by coneTangent times their
+    // distance, distance returns the distance along the ray to the center of the hit sphere
+    int intersect(const std::vector<glm::vec4> &spheres, glm::vec3 origin, glm::vec3 direction, float coneTangent,
+                  float &distance) const {
+        int hit = -1;
+        distance = HUGE_VALF;
+        if (nodes.empty()) return hit;
+
+        glm::vec3 inverse = 1.0f / direction;
+        unsigned int stack[64];
+        int top = 0;
+        stack[top++] = 0;
+        while (top > 0) {
+            const BvhNode &node = nodes[stack[--top]];
+            if (!hitsBox(node, origin, inverse, coneTangent, distance)) continue;
+            if (node.count > 0) {
+                for (unsigned int k = node.first; k < node.first + node.count; k++) {
+                    glm::vec3 toCenter = glm::vec3(spheres[order[k]]) - origin;
+                    float along = glm::dot(toCenter, direction);
+                    if (along <= 0.0f || along >= distance) continue;
+                    float radius = spheres[order[k]].w + coneTangent * along;
+                    if (glm::dot(toCenter, toCenter) - along * along <= radius * radius) {
+                        distance = along;
+                        hit = (int) order[k];
+                    }
+                }
+            } else if (top + 2 <= 64) {
+                stack[top++] = node.first + 1;
+                stack[top++] = node.first;
+            }
+        }
+        return hit;
+    }
+
+private:
+    struct BvhNode {
+        glm::vec3 min;
+        unsigned int first; // first sphere of a leaf (in order), or left child of an inner node
+        glm::vec3 max;
+        unsigned int count; // spheres of a leaf, 0 for inner nodes
+    };
+
+    std::vector<BvhNode> nodes;
+    std::vector<unsigned int> order; // sphere indices grouped by leaf
+    float builtCost = 0.0f;
+
+    void fitLeaf(BvhNode &node, const std::vector<glm::vec4> &spheres) const {
+        node.min = glm::vec3(HUGE_VALF);
+        node.max = glm::vec3(-HUGE_VALF);
+        for (unsigned int k = node.first; k < node.first + node.count; k++) {
+            glm::vec3 center = glm::vec3(spheres[order[k]]);
+            node.min = glm::min(node.min, center - glm::vec3(spheres[order[k]].w));
+            node.max = glm::max(node.max, center + glm::vec3(spheres[order[k]].w));
+        }
+    }
+
+    // sum of the surface areas of the boxes (proportional to the expected cost of a random ray)
+    float cost() const {
+        float sum = 0.0f;
+        for (const BvhNode &node: nodes) {
+            glm::vec3 d = node.max - node.min;
+            sum += d.x * d.y + d.y * d.z + d.z * d.x;
+        }
+        return sum;
+    }
+
+    // slab test against the box widened by the cone at its farthest point, closer than the best hit so far
+    static bool hitsBox(const BvhNode &node, glm::vec3 origin, glm::vec3 inverse, float coneTangent, float best) {
+        glm::vec3 far = glm::max(glm::abs(node.min - origin), glm::abs(node.max - origin));
+        glm::vec3 pad = glm::vec3(coneTangent * glm::length(far));
+        glm::vec3 t0 = (node.min - pad - origin) * inverse;
+        glm::vec3 t1 = (node.max + pad - origin) * inverse;
+        glm::vec3 tNear = glm::min(t0, t1), tFar = glm::max(t0, t1);
+        float enter = std::max(std::max(tNear.x, tNear.y), std::max(tNear.z, 0.0f));
+        float exit = std::min(std::min(tFar.x, tFar.y), std::min(tFar.z, best));
+        return enter <= exit;
+    }
+};
+
+#endif
@@ -0,0 +1,340 @@
+#ifndef POSTER_H
+#define POSTER_H
+
+#include <glad/glad.h>
+
+#include <glm/glm.hpp>
+#include <glm/gtc/matrix_transform.hpp>
+
+#include <algorithm>
+#include <cstdint>
+#include <cstdio>
+#include <cstring>
+#include <vector>
+
+// Still images many times larger than the window (posters of 16k to 32k pixels), rendered in tiles.
+//
+// The poster is split into tiles of at most POSTER_TILE_SIZE pixels, rendered one per frame into the same
+// framebuffer with the view frozen. Each tile's projection is the poster's projection cropped to the tile in clip
+// space (the off-center sub-frustum of the tile, whatever the projection: conventional or reversed depth), and the
+// HUD is drawn with an orthographic projection of the same part of the window scaled to the poster. Tiles are
+// read back into pixel buffer objects and copied out one frame later, when the transfer is done, so the render
+// never waits for it. The tiles are rendered from the top band to the bottom one and every band is written as soon
+// as it is complete, so only one band of rows is ever kept in memory.
+//
+// The image is written as a PNG made of stored (uncompressed) deflate blocks, which needs no compression library
+// and can be streamed row by row: every row is its own IDAT chunk.
+// see more at: https://www.w3.org/TR/png/
+// and at: https://www.rfc-editor.org/rfc/rfc1950 (zlib stream) and https://www.rfc-editor.org/rfc/rfc1951
+
+const int POSTER_TILE_SIZE = 1024; ///< side of a tile (pixels, lowered to what the context supports)
+
+// writes a 24-bit RGB PNG one row at a time, from the top row to the bottom one
+class PngStreamWriter {
+public:
+    // writes the header, returns false if the file cannot be created
+    bool open(const char *path, uint32_t imageWidth, uint32_t imageHeight) {
+        file = std::fopen(path, "wb");
+        if (!file) return false;
+        width = imageWidth;
+        height = imageHeight;
+        rows = 0;
+        adlerA = 1;
+        adlerB = 0;
+        failed = false;
+
+        const unsigned char signature[8] = {0x89, 'P', 'N', 'G', '\r', '\n', 0x1a, '\n'};
+        write(signature, sizeof(signature));
+        unsigned char header[13];
+        putBigEndian(header, width);
+        putBigEndian(header + 4, height);
+        header[8] = 8; // bits per sample
+        header[9] = 2; // truecolor (RGB)
+        header[10] = header[11] = header[12] = 0; // deflate, adaptive filtering, no interlace
+        chunk("IHDR", header, sizeof(header));
+        const unsigned char zlibHeader[2] = {0x78, 0x01}; // deflate with a 32 KB window, no preset dictionary
+        chunk("IDAT", zlibHeader, sizeof(zlibHeader));
+        return !failed;
+    }
+
+    // appends a row of width RGB pixels (filter type 0, split into stored blocks of at most 65535 bytes)
+    void writeRow(const unsigned char *rgb) {
+        size_t size = 1 + (size_t) width * 3; // filter byte and pixels
+        size_t blocks = (size + 65534) / 65535;
+        auto length = (uint32_t) (size + blocks * 5);
+        unsigned char lengthBytes[4];
+        putBigEndian(lengthBytes, length);
+        write(lengthBytes, 4);
+        uint32_t crc = crcUpdate(0xffffffffu, (const unsigned char *) "IDAT", 4);
+        write("IDAT", 4);
+
+        const unsigned char filter = 0;
+        size_t offset = 0; // bytes of the row (with its filter byte) already written
+        while (offset < size) {
+            auto blockSize = (uint16_t) std::min<size_t>(size - offset, 65535);
+            unsigned char blockHeader[5] = {0, (unsigned char) (blockSize & 0xff), (unsigned char) (blockSize >> 8),
+                                            (unsigned char) (~blockSize & 0xff),
+                                            (unsigned char) ((~blockSize >> 8) & 0xff)}; // not final, stored
+            crc = crcUpdate(crc, blockHeader, 5);
+            write(blockHeader, 5);
+            size_t end = offset + blockSize;
+            if (offset == 0) {
+                crc = crcUpdate(crc, &filter, 1);
+                adler(&filter, 1);
+                write(&filter, 1);
+                offset = 1;
+            }
+            const unsigned char *pixels = rgb + offset - 1;
+            crc = crcUpdate(crc, pixels, end - offset);
+            adler(pixels, end - offset);
+            write(pixels, end - offset);
+            offset = end;
+        }
+        unsigned char crcBytes[4];
+        putBigEndian(crcBytes, crc ^ 0xffffffffu);
+        write(crcBytes, 4);
+        rows++;
+    }
+
+    // ends the deflate stream and the file, returns true if every row was written without errors
+    bool close() {
+        if (!file) return false;
+        unsigned char end[9] = {1, 0, 0, 0xff, 0xff}; // final empty stored block, then the adler-32 checksum
+        putBigEndian(end + 5, (adlerB << 16) | adlerA);
+        chunk("IDAT", end, sizeof(end));
+        chunk("IEND", nullptr, 0);
+        failed |= std::fclose(file) != 0;
+        file = nullptr;
+        return !failed && rows == height;
+    }
+
+private:
+    std::FILE *file = nullptr;
+    uint32_t width = 0;
+    uint32_t height = 0;
+    uint32_t rows = 0;
+    uint32_t adlerA = 1; // adler-32 of the uncompressed stream
+    uint32_t adlerB = 0;
+    bool failed = false;
+
+    void write(const void *data, size_t size) {
+        if (size != 0 && std::fwrite(data, 1, size, file) != size) failed = true;
+    }
+
+    void chunk(const char *type, const unsigned char *data, uint32_t size) {
+        unsigned char bytes[4];
+        putBigEndian(bytes, size);
+        write(bytes, 4);
+        write(type, 4);
+        write(data, size);
+        uint32_t crc = crcUpdate(crcUpdate(0xffffffffu, (const unsigned char *) type, 4), data, size);
+        putBigEndian(bytes, crc ^ 0xffffffffu);
+        write(bytes, 4);
+    }
+
+    void adler(const unsigned char *data, size_t size) {
+        while (size > 0) {
+            size_t run = std::min<size_t>(size, 5552); // largest run whose sums cannot overflow
+            for (size_t i = 0; i < run; i++) {
+                adlerA += data[i];
+                adlerB += adlerA;
+            }
+            adlerA %= 65521;
+            adlerB %= 65521;
+            data += run;
+            size -= run;
+        }
+    }
+
+    static uint32_t crcUpdate(uint32_t crc, const unsigned char *data, size_t size) {
+        static const std::vector<uint32_t> table = [] {
+            std::vector<uint32_t> result(256);
+            for (uint32_t n = 0; n < 256; n++) {
+                uint32_t c = n;
+                for (int k = 0; k < 8; k++) c = c & 1 ? 0xedb88320u ^ (c >> 1) : c >> 1;
+                result[n] = c;
+            }
+            return result;
+        }();
+        for (size_t i = 0; i < size; i++) crc = table[(crc ^ data[i]) & 0xff] ^ (crc >> 8);
+        return crc;
+    }
+
+    static void putBigEndian(unsigned char *bytes, uint32_t value) {
+        bytes[0] = (unsigned char) (value >> 24);
+        bytes[1] = (unsigned char) (value >> 16);
+        bytes[2] = (unsigned char) (value >> 8);
+        bytes[3] = (unsigned char) value;
+    }
+};
+
+// tiled render of a poster: a reusable tile framebuffer, two pixel buffers for the readback and the current band
+class PosterRender {
+public:
+    int width = 0; // poster size (pixels)
+    int height = 0;
+
+    // starts a poster written to path, returns false if the file or the framebuffer cannot be created
+    bool begin(const char *path, int posterWidth, int posterHeight) {
+        GLint maxSize = 0;
+        glGetIntegerv(GL_MAX_RENDERBUFFER_SIZE, &maxSize);
+        tileSize = std::min(POSTER_TILE_SIZE, (int) maxSize);
+        width = posterWidth;
+        height = posterHeight;
+        columns = (width + tileSize - 1) / tileSize;
+        tileCount = columns * ((height + tileSize - 1) / tileSize);
+        tile = 0;
+        if (tileSize <= 0 || !writer.open(path, (uint32_t) width, (uint32_t) height)) return false;
+
+        glGenFramebuffers(1, &FBO);
+        glGenRenderbuffers(1, &colorBuffer);
+        glGenRenderbuffers(1, &depthBuffer);
+        glBindFramebuffer(GL_FRAMEBUFFER, FBO);
+        glBindRenderbuffer(GL_RENDERBUFFER, colorBuffer);
+        glRenderbufferStorage(GL_RENDERBUFFER, GL_RGBA8, tileSize, tileSize);
+        glFramebufferRenderbuffer(GL_FRAMEBUFFER, GL_COLOR_ATTACHMENT0, GL_RENDERBUFFER, colorBuffer);
+        glBindRenderbuffer(GL_RENDERBUFFER, depthBuffer);
+        glRenderbufferStorage(GL_RENDERBUFFER, GL_DEPTH_COMPONENT32F, tileSize, tileSize); // any depth mode
+        glFramebufferRenderbuffer(GL_FRAMEBUFFER, GL_DEPTH_ATTACHMENT, GL_RENDERBUFFER, depthBuffer);
+        bool complete = glCheckFramebufferStatus(GL_FRAMEBUFFER) == GL_FRAMEBUFFER_COMPLETE;
+        glBindRenderbuffer(GL_RENDERBUFFER, 0);
+        glBindFramebuffer(GL_FRAMEBUFFER, 0);
+
+        glGenBuffers(2, PBO);
+        for (unsigned int buffer: PBO) {
+            glBindBuffer(GL_PIXEL_PACK_BUFFER, buffer);
+            glBufferData(GL_PIXEL_PACK_BUFFER, (GLsizeiptr) tileSize * tileSize * 4, nullptr, GL_STREAM_READ);
+        }
+        glBindBuffer(GL_PIXEL_PACK_BUFFER, 0);
+        band.assign((size_t) width * tileSize * 3, 0);
+        if (!complete) {
+            writer.close();
+            release();
+        }
+        return complete;
+    }
+
+    bool active() const {
+        return FBO != 0;
+    }
+
+    // tiles rendered so far and in total (for progress)
+    int progress() const {
+        return tile;
+    }
+
+    int tiles() const {
+        return tileCount;
+    }
+
+    // redirects rendering into the tile framebuffer, over the size of the current tile
+    void bindTile() const {
+        int x, y, w, h;
+        tileRect(tile, x, y, w, h);
+        glBindFramebuffer(GL_FRAMEBUFFER, FBO);
+        glViewport(0, 0, w, h);
+    }
+
+    // projection of the current tile: the poster's projection cropped in clip space to the tile's rectangle
+    glm::mat4 tileProjection(const glm::mat4 &projection) const {
+        int x, y, w, h;
+        tileRect(tile, x, y, w, h);
+        glm::mat4 crop(1.0f);
+        crop[0][0] = (float) width / (float) w;
+        crop[1][1] = (float) height / (float) h;
+        crop[3][0] = -(float) (2 * x + w - width) / (float) w; // moves the tile's center to the middle
+        crop[3][1] = -(float) (2 * y + h - height) / (float) h;
+        return crop * projection;
+    }
+
+    // orthographic projection of the current tile's part of a screen of screenWidth x screenHeight pixels
+    // (positions of the HUD, whose text then scales with the poster)
+    glm::mat4 hudProjection(float screenWidth, float screenHeight) const {
+        int x, y, w, h;
+        tileRect(tile, x, y, w, h);
+        float scaleX = screenWidth / (float) width, scaleY = screenHeight / (float) height;
+        return glm::ortho((float) x * scaleX, (float) (x + w) * scaleX, (float) y * scaleY, (float) (y + h) * scaleY);
+    }
+
+    // starts the readback of the rendered tile, copies the previous one and moves on; returns true when the
+    // poster is complete (success tells if it was written)
+    bool endTile(bool &success) {
+        int x, y, w, h;
+        tileRect(tile, x, y, w, h);
+        glBindFramebuffer(GL_READ_FRAMEBUFFER, FBO);
+        glBindBuffer(GL_PIXEL_PACK_BUFFER, PBO[tile % 2]);
+        glPixelStorei(GL_PACK_ALIGNMENT, 4);
+        glReadPixels(0, 0, w, h, GL_RGBA, GL_UNSIGNED_BYTE, nullptr); // returns at once, the copy is queued
+        glBindBuffer(GL_PIXEL_PACK_BUFFER, 0);
+        glBindFramebuffer(GL_FRAMEBUFFER, 0);
+
+        if (tile > 0) copyTile(tile - 1); // transferred while this tile was rendered
+        tile++;
+        if (tile < tileCount) return false;
+        copyTile(tile - 1);
+        success = writer.close();
+        release();
+        return true;
+    }
+
+    // stops the poster (the file is left incomplete)
+    void release() {
+        if (FBO != 0) {
+            glDeleteFramebuffers(1, &FBO);
+            glDeleteRenderbuffers(1, &colorBuffer);
+            glDeleteRenderbuffers(1, &depthBuffer);
+            glDeleteBuffers(2, PBO);
+        }
+        writer.close();
+        FBO = colorBuffer = depthBuffer = PBO[0] = PBO[1] = 0;
+        std::vector<unsigned char>().swap(band);
+    }
+
+private:
+    PngStreamWriter writer;
+    unsigned int FBO = 0;
+    unsigned int colorBuffer = 0;
+    unsigned int depthBuffer = 0;
+    unsigned int PBO[2] = {0, 0}; // readbacks of consecutive tiles
+    std::vector<unsigned char> band; // rows of the current band of tiles (RGB, top row first)
+    int tileSize = 0;
+    int columns = 0;
+    int tileCount = 0;
+    int tile = 0; // tile rendered this frame
+
+    // rectangle of a tile in the poster (origin at the bottom left): bands from the top, tiles from the left
+    void tileRect(int index, int &x, int &y, int &w, int &h) const {
+        int row = index / columns, column = index % columns;
+        x = column * tileSize;
+        w = std::min(tileSize, width - x);
+        int top = height - row * tileSize;
+        y = std::max(top - tileSize, 0);
+        h = top - y;
+    }
+
+    // copies a read back tile into the band, and writes the band once its last tile is in
+    void copyTile(int index) {
+        int x, y, w, h;
+        tileRect(index, x, y, w, h);
+        glBindBuffer(GL_PIXEL_PACK_BUFFER, PBO[index % 2]);
+        auto *pixels = (const unsigned char *) glMapBuffer(GL_PIXEL_PACK_BUFFER, GL_READ_ONLY);
+        if (pixels) {
+            for (int row = 0; row < h; row++) {
+                const unsigned char *source = pixels + (size_t) row * w * 4;
+                unsigned char *target = band.data() + ((size_t) (h - 1 - row) * width + x) * 3; // flipped
+                for (int i = 0; i < w; i++) {
+                    std::memcpy(target + i * 3, source + i * 4, 3);
+                }
+            }
+            glUnmapBuffer(GL_PIXEL_PACK_BUFFER);
+        }
+        glBindBuffer(GL_PIXEL_PACK_BUFFER, 0);
+
+        if (x + w < width) return;
+        for (int row = 0; row < h; row++) {
+            writer.writeRow(band.data() + (size_t) row * width * 3);
+        }
+    }
+};
+
+#endif
@@ -0,0 +1,109 @@
+#ifndef PROPAGATOR_H
+#define PROPAGATOR_H
+
+#include <chrono>
+#include <cmath>
+#include <cstddef>
+#include <iomanip>
+#include <iostream>
+#include <vector>
+
+#include "orbit.h"
+#include "parallel.h"
+#include "propagator_kernel.h"
+
+#if defined(SOLAR_SYSTEM_X86_SIMD) && defined(_MSC_VER)
+#include <intrin.h>
+#endif
+
+// Batch two-body propagator: evaluates position and velocity of every orbit in an OrbitalElements table at one
+// scene time. The kernel (propagator_kernel.h) is written once over a "lanes" type (scalar, AVX2 or AVX-512 wide
+// doubles), the wide versions are compiled in their own translation units (propagator_avx2.cpp,
+// propagator_avx512.cpp) and the widest one supported by the CPU is picked at runtime.
+
+#ifdef SOLAR_SYSTEM_X86_SIMD
+// wide kernels, defined in their own translation units compiled for the matching instruction set
+size_t propagateAvx2(const OrbitArrays &el, double time, const StateArrays &out, size_t begin, size_t end);
+
+size_t propagateAvx512(const OrbitArrays &el, double time, const StateArrays &out, size_t begin, size_t end);
+#endif
+
+// arrays of the elements seen by the kernels
+inline OrbitArrays orbitArrays(const OrbitalElements &el) {
+    return {el.semiMajorAxis.data(), el.eccentricity.data(), el.inclination.data(), el.ascendingNode.data(),
+            el.perihelion.data(), el.meanAnomaly.data(), el.meanMotion.data()};
+}
+
+// arrays of the state vectors seen by the kernels (valid until they are resized)
+inline StateArrays stateArrays(StateVectors &out) {
+    return {out.x.data(), out.y.data(), out.z.data(), out.vx.data(), out.vy.data(), out.vz.data()};
+}
+
+// widest vector (in doubles) the CPU and OS support: 8 (AVX-512), 4 (AVX2 + FMA) or 1
+inline size_t propagatorMaxWidth() {
+#if defined(SOLAR_SYSTEM_X86_SIMD) && (defined(__GNUC__) || defined(__clang__))
+    __builtin_cpu_init();
+    if (__builtin_cpu_supports("avx512f")) return 8;
+    if (__builtin_cpu_supports("avx2") && __builtin_cpu_supports("fma")) return 4;
+#elif defined(SOLAR_SYSTEM_X86_SIMD) && defined(_MSC_VER)
+    int info[4];
+    __cpuid(info, 1);
+    bool osSaves = (info[2] & (1 << 27)) != 0; // OSXSAVE
+    bool fma = (info[2] & (1 << 12)) != 0;
+    if (osSaves) {
+        unsigned long long xcr0 = _xgetbv(0);
+        __cpuidex(info, 7, 0);
+        if ((info[1] & (1 << 16)) && (xcr0 & 0xe6) == 0xe6) return 8; // AVX-512F with ZMM state enabled
+        if ((info[1] & (1 << 5)) && fma && (xcr0 & 0x6) == 0x6) return 4; // AVX2 with YMM state enabled
+    }
+#endif
+    return 1;
+}
+
+// propagates every orbit to the given scene time
+// width: vector width in doubles (0 picks the widest supported), threads: worker threads (0 uses every core)
+inline void propagateOrbits(const OrbitalElements &el, double time, StateVectors &out, size_t width = 0,
+                            unsigned int threads = 0) {
+    size_t maxWidth = propagatorMaxWidth();
+    if (width == 0 || width > maxWidth) width = maxWidth;
+    out.resize(el.count());
+    OrbitArrays elements = orbitArrays(el);
+    StateArrays states = stateArrays(out);
+
+    parallelFor(el.count(), [&](size_t begin, size_t end, unsigned int) {
+#ifdef SOLAR_SYSTEM_X86_SIMD
+        if (width >= 8) begin = propagateAvx512(elements, time, states, begin, end);
+        else if (width >= 4) begin = propagateAvx2(elements, time, states, begin, end);
+#endif
+        propagateLanes<ScalarLanes>(elements, time, states, begin, end);
+    }, threads);
+}
+
+// prints the propagation throughput (bodies per second) for every vector width and a range of thread counts
+inline void benchmarkPropagator(const OrbitalElements &el, std::ostream &os = std::cout) {
+    if (el.count() == 0) return;
+    StateVectors out;
+    size_t maxWidth = propagatorMaxWidth();
+
+    os << "Propagator benchmark: " << el.count() << " orbits" << std::endl;
+    os << std::setw(8) << "width" << std::setw(10) << "threads" << std::setw(18) << "bodies/s" << std::endl;
+    // powers of two up to every core
+    std::vector<unsigned int> threadCounts;
+    for (unsigned int threads = 1; threads < workerCount(); threads *= 2) threadCounts.push_back(threads);
+    threadCounts.push_back(workerCount());
+
+    for (size_t width = 1; width <= maxWidth; width *= 2) {
+        if (width == 2) continue; // no two-wide kernel
+        for (unsigned int threads: threadCounts) {
+            propagateOrbits(el, 0.0, out, width, threads); // warm up
+            const int runs = 3;
+            auto start = std::chrono::steady_clock::now();
+            for (int run = 0; run < runs; run++) propagateOrbits(el, run * 10.0, out, width, threads);
+            std::chrono::duration<double> elapsed = std::chrono::steady_clock::now() - start;
+            os << std::setw(8) << width << std::setw(10) << threads << std::setw(18) << std::fixed
+               << std::setprecision(0) << (double) el.count() * runs / elapsed.count() << std::endl;
+        }
+    }
+}
+
+#endif
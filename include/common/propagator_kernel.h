@@ -0,0 +1,148 @@
+#ifndef PROPAGATOR_KERNEL_H
+#define PROPAGATOR_KERNEL_H
+
+#include <cmath>
+#include <cstddef>
+
+// Kernel of the batch two-body propagator (see propagator.h), written once over a "lanes" type that wraps one
+// or more doubles. This header is also compiled into the AVX2/AVX-512 translation units, so it must stay free of
+// anything with static initialization, and the kernels only see raw arrays: an STL type used there would have its
+// inline members compiled with the wide instruction set, and the linker could keep that copy for the whole program
+// (orbit.h is not included for the same reason).
+
+const int PROPAGATOR_ITERATIONS = 5; ///< fixed number of Newton-Raphson steps for Kepler's equation
+const double LANES_PI = 3.14159265358979323846; ///< the same as ORBIT_PI
+const double LANES_TWO_PI = 2.0 * LANES_PI;
+
+// Arrays of an OrbitalElements table read by the kernels (see orbitArrays)
+struct OrbitArrays {
+    const float *semiMajorAxis;
+    const float *eccentricity;
+    const float *inclination;
+    const float *ascendingNode;
+    const float *perihelion;
+    const float *meanAnomaly;
+    const float *meanMotion;
+};
+
+// Arrays of a StateVectors table written by the kernels (see stateArrays)
+struct StateArrays {
+    double *x, *y, *z;
+    double *vx, *vy, *vz;
+};
+
+// Lanes of width 1: the portable fallback and the tail of the wide loops
+struct ScalarLanes {
+    typedef bool Mask;
+    static const size_t width = 1;
+    double v;
+
+    ScalarLanes() = default;
+
+    ScalarLanes(double value) : v(value) {}
+
+    static ScalarLanes load(const float *p) { return (double) *p; }
+
+    static ScalarLanes load(const double *p) { return *p; }
+
+    void store(double *p) const { *p = v; }
+
+    static ScalarLanes sqrt(ScalarLanes a) { return std::sqrt(a.v); }
+
+    static ScalarLanes floor(ScalarLanes a) { return std::floor(a.v); }
+
+    static ScalarLanes round(ScalarLanes a) { return std::nearbyint(a.v); }
+
+    static Mask less(ScalarLanes a, ScalarLanes b) { return a.v < b.v; }
+
+    static ScalarLanes select(Mask m, ScalarLanes a, ScalarLanes b) { return m ? a : b; }
+
+    friend ScalarLanes operator+(ScalarLanes a, ScalarLanes b) { return a.v + b.v; }
+
+    friend ScalarLanes operator-(ScalarLanes a, ScalarLanes b) { return a.v - b.v; }
+
+    friend ScalarLanes operator*(ScalarLanes a, ScalarLanes b) { return a.v * b.v; }
+
+    friend ScalarLanes operator/(ScalarLanes a, ScalarLanes b) { return a.v / b.v; }
+};
+
+// sine and cosine of every lane (Cody-Waite reduction to [-PI/4, PI/4] and Taylor polynomials, ~1e-14 accurate)
+template<typename V>
+inline void sinCosLanes(V x, V &s, V &c) {
+    const double pio2Hi = 1.57079632673412561417e+00;
+    const double pio2Mid = 6.07710050650619224932e-11;
+    const double pio2Lo = 2.02226624879595063154e-21;
+
+    V k = V::round(x * V(2.0 / LANES_PI));
+    V r = ((x - k * V(pio2Hi)) - k * V(pio2Mid)) - k * V(pio2Lo);
+    V r2 = r * r;
+
+    V ps = r + r * r2 * (V(-1.0 / 6.0) + r2 * (V(1.0 / 120.0) + r2 * (V(-1.0 / 5040.0) + r2 * (V(1.0 / 362880.0) +
+            r2 * (V(-1.0 / 39916800.0) + r2 * V(1.0 / 6227020800.0))))));
+    V pc = V(1.0) + r2 * (V(-0.5) + r2 * (V(1.0 / 24.0) + r2 * (V(-1.0 / 720.0) + r2 * (V(1.0 / 40320.0) +
+            r2 * (V(-1.0 / 3628800.0) + r2 * (V(1.0 / 479001600.0) + r2 * V(-1.0 / 87178291200.0)))))));
+
+    // quadrant (0..3) decides which polynomial and sign each lane takes
+    V q = k - V::floor(k * V(0.25)) * V(4.0);
+    V odd = q - V::floor(q * V(0.5)) * V(2.0);
+    typename V::Mask swap = V::less(V(0.5), odd);
+    V sinValue = V::select(swap, pc, ps);
+    V cosValue = V::select(swap, ps, pc);
+    s = V::select(V::less(q, V(1.5)), sinValue, V(0.0) - sinValue);
+    c = V::select(V::less((q - V(1.5)) * (q - V(1.5)), V(1.0)), V(0.0) - cosValue, cosValue);
+}
+
+// propagates orbits [begin, end) with the given lanes type while whole vectors fit, returns the first orbit
+// left for the caller (the remainder is done with scalar lanes in the baseline translation unit, so no scalar
+// code is ever compiled with a wider instruction set)
+template<typename V>
+inline size_t propagateLanes(const OrbitArrays &el, double time, const StateArrays &out, size_t begin, size_t end) {
+    size_t i = begin;
+    for (; i + V::width <= end; i += V::width) {
+        V a = V::load(&el.semiMajorAxis[i]);
+        V e = V::load(&el.eccentricity[i]);
+        V n = V::load(&el.meanMotion[i]);
+
+        // mean anomaly wrapped to [0, 2*PI)
+        V M = V::load(&el.meanAnomaly[i]) + n * V(time);
+        M = M - V::floor(M * V(1.0 / LANES_TWO_PI)) * V(LANES_TWO_PI);
+
+        // Kepler's equation with a fixed number of Newton-Raphson steps (no divergent branches)
+        V sinE, cosE;
+        sinCosLanes(M, sinE, cosE);
+        V E = M + e * sinE;
+        for (int k = 0; k < PROPAGATOR_ITERATIONS; k++) {
+            sinCosLanes(E, sinE, cosE);
+            E = E - (E - e * sinE - M) / (V(1.0) - e * cosE);
+        }
+        sinCosLanes(E, sinE, cosE);
+
+        // position and velocity in the orbital plane (perihelion along +x)
+        V b = a * V::sqrt(V(1.0) - e * e);
+        V px = a * (cosE - e);
+        V py = b * sinE;
+        V dE = n / (V(1.0) - e * cosE);
+        V qx = V(0.0) - a * sinE * dE;
+        V qy = b * cosE * dE;
+
+        // rotate by argument of perihelion, inclination and ascending node
+        V sw, cw, si, ci, sn, cn;
+        sinCosLanes(V::load(&el.perihelion[i]), sw, cw);
+        sinCosLanes(V::load(&el.inclination[i]), si, ci);
+        sinCosLanes(V::load(&el.ascendingNode[i]), sn, cn);
+
+        V xx = cw * cn - sw * ci * sn, xy = V(0.0) - sw * cn - cw * ci * sn;
+        V yx = cw * sn + sw * ci * cn, yy = cw * ci * cn - sw * sn;
+        V zx = sw * si, zy = cw * si;
+
+        (xx * px + xy * py).store(&out.x[i]);
+        (yx * px + yy * py).store(&out.y[i]);
+        (zx * px + zy * py).store(&out.z[i]);
+        (xx * qx + xy * qy).store(&out.vx[i]);
+        (yx * qx + yy * qy).store(&out.vy[i]);
+        (zx * qx + zy * qy).store(&out.vz[i]);
+    }
+    return i;
+}
+
+#endif
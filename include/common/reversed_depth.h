@@ -0,0 +1,98 @@
+#ifndef REVERSED_DEPTH_H
+#define REVERSED_DEPTH_H
+
+#include <glad/glad.h>
+
+#include <glm/glm.hpp>
+
+#include <cmath>
+
+// Reversed-Z rendering: depth 1 at the near plane falling to 0 at an infinitely far plane, stored in a 32-bit float
+// depth buffer. The float exponent then compensates the 1/z distribution of perspective depth, so precision stays
+// nearly uniform from the near plane to any distance and one depth pass covers the whole true scale solar system.
+// It needs glClipControl (OpenGL 4.5) to keep the depth in [0, 1] instead of [-1, 1], where the remapping to the
+// window's depth range would throw that precision away again, and a float depth attachment (the default
+// framebuffer usually has a 24-bit fixed point one). Depth is cleared to 0 and tested with GL_GREATER.
+// see more at: https://developer.nvidia.com/content/depth-precision-visualized
+
+// checks if the context can render with a reversed depth buffer
+inline bool reversedDepthSupported() {
+    return GLAD_GL_VERSION_4_5 && glClipControl != nullptr;
+}
+
+// perspective projection with reversed depth in [0, 1] and no far plane
+inline glm::mat4 reversedPerspective(float fovy, float aspect, float zNear) {
+    float f = 1.0f / std::tan(fovy / 2.0f);
+    glm::mat4 result(0.0f);
+    result[0][0] = f / aspect;
+    result[1][1] = f;
+    result[2][3] = -1.0f; // w = -z
+    result[3][2] = zNear; // depth = zNear / -z
+    return result;
+}
+
+// off-screen target with a 32-bit float depth buffer, copied to the window at the end of each frame
+class DepthTarget {
+public:
+    unsigned int FBO = 0;
+    int width = 0;
+    int height = 0;
+
+    // creates the color and depth attachments, returns false if the framebuffer is incomplete
+    bool create(int targetWidth, int targetHeight) {
+        width = targetWidth;
+        height = targetHeight;
+        glGenFramebuffers(1, &FBO);
+        glGenRenderbuffers(1, &colorBuffer);
+        glGenRenderbuffers(1, &depthBuffer);
+        glBindFramebuffer(GL_FRAMEBUFFER, FBO);
+        glBindRenderbuffer(GL_RENDERBUFFER, colorBuffer);
+        glRenderbufferStorage(GL_RENDERBUFFER, GL_RGBA8, width, height);
+        glFramebufferRenderbuffer(GL_FRAMEBUFFER, GL_COLOR_ATTACHMENT0, GL_RENDERBUFFER, colorBuffer);
+        glBindRenderbuffer(GL_RENDERBUFFER, depthBuffer);
+        glRenderbufferStorage(GL_RENDERBUFFER, GL_DEPTH_COMPONENT32F, width, height);
+        glFramebufferRenderbuffer(GL_FRAMEBUFFER, GL_DEPTH_ATTACHMENT, GL_RENDERBUFFER, depthBuffer);
+        bool complete = glCheckFramebufferStatus(GL_FRAMEBUFFER) == GL_FRAMEBUFFER_COMPLETE;
+        glBindRenderbuffer(GL_RENDERBUFFER, 0);
+        glBindFramebuffer(GL_FRAMEBUFFER, 0);
+        return complete;
+    }
+
+    // reallocates the attachments at a new size (the window's framebuffer was resized), keeping the framebuffer
+    void resize(int targetWidth, int targetHeight) {
+        width = targetWidth;
+        height = targetHeight;
+        glBindRenderbuffer(GL_RENDERBUFFER, colorBuffer);
+        glRenderbufferStorage(GL_RENDERBUFFER, GL_RGBA8, width, height);
+        glBindRenderbuffer(GL_RENDERBUFFER, depthBuffer);
+        glRenderbufferStorage(GL_RENDERBUFFER, GL_DEPTH_COMPONENT32F, width, height);
+        glBindRenderbuffer(GL_RENDERBUFFER, 0);
+    }
+
+    // redirects rendering into the target
+    void bind() const {
+        glBindFramebuffer(GL_FRAMEBUFFER, FBO);
+        glViewport(0, 0, width, height);
+    }
+
+    // copies the color to the window's framebuffer (scaled to its size) and binds it again
+    void blit(int windowWidth, int windowHeight) const {
+        glBindFramebuffer(GL_READ_FRAMEBUFFER, FBO);
+        glBindFramebuffer(GL_DRAW_FRAMEBUFFER, 0);
+        glBlitFramebuffer(0, 0, width, height, 0, 0, windowWidth, windowHeight, GL_COLOR_BUFFER_BIT, GL_LINEAR);
+        glBindFramebuffer(GL_FRAMEBUFFER, 0);
+    }
+
+    void release() {
+        glDeleteFramebuffers(1, &FBO);
+        glDeleteRenderbuffers(1, &colorBuffer);
+        glDeleteRenderbuffers(1, &depthBuffer);
+        FBO = colorBuffer = depthBuffer = 0;
+    }
+
+private:
+    unsigned int colorBuffer = 0;
+    unsigned int depthBuffer = 0;
+};
+
+#endif
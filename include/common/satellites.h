@@ -0,0 +1,113 @@
+#ifndef SATELLITES_H
+#define SATELLITES_H
+
+#include <glad/glad.h>
+
+#include <cmath>
+#include <random>
+#include <string>
+#include <vector>
+
+#include "orbit.h"
+#include "sgp4_kernel.h"
+#include "tle.h"
+
+// Renders earth satellites as point sprites around the earth. Positions are propagated on the CPU every frame
+// (see sgp4.h) and streamed into one vertex buffer in earth radii, so the model matrix only needs the earth's
+// center and radius.
+class SatelliteLayer {
+public:
+    unsigned int VAO = 0;
+    unsigned int VBO = 0;
+    GLsizei count = 0;
+
+    // streams the propagated positions (TEME km), skipping decayed or invalid ones
+    void update(const StateVectors &states) {
+        data.clear();
+        data.reserve(states.count() * 3);
+        for (size_t i = 0; i < states.count(); i++) {
+            double x = states.x[i] / SGP4_EARTH_RADIUS;
+            double y = states.y[i] / SGP4_EARTH_RADIUS;
+            double z = states.z[i] / SGP4_EARTH_RADIUS;
+            double r2 = x * x + y * y + z * z;
+            if (!(r2 >= 1.0 && r2 < 1e6)) continue; // also rejects NaN
+            data.push_back((float) x);
+            data.push_back((float) y);
+            data.push_back((float) z);
+        }
+        count = static_cast<GLsizei>(data.size() / 3);
+
+        if (VAO == 0) {
+            glGenVertexArrays(1, &VAO);
+            glGenBuffers(1, &VBO);
+            glBindVertexArray(VAO);
+            glBindBuffer(GL_ARRAY_BUFFER, VBO);
+            glVertexAttribPointer(0, 3, GL_FLOAT, GL_FALSE, 3 * sizeof(float), (void *) nullptr);
+            glEnableVertexAttribArray(0);
+            glBindVertexArray(0);
+        }
+        glBindBuffer(GL_ARRAY_BUFFER, VBO);
+        // orphan the previous storage so the driver does not wait for the last frame's draw
+        glBufferData(GL_ARRAY_BUFFER, (GLsizeiptr) (data.size() * sizeof(float)), nullptr, GL_STREAM_DRAW);
+        glBufferSubData(GL_ARRAY_BUFFER, 0, (GLsizeiptr) (data.size() * sizeof(float)), data.data());
+        glBindBuffer(GL_ARRAY_BUFFER, 0);
+    }
+
+    // draws every satellite as one point (shader must already be in use with model/view/projection set)
+    void draw() const {
+        if (count == 0) return;
+        glEnable(GL_PROGRAM_POINT_SIZE);
+        glBindVertexArray(VAO);
+        glDrawArrays(GL_POINTS, 0, count);
+        glBindVertexArray(0);
+        glDisable(GL_PROGRAM_POINT_SIZE);
+    }
+
+    void release() {
+        glDeleteVertexArrays(1, &VAO);
+        glDeleteBuffers(1, &VBO);
+        VAO = VBO = 0;
+        count = 0;
+    }
+
+private:
+    std::vector<float> data; // reused between frames
+};
+
+// appends a synthetic catalog (low earth orbit shells, navigation satellites and the geostationary belt)
+// with its epoch at the given time (days since J2000) and no drag, so it can be propagated for any time span
+inline void generateSatellites(SatelliteElements &elements, size_t count, double epoch, unsigned int seed = 3) {
+    const double earthMu = 398600.8; // km^3/s^2 (WGS-72)
+    std::mt19937 rng(seed);
+    std::uniform_real_distribution<double> angle(0.0, 360.0);
+    std::uniform_real_distribution<double> unit(0.0, 1.0);
+    std::normal_distribution<double> jitter(0.0, 0.3);
+
+    for (size_t i = 0; i < count; i++) {
+        double altitude, inclination, eccentricity = 0.0005 * unit(rng);
+        double family = unit(rng);
+        if (family < 0.5) { // broadband constellation shells
+            altitude = 540.0 + 30.0 * unit(rng);
+            inclination = 53.0 + jitter(rng);
+        } else if (family < 0.8) { // sun-synchronous
+            altitude = 500.0 + 400.0 * unit(rng);
+            inclination = 97.5 + jitter(rng);
+        } else if (family < 0.9) { // other low earth orbits
+            altitude = 350.0 + 1500.0 * unit(rng);
+            inclination = 30.0 + 60.0 * unit(rng);
+        } else if (family < 0.95) { // navigation constellations
+            altitude = 20200.0 + 1000.0 * unit(rng);
+            inclination = 55.0 + jitter(rng);
+        } else { // geostationary belt
+            altitude = 35786.0 + 50.0 * jitter(rng);
+            inclination = std::fabs(jitter(rng));
+        }
+
+        double a = SGP4_EARTH_RADIUS + altitude;
+        double revolutionsPerDay = 86400.0 / (ORBIT_TWO_PI * std::sqrt(a * a * a / earthMu));
+        elements.add("SYNTHETIC " + std::to_string(i + 1), (unsigned int) (i + 1), epoch, revolutionsPerDay,
+                     eccentricity, inclination, angle(rng), angle(rng), angle(rng), 0.0);
+    }
+}
+
+#endif
@@ -0,0 +1,365 @@
+#ifndef SGP4_H
+#define SGP4_H
+
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <cstddef>
+#include <iomanip>
+#include <iostream>
+#include <string>
+#include <vector>
+
+#include "parallel.h"
+#include "propagator.h"
+#include "sgp4_kernel.h"
+#include "tle.h"
+
+// Batch SGP4 propagator for earth satellites: sgp4Init turns the mean elements of a TLE catalog into per-satellite
+// coefficients once, propagateSatellites then evaluates every satellite at one time with the widest kernel the
+// CPU supports (see sgp4_kernel.h), split across every core. sgp4Reference is the plain scalar version used to
+// check the batch kernels.
+//
+// Only the near-earth model is implemented: satellites with periods of 225 minutes or more (deep space) use it
+// too, without the lunar-solar and resonance terms of SDP4, which is fine for display over a few days but drifts
+// by kilometres per day for those orbits.
+
+// Coefficients of many satellites in structure-of-arrays layout
+struct Sgp4Batch {
+    std::vector<double> field[SGP4_FIELD_COUNT];
+    std::vector<unsigned char> simple; // perigee below 220 km: the higher order drag terms are left out
+    std::vector<unsigned char> deepSpace; // period of 225 minutes or more (see sgp4Init)
+
+    size_t count() const {
+        return field[SGP4_EPOCH].size();
+    }
+
+    void resize(size_t n) {
+        for (std::vector<double> &f: field) f.resize(n);
+        simple.resize(n);
+        deepSpace.resize(n);
+    }
+
+    const double *operator[](Sgp4Field f) const {
+        return field[f].data();
+    }
+};
+
+#ifdef SOLAR_SYSTEM_X86_SIMD
+// wide kernels, defined in the same translation units as the two-body ones
+size_t sgp4Avx2(const Sgp4Arrays &batch, double days, const StateArrays &out, size_t begin, size_t end);
+
+size_t sgp4Avx512(const Sgp4Arrays &batch, double days, const StateArrays &out, size_t begin, size_t end);
+#endif
+
+// arrays of the coefficients seen by the kernels
+inline Sgp4Arrays sgp4Arrays(const Sgp4Batch &batch) {
+    Sgp4Arrays arrays;
+    for (int f = 0; f < SGP4_FIELD_COUNT; f++) arrays.field[f] = batch.field[f].data();
+    return arrays;
+}
+
+// computes the coefficients of every satellite (replaces the content of batch)
+inline void sgp4Init(const SatelliteElements &el, Sgp4Batch &batch) {
+    const double x2o3 = 2.0 / 3.0;
+    const double ss = 78.0 / SGP4_EARTH_RADIUS + 1.0;
+    const double qzms2t = std::pow((120.0 - 78.0) / SGP4_EARTH_RADIUS, 4.0);
+
+    batch.resize(el.count());
+    for (size_t i = 0; i < el.count(); i++) {
+        double ecco = el.eccentricity[i], inclo = el.inclination[i], argpo = el.perigee[i];
+        double mo = el.meanAnomaly[i], bstar = el.bstar[i];
+
+        // recover the original mean motion and semi-major axis from the Kozai mean motion
+        double eccsq = ecco * ecco;
+        double omeosq = 1.0 - eccsq;
+        double rteosq = std::sqrt(omeosq);
+        double cosio = std::cos(inclo), sinio = std::sin(inclo);
+        double cosio2 = cosio * cosio;
+        double ak = std::pow(SGP4_XKE / el.meanMotion[i], x2o3);
+        double d1 = 0.75 * SGP4_J2 * (3.0 * cosio2 - 1.0) / (rteosq * omeosq);
+        double del = d1 / (ak * ak);
+        double adel = ak * (1.0 - del * del - del * (1.0 / 3.0 + 134.0 * del * del / 81.0));
+        del = d1 / (adel * adel);
+        double no = el.meanMotion[i] / (1.0 + del);
+        double ao = std::pow(SGP4_XKE / no, x2o3);
+        double po = ao * omeosq;
+        double con42 = 1.0 - 5.0 * cosio2;
+        double con41 = -con42 - cosio2 - cosio2;
+        double posq = po * po;
+        double rp = ao * (1.0 - ecco);
+
+        bool deepSpace = ORBIT_TWO_PI / no >= 225.0;
+        bool simple = rp < 220.0 / SGP4_EARTH_RADIUS + 1.0 || deepSpace;
+
+        // atmospheric density parameters for low perigees
+        double sfour = ss, qzms24 = qzms2t;
+        double perige = (rp - 1.0) * SGP4_EARTH_RADIUS;
+        if (perige < 156.0) {
+            sfour = perige < 98.0 ? 20.0 : perige - 78.0;
+            qzms24 = std::pow((120.0 - sfour) / SGP4_EARTH_RADIUS, 4.0);
+            sfour = sfour / SGP4_EARTH_RADIUS + 1.0;
+        }
+
+        double pinvsq = 1.0 / posq;
+        double tsi = 1.0 / (ao - sfour);
+        double eta = ao * ecco * tsi;
+        double etasq = eta * eta;
+        double eeta = ecco * eta;
+        double psisq = std::fabs(1.0 - etasq);
+        double coef = qzms24 * std::pow(tsi, 4.0);
+        double coef1 = coef / std::pow(psisq, 3.5);
+        double cc2 = coef1 * no * (ao * (1.0 + 1.5 * etasq + eeta * (4.0 + etasq)) +
+                                   0.375 * SGP4_J2 * tsi / psisq * con41 * (8.0 + 3.0 * etasq * (8.0 + etasq)));
+        double cc1 = bstar * cc2;
+        double cc3 = ecco > 1e-4 ? -2.0 * coef * tsi * SGP4_J3OJ2 * no * sinio / ecco : 0.0;
+        double x1mth2 = 1.0 - cosio2;
+        double cc4 = 2.0 * no * coef1 * ao * omeosq *
+                     (eta * (2.0 + 0.5 * etasq) + ecco * (0.5 + 2.0 * etasq) -
+                      SGP4_J2 * tsi / (ao * psisq) *
+                      (-3.0 * con41 * (1.0 - 2.0 * eeta + etasq * (1.5 - 0.5 * eeta)) +
+                       0.75 * x1mth2 * (2.0 * etasq - eeta * (1.0 + etasq)) * std::cos(2.0 * argpo)));
+        double cc5 = 2.0 * coef1 * ao * omeosq * (1.0 + 2.75 * (etasq + eeta) + eeta * etasq);
+
+        // secular rates of the mean anomaly, argument of perigee and ascending node
+        double cosio4 = cosio2 * cosio2;
+        double temp1 = 1.5 * SGP4_J2 * pinvsq * no;
+        double temp2 = 0.5 * temp1 * SGP4_J2 * pinvsq;
+        double temp3 = -0.46875 * SGP4_J4 * pinvsq * pinvsq * no;
+        double mdot = no + 0.5 * temp1 * rteosq * con41 + 0.0625 * temp2 * rteosq * (13.0 - 78.0 * cosio2 + 137.0 * cosio4);
+        double argpdot = -0.5 * temp1 * con42 + 0.0625 * temp2 * (7.0 - 114.0 * cosio2 + 395.0 * cosio4) +
+                         temp3 * (3.0 - 36.0 * cosio2 + 49.0 * cosio4);
+        double xhdot1 = -temp1 * cosio;
+        double nodedot = xhdot1 + (0.5 * temp2 * (4.0 - 19.0 * cosio2) + 2.0 * temp3 * (3.0 - 7.0 * cosio2)) * cosio;
+
+        double *f[SGP4_FIELD_COUNT];
+        for (int k = 0; k < SGP4_FIELD_COUNT; k++) f[k] = &batch.field[k][i];
+        *f[SGP4_EPOCH] = el.epoch[i];
+        *f[SGP4_MO] = mo;
+        *f[SGP4_ARGPO] = argpo;
+        *f[SGP4_NODEO] = el.ascendingNode[i];
+        *f[SGP4_INCLO] = inclo;
+        *f[SGP4_ECCO] = ecco;
+        *f[SGP4_BSTAR] = bstar;
+        *f[SGP4_NO] = no;
+        *f[SGP4_AO] = ao;
+        *f[SGP4_MDOT] = mdot;
+        *f[SGP4_ARGPDOT] = argpdot;
+        *f[SGP4_NODEDOT] = nodedot;
+        *f[SGP4_NODECF] = 3.5 * omeosq * xhdot1 * cc1;
+        *f[SGP4_CC1] = cc1;
+        *f[SGP4_CC4] = cc4;
+        *f[SGP4_T2COF] = 1.5 * cc1;
+        *f[SGP4_ETA] = eta;
+        *f[SGP4_DELMO] = std::pow(1.0 + eta * std::cos(mo), 3.0);
+        *f[SGP4_SINMAO] = std::sin(mo);
+        // the (1 + cos i) divisor is kept away from zero for retrograde equatorial orbits
+        double xlcofDivisor = std::fabs(cosio + 1.0) > 1.5e-12 ? 1.0 + cosio : 1.5e-12;
+        *f[SGP4_XLCOF] = -0.25 * SGP4_J3OJ2 * sinio * (3.0 + 5.0 * cosio) / xlcofDivisor;
+        *f[SGP4_AYCOF] = -0.5 * SGP4_J3OJ2 * sinio;
+        *f[SGP4_CON41] = con41;
+        *f[SGP4_X1MTH2] = x1mth2;
+        *f[SGP4_X7THM1] = 7.0 * cosio2 - 1.0;
+        *f[SGP4_COSIO] = cosio;
+        *f[SGP4_SINIO] = sinio;
+
+        // higher order drag terms (left at zero for simple orbits, so the kernel needs no branch)
+        *f[SGP4_OMGCOF] = *f[SGP4_XMCOF] = *f[SGP4_CC5] = 0.0;
+        *f[SGP4_D2] = *f[SGP4_D3] = *f[SGP4_D4] = 0.0;
+        *f[SGP4_T3COF] = *f[SGP4_T4COF] = *f[SGP4_T5COF] = 0.0;
+        if (!simple) {
+            double cc1sq = cc1 * cc1;
+            double d2 = 4.0 * ao * tsi * cc1sq;
+            double temp = d2 * tsi * cc1 / 3.0;
+            double d3 = (17.0 * ao + sfour) * temp;
+            double d4 = 0.5 * temp * ao * tsi * (221.0 * ao + 31.0 * sfour) * cc1;
+            *f[SGP4_OMGCOF] = bstar * cc3 * std::cos(argpo);
+            *f[SGP4_XMCOF] = ecco > 1e-4 ? -x2o3 * coef * bstar / eeta : 0.0;
+            *f[SGP4_CC5] = cc5;
+            *f[SGP4_D2] = d2;
+            *f[SGP4_D3] = d3;
+            *f[SGP4_D4] = d4;
+            *f[SGP4_T3COF] = d2 + 2.0 * cc1sq;
+            *f[SGP4_T4COF] = 0.25 * (3.0 * d3 + cc1 * (12.0 * d2 + 10.0 * cc1sq));
+            *f[SGP4_T5COF] = 0.2 * (3.0 * d4 + 12.0 * cc1 * d3 + 6.0 * d2 * d2 + 15.0 * cc1sq * (2.0 * d2 + cc1sq));
+        }
+        batch.simple[i] = simple;
+        batch.deepSpace[i] = deepSpace;
+    }
+}
+
+// scalar reference: propagates satellite i to the given time (days since J2000) following the published
+// algorithm step by step (library trigonometry, branches, Kepler iterations until convergence)
+// returns false if the orbit has decayed or the elements became invalid
+inline bool sgp4Reference(const Sgp4Batch &b, size_t i, double days, double position[3], double velocity[3]) {
+    double t = (days - b[SGP4_EPOCH][i]) * 1440.0;
+    double t2 = t * t;
+
+    double xmdf = b[SGP4_MO][i] + b[SGP4_MDOT][i] * t;
+    double argpdf = b[SGP4_ARGPO][i] + b[SGP4_ARGPDOT][i] * t;
+    double nodedf = b[SGP4_NODEO][i] + b[SGP4_NODEDOT][i] * t;
+    double argpm = argpdf, mm = xmdf;
+    double nodem = nodedf + b[SGP4_NODECF][i] * t2;
+    double tempa = 1.0 - b[SGP4_CC1][i] * t;
+    double tempe = b[SGP4_BSTAR][i] * b[SGP4_CC4][i] * t;
+    double templ = b[SGP4_T2COF][i] * t2;
+
+    if (!b.simple[i]) {
+        double delomg = b[SGP4_OMGCOF][i] * t;
+        double delmtemp = 1.0 + b[SGP4_ETA][i] * std::cos(xmdf);
+        double delm = b[SGP4_XMCOF][i] * (delmtemp * delmtemp * delmtemp - b[SGP4_DELMO][i]);
+        double temp = delomg + delm;
+        mm = xmdf + temp;
+        argpm = argpdf - temp;
+        double t3 = t2 * t, t4 = t3 * t;
+        tempa = tempa - b[SGP4_D2][i] * t2 - b[SGP4_D3][i] * t3 - b[SGP4_D4][i] * t4;
+        tempe = tempe + b[SGP4_BSTAR][i] * b[SGP4_CC5][i] * (std::sin(mm) - b[SGP4_SINMAO][i]);
+        templ = templ + b[SGP4_T3COF][i] * t3 + t4 * (b[SGP4_T4COF][i] + t * b[SGP4_T5COF][i]);
+    }
+
+    double am = b[SGP4_AO][i] * tempa * tempa;
+    double nm = SGP4_XKE / std::pow(am, 1.5);
+    double em = b[SGP4_ECCO][i] - tempe;
+    if (em >= 1.0 || em < -0.001) return false;
+    if (em < 1e-6) em = 1e-6;
+    mm = mm + b[SGP4_NO][i] * templ;
+    double xlm = mm + argpm + nodem;
+    nodem = std::fmod(nodem, ORBIT_TWO_PI);
+    argpm = std::fmod(argpm, ORBIT_TWO_PI);
+    xlm = std::fmod(xlm, ORBIT_TWO_PI);
+    mm = std::fmod(xlm - argpm - nodem, ORBIT_TWO_PI);
+
+    // long period periodics
+    double axnl = em * std::cos(argpm);
+    double temp = 1.0 / (am * (1.0 - em * em));
+    double aynl = em * std::sin(argpm) + temp * b[SGP4_AYCOF][i];
+    double xl = mm + argpm + nodem + temp * b[SGP4_XLCOF][i] * axnl;
+
+    // Kepler's equation
+    double u = std::fmod(xl - nodem, ORBIT_TWO_PI);
+    double eo1 = u, tem5 = 9999.9, sineo1 = 0.0, coseo1 = 0.0;
+    for (int k = 0; std::fabs(tem5) >= 1e-12 && k < 10; k++) {
+        sineo1 = std::sin(eo1);
+        coseo1 = std::cos(eo1);
+        tem5 = (u - aynl * coseo1 + axnl * sineo1 - eo1) / (1.0 - coseo1 * axnl - sineo1 * aynl);
+        tem5 = std::max(-0.95, std::min(0.95, tem5));
+        eo1 += tem5;
+    }
+
+    // short period preliminary quantities
+    double ecose = axnl * coseo1 + aynl * sineo1;
+    double esine = axnl * sineo1 - aynl * coseo1;
+    double el2 = axnl * axnl + aynl * aynl;
+    double pl = am * (1.0 - el2);
+    if (pl < 0.0) return false;
+    double rl = am * (1.0 - ecose);
+    double rdotl = std::sqrt(am) * esine / rl;
+    double rvdotl = std::sqrt(pl) / rl;
+    double betal = std::sqrt(1.0 - el2);
+    temp = esine / (1.0 + betal);
+    double sinu = am / rl * (sineo1 - aynl - axnl * temp);
+    double cosu = am / rl * (coseo1 - axnl + aynl * temp);
+    double su = std::atan2(sinu, cosu);
+    double sin2u = (cosu + cosu) * sinu;
+    double cos2u = 1.0 - 2.0 * sinu * sinu;
+    temp = 1.0 / pl;
+    double temp1 = 0.5 * SGP4_J2 * temp;
+    double temp2 = temp1 * temp;
+
+    // short period periodics
+    double con41 = b[SGP4_CON41][i], x1mth2 = b[SGP4_X1MTH2][i], cosio = b[SGP4_COSIO][i];
+    double mrt = rl * (1.0 - 1.5 * temp2 * betal * con41) + 0.5 * temp1 * x1mth2 * cos2u;
+    su = su - 0.25 * temp2 * b[SGP4_X7THM1][i] * sin2u;
+    double xnode = nodem + 1.5 * temp2 * cosio * sin2u;
+    double xinc = b[SGP4_INCLO][i] + 1.5 * temp2 * cosio * b[SGP4_SINIO][i] * cos2u;
+    double mvt = rdotl - nm * temp1 * x1mth2 * sin2u / SGP4_XKE;
+    double rvdot = rvdotl + nm * temp1 * (x1mth2 * cos2u + 1.5 * con41) / SGP4_XKE;
+
+    // orientation vectors
+    double sinsu = std::sin(su), cossu = std::cos(su);
+    double snod = std::sin(xnode), cnod = std::cos(xnode);
+    double sini = std::sin(xinc), cosi = std::cos(xinc);
+    double xmx = -snod * cosi, xmy = cnod * cosi;
+    double ux = xmx * sinsu + cnod * cossu, uy = xmy * sinsu + snod * cossu, uz = sini * sinsu;
+    double vx = xmx * cossu - cnod * sinsu, vy = xmy * cossu - snod * sinsu, vz = sini * cossu;
+
+    position[0] = mrt * ux * SGP4_EARTH_RADIUS;
+    position[1] = mrt * uy * SGP4_EARTH_RADIUS;
+    position[2] = mrt * uz * SGP4_EARTH_RADIUS;
+    velocity[0] = (mvt * ux + rvdot * vx) * SGP4_VELOCITY;
+    velocity[1] = (mvt * uy + rvdot * vy) * SGP4_VELOCITY;
+    velocity[2] = (mvt * uz + rvdot * vz) * SGP4_VELOCITY;
+    return mrt >= 1.0;
+}
+
+// propagates every satellite to the given time (days since J2000)
+// width: vector width in doubles (0 picks the widest supported), threads: worker threads (0 uses every core)
+inline void propagateSatellites(const Sgp4Batch &batch, double days, StateVectors &out, size_t width = 0,
+                                unsigned int threads = 0) {
+    size_t maxWidth = propagatorMaxWidth();
+    if (width == 0 || width > maxWidth) width = maxWidth;
+    out.resize(batch.count());
+    Sgp4Arrays coefficients = sgp4Arrays(batch);
+    StateArrays states = stateArrays(out);
+
+    parallelFor(batch.count(), [&](size_t begin, size_t end, unsigned int) {
+#ifdef SOLAR_SYSTEM_X86_SIMD
+        if (width >= 8) begin = sgp4Avx512(coefficients, days, states, begin, end);
+        else if (width >= 4) begin = sgp4Avx2(coefficients, days, states, begin, end);
+#endif
+        sgp4Lanes<ScalarLanes>(coefficients, days, states, begin, end);
+    }, threads);
+}
+
+// prints the throughput of the scalar reference and of every batch kernel width, and the largest position
+// difference (km) between the batch kernels and the reference over the next week
+inline void benchmarkSgp4(const Sgp4Batch &batch, double days, std::ostream &os = std::cout) {
+    if (batch.count() == 0) return;
+    StateVectors out;
+    size_t maxWidth = propagatorMaxWidth();
+    const int runs = 5;
+
+    os << "SGP4 benchmark: " << batch.count() << " satellites" << std::endl;
+    os << std::setw(12) << "kernel" << std::setw(10) << "threads" << std::setw(14) << "ms/catalog"
+       << std::setw(16) << "max error (km)" << std::endl;
+
+    // scalar reference (one thread), positions kept to measure the error of the batch kernels
+    std::vector<std::vector<double>> reference(runs, std::vector<double>(batch.count() * 3));
+    std::vector<bool> valid(batch.count(), true);
+    auto start = std::chrono::steady_clock::now();
+    for (int run = 0; run < runs; run++) {
+        for (size_t i = 0; i < batch.count(); i++) {
+            double velocity[3];
+            if (!sgp4Reference(batch, i, days + run * 1.75, &reference[run][i * 3], velocity)) valid[i] = false;
+        }
+    }
+    std::chrono::duration<double, std::milli> elapsed = std::chrono::steady_clock::now() - start;
+    os << std::setw(12) << "reference" << std::setw(10) << 1 << std::setw(14) << std::fixed << std::setprecision(3)
+       << elapsed.count() / runs << std::setw(16) << "-" << std::endl;
+
+    for (size_t width = 1; width <= maxWidth; width *= 2) {
+        if (width == 2) continue; // no two-wide kernel
+        for (unsigned int threads: {1u, workerCount()}) {
+            propagateSatellites(batch, days, out, width, threads); // warm up
+            double error = 0.0;
+            std::chrono::duration<double, std::milli> total(0.0);
+            for (int run = 0; run < runs; run++) {
+                start = std::chrono::steady_clock::now();
+                propagateSatellites(batch, days + run * 1.75, out, width, threads);
+                total += std::chrono::steady_clock::now() - start;
+                for (size_t i = 0; i < batch.count(); i++) {
+                    if (!valid[i]) continue; // decayed orbits are not compared
+                    const double *r = &reference[run][i * 3];
+                    double dx = out.x[i] - r[0], dy = out.y[i] - r[1], dz = out.z[i] - r[2];
+                    error = std::max(error, std::sqrt(dx * dx + dy * dy + dz * dz));
+                }
+            }
+            os << std::setw(12) << "width " + std::to_string(width) << std::setw(10) << threads << std::setw(14)
+               << total.count() / runs << std::setw(16) << std::scientific << std::setprecision(2) << error
+               << std::fixed << std::setprecision(3) << std::endl;
+            if (workerCount() == 1) break;
+        }
+    }
+}
+
+#endif
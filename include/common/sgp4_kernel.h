@@ -0,0 +1,157 @@
+#ifndef SGP4_KERNEL_H
+#define SGP4_KERNEL_H
+
+#include <cstddef>
+
+#include "propagator_kernel.h"
+
+// Kernel of the batch SGP4 propagator (see sgp4.h), written over the same "lanes" types as the two-body
+// propagator. Every branch of the reference implementation is turned into per-satellite coefficients that are
+// zero when the branch is not taken, so all lanes run the same instructions. Like propagator_kernel.h, this
+// header is compiled into the AVX2/AVX-512 translation units and must stay free of static initialization and of
+// STL types (the coefficients are kept in Sgp4Batch, see sgp4.h, and the kernels only see its arrays).
+// see more at: https://celestrak.org/publications/AIAA/2006-6753/
+
+// WGS-72 constants used by the element sets
+const double SGP4_EARTH_RADIUS = 6378.135; // km
+const double SGP4_XKE = 0.0743669161331734132; // sqrt(GM) in earth radii^1.5 per minute
+const double SGP4_J2 = 0.001082616;
+const double SGP4_J3 = -0.00000253881;
+const double SGP4_J4 = -0.00000165597;
+const double SGP4_J3OJ2 = SGP4_J3 / SGP4_J2;
+const double SGP4_VELOCITY = SGP4_EARTH_RADIUS * SGP4_XKE / 60.0; // earth radii per minute to km/s
+const int SGP4_ITERATIONS = 6; ///< fixed number of Newton-Raphson steps for Kepler's equation
+
+// Per-satellite coefficients computed once by sgp4Init (names follow the reference implementation)
+enum Sgp4Field {
+    SGP4_EPOCH, SGP4_MO, SGP4_ARGPO, SGP4_NODEO, SGP4_INCLO, SGP4_ECCO, SGP4_BSTAR, SGP4_NO, SGP4_AO,
+    SGP4_MDOT, SGP4_ARGPDOT, SGP4_NODEDOT, SGP4_NODECF, SGP4_CC1, SGP4_CC4, SGP4_CC5, SGP4_T2COF,
+    SGP4_OMGCOF, SGP4_XMCOF, SGP4_ETA, SGP4_DELMO, SGP4_SINMAO, SGP4_D2, SGP4_D3, SGP4_D4,
+    SGP4_T3COF, SGP4_T4COF, SGP4_T5COF, SGP4_AYCOF, SGP4_XLCOF, SGP4_CON41, SGP4_X1MTH2, SGP4_X7THM1,
+    SGP4_COSIO, SGP4_SINIO, SGP4_FIELD_COUNT
+};
+
+// Arrays of an Sgp4Batch read by the kernels (see sgp4Arrays)
+struct Sgp4Arrays {
+    const double *field[SGP4_FIELD_COUNT];
+
+    const double *operator[](Sgp4Field f) const {
+        return field[f];
+    }
+};
+
+// propagates satellites [begin, end) to the given time (days since J2000) with the given lanes type while whole
+// vectors fit and returns the first satellite left for the caller; positions are TEME km, velocities km/s
+template<typename V>
+inline size_t sgp4Lanes(const Sgp4Arrays &b, double days, const StateArrays &out, size_t begin, size_t end) {
+    size_t i = begin;
+    for (; i + V::width <= end; i += V::width) {
+        V t = (V(days) - V::load(&b[SGP4_EPOCH][i])) * V(1440.0); // minutes since epoch
+        V t2 = t * t, t3 = t2 * t, t4 = t3 * t;
+        V bstar = V::load(&b[SGP4_BSTAR][i]);
+        V no = V::load(&b[SGP4_NO][i]);
+
+        // secular gravity and atmospheric drag
+        V xmdf = V::load(&b[SGP4_MO][i]) + V::load(&b[SGP4_MDOT][i]) * t;
+        V argpdf = V::load(&b[SGP4_ARGPO][i]) + V::load(&b[SGP4_ARGPDOT][i]) * t;
+        V nodem = V::load(&b[SGP4_NODEO][i]) + V::load(&b[SGP4_NODEDOT][i]) * t + V::load(&b[SGP4_NODECF][i]) * t2;
+
+        V sinM, cosM;
+        sinCosLanes(xmdf, sinM, cosM);
+        V delm = V(1.0) + V::load(&b[SGP4_ETA][i]) * cosM;
+        delm = V::load(&b[SGP4_XMCOF][i]) * (delm * delm * delm - V::load(&b[SGP4_DELMO][i]));
+        V temp = V::load(&b[SGP4_OMGCOF][i]) * t + delm;
+        V mm = xmdf + temp;
+        V argpm = argpdf - temp;
+
+        V tempa = V(1.0) - V::load(&b[SGP4_CC1][i]) * t - V::load(&b[SGP4_D2][i]) * t2 -
+                  V::load(&b[SGP4_D3][i]) * t3 - V::load(&b[SGP4_D4][i]) * t4;
+        V sinMm, cosMm;
+        sinCosLanes(mm, sinMm, cosMm);
+        V tempe = bstar * V::load(&b[SGP4_CC4][i]) * t +
+                  bstar * V::load(&b[SGP4_CC5][i]) * (sinMm - V::load(&b[SGP4_SINMAO][i]));
+        V templ = V::load(&b[SGP4_T2COF][i]) * t2 + V::load(&b[SGP4_T3COF][i]) * t3 +
+                  t4 * (V::load(&b[SGP4_T4COF][i]) + t * V::load(&b[SGP4_T5COF][i]));
+
+        V am = V::load(&b[SGP4_AO][i]) * tempa * tempa;
+        V nm = V(SGP4_XKE) / (am * V::sqrt(am));
+        V em = V::load(&b[SGP4_ECCO][i]) - tempe;
+        em = V::select(V::less(em, V(1e-6)), V(1e-6), em);
+        mm = mm + no * templ;
+
+        // long period periodics
+        V sinArgp, cosArgp;
+        sinCosLanes(argpm, sinArgp, cosArgp);
+        V axnl = em * cosArgp;
+        temp = V(1.0) / (am * (V(1.0) - em * em));
+        V aynl = em * sinArgp + temp * V::load(&b[SGP4_AYCOF][i]);
+        V u = mm + argpm + temp * V::load(&b[SGP4_XLCOF][i]) * axnl; // xl - nodem
+        u = u - V::floor(u * V(1.0 / LANES_TWO_PI)) * V(LANES_TWO_PI);
+
+        // Kepler's equation for E + argument of perigee (steps limited to 0.95 rad as in the reference)
+        V eo1 = u, sineo1, coseo1;
+        for (int k = 0; k < SGP4_ITERATIONS; k++) {
+            sinCosLanes(eo1, sineo1, coseo1);
+            V step = (u - aynl * coseo1 + axnl * sineo1 - eo1) / (V(1.0) - coseo1 * axnl - sineo1 * aynl);
+            step = V::select(V::less(V(0.95), step), V(0.95), step);
+            step = V::select(V::less(step, V(-0.95)), V(-0.95), step);
+            eo1 = eo1 + step;
+        }
+        sinCosLanes(eo1, sineo1, coseo1);
+
+        // short period preliminary quantities
+        V ecose = axnl * coseo1 + aynl * sineo1;
+        V esine = axnl * sineo1 - aynl * coseo1;
+        V el2 = axnl * axnl + aynl * aynl;
+        V pl = am * (V(1.0) - el2);
+        V rl = am * (V(1.0) - ecose);
+        V rdotl = V::sqrt(am) * esine / rl;
+        V rvdotl = V::sqrt(pl) / rl;
+        V betal = V::sqrt(V(1.0) - el2);
+        temp = esine / (V(1.0) + betal);
+        V sinu = am / rl * (sineo1 - aynl - axnl * temp);
+        V cosu = am / rl * (coseo1 - axnl + aynl * temp);
+        V norm = V(1.0) / V::sqrt(sinu * sinu + cosu * cosu);
+        sinu = sinu * norm;
+        cosu = cosu * norm;
+        V sin2u = (cosu + cosu) * sinu;
+        V cos2u = V(1.0) - V(2.0) * sinu * sinu;
+        temp = V(1.0) / pl;
+        V temp1 = V(0.5 * SGP4_J2) * temp;
+        V temp2 = temp1 * temp;
+
+        // short period periodics (the argument of latitude correction is applied with the angle sum formulas)
+        V con41 = V::load(&b[SGP4_CON41][i]);
+        V x1mth2 = V::load(&b[SGP4_X1MTH2][i]);
+        V cosio = V::load(&b[SGP4_COSIO][i]);
+        V mrt = rl * (V(1.0) - V(1.5) * temp2 * betal * con41) + V(0.5) * temp1 * x1mth2 * cos2u;
+        V dsu = V(-0.25) * temp2 * V::load(&b[SGP4_X7THM1][i]) * sin2u;
+        V xnode = nodem + V(1.5) * temp2 * cosio * sin2u;
+        V xinc = V::load(&b[SGP4_INCLO][i]) + V(1.5) * temp2 * cosio * V::load(&b[SGP4_SINIO][i]) * cos2u;
+        V mvt = rdotl - nm * temp1 * x1mth2 * sin2u * V(1.0 / SGP4_XKE);
+        V rvdot = rvdotl + nm * temp1 * (x1mth2 * cos2u + V(1.5) * con41) * V(1.0 / SGP4_XKE);
+
+        // orientation vectors
+        V sind, cosd, snod, cnod, sini, cosi;
+        sinCosLanes(dsu, sind, cosd);
+        sinCosLanes(xnode, snod, cnod);
+        sinCosLanes(xinc, sini, cosi);
+        V sinsu = sinu * cosd + cosu * sind;
+        V cossu = cosu * cosd - sinu * sind;
+        V xmx = V(0.0) - snod * cosi;
+        V xmy = cnod * cosi;
+        V ux = xmx * sinsu + cnod * cossu, uy = xmy * sinsu + snod * cossu, uz = sini * sinsu;
+        V vx = xmx * cossu - cnod * sinsu, vy = xmy * cossu - snod * sinsu, vz = sini * cossu;
+
+        V r = mrt * V(SGP4_EARTH_RADIUS);
+        (r * ux).store(&out.x[i]);
+        (r * uy).store(&out.y[i]);
+        (r * uz).store(&out.z[i]);
+        ((mvt * ux + rvdot * vx) * V(SGP4_VELOCITY)).store(&out.vx[i]);
+        ((mvt * uy + rvdot * vy) * V(SGP4_VELOCITY)).store(&out.vy[i]);
+        ((mvt * uz + rvdot * vz) * V(SGP4_VELOCITY)).store(&out.vz[i]);
+    }
+    return i;
+}
+
+#endif
@@ -0,0 +1,160 @@
+#ifndef SIM_CLOCK_H
+#define SIM_CLOCK_H
+
+#include <cmath>
+#include <cstdint>
+#include <cstdio>
+#include <ctime>
+#include <string>
+
+#include "orbit.h"
+
+// Simulation clock that drives every animation.
+//
+// Time is kept as an integer number of microseconds since J2000 (about 292,000 years of range), so it never loses
+// precision however long the application runs. The clock is advanced once per frame by the wall clock time of the
+// frame times the warp rate (fractions of a tick are carried over), and everything rendered in that frame reads the
+// same sample. Jumps to any epoch are O(1): they only replace the tick count.
+//
+// Warp is the ratio of simulated time to real time: x1 is real time and the default keeps the scene's historical
+// speed of one earth year per 2 * PI seconds.
+
+const int64_t CLOCK_TICKS_PER_SECOND = 1000000; ///< clock resolution (microseconds)
+const int64_t CLOCK_TICKS_PER_DAY = 86400 * CLOCK_TICKS_PER_SECOND;
+const double CLOCK_MIN_WARP = 1.0; ///< real time
+const double CLOCK_MAX_WARP = 1e7;
+const double CLOCK_DEFAULT_WARP = 86400.0 / SCENE_SECONDS_PER_DAY; ///< one year per 2 * PI seconds
+const int CLOCK_WARP_STEPS = 9;
+/// warps stepped through by stepWarp: decades, plus the default so it can always be reached again
+const double CLOCK_WARPS[CLOCK_WARP_STEPS] = {1.0, 10.0, 1e2, 1e3, 1e4, 1e5, 1e6, CLOCK_DEFAULT_WARP, 1e7};
+const double CLOCK_UNIX_J2000 = 946728000.0; ///< unix time of the J2000 epoch (seconds)
+
+class SimulationClock {
+public:
+    // advances the clock by one frame of realSeconds (or by the fixed step, if set) and samples it
+    void tick(double realSeconds) {
+        if (fixedStep > 0.0) realSeconds = fixedStep;
+        frameStart = current;
+        if (!paused) {
+            double advance = realSeconds * warpRate * (reversed ? -1.0 : 1.0) * CLOCK_TICKS_PER_SECOND + remainder;
+            double whole = std::floor(advance);
+            current += (int64_t) whole;
+            remainder = advance - whole;
+        }
+    }
+
+    // ticks since J2000 of the current frame
+    int64_t ticks() const {
+        return current;
+    }
+
+    // days since J2000 of the current frame
+    double days() const {
+        return (double) (current / CLOCK_TICKS_PER_DAY) +
+               (double) (current % CLOCK_TICKS_PER_DAY) / (double) CLOCK_TICKS_PER_DAY;
+    }
+
+    // scene time of the current frame (one earth year is 2 * PI)
+    double sceneTime() const {
+        return days() * SCENE_SECONDS_PER_DAY;
+    }
+
+    // scene time elapsed since the previous frame (negative when running backwards)
+    double sceneDelta() const {
+        return (double) (current - frameStart) / (double) CLOCK_TICKS_PER_DAY * SCENE_SECONDS_PER_DAY;
+    }
+
+    // jumps to an epoch given in days since J2000
+    void jumpTo(double days) {
+        current = (int64_t) std::llround(days * (double) CLOCK_TICKS_PER_DAY);
+        frameStart = current;
+        remainder = 0.0;
+    }
+
+    // jumps to an epoch given in scene time
+    void jumpToScene(double time) {
+        jumpTo(time / SCENE_SECONDS_PER_DAY);
+    }
+
+    // jumps to the current date of the system clock
+    void jumpToNow() {
+        jumpTo(((double) std::time(nullptr) - CLOCK_UNIX_J2000) / 86400.0);
+    }
+
+    double warp() const {
+        return warpRate;
+    }
+
+    void setWarp(double warp) {
+        warpRate = std::fmin(std::fmax(warp, CLOCK_MIN_WARP), CLOCK_MAX_WARP);
+    }
+
+    // moves the warp to the next step of CLOCK_WARPS above (direction > 0) or below (direction < 0) the current one
+    void stepWarp(int direction) {
+        if (direction > 0) {
+            for (double step: CLOCK_WARPS) {
+                if (step > warpRate * 1.000001) return setWarp(step);
+            }
+        } else {
+            for (int i = CLOCK_WARP_STEPS - 1; i >= 0; i--) {
+                if (CLOCK_WARPS[i] < warpRate / 1.000001) return setWarp(CLOCK_WARPS[i]);
+            }
+        }
+    }
+
+    bool isPaused() const {
+        return paused;
+    }
+
+    void setPaused(bool pause) {
+        paused = pause;
+    }
+
+    bool isReversed() const {
+        return reversed;
+    }
+
+    void setReversed(bool reverse) {
+        reversed = reverse;
+    }
+
+    // real seconds per frame used instead of the wall clock (0 to follow the wall clock), for reproducible runs
+    void setFixedStep(double realSeconds) {
+        fixedStep = realSeconds;
+    }
+
+    // calendar date and time (UTC, proleptic gregorian) of the current frame
+    std::string date() const {
+        int64_t seconds = current / CLOCK_TICKS_PER_SECOND - (current % CLOCK_TICKS_PER_SECOND < 0 ? 1 : 0);
+        seconds += 43200; // J2000 is 2000-01-01 12:00
+        int64_t day = seconds / 86400 - (seconds % 86400 < 0 ? 1 : 0);
+        int64_t second = seconds - day * 86400;
+
+        // civil date from days since 2000-01-01 (see: https://howardhinnant.github.io/date_algorithms.html)
+        int64_t z = day + 730425; // days since 0000-03-01
+        int64_t era = (z >= 0 ? z : z - 146096) / 146097;
+        int64_t dayOfEra = z - era * 146097;
+        int64_t yearOfEra = (dayOfEra - dayOfEra / 1460 + dayOfEra / 36524 - dayOfEra / 146096) / 365;
+        int64_t dayOfYear = dayOfEra - (365 * yearOfEra + yearOfEra / 4 - yearOfEra / 100);
+        int64_t monthIndex = (5 * dayOfYear + 2) / 153;
+        int64_t dayOfMonth = dayOfYear - (153 * monthIndex + 2) / 5 + 1;
+        int64_t month = monthIndex < 10 ? monthIndex + 3 : monthIndex - 9;
+        int64_t year = yearOfEra + era * 400 + (month <= 2 ? 1 : 0);
+
+        char text[64];
+        snprintf(text, sizeof(text), "%04lld-%02lld-%02lld %02lld:%02lld UTC", (long long) year, (long long) month,
+                 (long long) dayOfMonth, (long long) (second / 3600), (long long) (second % 3600 / 60));
+        return text;
+    }
+
+private:
+    int64_t current = 0; // ticks since J2000 of the current frame
+    int64_t frameStart = 0; // ticks since J2000 of the previous frame
+    double remainder = 0.0; // fraction of a tick carried to the next frame
+    double warpRate = CLOCK_DEFAULT_WARP;
+    double fixedStep = 0.0;
+    bool paused = false;
+    bool reversed = false;
+};
+
+#endif
@@ -0,0 +1,65 @@
+#ifndef STAR_OCTREE_H
+#define STAR_OCTREE_H
+
+#include <glm/glm.hpp>
+
+#include <cmath>
+#include <cstdint>
+
+#include "orbit.h"
+
+// On-disk octree of star points, built offline by tools/build_star_octree.cpp and streamed by star_streamer.h.
+//
+// Every node keeps up to STAR_NODE_CAPACITY stars of its cube: the brightest ones not already kept by one of its
+// ancestors, sorted from the brightest. Drawing a node and any subset of its ancestors therefore never duplicates
+// a star, and cutting the tree at any depth shows the brightest stars of each region (magnitude sorted LOD).
+//
+// File layout: StarOctreeHeader, the stars of every node (contiguous per node, StarPoint each), then the node
+// table (StarOctreeNode each, root first). Positions are heliocentric equatorial (ICRS) in parsecs.
+
+const uint32_t STAR_OCTREE_MAGIC = 0x54434f53; // "SOCT"
+const uint32_t STAR_OCTREE_VERSION = 1;
+const uint32_t STAR_NODE_CAPACITY = 4096; ///< stars kept by each node
+const int STAR_OCTREE_MAX_DEPTH = 24; ///< nodes at this depth keep all their stars (duplicate positions)
+
+struct StarOctreeHeader {
+    uint32_t magic;
+    uint32_t version;
+    uint64_t starCount;
+    uint64_t nodeCount;
+    uint64_t nodeOffset; // byte offset of the node table
+    float center[3]; // root cube (parsecs)
+    float halfSize;
+};
+
+struct StarOctreeNode {
+    float center[3]; // parsecs
+    float halfSize;
+    uint64_t firstStar; // index of the first star of the node in the star array
+    uint32_t starCount;
+    float brightest; // absolute magnitude of the brightest star in the node (its first one)
+    uint32_t children[8]; // node index of each octant, 0 when empty (the root is never a child)
+};
+
+// 16 bytes per star: position in parsecs, absolute magnitude and B-V color index in thousandths
+struct StarPoint {
+    float x;
+    float y;
+    float z;
+    int16_t magnitude;
+    int16_t color;
+};
+
+// octant of a point inside a cube (bit 0: +x, bit 1: +y, bit 2: +z)
+inline int starOctant(const float center[3], float x, float y, float z) {
+    return (x >= center[0] ? 1 : 0) | (y >= center[1] ? 2 : 0) | (z >= center[2] ? 4 : 0);
+}
+
+// rotation from heliocentric equatorial directions to scene directions (through the J2000 ecliptic)
+inline glm::mat3 equatorialToScene() {
+    auto c = (float) std::cos(J2000_OBLIQUITY), s = (float) std::sin(J2000_OBLIQUITY);
+    // equatorial (X, Y, Z) is ecliptic (X, Y cos + Z sin, Z cos - Y sin), which is the scene's (z, x, y)
+    return glm::mat3(glm::vec3(0.0f, 0.0f, 1.0f), glm::vec3(c, -s, 0.0f), glm::vec3(s, c, 0.0f));
+}
+
+#endif
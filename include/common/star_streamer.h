@@ -0,0 +1,187 @@
+#ifndef STAR_STREAMER_H
+#define STAR_STREAMER_H
+
+#include <glad/glad.h>
+
+#include <glm/glm.hpp>
+
+#include <algorithm>
+#include <cmath>
+#include <cstring>
+#include <queue>
+#include <vector>
+
+#include "mapped_file.h"
+#include "star_octree.h"
+
+// Out-of-core renderer of a star octree (see star_octree.h) of any size.
+//
+// The file is memory mapped without reading it: only the node table is touched at start-up. Every frame the tree
+// is walked from the root in order of screen-space error (the size in pixels of a node's cube seen from the
+// observer), refining nodes larger than STAR_PIXEL_ERROR and skipping those whose brightest star is fainter than
+// STAR_MAGNITUDE_LIMIT, until STAR_SLOTS nodes are selected. The GPU keeps a fixed buffer of STAR_SLOTS slots of
+// STAR_NODE_CAPACITY stars; selected nodes that are not resident are copied from the mapping into the least
+// recently used slots, at most STAR_UPLOADS per frame, and the nodes about to be needed (children of refined
+// nodes and selected nodes not uploaded yet) are prefetched by the OS in background. So memory and the work per
+// frame are bounded whatever the size of the catalog; the view just fills in over a few frames after a jump.
+
+const int STAR_SLOTS = 512; ///< nodes resident on the GPU (32 MB of stars)
+const int STAR_UPLOADS = 16; ///< nodes copied to the GPU per frame at most
+const float STAR_PIXEL_ERROR = 256.0f; ///< nodes whose cube spans more pixels than this are refined
+const float STAR_MAGNITUDE_LIMIT = 9.0f; ///< apparent magnitude of the faintest stars drawn
+
+class StarStreamer {
+public:
+    unsigned int VAO = 0;
+    unsigned int VBO = 0;
+
+    // maps the octree and allocates the GPU slots, returns false if the file is missing or invalid
+    bool open(const char *path) {
+        if (!file.open(path, false) || file.size() < sizeof(StarOctreeHeader)) return false;
+        std::memcpy(&header, file.data(), sizeof(header));
+        if (header.magic != STAR_OCTREE_MAGIC || header.version != STAR_OCTREE_VERSION || header.nodeCount == 0 ||
+            header.nodeOffset + header.nodeCount * sizeof(StarOctreeNode) > file.size()) {
+            file.close();
+            return false;
+        }
+        nodes = (const StarOctreeNode *) (file.data() + header.nodeOffset);
+        slotNode.assign(STAR_SLOTS, -1);
+        slotUsed.assign(STAR_SLOTS, 0);
+        nodeSlot.assign(header.nodeCount, -1);
+
+        glGenVertexArrays(1, &VAO);
+        glGenBuffers(1, &VBO);
+        glBindVertexArray(VAO);
+        glBindBuffer(GL_ARRAY_BUFFER, VBO);
+        glBufferData(GL_ARRAY_BUFFER, (GLsizeiptr) STAR_SLOTS * STAR_NODE_CAPACITY * sizeof(StarPoint), nullptr,
+                     GL_DYNAMIC_DRAW);
+
+        // position (parsecs), absolute magnitude and color index (thousandths)
+        glVertexAttribPointer(0, 3, GL_FLOAT, GL_FALSE, sizeof(StarPoint), (void *) nullptr);
+        glEnableVertexAttribArray(0);
+        glVertexAttribPointer(1, 2, GL_SHORT, GL_FALSE, sizeof(StarPoint), (void *) (3 * sizeof(float)));
+        glEnableVertexAttribArray(1);
+        glBindVertexArray(0);
+        glBindBuffer(GL_ARRAY_BUFFER, 0);
+        return true;
+    }
+
+    bool isOpen() const {
+        return nodes != nullptr;
+    }
+
+    // selects the nodes seen from the observer (equatorial parsecs) and uploads the missing ones;
+    // pixelsPerRadian is the screen height divided by the vertical field of view
+    void update(glm::dvec3 observer, float pixelsPerRadian) {
+        if (!isOpen()) return;
+        frame++;
+        selected.clear();
+
+        std::priority_queue<std::pair<float, uint32_t>> queue; // largest error first
+        queue.emplace(HUGE_VALF, 0);
+        while (!queue.empty() && selected.size() < (size_t) STAR_SLOTS) {
+            uint32_t index = queue.top().second;
+            float error = queue.top().first;
+            queue.pop();
+            selected.push_back(index);
+            if (error <= STAR_PIXEL_ERROR) continue;
+            for (uint32_t child: nodes[index].children) {
+                if (child == 0) continue;
+                double distance = cubeDistance(nodes[child], observer);
+                // the brightest star of the child is at least this far, skip it if even that one is too faint
+                double apparent = nodes[child].brightest + 5.0 * std::log10(std::max(distance, 1e-3) / 10.0);
+                if (apparent > STAR_MAGNITUDE_LIMIT) continue;
+                float childError = distance <= 0.0 ? HUGE_VALF :
+                                   (float) (2.0 * nodes[child].halfSize / distance) * pixelsPerRadian;
+                queue.emplace(childError, child);
+                if (childError > STAR_PIXEL_ERROR / 2.0f) prefetch(child); // likely refined soon
+            }
+        }
+
+        // copy the missing nodes, the most important first, into slots not used by this frame
+        for (uint32_t index: selected) {
+            if (nodeSlot[index] >= 0) slotUsed[nodeSlot[index]] = frame;
+        }
+        int uploads = 0;
+        for (uint32_t index: selected) {
+            if (nodeSlot[index] >= 0) continue;
+            if (uploads == STAR_UPLOADS) {
+                prefetch(index);
+                continue;
+            }
+            int slot = (int) (std::min_element(slotUsed.begin(), slotUsed.end()) - slotUsed.begin());
+            if (slotUsed[slot] == frame) break; // every slot is in use
+            if (slotNode[slot] >= 0) nodeSlot[slotNode[slot]] = -1;
+            slotNode[slot] = (int64_t) index;
+            nodeSlot[index] = slot;
+            slotUsed[slot] = frame;
+
+            const StarOctreeNode &node = nodes[index];
+            glBindBuffer(GL_ARRAY_BUFFER, VBO);
+            glBufferSubData(GL_ARRAY_BUFFER, (GLintptr) ((size_t) slot * STAR_NODE_CAPACITY * sizeof(StarPoint)),
+                            (GLsizeiptr) (std::min(node.starCount, STAR_NODE_CAPACITY) * sizeof(StarPoint)),
+                            file.data() + sizeof(StarOctreeHeader) + node.firstStar * sizeof(StarPoint));
+            glBindBuffer(GL_ARRAY_BUFFER, 0);
+            uploads++;
+        }
+
+        // draw ranges of the selected nodes that are resident
+        firsts.clear();
+        counts.clear();
+        for (uint32_t index: selected) {
+            if (nodeSlot[index] < 0) continue;
+            firsts.push_back((GLint) (nodeSlot[index] * STAR_NODE_CAPACITY));
+            counts.push_back((GLsizei) std::min(nodes[index].starCount, STAR_NODE_CAPACITY));
+        }
+    }
+
+    // draws the resident selected nodes as additive point sprites (shader must already be in use)
+    void draw() const {
+        if (firsts.empty()) return;
+        glEnable(GL_PROGRAM_POINT_SIZE);
+        glBlendFunc(GL_SRC_ALPHA, GL_ONE);
+        glBindVertexArray(VAO);
+        glMultiDrawArrays(GL_POINTS, firsts.data(), counts.data(), (GLsizei) firsts.size());
+        glBindVertexArray(0);
+        glBlendFunc(GL_SRC_ALPHA, GL_ONE_MINUS_SRC_ALPHA);
+        glDisable(GL_PROGRAM_POINT_SIZE);
+    }
+
+    void release() {
+        glDeleteVertexArrays(1, &VAO);
+        glDeleteBuffers(1, &VBO);
+        VAO = VBO = 0;
+        file.close();
+        nodes = nullptr;
+    }
+
+private:
+    MappedFile file;
+    StarOctreeHeader header{};
+    const StarOctreeNode *nodes = nullptr; // node table inside the mapping
+    std::vector<int64_t> slotNode; // node held by each slot (-1 when free)
+    std::vector<uint64_t> slotUsed; // last frame that selected the node of each slot
+    std::vector<int> nodeSlot; // slot of each node (-1 when not resident)
+    std::vector<uint32_t> selected; // nodes selected this frame, most important first
+    std::vector<GLint> firsts; // multi-draw ranges (reused every frame)
+    std::vector<GLsizei> counts;
+    uint64_t frame = 0;
+
+    // distance from the observer to the nearest point of a node's cube (0 inside)
+    static double cubeDistance(const StarOctreeNode &node, glm::dvec3 observer) {
+        double sum = 0.0;
+        for (int k = 0; k < 3; k++) {
+            double d = std::max(std::fabs(observer[k] - (double) node.center[k]) - (double) node.halfSize, 0.0);
+            sum += d * d;
+        }
+        return std::sqrt(sum);
+    }
+
+    void prefetch(uint32_t index) const {
+        const StarOctreeNode &node = nodes[index];
+        file.prefetch(sizeof(StarOctreeHeader) + node.firstStar * sizeof(StarPoint),
+                      std::min(node.starCount, STAR_NODE_CAPACITY) * sizeof(StarPoint));
+    }
+};
+
+#endif
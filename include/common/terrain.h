@@ -0,0 +1,360 @@
+#ifndef TERRAIN_H
+#define TERRAIN_H
+
+#include <glad/glad.h>
+
+#include <glm/glm.hpp>
+
+#include <algorithm>
+#include <cmath>
+#include <cstdint>
+#include <cstring>
+#include <queue>
+#include <unordered_map>
+#include <vector>
+
+#include "mapped_file.h"
+#include "terrain_tiles.h"
+
+// Close-up surface of a planet (focus mode): the cube sphere of terrain_tiles.h drawn in chunks, each chunk a node of
+// the quadtree of a face and the same shared grid of TERRAIN_GRID x TERRAIN_GRID quads. terrainVertex.glsl places the
+// grid on its chunk and pushes it out by the height in the alpha of the chunk's tile; skirts hanging from the edges
+// of every chunk hide the cracks between neighbors of different levels.
+//
+// Every frame the quadtrees are walked from the six faces in order of screen-space error (the size in pixels of a
+// quad of the chunk seen from the camera), splitting the chunks above TERRAIN_PIXEL_ERROR while fewer than
+// TERRAIN_MAX_CHUNKS are selected. Chunks behind the horizon of the planet or outside the view cone are dropped with
+// their subtree, so the vertices drawn depend on what is on screen, not on the size of the planet.
+//
+// The tiles are streamed like the stars (star_streamer.h): the file is memory mapped, the tile of each chunk (the
+// deepest level of the pyramid for chunks below it) is copied into the least recently used of TERRAIN_TILE_SLOTS
+// textures, at most TERRAIN_UPLOADS per frame, and the tiles still waited for or likely needed soon are prefetched
+// by the OS in background. Until its tile arrives, a chunk shows the part of its nearest resident ancestor (the six
+// tiles of level 0 always are).
+// see more at: https://tulrich.com/geekstuff/sig-notes.pdf (chunked LOD)
+
+const int TERRAIN_GRID = 32; ///< quads on the side of a chunk (the same as terrainVertex.glsl)
+const int TERRAIN_MAX_LEVEL = 14; ///< deepest chunks (the vertices are floats on a sphere of radius 1)
+const int TERRAIN_MAX_CHUNKS = 768; ///< chunks drawn per frame at most
+const float TERRAIN_PIXEL_ERROR = 3.0f; ///< chunks whose quads span more pixels than this are split
+const int TERRAIN_TILE_SLOTS = 128; ///< tiles resident on the GPU (43 MB with their mipmaps)
+const int TERRAIN_UPLOADS = 4; ///< tiles copied to the GPU per frame at most
+
+class PlanetTerrain {
+public:
+    unsigned int VAO = 0;
+    unsigned int VBO = 0;
+    unsigned int EBO = 0;
+
+    // maps the tiles of a planet, creates the grid and the GPU slots and uploads the tiles of level 0
+    // returns false if the file is missing or invalid
+    bool open(const char *path) {
+        if (!file.open(path, false) || file.size() < sizeof(TerrainTilesHeader)) return false;
+        std::memcpy(&header, file.data(), sizeof(header));
+        if (header.magic != TERRAIN_TILES_MAGIC || header.version != TERRAIN_TILES_VERSION || header.levels == 0 ||
+            header.levels > 16 ||
+            file.size() < sizeof(header) + terrainLevelStart((int) header.levels) * TERRAIN_TILE_BYTES) {
+            file.close();
+            return false;
+        }
+        createGrid();
+
+        slotTexture.assign(TERRAIN_TILE_SLOTS, 0);
+        slotTile.assign(TERRAIN_TILE_SLOTS, UINT64_MAX);
+        slotUsed.assign(TERRAIN_TILE_SLOTS, 0);
+        glGenTextures(TERRAIN_TILE_SLOTS, slotTexture.data());
+        for (unsigned int texture: slotTexture) {
+            glBindTexture(GL_TEXTURE_2D, texture);
+            glTexImage2D(GL_TEXTURE_2D, 0, GL_RGBA8, TERRAIN_TILE_SIZE, TERRAIN_TILE_SIZE, 0, GL_RGBA,
+                         GL_UNSIGNED_BYTE, nullptr);
+            glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_EDGE);
+            glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_EDGE);
+            glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_LINEAR_MIPMAP_LINEAR);
+            glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
+        }
+        glBindTexture(GL_TEXTURE_2D, 0);
+
+        // the faces are never evicted (every chunk falls back on them)
+        for (int face = 0; face < 6; face++) upload(terrainTileIndex(face, 0, 0, 0), face, UINT64_MAX);
+        return true;
+    }
+
+    bool isOpen() const {
+        return VAO != 0;
+    }
+
+    // selects the chunks seen from the camera and uploads their missing tiles; model is the matrix of the planet
+    // (a sphere of radius 1 in its model space), pixelsPerRadian the screen height divided by the vertical field
+    // of view and viewAngle the angle between the view direction and the corners of the screen
+    void update(const glm::dmat4 &model, glm::dvec3 eye, glm::dvec3 forward, float pixelsPerRadian, float viewAngle) {
+        if (!isOpen()) return;
+        frame++;
+
+        // camera in the model space of the planet (the model matrix is a rotation and a uniform scale)
+        double scale = glm::length(glm::dvec3(model[0]));
+        glm::dmat3 rotation(glm::dvec3(model[0]) / scale, glm::dvec3(model[1]) / scale, glm::dvec3(model[2]) / scale);
+        glm::dmat3 inverse = glm::transpose(rotation);
+        localEye = inverse * (eye - glm::dvec3(model[3])) / scale;
+        localForward = inverse * forward;
+        this->pixelsPerRadian = pixelsPerRadian;
+        this->viewAngle = viewAngle;
+
+        selected.clear();
+        candidates.clear();
+        std::priority_queue<std::pair<float, size_t>> queue; // largest error first
+        for (int face = 0; face < 6; face++) consider({(uint8_t) face, 0, 0, 0, 0.0f}, queue);
+        while (!queue.empty()) {
+            Chunk chunk = candidates[queue.top().second];
+            queue.pop();
+            bool split = chunk.error > TERRAIN_PIXEL_ERROR && chunk.level < TERRAIN_MAX_LEVEL &&
+                         selected.size() + queue.size() + 4 <= (size_t) TERRAIN_MAX_CHUNKS;
+            if (!split) {
+                selected.push_back(chunk);
+                continue;
+            }
+            for (uint32_t child = 0; child < 4; child++) {
+                consider({chunk.face, (uint8_t) (chunk.level + 1), chunk.x * 2 + (child & 1), chunk.y * 2 + (child >> 1),
+                          0.0f}, queue);
+            }
+        }
+
+        // the tiles drawn are kept, the missing ones are copied (most important first: the queue order)
+        for (const Chunk &chunk: selected) {
+            int slot = residentSlot(chunk);
+            if (slotUsed[slot] != UINT64_MAX) slotUsed[slot] = frame;
+        }
+        int uploads = 0;
+        for (const Chunk &chunk: selected) {
+            uint64_t tile = tileOf(chunk);
+            if (tileSlot.count(tile) != 0) continue;
+            if (uploads == TERRAIN_UPLOADS) {
+                prefetch(tile);
+                continue;
+            }
+            int slot = (int) (std::min_element(slotUsed.begin(), slotUsed.end()) - slotUsed.begin());
+            if (slotUsed[slot] >= frame) break; // every slot is in use
+            upload(tile, slot, frame);
+            uploads++;
+        }
+    }
+
+    // draws the selected chunks (the shader must already be in use, with the planet's model matrix); the tile of
+    // each chunk is bound to texture unit 0
+    void draw(unsigned int program) const {
+        if (!isOpen()) return;
+        GLint faceNormal = glGetUniformLocation(program, "faceNormal");
+        GLint faceU = glGetUniformLocation(program, "faceU");
+        GLint faceV = glGetUniformLocation(program, "faceV");
+        GLint chunkLocation = glGetUniformLocation(program, "chunk");
+        GLint tileLocation = glGetUniformLocation(program, "tile");
+        GLint skirtLocation = glGetUniformLocation(program, "skirt");
+        glUniform1f(glGetUniformLocation(program, "relief"), header.relief);
+
+        glActiveTexture(GL_TEXTURE0);
+        glBindVertexArray(VAO);
+        for (const Chunk &chunk: selected) {
+            // part of the chunk in the resident tile (its own or an ancestor's)
+            int slot = residentSlot(chunk);
+            int tileLevel = (int) levelOf(slotTile[slot]);
+            float side = (float) (1u << chunk.level);
+            uint32_t shift = chunk.level - tileLevel;
+            float tileScale = 1.0f / (float) (1u << shift);
+            glUniform3fv(faceNormal, 1, &TERRAIN_FACE_NORMAL[chunk.face][0]);
+            glUniform3fv(faceU, 1, &TERRAIN_FACE_U[chunk.face][0]);
+            glUniform3fv(faceV, 1, &TERRAIN_FACE_V[chunk.face][0]);
+            glUniform3f(chunkLocation, (float) chunk.x / side, (float) chunk.y / side, 1.0f / side);
+            glUniform3f(tileLocation, (float) (chunk.x - ((chunk.x >> shift) << shift)) * tileScale,
+                        (float) (chunk.y - ((chunk.y >> shift) << shift)) * tileScale, tileScale);
+            glUniform1f(skirtLocation, 0.05f * angularRadius(chunk) + header.relief);
+            glBindTexture(GL_TEXTURE_2D, slotTexture[slot]);
+            glDrawElements(GL_TRIANGLES, indexCount, GL_UNSIGNED_INT, nullptr);
+        }
+        glBindVertexArray(0);
+    }
+
+    // chunks drawn by the last update
+    size_t chunkCount() const {
+        return selected.size();
+    }
+
+    void release() {
+        if (!slotTexture.empty()) glDeleteTextures((GLsizei) slotTexture.size(), slotTexture.data());
+        glDeleteVertexArrays(1, &VAO);
+        glDeleteBuffers(1, &VBO);
+        glDeleteBuffers(1, &EBO);
+        VAO = VBO = EBO = 0;
+        slotTexture.clear();
+        slotTile.clear();
+        slotUsed.clear();
+        tileSlot.clear();
+        selected.clear();
+        file.close();
+    }
+
+private:
+    // node of the quadtree of a face: column x and row y of 2^level on the face
+    struct Chunk {
+        uint8_t face;
+        uint8_t level;
+        uint32_t x;
+        uint32_t y;
+        float error; // size in pixels of one of its quads
+    };
+
+    MappedFile file;
+    TerrainTilesHeader header{};
+    GLsizei indexCount = 0;
+    std::vector<unsigned int> slotTexture; // texture of each slot
+    std::vector<uint64_t> slotTile; // tile held by each slot (UINT64_MAX when free)
+    std::vector<uint64_t> slotUsed; // last frame that drew the tile of each slot (UINT64_MAX for level 0)
+    std::unordered_map<uint64_t, int> tileSlot; // slot of each resident tile
+    std::vector<Chunk> candidates; // chunks visited by the last update (indexed by the queue)
+    std::vector<Chunk> selected; // chunks drawn, most important first
+    uint64_t frame = 0;
+    glm::dvec3 localEye{0.0};
+    glm::dvec3 localForward{0.0};
+    float pixelsPerRadian = 1.0f;
+    float viewAngle = 1.0f;
+
+    // grid of the chunks (x and y from 0 to 1) with a skirt along each edge (z = 1 on the skirt's lower edge)
+    void createGrid() {
+        std::vector<glm::vec3> vertices;
+        std::vector<unsigned int> indices;
+        const int n = TERRAIN_GRID + 1;
+        for (int j = 0; j < n; j++) {
+            for (int i = 0; i < n; i++) vertices.emplace_back((float) i / TERRAIN_GRID, (float) j / TERRAIN_GRID, 0.0f);
+        }
+        for (int j = 0; j < TERRAIN_GRID; j++) {
+            for (int i = 0; i < TERRAIN_GRID; i++) {
+                unsigned int a = j * n + i;
+                indices.insert(indices.end(), {a, a + 1, a + n + 1, a, a + n + 1, a + n});
+            }
+        }
+        // the four edges: vertex k of edge e is grid vertex first[e] + k * step[e]
+        const int first[4] = {0, TERRAIN_GRID, n * TERRAIN_GRID, 0};
+        const int step[4] = {1, n, 1, n};
+        for (int e = 0; e < 4; e++) {
+            auto skirt = (unsigned int) vertices.size();
+            for (int k = 0; k < n; k++) {
+                glm::vec3 top = vertices[first[e] + k * step[e]];
+                vertices.emplace_back(top.x, top.y, 1.0f);
+            }
+            for (int k = 0; k < TERRAIN_GRID; k++) {
+                unsigned int a = first[e] + k * step[e], b = first[e] + (k + 1) * step[e];
+                indices.insert(indices.end(), {a, b, skirt + k + 1, a, skirt + k + 1, skirt + k});
+            }
+        }
+        indexCount = (GLsizei) indices.size();
+
+        glGenVertexArrays(1, &VAO);
+        glGenBuffers(1, &VBO);
+        glGenBuffers(1, &EBO);
+        glBindVertexArray(VAO);
+        glBindBuffer(GL_ARRAY_BUFFER, VBO);
+        glBufferData(GL_ARRAY_BUFFER, (GLsizeiptr) (vertices.size() * sizeof(glm::vec3)), vertices.data(),
+                     GL_STATIC_DRAW);
+        glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, EBO);
+        glBufferData(GL_ELEMENT_ARRAY_BUFFER, (GLsizeiptr) (indices.size() * sizeof(unsigned int)), indices.data(),
+                     GL_STATIC_DRAW);
+        glVertexAttribPointer(0, 3, GL_FLOAT, GL_FALSE, sizeof(glm::vec3), (void *) nullptr);
+        glEnableVertexAttribArray(0);
+        glBindVertexArray(0);
+        glBindBuffer(GL_ARRAY_BUFFER, 0);
+    }
+
+    static glm::dvec3 chunkCenter(const Chunk &chunk) {
+        double side = (double) (1u << chunk.level);
+        return terrainDirection(chunk.face, (chunk.x + 0.5) / side, (chunk.y + 0.5) / side);
+    }
+
+    // angle between the center of a chunk and its farthest corner
+    static float angularRadius(const Chunk &chunk) {
+        double side = (double) (1u << chunk.level);
+        glm::dvec3 center = chunkCenter(chunk);
+        double smallest = 1.0;
+        for (int corner = 0; corner < 4; corner++) {
+            glm::dvec3 direction = terrainDirection(chunk.face, (chunk.x + (corner & 1)) / side,
+                                                    (chunk.y + (corner >> 1)) / side);
+            smallest = std::min(smallest, glm::dot(center, direction));
+        }
+        return (float) std::acos(std::min(smallest, 1.0));
+    }
+
+    // queues a chunk with its screen-space error, unless it is behind the horizon or outside the view
+    void consider(Chunk chunk, std::priority_queue<std::pair<float, size_t>> &queue) {
+        glm::dvec3 center = chunkCenter(chunk);
+        double angle = angularRadius(chunk);
+        double radius = 2.0 * std::sin(angle / 2.0) + header.relief; // bounding sphere around the center
+
+        // behind the horizon: every point of the chunk is farther from the camera's direction than the horizon
+        // (of the highest possible point) plus the chunk's own radius
+        double distance = glm::length(localEye);
+        if (distance > 1.0) {
+            double horizon = std::acos(1.0 / distance) + std::acos(1.0 / (1.0 + header.relief));
+            double fromEye = std::acos(std::max(std::min(glm::dot(center, localEye / distance), 1.0), -1.0));
+            if (fromEye > horizon + angle) return;
+        }
+
+        // outside the view cone
+        glm::dvec3 toCenter = center - localEye;
+        double centerDistance = glm::length(toCenter);
+        if (centerDistance > radius) {
+            double offAxis = std::acos(std::max(std::min(glm::dot(toCenter / centerDistance, localForward), 1.0), -1.0));
+            if (offAxis > viewAngle + std::asin(radius / centerDistance)) return;
+        }
+
+        // one quad is about the side of the chunk (sqrt(2) times its angular radius) over the grid
+        double nearest = std::max(centerDistance - radius, 1e-9);
+        chunk.error = (float) (1.41421356 * angle / TERRAIN_GRID / nearest * pixelsPerRadian);
+        candidates.push_back(chunk);
+        queue.emplace(chunk.error, candidates.size() - 1);
+        if (chunk.error > TERRAIN_PIXEL_ERROR / 2.0f && chunk.level + 1u < header.levels) { // likely split soon
+            for (uint32_t child = 0; child < 4; child++) {
+                prefetch(terrainTileIndex(chunk.face, chunk.level + 1, chunk.x * 2 + (child & 1),
+                                          chunk.y * 2 + (child >> 1)));
+            }
+        }
+    }
+
+    // tile wanted by a chunk: its own, or its ancestor on the deepest level of the pyramid
+    uint64_t tileOf(const Chunk &chunk) const {
+        int level = std::min((int) chunk.level, (int) header.levels - 1);
+        uint32_t shift = chunk.level - level;
+        return terrainTileIndex(chunk.face, level, chunk.x >> shift, chunk.y >> shift);
+    }
+
+    // slot of the deepest resident tile over a chunk (level 0 always is)
+    int residentSlot(const Chunk &chunk) const {
+        for (int level = std::min((int) chunk.level, (int) header.levels - 1); level > 0; level--) {
+            uint32_t shift = chunk.level - level;
+            auto found = tileSlot.find(terrainTileIndex(chunk.face, level, chunk.x >> shift, chunk.y >> shift));
+            if (found != tileSlot.end()) return found->second;
+        }
+        return tileSlot.at(terrainTileIndex(chunk.face, 0, 0, 0));
+    }
+
+    // level of a tile from its index in the file
+    uint32_t levelOf(uint64_t tile) const {
+        uint32_t level = 0;
+        while (level + 1 < header.levels && terrainLevelStart((int) level + 1) <= tile) level++;
+        return level;
+    }
+
+    void upload(uint64_t tile, int slot, uint64_t used) {
+        if (slotTile[slot] != UINT64_MAX) tileSlot.erase(slotTile[slot]);
+        slotTile[slot] = tile;
+        slotUsed[slot] = used;
+        tileSlot[tile] = slot;
+        glBindTexture(GL_TEXTURE_2D, slotTexture[slot]);
+        glTexSubImage2D(GL_TEXTURE_2D, 0, 0, 0, TERRAIN_TILE_SIZE, TERRAIN_TILE_SIZE, GL_RGBA, GL_UNSIGNED_BYTE,
+                        file.data() + sizeof(TerrainTilesHeader) + tile * TERRAIN_TILE_BYTES);
+        glGenerateMipmap(GL_TEXTURE_2D);
+        glBindTexture(GL_TEXTURE_2D, 0);
+    }
+
+    void prefetch(uint64_t tile) const {
+        file.prefetch(sizeof(TerrainTilesHeader) + tile * TERRAIN_TILE_BYTES, TERRAIN_TILE_BYTES);
+    }
+};
+
+#endif
@@ -0,0 +1,72 @@
+#ifndef TERRAIN_TILES_H
+#define TERRAIN_TILES_H
+
+#include <glm/glm.hpp>
+
+#include <cmath>
+#include <cstdint>
+
+// On-disk pyramid of surface tiles of a planet, built offline by tools/build_planet_tiles.cpp and streamed by
+// terrain.h.
+//
+// The sphere is the six faces of a cube pushed out onto it. Each face is a quadtree: level l splits it into
+// 2^l x 2^l square tiles of TERRAIN_TILE_SIZE texels, so every level doubles the resolution of the one above.
+// Texels are RGBA: the color and, in alpha, the height above the lowest point of the planet (0 to 255 for 0 to
+// header.relief planet radii). The texels on the edges of a tile lie exactly on the edges of its square, so
+// neighboring tiles share their edge texels and bilinear filtering shows no seam between them.
+//
+// File layout: TerrainTilesHeader, then the tiles of every level, face, row and column in that order (fixed size,
+// so the offset of a tile is computed from its coordinates, see terrainTileIndex).
+
+const uint32_t TERRAIN_TILES_MAGIC = 0x454c4954; // "TILE"
+const uint32_t TERRAIN_TILES_VERSION = 1;
+const int TERRAIN_TILE_SIZE = 256; ///< texels on the side of a tile (the same as terrainVertex.glsl)
+const size_t TERRAIN_TILE_BYTES = (size_t) TERRAIN_TILE_SIZE * TERRAIN_TILE_SIZE * 4; ///< RGBA8 texels of a tile
+const double TERRAIN_PI = 3.14159265358979323846;
+
+struct TerrainTilesHeader {
+    uint32_t magic;
+    uint32_t version;
+    uint32_t levels; // levels of the pyramid (level 0 is one tile per face)
+    float relief; // height of an alpha of 255 (planet radii)
+};
+
+// cube faces in the planet's model space: each face is normal + (2s - 1) u + (2t - 1) v for s and t in [0, 1],
+// with u x v = normal (the faces are seen counterclockwise from outside)
+const glm::vec3 TERRAIN_FACE_NORMAL[6] = {glm::vec3(1.0f, 0.0f, 0.0f), glm::vec3(-1.0f, 0.0f, 0.0f),
+                                          glm::vec3(0.0f, 1.0f, 0.0f), glm::vec3(0.0f, -1.0f, 0.0f),
+                                          glm::vec3(0.0f, 0.0f, 1.0f), glm::vec3(0.0f, 0.0f, -1.0f)};
+const glm::vec3 TERRAIN_FACE_U[6] = {glm::vec3(0.0f, 1.0f, 0.0f), glm::vec3(0.0f, 0.0f, 1.0f),
+                                     glm::vec3(0.0f, 0.0f, 1.0f), glm::vec3(1.0f, 0.0f, 0.0f),
+                                     glm::vec3(1.0f, 0.0f, 0.0f), glm::vec3(0.0f, 1.0f, 0.0f)};
+const glm::vec3 TERRAIN_FACE_V[6] = {glm::vec3(0.0f, 0.0f, 1.0f), glm::vec3(0.0f, 1.0f, 0.0f),
+                                     glm::vec3(1.0f, 0.0f, 0.0f), glm::vec3(0.0f, 0.0f, 1.0f),
+                                     glm::vec3(0.0f, 1.0f, 0.0f), glm::vec3(1.0f, 0.0f, 0.0f)};
+
+// direction from the center of the planet of a point of a face (s and t in [0, 1])
+inline glm::dvec3 terrainDirection(int face, double s, double t) {
+    glm::dvec3 cube = glm::dvec3(TERRAIN_FACE_NORMAL[face]) + (2.0 * s - 1.0) * glm::dvec3(TERRAIN_FACE_U[face]) +
+                      (2.0 * t - 1.0) * glm::dvec3(TERRAIN_FACE_V[face]);
+    return glm::normalize(cube);
+}
+
+// texture coordinates of a direction in the planet textures, as mapped by the sphere of renderSphere (the poles are
+// on the z axis, v = 0 at +z)
+inline glm::dvec2 terrainTexCoords(glm::dvec3 direction) {
+    double u = std::atan2(direction.y, direction.x) / (2.0 * TERRAIN_PI);
+    double v = std::acos(std::fmax(-1.0, std::fmin(1.0, direction.z))) / TERRAIN_PI;
+    return glm::dvec2(u < 0.0 ? u + 1.0 : u, v);
+}
+
+// tiles of the levels above a level (6 faces of 4^l tiles each)
+inline uint64_t terrainLevelStart(int level) {
+    return 6 * (((uint64_t) 1 << (2 * level)) - 1) / 3;
+}
+
+// index of a tile in the file (x and y are its column and row on the face, below 2^level)
+inline uint64_t terrainTileIndex(int face, int level, uint32_t x, uint32_t y) {
+    uint64_t side = (uint64_t) 1 << level;
+    return terrainLevelStart(level) + (uint64_t) face * side * side + y * side + x;
+}
+
+#endif
@@ -0,0 +1,156 @@
+#ifndef TEXT_BATCH_H
+#define TEXT_BATCH_H
+
+#include <glad/glad.h>
+
+#include <glm/glm.hpp>
+
+#include <algorithm>
+#include <string>
+#include <vector>
+
+// Text drawn with a single draw call, for screens full of short strings (body labels).
+//
+// Every glyph of the font is copied once into one texture (the atlas, packed in shelves in the order the glyphs
+// are loaded), so the quads of any number of strings share that texture and are uploaded and drawn together.
+// Each vertex carries its own color, so strings can fade independently within the same batch.
+// see more at: https://learnopengl.com/In-Practice/Text-Rendering
+
+const int TEXT_ATLAS_SIZE = 1024; ///< width and height of the glyph atlas (texels)
+
+class TextBatch {
+public:
+    unsigned int VAO = 0;
+    unsigned int VBO = 0;
+    unsigned int texture = 0;
+
+    // copies a glyph bitmap (one byte per texel, rows from the top) into the atlas; advance is in 1/64 pixels
+    void addGlyph(unsigned char c, const unsigned char *bitmap, int width, int rows, int left, int top,
+                  unsigned int advance) {
+        if (c >= 128) return;
+        if (pixels.empty()) pixels.assign((size_t) TEXT_ATLAS_SIZE * TEXT_ATLAS_SIZE, 0);
+        if (shelfX + width + 1 > TEXT_ATLAS_SIZE) { // next shelf
+            shelfX = 0;
+            shelfY += shelfHeight + 1;
+            shelfHeight = 0;
+        }
+        Glyph &glyph = glyphs[c];
+        glyph.size = glm::ivec2(width, rows);
+        glyph.bearing = glm::ivec2(left, top);
+        glyph.advance = (float) (advance >> 6);
+        if (shelfY + rows > TEXT_ATLAS_SIZE) return; // atlas full: the glyph keeps its advance only
+
+        for (int row = 0; row < rows; row++) {
+            std::copy(bitmap + (size_t) row * width, bitmap + (size_t) (row + 1) * width,
+                      pixels.begin() + (size_t) (shelfY + row) * TEXT_ATLAS_SIZE + shelfX);
+        }
+        glyph.uvMin = glm::vec2((float) shelfX, (float) shelfY) / (float) TEXT_ATLAS_SIZE;
+        glyph.uvMax = glm::vec2((float) (shelfX + width), (float) (shelfY + rows)) / (float) TEXT_ATLAS_SIZE;
+        shelfX += width + 1; // one empty texel keeps linear filtering from bleeding into the neighbours
+        shelfHeight = std::max(shelfHeight, rows);
+    }
+
+    // uploads the atlas (after every addGlyph) and creates the vertex buffer
+    void create() {
+        glPixelStorei(GL_UNPACK_ALIGNMENT, 1);
+        glGenTextures(1, &texture);
+        glBindTexture(GL_TEXTURE_2D, texture);
+        glTexImage2D(GL_TEXTURE_2D, 0, GL_RED, TEXT_ATLAS_SIZE, TEXT_ATLAS_SIZE, 0, GL_RED, GL_UNSIGNED_BYTE,
+                     pixels.data());
+        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_EDGE);
+        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_EDGE);
+        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_LINEAR);
+        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
+        glBindTexture(GL_TEXTURE_2D, 0);
+        pixels.clear();
+        pixels.shrink_to_fit();
+
+        glGenVertexArrays(1, &VAO);
+        glGenBuffers(1, &VBO);
+        glBindVertexArray(VAO);
+        glBindBuffer(GL_ARRAY_BUFFER, VBO);
+
+        // position and texture coordinates, color
+        glVertexAttribPointer(0, 4, GL_FLOAT, GL_FALSE, 8 * sizeof(float), (void *) nullptr);
+        glEnableVertexAttribArray(0);
+        glVertexAttribPointer(1, 4, GL_FLOAT, GL_FALSE, 8 * sizeof(float), (void *) (4 * sizeof(float)));
+        glEnableVertexAttribArray(1);
+        glBindVertexArray(0);
+        glBindBuffer(GL_ARRAY_BUFFER, 0);
+    }
+
+    // width in pixels of a string drawn at scale
+    float measure(const std::string &text, float scale) const {
+        float width = 0.0f;
+        for (char c: text) width += glyphs[(unsigned char) c & 127].advance;
+        return width * scale;
+    }
+
+    // queues a string with its baseline starting at (x, y) in screen pixels
+    void add(const std::string &text, float x, float y, float scale, glm::vec4 color) {
+        for (char c: text) {
+            const Glyph &glyph = glyphs[(unsigned char) c & 127];
+            float x0 = x + (float) glyph.bearing.x * scale;
+            float y0 = y - (float) (glyph.size.y - glyph.bearing.y) * scale;
+            float x1 = x0 + (float) glyph.size.x * scale;
+            float y1 = y0 + (float) glyph.size.y * scale;
+            x += glyph.advance * scale;
+            if (glyph.size.x == 0 || glyph.size.y == 0) continue; // spaces
+
+            // bitmap rows start at the top, so the top of the quad samples uvMin.y
+            const float quad[6][4] = {
+                    {x0, y1, glyph.uvMin.x, glyph.uvMin.y},
+                    {x0, y0, glyph.uvMin.x, glyph.uvMax.y},
+                    {x1, y0, glyph.uvMax.x, glyph.uvMax.y},
+                    {x0, y1, glyph.uvMin.x, glyph.uvMin.y},
+                    {x1, y0, glyph.uvMax.x, glyph.uvMax.y},
+                    {x1, y1, glyph.uvMax.x, glyph.uvMin.y}
+            };
+            for (const float *vertex: quad) {
+                vertices.insert(vertices.end(), vertex, vertex + 4);
+                vertices.insert(vertices.end(), {color.x, color.y, color.z, color.w});
+            }
+        }
+    }
+
+    // draws every queued string in one call and empties the batch (shader must already be in use)
+    void draw() {
+        if (vertices.empty()) return;
+        glBindBuffer(GL_ARRAY_BUFFER, VBO);
+        glBufferData(GL_ARRAY_BUFFER, (GLsizeiptr) (vertices.size() * sizeof(float)), vertices.data(),
+                     GL_STREAM_DRAW); // a new store each frame, so the GPU never waits for the previous one
+        glBindBuffer(GL_ARRAY_BUFFER, 0);
+        glActiveTexture(GL_TEXTURE0);
+        glBindTexture(GL_TEXTURE_2D, texture);
+        glBindVertexArray(VAO);
+        glDrawArrays(GL_TRIANGLES, 0, (GLsizei) (vertices.size() / 8));
+        glBindVertexArray(0);
+        glBindTexture(GL_TEXTURE_2D, 0);
+        vertices.clear();
+    }
+
+    void release() {
+        glDeleteVertexArrays(1, &VAO);
+        glDeleteBuffers(1, &VBO);
+        glDeleteTextures(1, &texture);
+        VAO = VBO = texture = 0;
+    }
+
+private:
+    struct Glyph {
+        glm::vec2 uvMin = glm::vec2(0.0f); // atlas coordinates of the bitmap's top left corner
+        glm::vec2 uvMax = glm::vec2(0.0f);
+        glm::ivec2 size = glm::ivec2(0); // bitmap size
+        glm::ivec2 bearing = glm::ivec2(0); // offset from the baseline to the left and top of the bitmap
+        float advance = 0.0f; // pixels to the next glyph
+    };
+
+    Glyph glyphs[128];
+    std::vector<unsigned char> pixels; // atlas being packed (freed once uploaded)
+    int shelfX = 0;
+    int shelfY = 0;
+    int shelfHeight = 0;
+    std::vector<float> vertices; // position, texture coordinates and color of each vertex
+};
+
+#endif
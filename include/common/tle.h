@@ -0,0 +1,156 @@
+#ifndef TLE_H
+#define TLE_H
+
+#include <cmath>
+#include <cstdlib>
+#include <cstring>
+#include <string>
+#include <vector>
+
+#include "mapped_file.h"
+#include "mpcorb.h"
+#include "orbit.h"
+
+// Parser for NORAD two-line element sets (TLE), optionally preceded by a name line (three-line format)
+// see more at: https://celestrak.org/NORAD/documentation/tle-fmt.php
+
+const int TLE_LINE = 69; // every element line has 69 columns, the last one is a checksum
+
+// Mean elements of many earth satellites in structure-of-arrays layout (angles in radians)
+struct SatelliteElements {
+    std::vector<double> epoch; // days since J2000
+    std::vector<double> meanMotion; // radians per minute (Kozai mean motion as given by the TLE)
+    std::vector<double> eccentricity;
+    std::vector<double> inclination;
+    std::vector<double> ascendingNode; // right ascension of the ascending node
+    std::vector<double> perigee; // argument of perigee
+    std::vector<double> meanAnomaly; // mean anomaly at epoch
+    std::vector<double> bstar; // drag term (1 / earth radii)
+    std::vector<unsigned int> catalogNumber;
+    std::vector<std::string> name;
+
+    size_t count() const {
+        return epoch.size();
+    }
+
+    void clear() {
+        epoch.clear();
+        meanMotion.clear();
+        eccentricity.clear();
+        inclination.clear();
+        ascendingNode.clear();
+        perigee.clear();
+        meanAnomaly.clear();
+        bstar.clear();
+        catalogNumber.clear();
+        name.clear();
+    }
+
+    // appends one satellite (epoch in days since J2000, mean motion in revolutions per day, angles in degrees)
+    void add(const std::string &name_, unsigned int number, double epoch_, double revolutionsPerDay, double e,
+             double i, double node, double peri, double m0, double bstar_) {
+        const double degree = ORBIT_PI / 180.0;
+        epoch.push_back(epoch_);
+        meanMotion.push_back(revolutionsPerDay * ORBIT_TWO_PI / 1440.0);
+        eccentricity.push_back(e);
+        inclination.push_back(i * degree);
+        ascendingNode.push_back(node * degree);
+        perigee.push_back(peri * degree);
+        meanAnomaly.push_back(m0 * degree);
+        bstar.push_back(bstar_);
+        catalogNumber.push_back(number);
+        name.push_back(name_);
+    }
+};
+
+// checks the modulo 10 checksum in column 69 (digits count their value, minus signs count 1)
+inline bool tleChecksum(const char *line) {
+    int sum = 0;
+    for (int k = 0; k < TLE_LINE - 1; k++) {
+        if (line[k] >= '0' && line[k] <= '9') sum += line[k] - '0';
+        else if (line[k] == '-') sum += 1;
+    }
+    return line[TLE_LINE - 1] - '0' == sum % 10;
+}
+
+// parses a field with an implied leading decimal point and a power of ten, such as " 13844-3" (0.13844e-3)
+inline bool tleExponentField(const char *line, int first, int last, double &value) {
+    char text[16];
+    int length = 0;
+    for (int k = first - 1; k < last && length < 12; k++) {
+        char c = line[k];
+        if (c == ' ') continue;
+        // the sign of the exponent is the last sign of the field
+        if ((c == '-' || c == '+') && length > 0) text[length++] = 'e';
+        else if (length == 0 || (length == 1 && (text[0] == '-' || text[0] == '+'))) {
+            if (c != '-' && c != '+') text[length++] = '.';
+        }
+        text[length++] = c;
+    }
+    if (length == 0) return false;
+    text[length] = '\0';
+    char *end;
+    value = std::strtod(text, &end);
+    return end == text + length;
+}
+
+// parses one element set, returns false if a line is malformed or fails its checksum
+inline bool tleParseLines(const char *line1, const char *line2, const std::string &name,
+                          SatelliteElements &elements) {
+    if (line1[0] != '1' || line2[0] != '2' || !tleChecksum(line1) || !tleChecksum(line2)) return false;
+
+    double number, year, day, bstar, i, node, e, peri, m, n;
+    if (!mpcorbField(line1, 3, 7, number) || !mpcorbField(line1, 19, 20, year) ||
+        !mpcorbField(line1, 21, 32, day) || !tleExponentField(line1, 54, 61, bstar) ||
+        !mpcorbField(line2, 9, 16, i) || !mpcorbField(line2, 18, 25, node) || !mpcorbField(line2, 27, 33, e) ||
+        !mpcorbField(line2, 35, 42, peri) || !mpcorbField(line2, 44, 51, m) || !mpcorbField(line2, 53, 63, n))
+        return false;
+    if (n <= 0.0) return false;
+
+    // two digit years: 57-99 are 1957-1999, 00-56 are 2000-2056; day 1.0 is january 1st at 0h UTC
+    int y = (int) year + (year < 57.0 ? 2000 : 1900) - 1;
+    long january1 = 365L * y + y / 4 - y / 100 + y / 400 - 730119; // days from 2000-01-01 to year-01-01
+    double epoch = (double) january1 + day - 1.5; // J2000 is 2000-01-01 at 12h
+
+    elements.add(name, (unsigned int) number, epoch, n, e * 1e-7, i, node, peri, m, bstar);
+    return true;
+}
+
+// parses a whole two/three-line catalog already in memory
+inline void tleParse(const char *data, size_t size, SatelliteElements &elements) {
+    std::vector<std::string> lines;
+    size_t begin = 0;
+    while (begin < size) {
+        const char *eol = (const char *) std::memchr(data + begin, '\n', size - begin);
+        size_t end = eol ? (size_t) (eol - data) : size;
+        std::string line(data + begin, end - begin);
+        while (!line.empty() && (line.back() == '\r' || line.back() == ' ')) line.pop_back();
+        lines.push_back(line);
+        begin = end + 1;
+    }
+
+    std::string name;
+    for (size_t k = 0; k < lines.size(); k++) {
+        const std::string &line = lines[k];
+        if (line.size() >= TLE_LINE && line[0] == '1' && line[1] == ' ' && k + 1 < lines.size() &&
+            lines[k + 1].size() >= TLE_LINE) {
+            tleParseLines(line.c_str(), lines[k + 1].c_str(), name, elements);
+            name.clear();
+            k++; // skip the second line
+        } else {
+            name = line.compare(0, 2, "0 ") == 0 ? line.substr(2) : line; // some catalogs prefix names with "0 "
+        }
+    }
+}
+
+// loads a two/three-line catalog into elements (replacing its content)
+// returns false if the catalog does not exist or contains no valid element set
+inline bool loadTle(const char *path, SatelliteElements &elements) {
+    elements.clear();
+    MappedFile catalog(path);
+    if (catalog.data() == nullptr) return false;
+    tleParse(catalog.data(), catalog.size(), elements);
+    return elements.count() > 0;
+}
+
+#endif
@@ -0,0 +1,188 @@
+#ifndef TRAILS_H
+#define TRAILS_H
+
+#include <glad/glad.h>
+
+#include <glm/glm.hpp>
+
+#include <algorithm>
+#include <vector>
+
+// Fading trails of the recent path of many bodies, kept in one GPU buffer of fixed size.
+//
+// Every trail owns TRAIL_LEVELS ring buffers: level 0 records every pushed sample, level l every 2^l-th one, so old
+// parts of the path are drawn with fewer vertices (adaptive decimation) while the memory per trail stays constant.
+// Each ring stores every sample twice (at s and s + capacity), so the visible window of any ring is one contiguous
+// range and all trails are drawn with a single glMultiDrawArrays call.
+//
+// Only the newest sample of each trail is written per push: through a persistently mapped buffer when
+// glBufferStorage is available (OpenGL 4.4), otherwise through an unsynchronized mapping flushed per sample.
+// The slots that are about to be overwritten are never drawn (TRAIL_GUARD samples per ring), and a fence from
+// TRAIL_GUARD frames ago is waited for before writing, so the GPU never reads a sample while it is written.
+
+const int TRAIL_LEVELS = 3; ///< decimation levels per trail
+const int TRAIL_GUARD = 3; ///< samples per ring kept out of the draws (frames the GPU may lag behind)
+
+class TrailBuffer {
+public:
+    unsigned int VAO = 0;
+    unsigned int VBO = 0;
+
+    // allocates trails rings of capacity samples (including the guard) per level
+    void create(unsigned int trails, unsigned int capacity) {
+        trailCount = trails;
+        ringCapacity = capacity;
+        pushes.assign(trails, 0);
+        firsts.resize((size_t) trails * TRAIL_LEVELS);
+        counts.resize((size_t) trails * TRAIL_LEVELS);
+
+        size_t size = (size_t) trails * TRAIL_LEVELS * 2 * capacity * sizeof(glm::vec4);
+        glGenVertexArrays(1, &VAO);
+        glGenBuffers(1, &VBO);
+        glBindVertexArray(VAO);
+        glBindBuffer(GL_ARRAY_BUFFER, VBO);
+        persistent = GLAD_GL_VERSION_4_4 && glBufferStorage != nullptr;
+        if (persistent) {
+            GLbitfield flags = GL_MAP_WRITE_BIT | GL_MAP_PERSISTENT_BIT | GL_MAP_COHERENT_BIT;
+            glBufferStorage(GL_ARRAY_BUFFER, (GLsizeiptr) size, nullptr, flags);
+            mapped = (glm::vec4 *) glMapBufferRange(GL_ARRAY_BUFFER, 0, (GLsizeiptr) size, flags);
+        } else {
+            glBufferData(GL_ARRAY_BUFFER, (GLsizeiptr) size, nullptr, GL_DYNAMIC_DRAW);
+        }
+
+        // position and time stamp of each sample
+        glVertexAttribPointer(0, 4, GL_FLOAT, GL_FALSE, sizeof(glm::vec4), (void *) nullptr);
+        glEnableVertexAttribArray(0);
+        glBindVertexArray(0);
+        glBindBuffer(GL_ARRAY_BUFFER, 0);
+    }
+
+    unsigned int count() const {
+        return trailCount;
+    }
+
+    // forgets every sample (after a jump in time)
+    void clear() {
+        std::fill(pushes.begin(), pushes.end(), 0);
+    }
+
+    // starts writing the samples of a new frame (waits for the frame that last drew the slots written now)
+    void begin() {
+        GLsync &fence = fences[frame % TRAIL_GUARD];
+        if (fence) {
+            glClientWaitSync(fence, GL_SYNC_FLUSH_COMMANDS_BIT, 1000000000); // 1 s at most
+            glDeleteSync(fence);
+            fence = nullptr;
+        }
+        if (!persistent) {
+            glBindBuffer(GL_ARRAY_BUFFER, VBO);
+            size_t size = (size_t) trailCount * TRAIL_LEVELS * 2 * ringCapacity * sizeof(glm::vec4);
+            mapped = (glm::vec4 *) glMapBufferRange(GL_ARRAY_BUFFER, 0, (GLsizeiptr) size,
+                                                    GL_MAP_WRITE_BIT | GL_MAP_UNSYNCHRONIZED_BIT |
+                                                    GL_MAP_FLUSH_EXPLICIT_BIT);
+        }
+    }
+
+    // appends the newest sample of a trail (position and time stamp used to fade it out), at most once per frame
+    // and only between begin() and end() (the fallback path keeps the buffer bound to GL_ARRAY_BUFFER meanwhile)
+    void push(unsigned int trail, glm::vec3 position, float time) {
+        if (mapped == nullptr) return;
+        pushes[trail]++;
+        for (int level = 0; level < TRAIL_LEVELS; level++) {
+            if ((pushes[trail] - 1) % (1u << level) != 0) break; // level l keeps every 2^l-th sample
+            unsigned int slot = (pushes[trail] - 1) >> level;
+            unsigned int s = slot % ringCapacity;
+            size_t base = ringBase(trail, level);
+            write(base + s, glm::vec4(position, time));
+            write(base + s + ringCapacity, glm::vec4(position, time));
+        }
+    }
+
+    // finishes writing the samples of this frame
+    void end() {
+        if (!persistent && mapped != nullptr) {
+            glUnmapBuffer(GL_ARRAY_BUFFER);
+            glBindBuffer(GL_ARRAY_BUFFER, 0);
+            mapped = nullptr;
+        }
+    }
+
+    // draws every trail as line strips (shader must already be in use): each level starts where the previous one
+    // ends, one sample earlier so the strips join, and never reaches the guard slots written by the next frames
+    void draw() {
+        GLsizei drawCount = 0;
+        unsigned int visible = ringCapacity - TRAIL_GUARD;
+        for (unsigned int trail = 0; trail < trailCount; trail++) {
+            unsigned int total = pushes[trail];
+            unsigned int drawnAge = 0; // age (in pushes) of the oldest sample drawn by the lower levels
+            for (int level = 0; level < TRAIL_LEVELS; level++) {
+                unsigned int stride = 1u << level;
+                unsigned int stored = (total + stride - 1) >> level; // samples written to this level
+                if (stored == 0) break;
+                unsigned int newestAge = total - 1 - (stored - 1) * stride;
+                unsigned int available = std::min(stored, visible);
+
+                // samples newer than what the lower levels already drew are skipped (but one)
+                unsigned int skip = 0;
+                if (level > 0 && drawnAge > newestAge) {
+                    skip = std::min(available, (drawnAge - newestAge + stride - 1) / stride) - 1;
+                }
+                unsigned int count = available - skip;
+                if (count >= 2) {
+                    size_t newest = (stored - 1) % ringCapacity + ringCapacity; // second copy of the newest sample
+                    firsts[drawCount] = (GLint) (ringBase(trail, level) + newest - skip - count + 1);
+                    counts[drawCount] = (GLsizei) count;
+                    drawCount++;
+                }
+                drawnAge = std::max(drawnAge, newestAge + (available - 1) * stride);
+            }
+        }
+        if (drawCount == 0) return;
+
+        glBindVertexArray(VAO);
+        glMultiDrawArrays(GL_LINE_STRIP, firsts.data(), counts.data(), drawCount);
+        glBindVertexArray(0);
+
+        fences[frame % TRAIL_GUARD] = glFenceSync(GL_SYNC_GPU_COMMANDS_COMPLETE, 0);
+        frame++;
+    }
+
+    void release() {
+        for (GLsync &fence: fences) {
+            if (fence) glDeleteSync(fence);
+            fence = nullptr;
+        }
+        if (persistent && mapped != nullptr) {
+            glBindBuffer(GL_ARRAY_BUFFER, VBO);
+            glUnmapBuffer(GL_ARRAY_BUFFER);
+            glBindBuffer(GL_ARRAY_BUFFER, 0);
+        }
+        mapped = nullptr;
+        glDeleteVertexArrays(1, &VAO);
+        glDeleteBuffers(1, &VBO);
+        VAO = VBO = 0;
+    }
+
+private:
+    unsigned int trailCount = 0;
+    unsigned int ringCapacity = 0;
+    std::vector<unsigned int> pushes; // samples pushed to each trail
+    std::vector<GLint> firsts; // multi-draw ranges (reused every frame)
+    std::vector<GLsizei> counts;
+    bool persistent = false;
+    glm::vec4 *mapped = nullptr;
+    GLsync fences[TRAIL_GUARD] = {};
+    unsigned int frame = 0;
+
+    size_t ringBase(unsigned int trail, int level) const {
+        return ((size_t) trail * TRAIL_LEVELS + level) * 2 * ringCapacity;
+    }
+
+    void write(size_t index, glm::vec4 sample) {
+        mapped[index] = sample;
+        if (!persistent) glFlushMappedBufferRange(GL_ARRAY_BUFFER, (GLintptr) (index * sizeof(glm::vec4)),
+                                                  sizeof(glm::vec4));
+    }
+};
+
+#endif
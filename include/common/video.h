@@ -0,0 +1,319 @@
+#ifndef VIDEO_H
+#define VIDEO_H
+
+#include <glad/glad.h>
+
+#include <glm/glm.hpp>
+
+#include <algorithm>
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+#include <filesystem>
+#include <fstream>
+#include <future>
+#include <iostream>
+#include <sstream>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "camera.h"
+#include "sim_clock.h"
+
+#ifdef _WIN32
+#define VIDEO_POPEN _popen
+#define VIDEO_PCLOSE _pclose
+#define VIDEO_WRITE_MODE "wb"
+#define VIDEO_NULL_DEVICE "NUL"
+#else
+#define VIDEO_POPEN popen
+#define VIDEO_PCLOSE pclose
+#define VIDEO_WRITE_MODE "w"
+#define VIDEO_NULL_DEVICE "/dev/null"
+#endif
+
+// Offline video of a camera script, rendered by several headless processes at once.
+//
+// The driver (solar_system.out --video script output [shards]) splits the frames of the script into contiguous
+// shards and runs one worker per shard (solar_system.out --render script output first count threads). A worker has no
+// window: it renders into an off-screen target of the script's size from a surfaceless EGL context (llvmpipe or a
+// GPU) and pipes its raw frames into ffmpeg, which encodes one file per shard. The driver then joins the shard
+// files in order without re-encoding them. Every frame is a pure function of its index: the simulation clock is set
+// to the script's epoch plus the frame's time before each frame (with a fixed step for the time elapsed in it) and
+// the camera is interpolated from the script, so the shards join without seams whatever their number. Bodies whose
+// look depends on past frames (trails, comet tails) are warmed up with VIDEO_WARMUP frames before each shard.
+//
+// Workers share nothing, so on CPU-only nodes throughput grows with the number of shards until the cores are used;
+// each worker's rasterizer threads (LP_NUM_THREADS for llvmpipe) and its encoder threads (x264's -threads, which
+// would otherwise start about 1.5 threads per core in every shard) are limited to its share of the cores.
+//
+// Script format, one entry per line ('#' starts a comment):
+//   fps 30
+//   size 3840 2160            (frame size, with the aspect of the window: other aspects are rejected)
+//   epoch 8864.5              (days since J2000 of the first frame)
+//   warp 86400                (simulated seconds per second of video)
+//   skybox 3                  (skybox mode, as the F1 to F4 keys)
+//   key 0 0 4 12 -90 -15 45   (time in seconds, camera position x y z, yaw, pitch and zoom in degrees)
+// Key positions are interpolated by a Catmull-Rom spline, the angles linearly; the video lasts until the last key.
+// see more at: https://trac.ffmpeg.org/wiki/Concatenate
+
+const int VIDEO_WARMUP = 60; ///< frames rendered before a shard's first frame (not written)
+const char *const VIDEO_ENCODER = "-c:v libx264 -preset medium -crf 18 -pix_fmt yuv420p"; ///< ffmpeg output options
+
+// camera of the script at a given time
+struct CameraKey {
+    double time; // seconds of video
+    glm::dvec3 position;
+    float yaw;
+    float pitch;
+    float zoom;
+};
+
+struct VideoScript {
+    double fps = 30.0;
+    int width = 1920;
+    int height = 1080;
+    double epoch = 0.0; // days since J2000
+    double warp = CLOCK_DEFAULT_WARP;
+    unsigned int skybox = 3; // bright stars (a few MB per worker instead of hundreds for a large cube map)
+    std::vector<CameraKey> keys; // sorted by time
+
+    int frameCount() const {
+        return keys.empty() ? 0 : (int) std::floor(keys.back().time * fps) + 1;
+    }
+
+    // days since J2000 of a frame
+    double frameDays(int frame) const {
+        return epoch + (double) frame / fps * warp / 86400.0;
+    }
+
+    // camera at a time, between the keys around it
+    CameraKey camera(double time) const {
+        auto next = std::upper_bound(keys.begin(), keys.end(), time,
+                                     [](double t, const CameraKey &key) { return t < key.time; });
+        if (next == keys.begin()) return keys.front();
+        if (next == keys.end()) return keys.back();
+        auto i = (size_t) (next - keys.begin()) - 1;
+        const CameraKey &k1 = keys[i], &k2 = keys[i + 1];
+        const CameraKey &k0 = keys[i > 0 ? i - 1 : i], &k3 = keys[std::min(i + 2, keys.size() - 1)];
+        double u = (time - k1.time) / (k2.time - k1.time);
+        double u2 = u * u, u3 = u2 * u;
+
+        CameraKey result{};
+        result.time = time;
+        result.position = 0.5 * ((2.0 * k1.position) + (k2.position - k0.position) * u +
+                                 (2.0 * k0.position - 5.0 * k1.position + 4.0 * k2.position - k3.position) * u2 +
+                                 (3.0 * k1.position - k0.position - 3.0 * k2.position + k3.position) * u3);
+        auto f = (float) u;
+        result.yaw = k1.yaw + (k2.yaw - k1.yaw) * f;
+        result.pitch = k1.pitch + (k2.pitch - k1.pitch) * f;
+        result.zoom = k1.zoom + (k2.zoom - k1.zoom) * f;
+        return result;
+    }
+};
+
+// reads a camera script, returns false if it does not exist or has no keys
+inline bool loadVideoScript(const char *path, VideoScript &script) {
+    std::ifstream input(path);
+    if (!input) return false;
+    script = VideoScript();
+    std::string line;
+    while (std::getline(input, line)) {
+        std::istringstream fields(line.substr(0, line.find('#')));
+        std::string name;
+        if (!(fields >> name)) continue;
+        if (name == "fps") fields >> script.fps;
+        else if (name == "size") fields >> script.width >> script.height;
+        else if (name == "epoch") fields >> script.epoch;
+        else if (name == "warp") fields >> script.warp;
+        else if (name == "skybox") fields >> script.skybox;
+        else if (name == "key") {
+            CameraKey key{};
+            fields >> key.time >> key.position.x >> key.position.y >> key.position.z >> key.yaw >> key.pitch >>
+                   key.zoom;
+            if (fields) script.keys.push_back(key);
+        }
+    }
+    std::stable_sort(script.keys.begin(), script.keys.end(),
+                     [](const CameraKey &a, const CameraKey &b) { return a.time < b.time; });
+    return !script.keys.empty() && script.fps > 0.0 && script.width > 0 && script.height > 0;
+}
+
+// checks that the frames have the aspect of the window (the projection, the labels and the HUD are laid out for it,
+// so frames of another aspect would be stretched)
+inline bool videoAspectMatches(const VideoScript &script, int windowWidth, int windowHeight) {
+    double ratio = (double) script.width * windowHeight / ((double) script.height * windowWidth);
+    return std::fabs(ratio - 1.0) < 0.005; // sizes rounded to whole pixels (1366 x 768) are accepted
+}
+
+// name of the file encoded by the shard starting at a frame
+inline std::string videoShardName(int firstFrame) {
+    char name[32];
+    snprintf(name, sizeof(name), "shard_%06d.mp4", firstFrame);
+    return name;
+}
+
+// frames of a shard [first, first + count) when frameCount frames are split in shards contiguous parts
+inline void videoShardRange(int frameCount, int shards, int shard, int &first, int &count) {
+    first = (int) ((long long) frameCount * shard / shards);
+    count = (int) ((long long) frameCount * (shard + 1) / shards) - first;
+}
+
+// renders a whole script with shards worker processes of executable, returns the process exit status
+// windowWidth, windowHeight: size of the window the scene is laid out for (the frames must have its aspect)
+inline int runVideoDriver(const char *executable, const char *scriptPath, const char *output, int shards,
+                          int windowWidth, int windowHeight) {
+    VideoScript script;
+    if (!loadVideoScript(scriptPath, script)) {
+        std::cerr << "Failed to load the camera script: " << scriptPath << std::endl;
+        return -1;
+    }
+    if (!videoAspectMatches(script, windowWidth, windowHeight)) {
+        std::cerr << "The frame size of " << scriptPath << " (" << script.width << "x" << script.height
+                  << ") must have the aspect of the window (" << windowWidth << "x" << windowHeight << ")"
+                  << std::endl;
+        return -1;
+    }
+    if (std::system("ffmpeg -version > " VIDEO_NULL_DEVICE " 2>&1") != 0) {
+        std::cerr << "Failed to find ffmpeg (needed to encode the video)" << std::endl;
+        return -1;
+    }
+    std::error_code error;
+    std::filesystem::create_directories(output, error);
+    unsigned int cores = std::max(std::thread::hardware_concurrency(), 1u);
+    int frameCount = script.frameCount();
+    shards = std::max(1, std::min(shards > 0 ? shards : (int) cores, frameCount));
+    unsigned int threads = std::max(cores / (unsigned int) shards, 1u); // rasterizer and encoder threads of a worker
+
+    // every worker runs in its own process (the threads only wait for them)
+    std::vector<std::future<int>> workers;
+    for (int shard = 0; shard < shards; shard++) {
+        int first, count;
+        videoShardRange(frameCount, shards, shard, first, count);
+        std::string command;
+#ifndef _WIN32
+        command = "LP_NUM_THREADS=" + std::to_string(threads) + " ";
+#endif
+        command += "\"" + std::string(executable) + "\" --render \"" + scriptPath + "\" \"" + output + "\" " +
+                   std::to_string(first) + " " + std::to_string(count) + " " + std::to_string(threads);
+        workers.push_back(std::async(std::launch::async, [command] { return std::system(command.c_str()); }));
+    }
+    bool failed = false;
+    for (int shard = 0; shard < shards; shard++) {
+        if (workers[shard].get() != 0) {
+            std::cerr << "Failed to render shard " << shard << std::endl;
+            failed = true;
+        }
+    }
+    if (failed) return -1;
+
+    // join the shards in order (the streams are copied, not encoded again)
+    std::string listPath = std::string(output) + "/shards.txt";
+    std::ofstream list(listPath, std::ios::trunc);
+    for (int shard = 0; shard < shards; shard++) {
+        int first, count;
+        videoShardRange(frameCount, shards, shard, first, count);
+        list << "file '" << videoShardName(first) << "'\n"; // relative to the list
+    }
+    list.close();
+    std::string join = "ffmpeg -y -loglevel error -f concat -safe 0 -i \"" + listPath + "\" -c copy \"" +
+                       std::string(output) + "/video.mp4\"";
+    if (std::system(join.c_str()) != 0) {
+        std::cerr << "Failed to join the shards in " << output << std::endl;
+        return -1;
+    }
+    std::cout << "Video written: " << output << "/video.mp4 (" << frameCount << " frames, " << shards << " shards)"
+              << std::endl;
+    return 0;
+}
+
+// frames of one shard: sets the clock and the camera of each frame and streams the rendered frames into ffmpeg
+class VideoShard {
+public:
+    VideoScript script;
+
+    // starts the shard (its file is encoded in output with at most threads encoder threads), returns false if the
+    // script or the encoder cannot be opened
+    bool begin(const char *scriptPath, const std::string &output, int firstFrame, int frameCount, int threads) {
+        if (!loadVideoScript(scriptPath, script)) return false;
+        first = firstFrame;
+        end = std::min(firstFrame + frameCount, script.frameCount());
+        frame = std::max(first - VIDEO_WARMUP, 0);
+        char input[160];
+        snprintf(input, sizeof(input), "-f rawvideo -pix_fmt rgba -s %dx%d -r %.6g -i - -vf vflip", script.width,
+                 script.height, script.fps); // rows are read back from the bottom
+        std::string command = "ffmpeg -y -loglevel error " + std::string(input) + " " + VIDEO_ENCODER + " -threads " +
+                              std::to_string(std::max(threads, 1)) + " \"" + output + "/" +
+                              videoShardName(firstFrame) + "\"";
+        encoder = VIDEO_POPEN(command.c_str(), VIDEO_WRITE_MODE);
+        return encoder != nullptr && first < end;
+    }
+
+    bool active() const {
+        return encoder != nullptr;
+    }
+
+    // real seconds of a frame
+    double frameTime() const {
+        return 1.0 / script.fps;
+    }
+
+    // real seconds from the start of the video to the current frame
+    double frameSeconds() const {
+        return (double) frame / script.fps;
+    }
+
+    // sets the clock at the start of the current frame (and the time elapsed in it) and the camera of the frame
+    void startFrame(SimulationClock &clock, Camera &camera) const {
+        clock.setWarp(script.warp);
+        clock.setPaused(false);
+        clock.setReversed(false);
+        clock.setFixedStep(frameTime());
+        clock.jumpTo(script.frameDays(frame - 1));
+        clock.tick(0.0); // one fixed step later: the frame's time, whatever frame the shard started from
+
+        CameraKey key = script.camera(frameSeconds());
+        camera = Camera(key.position, glm::vec3(0.0f, 1.0f, 0.0f), key.yaw, key.pitch);
+        camera.Zoom = key.zoom;
+    }
+
+    // writes the frame rendered in framebuffer (warm-up frames are skipped) and moves on; returns false once the
+    // shard is done or the encoder failed (success tells which)
+    bool endFrame(unsigned int framebuffer, bool &success) {
+        if (frame >= first) {
+            pixels.resize((size_t) script.width * script.height * 4);
+            glBindFramebuffer(GL_READ_FRAMEBUFFER, framebuffer);
+            glPixelStorei(GL_PACK_ALIGNMENT, 4);
+            glReadPixels(0, 0, script.width, script.height, GL_RGBA, GL_UNSIGNED_BYTE, pixels.data());
+            glBindFramebuffer(GL_FRAMEBUFFER, 0);
+            if (std::fwrite(pixels.data(), 1, pixels.size(), encoder) != pixels.size()) {
+                release();
+                success = false;
+                return false;
+            }
+        }
+        frame++;
+        if (frame < end) return true;
+        success = release();
+        return false;
+    }
+
+    // closes the encoder, returns true if it encoded the shard
+    bool release() {
+        if (!encoder) return false;
+        bool encoded = VIDEO_PCLOSE(encoder) == 0;
+        encoder = nullptr;
+        std::vector<unsigned char>().swap(pixels);
+        return encoded;
+    }
+
+private:
+    std::FILE *encoder = nullptr; // pipe to ffmpeg
+    std::vector<unsigned char> pixels; // frame read back (RGBA, bottom row first)
+    int first = 0; // first frame written
+    int end = 0; // frame after the last one
+    int frame = 0; // frame rendered now
+};
+
+#endif
@@ -0,0 +1,445 @@
+#ifndef VIRTUAL_TEXTURE_H
+#define VIRTUAL_TEXTURE_H
+
+#include <glad/glad.h>
+
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <cstdint>
+#include <cstring>
+#include <future>
+#include <memory>
+#include <unordered_set>
+#include <vector>
+
+#include "mapped_file.h"
+#include "virtual_texture_pages.h"
+
+// Planet textures of any resolution in a fixed amount of GPU memory: the paged pyramids of
+// virtual_texture_pages.h share one physical cache of VIRTUAL_CACHE_SIDE x VIRTUAL_CACHE_SIDE pages, and each
+// texture has a page table (one texel per page of each level, as the mipmaps of a small texture) that tells
+// planetFragment.glsl where the page it needs is in the cache. A page that is not resident points to its nearest
+// resident ancestor, so the texture is always complete, only blurrier where pages are still on their way; the
+// coarsest level of every texture stays resident.
+//
+// The pages needed are found by a feedback pass: before the scene, the bodies with a virtual texture are drawn at
+// 1/VIRTUAL_FEEDBACK_SCALE of the size of the image with virtualFeedbackFragment.glsl, which writes the page (and
+// mipmap level) each pixel samples. The target is read back through two pixel buffers, so the requests of a frame
+// are read during the next one without waiting for the GPU. The requested pages and their ancestors are then
+// marked used, the missing ones read from the memory mapped file by a background task (coarse levels first) and
+// copied into the least recently used slots of the cache, at most VIRTUAL_UPLOADS per frame.
+// see more at: https://silverspaceship.com/src/svt/ (sparse virtual textures)
+
+const int VIRTUAL_CACHE_SIDE = 64; ///< pages on the side of the physical cache (8192 x 8192 texels, 256 MB)
+const int VIRTUAL_FEEDBACK_SCALE = 8; ///< the feedback pass is rendered at 1/8 of the size of the image
+const int VIRTUAL_READS = 32; ///< pages read from disk by one background task
+const int VIRTUAL_UPLOADS = 8; ///< pages copied to the GPU per frame at most
+
+class VirtualTextureCache {
+public:
+    unsigned int cacheTexture = 0;
+    unsigned int FBO = 0;
+
+    // sets the size of the images rendered (the GPU memory is only allocated when the first texture is opened)
+    void create(int width, int height) {
+        feedbackWidth = std::max(width / VIRTUAL_FEEDBACK_SCALE, 1);
+        feedbackHeight = std::max(height / VIRTUAL_FEEDBACK_SCALE, 1);
+    }
+
+    // maps a paged texture and loads its coarsest level, returns its index (-1 if the file is missing or invalid)
+    int open(const char *path) {
+        Texture texture;
+        texture.file = std::make_unique<MappedFile>();
+        if (!texture.file->open(path, false) || texture.file->size() < sizeof(VirtualPagesHeader)) return -1;
+        std::memcpy(&texture.header, texture.file->data(), sizeof(texture.header));
+        uint32_t levels = texture.header.levels;
+        if (texture.header.magic != VIRTUAL_PAGES_MAGIC || texture.header.version != VIRTUAL_PAGES_VERSION ||
+            levels == 0 || levels > (uint32_t) VIRTUAL_MAX_LEVELS || textures.size() == 255 ||
+            texture.file->size() < sizeof(VirtualPagesHeader) + virtualPageCount(levels) * VIRTUAL_PAGE_BYTES) {
+            return -1;
+        }
+        if (cacheTexture == 0 && !allocate()) return -1;
+
+        texture.slot.resize(levels);
+        texture.entry.resize(levels);
+        texture.dirtyBegin.assign(levels, UINT32_MAX);
+        texture.dirtyEnd.assign(levels, 0);
+        glGenTextures(1, &texture.pageTable);
+        glBindTexture(GL_TEXTURE_2D, texture.pageTable);
+        for (uint32_t level = 0; level < levels; level++) {
+            uint32_t wide = virtualPagesWide(levels, level);
+            texture.slot[level].assign((size_t) wide * wide / 2, -1);
+            texture.entry[level].assign((size_t) wide * wide / 2, 0);
+            glTexImage2D(GL_TEXTURE_2D, (GLint) level, GL_RGBA8, (GLsizei) wide, (GLsizei) wide / 2, 0, GL_RGBA,
+                         GL_UNSIGNED_BYTE, nullptr);
+        }
+        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAX_LEVEL, (GLint) levels - 1);
+        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_NEAREST_MIPMAP_NEAREST);
+        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_NEAREST);
+        glBindTexture(GL_TEXTURE_2D, 0);
+        textures.push_back(std::move(texture));
+
+        // the two pages of the coarsest level are never evicted (every page falls back on them)
+        auto index = (int) textures.size() - 1;
+        for (uint32_t x = 0; x < 2; x++) {
+            auto free = std::find(slotKey.begin(), slotKey.end(), NO_PAGE);
+            if (free == slotKey.end()) return -1;
+            uint64_t key = pageKey(index, levels - 1, x, 0);
+            const char *texels = textures[index].file->data() + pageOffset(key);
+            upload(key, texels, (int) (free - slotKey.begin()), UINT64_MAX);
+        }
+        uploadPageTables();
+        return index;
+    }
+
+    bool empty() const {
+        return textures.empty();
+    }
+
+    // redirects rendering into the feedback target, over the current viewport scaled down
+    void beginFeedback() {
+        glGetIntegerv(GL_FRAMEBUFFER_BINDING, &previousFramebuffer);
+        glGetIntegerv(GL_VIEWPORT, previousViewport);
+        float scale = std::min({1.0f / VIRTUAL_FEEDBACK_SCALE, (float) feedbackWidth / (float) previousViewport[2],
+                                (float) feedbackHeight / (float) previousViewport[3]});
+        int current = (int) (feedbackCount % 2);
+        readWidth[current] = std::max((int) ((float) previousViewport[2] * scale), 1);
+        readHeight[current] = std::max((int) ((float) previousViewport[3] * scale), 1);
+        lodBias = std::log2(scale); // the derivatives are larger than in the image by 1 / scale
+
+        glBindFramebuffer(GL_FRAMEBUFFER, FBO);
+        glViewport(0, 0, readWidth[current], readHeight[current]);
+        const GLuint none[4] = {0, 0, 0, 0};
+        glClearBufferuiv(GL_COLOR, 0, none);
+        glClear(GL_DEPTH_BUFFER_BIT);
+    }
+
+    // sets the uniforms of virtualFeedbackFragment.glsl for a texture
+    void bindFeedback(unsigned int program, int texture) const {
+        uint32_t levels = textures[texture].header.levels;
+        glUniform1i(glGetUniformLocation(program, "virtualTexture"), texture);
+        glUniform1i(glGetUniformLocation(program, "virtualLevels"), (GLint) levels);
+        glUniform2i(glGetUniformLocation(program, "virtualPages"), (GLint) virtualPagesWide(levels, 0),
+                    (GLint) virtualPagesWide(levels, 0) / 2);
+        glUniform1f(glGetUniformLocation(program, "lodBias"), lodBias);
+    }
+
+    // starts the readback of the feedback and restores the previous target
+    void endFeedback() {
+        int current = (int) (feedbackCount % 2);
+        glBindFramebuffer(GL_READ_FRAMEBUFFER, FBO);
+        glBindBuffer(GL_PIXEL_PACK_BUFFER, PBO[current]);
+        glPixelStorei(GL_PACK_ALIGNMENT, 4);
+        glReadPixels(0, 0, readWidth[current], readHeight[current], GL_RG_INTEGER, GL_UNSIGNED_INT, nullptr);
+        glBindBuffer(GL_PIXEL_PACK_BUFFER, 0);
+        glBindFramebuffer(GL_FRAMEBUFFER, (GLuint) previousFramebuffer);
+        glViewport(previousViewport[0], previousViewport[1], previousViewport[2], previousViewport[3]);
+        feedbackCount++;
+    }
+
+    // reads the pages requested by the previous feedback, starts reading the missing ones in background and copies
+    // the pages read into the cache
+    void update() {
+        if (textures.empty()) return;
+        frame++;
+        readFeedback();
+
+        // the pages requested are kept, the coarsest first (they are the fallback of the finer ones)
+        std::sort(requested.begin(), requested.end(), [](uint64_t a, uint64_t b) {
+            return levelOf(a) > levelOf(b);
+        });
+        for (uint64_t key: requested) {
+            int slot = slotOf(key);
+            if (slot >= 0 && slotUsed[slot] != UINT64_MAX) slotUsed[slot] = frame;
+        }
+
+        // pages read by the background task, copied while slots not used this frame are left
+        if (reading.valid() && reading.wait_for(std::chrono::seconds(0)) == std::future_status::ready) {
+            for (LoadedPage &page: reading.get()) read.push_back(std::move(page));
+        }
+        int uploads = 0;
+        size_t kept = 0;
+        for (LoadedPage &page: read) {
+            if (requestedPages.count(page.key) == 0 || slotOf(page.key) >= 0) { // no longer needed, or already there
+                pending.erase(page.key);
+                continue;
+            }
+            int slot = (int) (std::min_element(slotUsed.begin(), slotUsed.end()) - slotUsed.begin());
+            if (uploads == VIRTUAL_UPLOADS || slotUsed[slot] >= frame) { // later (or once pages are released)
+                read[kept++] = std::move(page);
+                continue;
+            }
+            upload(page.key, page.texels.data(), slot, frame);
+            pending.erase(page.key);
+            uploads++;
+        }
+        read.resize(kept);
+
+        // next pages read in background
+        if (!reading.valid()) {
+            std::vector<std::pair<uint64_t, const char *>> batch;
+            for (uint64_t key: requested) {
+                if ((int) batch.size() == VIRTUAL_READS) break;
+                if (slotOf(key) >= 0 || pending.count(key) != 0) continue;
+                pending.insert(key);
+                batch.emplace_back(key, textures[textureOf(key)].file->data() + pageOffset(key));
+            }
+            if (!batch.empty()) reading = std::async(std::launch::async, readPages, std::move(batch));
+        }
+        uploadPageTables();
+    }
+
+    // binds a texture for planetFragment.glsl (the cache to texture unit 2 and the page table to unit 3)
+    void bind(unsigned int program, int texture) const {
+        glUniform1i(glGetUniformLocation(program, "virtualDiffuse"), 1);
+        glUniform1i(glGetUniformLocation(program, "virtualLevels"), (GLint) textures[texture].header.levels);
+        glUniform1f(glGetUniformLocation(program, "cacheSide"), (float) cacheSide);
+        glActiveTexture(GL_TEXTURE2);
+        glBindTexture(GL_TEXTURE_2D, cacheTexture);
+        glActiveTexture(GL_TEXTURE3);
+        glBindTexture(GL_TEXTURE_2D, textures[texture].pageTable);
+        glActiveTexture(GL_TEXTURE0);
+    }
+
+    void release() {
+        if (reading.valid()) reading.wait();
+        reading = std::future<std::vector<LoadedPage>>();
+        for (Texture &texture: textures) glDeleteTextures(1, &texture.pageTable);
+        textures.clear();
+        if (cacheTexture != 0) {
+            glDeleteTextures(1, &cacheTexture);
+            glDeleteFramebuffers(1, &FBO);
+            glDeleteRenderbuffers(1, &colorBuffer);
+            glDeleteRenderbuffers(1, &depthBuffer);
+            glDeleteBuffers(2, PBO);
+        }
+        cacheTexture = FBO = colorBuffer = depthBuffer = PBO[0] = PBO[1] = 0;
+        slotKey.clear();
+        slotUsed.clear();
+        read.clear();
+        pending.clear();
+        requestedPages.clear();
+        requested.clear();
+    }
+
+private:
+    static constexpr uint64_t NO_PAGE = UINT64_MAX;
+
+    // paged texture: its file, page table and the slot of each of its pages
+    struct Texture {
+        std::unique_ptr<MappedFile> file;
+        VirtualPagesHeader header{};
+        unsigned int pageTable = 0;
+        std::vector<std::vector<int>> slot; // slot of each page of each level (-1 when not resident)
+        std::vector<std::vector<uint32_t>> entry; // page table texels: slot x, slot y and level of the page shown
+        std::vector<uint32_t> dirtyBegin; // rows of each level changed since the last upload
+        std::vector<uint32_t> dirtyEnd;
+    };
+
+    // page read from the file by the background task
+    struct LoadedPage {
+        uint64_t key;
+        std::vector<char> texels;
+    };
+
+    std::vector<Texture> textures;
+    int cacheSide = VIRTUAL_CACHE_SIDE;
+    std::vector<uint64_t> slotKey; // page held by each slot
+    std::vector<uint64_t> slotUsed; // last frame that requested the page of each slot (UINT64_MAX when pinned)
+    std::unordered_set<uint64_t> requestedPages; // pages requested by the last feedback and their ancestors
+    std::vector<uint64_t> requested; // the same pages, the coarsest first
+    std::unordered_set<uint64_t> pending; // pages being read or waiting to be copied
+    std::vector<LoadedPage> read; // pages waiting to be copied
+    std::future<std::vector<LoadedPage>> reading;
+    uint64_t frame = 0;
+
+    unsigned int colorBuffer = 0;
+    unsigned int depthBuffer = 0;
+    unsigned int PBO[2] = {0, 0}; // readbacks of consecutive feedbacks
+    int feedbackWidth = 1;
+    int feedbackHeight = 1;
+    int readWidth[2] = {1, 1}; // size of the feedback in each pixel buffer
+    int readHeight[2] = {1, 1};
+    uint64_t feedbackCount = 0;
+    float lodBias = 0.0f;
+    GLint previousFramebuffer = 0;
+    GLint previousViewport[4] = {0, 0, 1, 1};
+
+    // page of a texture: texture, level, row and column packed in 64 bits
+    static uint64_t pageKey(int texture, uint32_t level, uint32_t x, uint32_t y) {
+        return (uint64_t) texture << 56 | (uint64_t) level << 48 | (uint64_t) y << 24 | x;
+    }
+
+    static int textureOf(uint64_t key) {
+        return (int) (key >> 56);
+    }
+
+    static uint32_t levelOf(uint64_t key) {
+        return (uint32_t) (key >> 48) & 0xff;
+    }
+
+    static uint32_t rowOf(uint64_t key) {
+        return (uint32_t) (key >> 24) & 0xffffff;
+    }
+
+    static uint32_t columnOf(uint64_t key) {
+        return (uint32_t) key & 0xffffff;
+    }
+
+    size_t pageOffset(uint64_t key) const {
+        uint32_t levels = textures[textureOf(key)].header.levels;
+        return sizeof(VirtualPagesHeader) +
+               virtualPageIndex(levels, levelOf(key), columnOf(key), rowOf(key)) * VIRTUAL_PAGE_BYTES;
+    }
+
+    int slotOf(uint64_t key) const {
+        const Texture &texture = textures[textureOf(key)];
+        uint32_t wide = virtualPagesWide(texture.header.levels, levelOf(key));
+        return texture.slot[levelOf(key)][(size_t) rowOf(key) * wide + columnOf(key)];
+    }
+
+    // creates the cache (as large as the GPU allows up to VIRTUAL_CACHE_SIDE pages) and the feedback target
+    bool allocate() {
+        GLint maxSize;
+        glGetIntegerv(GL_MAX_TEXTURE_SIZE, &maxSize);
+        cacheSide = std::min(VIRTUAL_CACHE_SIDE, (int) maxSize / VIRTUAL_PAGE_SIZE);
+        slotKey.assign((size_t) cacheSide * cacheSide, NO_PAGE);
+        slotUsed.assign((size_t) cacheSide * cacheSide, 0);
+        glGenTextures(1, &cacheTexture);
+        glBindTexture(GL_TEXTURE_2D, cacheTexture);
+        glTexImage2D(GL_TEXTURE_2D, 0, GL_RGBA8, cacheSide * VIRTUAL_PAGE_SIZE, cacheSide * VIRTUAL_PAGE_SIZE, 0,
+                     GL_RGB, GL_UNSIGNED_BYTE, nullptr);
+        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAX_LEVEL, 0);
+        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_EDGE);
+        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_EDGE);
+        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_LINEAR);
+        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
+        glBindTexture(GL_TEXTURE_2D, 0);
+
+        // page and level of each pixel (see virtualFeedbackFragment.glsl)
+        glGenFramebuffers(1, &FBO);
+        glGenRenderbuffers(1, &colorBuffer);
+        glGenRenderbuffers(1, &depthBuffer);
+        glBindFramebuffer(GL_FRAMEBUFFER, FBO);
+        glBindRenderbuffer(GL_RENDERBUFFER, colorBuffer);
+        glRenderbufferStorage(GL_RENDERBUFFER, GL_RG32UI, feedbackWidth, feedbackHeight);
+        glFramebufferRenderbuffer(GL_FRAMEBUFFER, GL_COLOR_ATTACHMENT0, GL_RENDERBUFFER, colorBuffer);
+        glBindRenderbuffer(GL_RENDERBUFFER, depthBuffer);
+        glRenderbufferStorage(GL_RENDERBUFFER, GL_DEPTH_COMPONENT32F, feedbackWidth, feedbackHeight); // any depth mode
+        glFramebufferRenderbuffer(GL_FRAMEBUFFER, GL_DEPTH_ATTACHMENT, GL_RENDERBUFFER, depthBuffer);
+        bool complete = glCheckFramebufferStatus(GL_FRAMEBUFFER) == GL_FRAMEBUFFER_COMPLETE;
+        glBindRenderbuffer(GL_RENDERBUFFER, 0);
+        glBindFramebuffer(GL_FRAMEBUFFER, 0);
+
+        glGenBuffers(2, PBO);
+        for (unsigned int buffer: PBO) {
+            glBindBuffer(GL_PIXEL_PACK_BUFFER, buffer);
+            glBufferData(GL_PIXEL_PACK_BUFFER, (GLsizeiptr) feedbackWidth * feedbackHeight * 2 * sizeof(GLuint),
+                         nullptr, GL_STREAM_READ);
+        }
+        glBindBuffer(GL_PIXEL_PACK_BUFFER, 0);
+        if (!complete) release();
+        return complete;
+    }
+
+    // collects the pages requested by the feedback of the previous frame, with their ancestors
+    void readFeedback() {
+        if (feedbackCount < 2) return; // the last one is still being transferred
+        int previous = (int) (feedbackCount % 2);
+        glBindBuffer(GL_PIXEL_PACK_BUFFER, PBO[previous]);
+        auto *pixels = (const GLuint *) glMapBuffer(GL_PIXEL_PACK_BUFFER, GL_READ_ONLY);
+        if (pixels) {
+            requestedPages.clear();
+            size_t count = (size_t) readWidth[previous] * readHeight[previous];
+            for (size_t i = 0; i < count; i++) {
+                GLuint page = pixels[2 * i], tag = pixels[2 * i + 1]; // see virtualFeedbackFragment.glsl
+                if (tag == 0) continue; // no virtual texture there
+                auto texture = (int) (tag >> 16);
+                uint32_t level = (tag >> 8) & 0xff, x = page & 0xffff, y = page >> 16;
+                if (texture >= (int) textures.size() || level >= textures[texture].header.levels) continue;
+                uint32_t wide = virtualPagesWide(textures[texture].header.levels, level);
+                if (x >= wide || y >= wide / 2) continue;
+                for (; level < textures[texture].header.levels; level++, x /= 2, y /= 2) {
+                    if (!requestedPages.insert(pageKey(texture, level, x, y)).second) break; // its ancestors are in
+                }
+            }
+            glUnmapBuffer(GL_PIXEL_PACK_BUFFER);
+            requested.assign(requestedPages.begin(), requestedPages.end());
+        }
+        glBindBuffer(GL_PIXEL_PACK_BUFFER, 0);
+    }
+
+    // copies a page into a slot (evicting the page there) and updates the page table
+    void upload(uint64_t key, const char *texels, int slot, uint64_t used) {
+        if (slotKey[slot] != NO_PAGE) setSlot(slotKey[slot], -1);
+        glBindTexture(GL_TEXTURE_2D, cacheTexture);
+        glPixelStorei(GL_UNPACK_ALIGNMENT, 4);
+        int x = (slot % cacheSide) * VIRTUAL_PAGE_SIZE, y = (slot / cacheSide) * VIRTUAL_PAGE_SIZE;
+        glTexSubImage2D(GL_TEXTURE_2D, 0, x, y, VIRTUAL_PAGE_SIZE, VIRTUAL_PAGE_SIZE, GL_RGB, GL_UNSIGNED_BYTE, texels);
+        glBindTexture(GL_TEXTURE_2D, 0);
+        slotKey[slot] = key;
+        slotUsed[slot] = used;
+        setSlot(key, slot);
+    }
+
+    // sets the slot of a page (-1 when evicted) and points the page table at it
+    void setSlot(uint64_t key, int slot) {
+        Texture &texture = textures[textureOf(key)];
+        uint32_t wide = virtualPagesWide(texture.header.levels, levelOf(key));
+        texture.slot[levelOf(key)][(size_t) rowOf(key) * wide + columnOf(key)] = slot;
+        refresh(texture, levelOf(key), columnOf(key), rowOf(key));
+    }
+
+    // page table texel of a page: its own slot if it is resident, else the texel of its parent; the pages below
+    // that are not resident follow
+    void refresh(Texture &texture, uint32_t level, uint32_t x, uint32_t y) {
+        uint32_t levels = texture.header.levels, wide = virtualPagesWide(levels, level);
+        size_t index = (size_t) y * wide + x;
+        int slot = texture.slot[level][index];
+        if (slot >= 0) {
+            texture.entry[level][index] = (uint32_t) (slot % cacheSide) | (uint32_t) (slot / cacheSide) << 8 |
+                                          level << 16 | 0xffu << 24;
+        } else if (level + 1 < levels) {
+            texture.entry[level][index] = texture.entry[level + 1][(size_t) (y / 2) * (wide / 2) + x / 2];
+        }
+        texture.dirtyBegin[level] = std::min(texture.dirtyBegin[level], y);
+        texture.dirtyEnd[level] = std::max(texture.dirtyEnd[level], y + 1);
+        if (level == 0) return;
+        for (uint32_t child = 0; child < 4; child++) {
+            uint32_t childX = 2 * x + (child & 1), childY = 2 * y + (child >> 1);
+            if (texture.slot[level - 1][(size_t) childY * wide * 2 + childX] < 0) {
+                refresh(texture, level - 1, childX, childY);
+            }
+        }
+    }
+
+    // uploads the rows of the page tables changed since the last upload
+    void uploadPageTables() {
+        glPixelStorei(GL_UNPACK_ALIGNMENT, 4);
+        for (Texture &texture: textures) {
+            glBindTexture(GL_TEXTURE_2D, texture.pageTable);
+            for (uint32_t level = 0; level < texture.header.levels; level++) {
+                if (texture.dirtyBegin[level] >= texture.dirtyEnd[level]) continue;
+                uint32_t wide = virtualPagesWide(texture.header.levels, level);
+                glTexSubImage2D(GL_TEXTURE_2D, (GLint) level, 0, (GLint) texture.dirtyBegin[level], (GLsizei) wide,
+                                (GLsizei) (texture.dirtyEnd[level] - texture.dirtyBegin[level]), GL_RGBA,
+                                GL_UNSIGNED_BYTE, &texture.entry[level][(size_t) texture.dirtyBegin[level] * wide]);
+                texture.dirtyBegin[level] = UINT32_MAX;
+                texture.dirtyEnd[level] = 0;
+            }
+        }
+        glBindTexture(GL_TEXTURE_2D, 0);
+    }
+
+    // copies pages out of the mapping (run in background: the OS reads the file while the frames go on)
+    static std::vector<LoadedPage> readPages(std::vector<std::pair<uint64_t, const char *>> batch) {
+        std::vector<LoadedPage> pages;
+        for (const auto &[key, texels]: batch) {
+            pages.push_back({key, std::vector<char>(texels, texels + VIRTUAL_PAGE_BYTES)});
+        }
+        return pages;
+    }
+};
+
+#endif
@@ -0,0 +1,54 @@
+#ifndef VIRTUAL_TEXTURE_PAGES_H
+#define VIRTUAL_TEXTURE_PAGES_H
+
+#include <cstddef>
+#include <cstdint>
+
+// On-disk mip pyramid of a virtual texture, built offline by tools/build_virtual_texture.cpp and streamed by
+// virtual_texture.h.
+//
+// The texture is an equirectangular planet map (twice as wide as it is high) cut into square pages of
+// VIRTUAL_PAGE_SIZE texels: VIRTUAL_PAGE_CONTENT texels of the map surrounded by a border of VIRTUAL_PAGE_BORDER
+// texels copied from the neighboring pages, so a page sampled with bilinear filtering shows no seam in the
+// physical cache. Level 0 is the finest, with 2^levels x 2^(levels - 1) pages; every level halves the one below,
+// down to the 2 x 1 pages of the last one. Texels are RGB, the first row of a page at the bottom (v grows upwards
+// like the texture coordinates of the sphere, see loadTexture).
+//
+// File layout: VirtualPagesHeader, then the pages of every level, row and column in that order (fixed size, so the
+// offset of a page is computed from its coordinates, see virtualPageIndex).
+
+const uint32_t VIRTUAL_PAGES_MAGIC = 0x45474150; // "PAGE"
+const uint32_t VIRTUAL_PAGES_VERSION = 1;
+const int VIRTUAL_PAGE_SIZE = 128; ///< texels on the side of a page, borders included
+const int VIRTUAL_PAGE_BORDER = 4; ///< texels of the border (the same as planetFragment.glsl)
+const int VIRTUAL_PAGE_CONTENT = VIRTUAL_PAGE_SIZE - 2 * VIRTUAL_PAGE_BORDER; ///< texels of the map in a page
+const size_t VIRTUAL_PAGE_BYTES = (size_t) VIRTUAL_PAGE_SIZE * VIRTUAL_PAGE_SIZE * 3; ///< RGB8 texels of a page
+const int VIRTUAL_MAX_LEVELS = 10; ///< deepest pyramid (a map of 122880 x 61440 texels)
+
+struct VirtualPagesHeader {
+    uint32_t magic;
+    uint32_t version;
+    uint32_t levels; // levels of the pyramid (1 to VIRTUAL_MAX_LEVELS)
+};
+
+// pages on a row of a level (there are half as many rows)
+inline uint32_t virtualPagesWide(uint32_t levels, uint32_t level) {
+    return 1u << (levels - level);
+}
+
+// index of a page in the file (x and y are its column and row on its level, the row 0 at the bottom)
+inline uint64_t virtualPageIndex(uint32_t levels, uint32_t level, uint32_t x, uint32_t y) {
+    uint64_t start = 0;
+    for (uint32_t l = 0; l < level; l++) {
+        uint64_t wide = virtualPagesWide(levels, l);
+        start += wide * wide / 2;
+    }
+    return start + (uint64_t) y * virtualPagesWide(levels, level) + x;
+}
+
+// pages of the whole pyramid
+inline uint64_t virtualPageCount(uint32_t levels) {
+    return virtualPageIndex(levels, levels, 0, 0);
+}
+
+#endif
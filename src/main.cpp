@@ -7,17 +7,52 @@
  * - Q key: move the camera down
  * - E key: move the camera up
  * - Mouse: look around
+ * - Left mouse button: pick the body under the cursor (or the screen's center) to focus or describe it
+ * - M key: free the cursor for picking (mouse look is paused) or capture it again
  * - Mouse scroll-wheel: zoom in and out
  * - ESC key: close the window
  *
  * Camera modes:
  * - SPACE key: free camera mode (default)
  * - 0 key: top view camera mode
+ * - V key: switch between compressed and true scale distances and sizes
  * - 1 to 8 keys: focus on a planet (NUMPAD also works)
+ * - H key: sky view from a place on the earth (arrow keys move the observer by one degree)
+ * - O key: fulldome fisheye of the view around the camera (dome master for planetarium projectors)
+ * - F9 key: render the view as a poster 16 times the window's size, in tiles (written to poster.png)
  *
  * Skybox modes:
  * - F1 key: purple nebula complex skybox (default)
  * - F2 key: green nebula skybox
+ * - F3 key: streamed star catalog (resources/catalogs/stars.oct, built by tools/build_star_octree.cpp)
+ * - F4 key: bright stars over a low resolution nebula (resources/catalogs/bright_stars.bin, or a synthetic sky)
+ *
+ * Time:
+ * - P key: pause/resume the simulation clock
+ * - R key: run the simulation clock backwards/forwards
+ * - + and - keys: speed up/slow down time by decades from real time to 10 million times faster (the default
+ *   speed, one year per 2 * PI seconds, is one of the steps)
+ * - HOME key: jump to the current date
+ *
+ * Small bodies:
+ * - B key: show/hide the main and kuiper asteroid belts
+ * - N key: jump to the next planetary event (conjunction, opposition, greatest elongation) and focus on it
+ * - C key: screen close approaches to the earth over the next year (press again to clear)
+ * - T key: show/hide the earth satellites
+ * - X key: screen conjunctions between earth satellites over the next week (press again to clear)
+ * - K key: show/hide the comets and their tails
+ * - L key: show/hide the trails of the planets, the moon and the earth satellites
+ * - G key: show/hide the labels of the bodies (overlapping labels are left out by priority)
+ * - F12 key (debug builds): benchmark the CPU propagators on the loaded small bodies and satellites (see also
+ *   solar_system.out --benchmark below)
+ *
+ * Video (headless, see include/common/video.h):
+ * - solar_system.out --video script output [shards]: render a camera script (resources/scripts/flythrough.txt) in
+ *   parallel worker processes and join their parts into output/video.mp4 (needs ffmpeg)
+ *
+ * Benchmark (headless):
+ * - solar_system.out --benchmark: print the throughput of the CPU propagators on the small bodies and the earth
+ *   satellites, for every vector width and thread count (build in release mode to measure the optimized kernels)
  *
  * @author joelvaz0x01
  * @author BrunoFG1
@@ -26,6 +61,9 @@
 
 #include <iostream>
 #include <map>
+#include <future>
+#include <cstdio>
+#include <cstring>
 #include <glad/glad.h>
 #include <GLFW/glfw3.h>
 #include <glm/glm.hpp>
@@ -38,6 +76,33 @@
 #include <stb_image.h>
 #include <shader_m.h>
 #include <camera.h>
+#include <asteroid_belt.h>
+#include <mpcorb.h>
+#include <propagator.h>
+#include <close_approach.h>
+#include <event_finder.h>
+#include <sgp4.h>
+#include <satellites.h>
+#include <conjunction.h>
+#include <trails.h>
+#include <comet_tail.h>
+#include <sim_clock.h>
+#include <reversed_depth.h>
+#include <picking.h>
+#include <text_batch.h>
+#include <labels.h>
+#include <star_streamer.h>
+#include <bright_stars.h>
+#include <horizon.h>
+#include <dome.h>
+#include <poster.h>
+#include <video.h>
+#include <eclipse.h>
+#include <atmosphere.h>
+#include <terrain.h>
+#include <virtual_texture.h>
+#include <impostors.h>
+#include <cubemap_loader.h>
 
 #include "main.h"
 
@@ -53,6 +118,39 @@
 #define CHAR_HEIGHT_UP 60.0f ///< additional font space when y = HEIGHT
 #define CHAR_HEIGHT_DOWN 25.0f ///< additional font space when y = 0
 
+#define MAIN_BELT_COUNT 750000 ///< number of synthetic main belt asteroids
+#define KUIPER_BELT_COUNT 250000 ///< number of synthetic kuiper belt objects
+#define CLOSE_APPROACH_DISTANCE 0.05 ///< close approach threshold (AU)
+#define CLOSE_APPROACH_SHOWN 8 ///< number of close approaches highlighted
+#define EVENT_YEARS 1000.0 ///< years of planetary events searched at start-up
+#define EARTH_INDEX 2 ///< index of the earth in planetProp
+#define MPCORB_PATH "resources/catalogs/MPCORB.DAT" ///< minor planet center catalog (used instead of the synthetic belts)
+#define SATELLITE_COUNT 12000 ///< number of synthetic earth satellites
+#define CONJUNCTION_DISTANCE 5.0 ///< satellite conjunction threshold (km)
+#define CONJUNCTION_DAYS 7.0 ///< days screened for satellite conjunctions
+#define CONJUNCTION_SHOWN 8 ///< number of satellite conjunctions highlighted
+#define TRAIL_CAPACITY 256 ///< samples per trail and decimation level
+#define TRAIL_SATELLITES 1000 ///< number of earth satellites with a trail
+#define TRAIL_BODY_SECONDS 4.0 ///< real seconds after which a planet or moon trail has faded out
+#define TRAIL_SATELLITE_SECONDS 2.0 ///< real seconds after which a satellite trail has faded out
+#define PICK_TOLERANCE 4.0f ///< distance in pixels within which points (asteroids, satellites) are picked
+#define COMET_PARTICLES 262144 ///< dust and ion particles shared by every comet
+#define LABEL_TEXT_SCALE 0.35f ///< scale of the body labels (glyphs are loaded 48 pixels high)
+#define TLE_PATH "resources/catalogs/satellites.tle" ///< satellite catalog in TLE format (used instead of the synthetic one)
+#define STAR_OCTREE_PATH "resources/catalogs/stars.oct" ///< star octree (optional background, see star_octree.h)
+#define BRIGHT_STARS_PATH "resources/catalogs/bright_stars.bin" ///< bright star catalog (see bright_stars.h)
+#define BRIGHT_STAR_COUNT 120000 ///< number of synthetic bright stars (without a bright star catalog)
+#define NEBULA_INTENSITY 0.6f ///< brightness of the low resolution nebula under the bright stars
+#define ATMOSPHERE_CACHE_PATH "resources/atmosphere.bin" ///< lookup tables of the earth's atmosphere (see atmosphere.h)
+#define ATMOSPHERE_EXPOSURE 10.0f ///< exposure of the light scattered by the atmosphere
+#define TERRAIN_PATH "resources/tiles/" ///< surface tiles of the planets (earth.tiles, ..., see terrain_tiles.h)
+#define VIRTUAL_TEXTURE_PATH "resources/textures/virtual/" ///< paged planet textures (earth.pages, ...)
+#define OBSERVER_LATITUDE 51.4769 ///< latitude of the sky view observer at start-up (degrees, royal observatory)
+#define OBSERVER_LONGITUDE 0.0 ///< east longitude of the sky view observer at start-up (degrees)
+#define SKY_MIN_RADIUS 3.0f ///< smallest radius in pixels of a body in the sky view
+#define POSTER_SCALE 16 ///< size of a poster in window sizes (30720x17280 pixels)
+#define POSTER_PATH "poster.png" ///< file of the last poster rendered
+
 /// planet information
 /// see more at: https://science.nasa.gov/solar-system/planets/
 /// and at: https://nssdc.gsfc.nasa.gov/planetary/factsheet/
@@ -82,18 +180,54 @@ planetProperties planetProp[] = {
 /// moon properties
 planetProperties moonProp = {6.0f, 0.3f, 3.0f, 0.03f};
 
-glm::mat4 view = glm::mat4(1.0f); ///< view matrix
+/// planet properties at true scale (same motion, distance and radius in scene units of TRUE_SCALE_KM)
+planetProperties trueScaleProp[] = {
+        {2.0f, (float) (0.387 * TRUE_SCALE_AU), 0.3f, 2440.0f / TRUE_SCALE_KM}, // mercury
+        {1.5f, (float) (0.723 * TRUE_SCALE_AU), 0.4f, 6051.0f / TRUE_SCALE_KM}, // venus
+        {1.0f, (float) (1.0 * TRUE_SCALE_AU), 0.5f, 6378.0f / TRUE_SCALE_KM}, // earth
+        {0.8f, (float) (1.524 * TRUE_SCALE_AU), 0.6f, 3390.0f / TRUE_SCALE_KM}, // mars
+        {0.6f, (float) (5.203 * TRUE_SCALE_AU), 0.7f, 69911.0f / TRUE_SCALE_KM}, // jupiter
+        {0.3f, (float) (9.537 * TRUE_SCALE_AU), 0.8f, 58232.0f / TRUE_SCALE_KM}, // saturn
+        {0.2f, (float) (19.19 * TRUE_SCALE_AU), 1.0f, 25362.0f / TRUE_SCALE_KM}, // uranus
+        {0.1f, (float) (30.07 * TRUE_SCALE_AU), 0.9f, 24622.0f / TRUE_SCALE_KM}  // neptune
+};
+
+/// moon properties at true scale
+planetProperties trueScaleMoonProp = {6.0f, 384400.0f / TRUE_SCALE_KM, 3.0f, 1737.0f / TRUE_SCALE_KM};
+
+bool trueScale = false; ///< check if distances and sizes are true to scale (instead of compressed)
+
+bool reversedDepth = false; ///< check if the scene is rendered with reversed float depth (see reversed_depth.h)
+DepthTarget depthTarget; ///< off-screen target with a float depth buffer (only with reversed depth)
+
+SphereBvh pickBvh; ///< hierarchy over the bounding spheres of every pickable body (refit at each pick)
+std::vector<glm::vec4> pickSpheres; ///< bounding spheres of the bodies, in the order described by pickBody
+StateVectors asteroidStates; ///< asteroid positions of the last pick (heliocentric AU)
+bool pickRequested = false; ///< check if a pick is waiting for the next frame
+glm::dvec2 pickCursor; ///< cursor position of the requested pick (screen coordinates)
+bool cursorFree = false; ///< check if the cursor is free (picking under it) instead of looking around
+std::string pickedText; ///< description of the last picked body
+
+/// orbital elements of the small bodies (asteroid catalog or synthetic belts)
+OrbitalElements asteroidElements;
+
+/// mean elements of the earth satellites (TLE catalog or synthetic)
+SatelliteElements satelliteElements;
+Sgp4Batch satelliteBatch; ///< SGP4 coefficients of the earth satellites
+StateVectors satelliteStates; ///< earth satellite positions and velocities of the current frame (TEME km)
+
+glm::mat4 view = glm::mat4(1.0f); ///< view matrix (rotation only, model matrices are relative to the camera)
 glm::mat4 projection = glm::mat4(1.0f); ///< projection matrix
 
 /// current camera position
 Camera camera(
-        glm::vec3(0.0f, 8.0f, 15.0f), // position
+        glm::dvec3(0.0, 8.0, 15.0), // position
         glm::vec3(0.0f, 1.0f, 0.0f), // up - default
         -90.0f, // yaw - default
         -35.0f // pitch (look down)
 );
 Camera upViewCamera(
-        glm::vec3(0.0f, 25.0f, 0.0f), // position
+        glm::dvec3(0.0, 25.0, 0.0), // position
         glm::vec3(0.0f, 1.0f, 0.0f), // up - default
         -90.0f, // yaw - default
         -89.0f // pitch (look down)
@@ -106,6 +240,7 @@ bool firstMouse = true; ///< check if it's the first time moving the mouse
 
 double deltaTime = 0.0f; ///< time between current frame and last frame
 double lastFrame = 0.0f; ///< time of last frame
+double frameRealTime = 0.0; ///< real seconds of the current frame (the time of the frame in a video)
 
 unsigned int sphereVAO = 0; ///< vertex array object for sphere
 GLsizei indexCount; ///< number of indices for sphere
@@ -122,13 +257,102 @@ unsigned int cameraMode = 8; ///< focus planet mode
 unsigned int skyboxVAO = 0; ///< vertex array object for skybox
 
 unsigned int skyboxMode = 0; ///< skybox mode
+StarStreamer starCatalog; ///< star octree streamed from disk (skybox mode 2)
+BrightStarField brightStars; ///< stars seen from the solar system (skybox mode 3)
+
+HorizonStars horizonStars; ///< bright stars above the horizon of the sky view observer
+OrbitalElements planetElements; ///< mean elements of the planets (sky view, see horizon.h)
+double observerLatitude = OBSERVER_LATITUDE; ///< latitude of the sky view observer (degrees)
+double observerLongitude = OBSERVER_LONGITUDE; ///< east longitude of the sky view observer (degrees)
+
+bool domeMode = false; ///< check if the view is rendered as a fulldome fisheye (see dome.h)
+DomeTarget domeTarget; ///< cube map faces of the fulldome fisheye
+
+PosterRender poster; ///< poster being rendered in tiles (see poster.h)
+Camera posterCamera = camera; ///< camera of the poster (the view is frozen until its last tile)
+bool posterWasPaused = false; ///< check if the simulation clock was paused before the poster
+VideoShard videoShard; ///< frames of a video rendered by this process (see video.h)
+
+EclipseOccluders eclipseOccluders; ///< bodies that may shadow one another this frame (see eclipse.h)
+
+AtmosphereParameters earthAir = earthAtmosphere(); ///< atmosphere of the earth (see atmosphere.h)
+AtmosphereTextures atmosphereTextures; ///< precomputed scattering of the earth's atmosphere (once it is built)
+std::future<AtmosphereTables> atmosphereBuild; ///< atmosphere lookup tables computed (or loaded) in background
+
+PlanetTerrain planetTerrain; ///< close-up surface of the focused planet (see terrain.h)
+int terrainPlanet = -1; ///< planet whose surface tiles were opened (-1 for none)
+
+VirtualTextureCache virtualTextures; ///< paged planet textures streamed into a fixed cache (see virtual_texture.h)
+std::vector<int> planetVirtualTexture; ///< virtual texture of each planet (-1 to use its whole texture)
+
+ImpostorCache impostors; ///< lit surfaces of the bodies too small on screen for a sphere (see impostors.h)
+
+AsteroidBelt asteroidBelt; ///< asteroid field evaluated in the vertex shader
+bool showAsteroids = true; ///< check if the asteroid belts are rendered
+
+std::vector<CloseApproach> closeApproaches; ///< close approaches to the earth (first body is the earth)
+std::future<std::vector<CloseApproach>> closeApproachSearch; ///< close approach screening running in background
+
+std::vector<PlanetEvent> planetEvents; ///< planetary events sorted by time
+std::future<std::vector<PlanetEvent>> planetEventSearch; ///< planetary event search running in background
+int shownEvent = -1; ///< index of the planetary event the camera jumped to (-1 if none)
+
+SimulationClock simulationClock; ///< clock of every animation (sampled once per frame)
+
+SatelliteLayer satelliteLayer; ///< earth satellites propagated on the CPU every frame
+bool showSatellites = true; ///< check if the earth satellites are rendered
+
+std::vector<SatelliteConjunction> conjunctions; ///< predicted conjunctions between earth satellites
+std::future<std::vector<SatelliteConjunction>> conjunctionSearch; ///< conjunction screening running in background
+
+TrailBuffer bodyTrails; ///< trails of the planets and the moon (scene coordinates)
+TrailBuffer satelliteTrails; ///< trails of the first earth satellites (earth radii around the earth)
+bool showTrails = true; ///< check if the trails are rendered
+
+OrbitalElements cometElements; ///< orbital elements of the comets (at most COMET_MAX)
+CometTail cometTail; ///< dust and ion tail particles of every comet (simulated on the GPU)
+bool showComets = true; ///< check if the comets are rendered
+
+TextBatch labelText; ///< glyph atlas and batched quads of the body labels
+LabelLayout labelLayout; ///< overlap free placement of the body labels
+std::vector<std::string> labelNames; ///< text of every label, in the order described by the label anchors
+std::vector<glm::vec4> labelAnchors; ///< camera relative position and priority of every label (current frame)
+bool showLabels = true; ///< check if the body labels are rendered
 
 /** Main function that is responsible for the execution of the solar system
  *
+ * @param argc: number of arguments
+ * @param argv: arguments (none for the interactive window, --benchmark, or a video mode, see video.h)
  * @return 0 if successful, -1 otherwise
  *
  */
-int main() {
+int main(int argc, char *argv[]) {
+    // video driver: only launches the worker processes
+    if (argc >= 4 && std::string(argv[1]) == "--video") {
+        return runVideoDriver(argv[0], argv[2], argv[3], argc >= 5 ? std::atoi(argv[4]) : 0, WIDTH, HEIGHT);
+    }
+
+    // propagator benchmark: runs in the optimized build without a window
+    if (argc == 2 && std::string(argv[1]) == "--benchmark") return runBenchmark();
+
+    // video worker: renders the frames of one shard without a window or a display
+    bool videoWorker = argc == 7 && std::string(argv[1]) == "--render";
+    if (videoWorker &&
+        !videoShard.begin(argv[2], argv[3], std::atoi(argv[4]), std::atoi(argv[5]), std::atoi(argv[6]))) {
+        std::cerr << "Failed to start the video shard of " << argv[2] << std::endl;
+        return -1;
+    }
+    if (videoWorker && !videoAspectMatches(videoShard.script, WIDTH, HEIGHT)) {
+        std::cerr << "The frame size of " << argv[2] << " must have the aspect of the window" << std::endl;
+        videoShard.release();
+        return -1;
+    }
+    if (videoWorker) skyboxMode = videoShard.script.skybox;
+    int exitStatus = 0;
+
+#ifdef GLFW_PLATFORM_NULL
+    if (videoWorker) glfwInitHint(GLFW_PLATFORM, GLFW_PLATFORM_NULL); // no display server needed
+#endif
     glfwInit();
     glfwWindowHint(GLFW_CONTEXT_VERSION_MAJOR, 3);
     glfwWindowHint(GLFW_CONTEXT_VERSION_MINOR, 3);
@@ -138,7 +362,13 @@ int main() {
     glfwWindowHint(GLFW_OPENGL_FORWARD_COMPAT, GL_TRUE);
 #endif
 
-    GLFWwindow *window = glfwCreateWindow(WIDTH, HEIGHT, "Solar System", glfwGetPrimaryMonitor() /*nullptr*/, nullptr);
+    if (videoWorker) {
+        glfwWindowHint(GLFW_CONTEXT_CREATION_API, GLFW_EGL_CONTEXT_API); // surfaceless EGL (llvmpipe or a GPU)
+        glfwWindowHint(GLFW_VISIBLE, GL_FALSE);
+    }
+
+    GLFWwindow *window = glfwCreateWindow(WIDTH, HEIGHT, "Solar System",
+                                          videoWorker ? nullptr : glfwGetPrimaryMonitor() /*nullptr*/, nullptr);
     if (window == nullptr) {
         std::cerr << "Failed to create GLFW window" << std::endl;
         glfwTerminate();
@@ -148,6 +378,7 @@ int main() {
     glfwSetFramebufferSizeCallback(window, framebuffer_size_callback);
     glfwSetCursorPosCallback(window, mouse_callback);
     glfwSetScrollCallback(window, scroll_callback);
+    glfwSetMouseButtonCallback(window, mouse_button_callback);
 
     // capture mouse
     glfwSetInputMode(window, GLFW_CURSOR, GLFW_CURSOR_DISABLED);
@@ -163,12 +394,47 @@ int main() {
     glEnable(GL_BLEND);
     glBlendFunc(GL_SRC_ALPHA, GL_ONE_MINUS_SRC_ALPHA);
 
+    // reversed depth in a float depth buffer when the context supports it (conventional depth otherwise); a video
+    // worker has no window to draw in, so it always renders into the off-screen target, at the frame's size
+    // (the window's target follows its framebuffer, which differs from WIDTH x HEIGHT on high density displays)
+    bool offscreen = videoWorker || reversedDepthSupported();
+    int targetWidth = videoShard.script.width, targetHeight = videoShard.script.height;
+    if (!videoWorker) glfwGetFramebufferSize(window, &targetWidth, &targetHeight);
+    if (offscreen && depthTarget.create(targetWidth, targetHeight)) {
+        if (reversedDepthSupported()) {
+            reversedDepth = true;
+            glClipControl(GL_LOWER_LEFT, GL_ZERO_TO_ONE);
+            glClearDepth(0.0);
+            glDepthFunc(GL_GREATER);
+        }
+    } else if (videoWorker) {
+        std::cerr << "Failed to create the video frame target" << std::endl;
+        return -1;
+    }
+
     // compile shaders
     Shader planet("shaders/planetVertex.glsl", "shaders/planetFragment.glsl");
     Shader sun("shaders/sunVertex.glsl", "shaders/sunFragment.glsl");
     Shader orbit("shaders/orbitVertex.glsl", "shaders/orbitFragment.glsl");
     Shader text("shaders/textVertex.glsl", "shaders/textFragment.glsl");
     Shader skybox("shaders/skyboxVertex.glsl", "shaders/skyboxFragment.glsl");
+    Shader asteroid("shaders/asteroidVertex.glsl", "shaders/asteroidFragment.glsl");
+    Shader satellite("shaders/satelliteVertex.glsl", "shaders/asteroidFragment.glsl");
+    Shader trail("shaders/trailVertex.glsl", "shaders/trailFragment.glsl");
+    Shader cometUpdate("shaders/cometUpdateVertex.glsl", {"Position", "Velocity"});
+    Shader comet("shaders/cometVertex.glsl", "shaders/cometFragment.glsl");
+    Shader label("shaders/labelVertex.glsl", "shaders/labelFragment.glsl");
+    Shader star("shaders/starVertex.glsl", "shaders/starFragment.glsl");
+    Shader domeSun("shaders/sunVertex.glsl", "shaders/sunFragment.glsl", "shaders/domeSunGeometry.glsl");
+    Shader domePlanet("shaders/planetVertex.glsl", "shaders/planetFragment.glsl", "shaders/domePlanetGeometry.glsl");
+    Shader domeOrbit("shaders/orbitVertex.glsl", "shaders/orbitFragment.glsl", "shaders/domeOrbitGeometry.glsl");
+    Shader domeStar("shaders/starVertex.glsl", "shaders/starFragment.glsl", "shaders/domeStarGeometry.glsl");
+    Shader domeWarp("shaders/domeVertex.glsl", "shaders/domeFragment.glsl");
+    Shader atmosphere("shaders/atmosphereVertex.glsl", "shaders/atmosphereFragment.glsl");
+    Shader terrain("shaders/terrainVertex.glsl", "shaders/planetFragment.glsl");
+    Shader virtualFeedback("shaders/planetVertex.glsl", "shaders/virtualFeedbackFragment.glsl");
+    Shader impostorBake("shaders/domeVertex.glsl", "shaders/impostorBakeFragment.glsl");
+    Shader impostor("shaders/impostorVertex.glsl", "shaders/impostorFragment.glsl");
 
     //load freetype
     FT_Library ft;
@@ -227,6 +493,11 @@ int main() {
                     static_cast<unsigned int>(face->glyph->advance.x)
             };
             Characters.insert(std::pair<char, Character>(c, character));
+
+            // copy the glyph to the atlas of the batched labels too
+            labelText.addGlyph(c, face->glyph->bitmap.buffer, (int) face->glyph->bitmap.width,
+                               (int) face->glyph->bitmap.rows, face->glyph->bitmap_left, face->glyph->bitmap_top,
+                               static_cast<unsigned int>(face->glyph->advance.x));
         }
         glBindTexture(GL_TEXTURE_2D, 0);
     }
@@ -234,6 +505,7 @@ int main() {
     // destroy FreeType once we're finished
     FT_Done_Face(face);
     FT_Done_FreeType(ft);
+    labelText.create();
 
     // configure textVAO/textVBO for texture quads
     glGenVertexArrays(1, &textVAO);
@@ -278,7 +550,7 @@ int main() {
             "resources/textures/skybox/purple_nebula_complex/purple_nebula_complex_front.png", // front side (+z)
             "resources/textures/skybox/purple_nebula_complex/purple_nebula_complex_back.png", // back side (-z)
     };
-    unsigned int pNebulaComplexSkybox = loadCubeMap(pNebulaComplex);
+    CubeMapLoader pNebulaComplexSkybox(pNebulaComplex); // decoded in background when shown (see the skybox render)
 
     // green nebula skybox
     const char *gNebula[] = {
@@ -289,13 +561,96 @@ int main() {
             "resources/textures/skybox/green_nebula/green_nebula_front.png", // front side (+z)
             "resources/textures/skybox/green_nebula/green_nebula_back.png", // back side (-z)
     };
-    unsigned int gNebulaSkybox = loadCubeMap(gNebula);
+    CubeMapLoader gNebulaSkybox(gNebula);
+
+    // low resolution nebula skybox (256x256, drawn under the bright stars)
+    const char *nebulaLow[] = {
+            "resources/textures/skybox/nebula_low/nebula_low_right.png", // right side (+x)
+            "resources/textures/skybox/nebula_low/nebula_low_left.png", // left side (-x)
+            "resources/textures/skybox/nebula_low/nebula_low_top.png", // top side (+y)
+            "resources/textures/skybox/nebula_low/nebula_low_bottom.png", // bottom side (-y)
+            "resources/textures/skybox/nebula_low/nebula_low_front.png", // front side (+z)
+            "resources/textures/skybox/nebula_low/nebula_low_back.png", // back side (-z)
+    };
+    unsigned int nebulaLowSkybox = loadCubeMap(nebulaLow);
+
+    // asteroid belts (orbital elements are uploaded once, positions are solved in the vertex shader)
+    if (!loadMpcorb(MPCORB_PATH, asteroidElements)) {
+        generateMainBelt(asteroidElements, MAIN_BELT_COUNT);
+        generateKuiperBelt(asteroidElements, KUIPER_BELT_COUNT);
+    }
+#ifdef _DEBUG
+    else std::cout << "Asteroid catalog loaded: " << asteroidElements.count() << " orbits" << std::endl;
+#endif
+    asteroidBelt.upload(asteroidElements);
+
+    // earth satellites (a real catalog moves the scene to its epoch, element sets are only valid near it)
+    if (loadTle(TLE_PATH, satelliteElements)) {
+        simulationClock.jumpTo(*std::max_element(satelliteElements.epoch.begin(), satelliteElements.epoch.end()));
+#ifdef _DEBUG
+        std::cout << "Satellite catalog loaded: " << satelliteElements.count() << " element sets" << std::endl;
+#endif
+    } else {
+        generateSatellites(satelliteElements, SATELLITE_COUNT, 0.0);
+    }
+    sgp4Init(satelliteElements, satelliteBatch);
+
+    // trails (one per planet plus the moon, and one per satellite up to TRAIL_SATELLITES)
+    bodyTrails.create(sizeof(planetProp) / sizeof(planetProp[0]) + 1, TRAIL_CAPACITY);
+    satelliteTrails.create((unsigned int) std::min<size_t>(satelliteBatch.count(), TRAIL_SATELLITES), TRAIL_CAPACITY);
+
+    // comets (particles are spawned at their nucleus by the first update)
+    addPeriodicComets(cometElements);
+    cometTail.create(COMET_PARTICLES);
+
+    // labels: sun, planets, moon, comets and satellites (their text never changes, so neither do their sizes)
+    labelNames.emplace_back("Sun");
+    for (const auto &info: planetInfo) labelNames.push_back(info.name);
+    labelNames.emplace_back("Moon");
+    for (unsigned int i = 0; i < cometElements.count(); i++) labelNames.emplace_back(COMET_NAMES[i]);
+    labelNames.insert(labelNames.end(), satelliteElements.name.begin(), satelliteElements.name.end());
+    std::vector<float> labelWidths;
+    for (const std::string &name: labelNames) labelWidths.push_back(labelText.measure(name, LABEL_TEXT_SCALE));
+    labelLayout.create((float) WIDTH, (float) HEIGHT, labelWidths, 48.0f * LABEL_TEXT_SCALE);
+
+    // star catalog (only its node table is read now, stars are streamed while they are in view)
+    if (starCatalog.open(STAR_OCTREE_PATH)) {
+#ifdef _DEBUG
+        std::cout << "Star octree mapped: " << STAR_OCTREE_PATH << std::endl;
+#endif
+    }
+
+    // bright stars (about 1 MB of catalog instead of a few hundred MB of cubemap textures)
+    std::vector<StarPoint> brightStarPoints;
+    if (!loadBrightStars(BRIGHT_STARS_PATH, brightStarPoints)) {
+        generateBrightStars(brightStarPoints, BRIGHT_STAR_COUNT, STAR_MAGNITUDE_LIMIT);
+    }
+#ifdef _DEBUG
+    else std::cout << "Bright star catalog loaded: " << brightStarPoints.size() << " stars" << std::endl;
+#endif
+    brightStars.create(brightStarPoints);
+
+    // sky view: the same stars in horizon coordinates and the real positions of the planets
+    horizonStars.create(brightStarPoints);
+    addPlanetElements(planetElements);
+
+    // search the planetary events in background
+    if (!videoWorker) planetEventSearch = std::async(std::launch::async, searchPlanetEvents, 0.0, EVENT_YEARS * 2.0 * PI);
 
     // number of planets
     unsigned int planetCount = sizeof(planetTextures) / sizeof(planetTextures[0]);
 
     // model matrix for each planet
-    auto *planetModel = new glm::mat4[planetCount];
+    auto *planetModel = new glm::dmat4[planetCount]; // double precision world matrices (see cameraRelative)
+
+    // paged textures of the planets that have one (the others keep their whole texture)
+    virtualTextures.create(WIDTH, HEIGHT);
+    planetVirtualTexture.assign(planetCount, -1);
+    for (unsigned int i = 0; i < planetCount; i++) {
+        std::string name = planetInfo[i].name;
+        std::transform(name.begin(), name.end(), name.begin(), ::tolower);
+        planetVirtualTexture[i] = virtualTextures.open((VIRTUAL_TEXTURE_PATH + name + ".pages").c_str());
+    }
 
     // sun shader configuration
     sun.use();
@@ -305,6 +660,60 @@ int main() {
     planet.use();
     planet.setInt("material.diffuse", 0);
     planet.setInt("material.specular", 1);
+    planet.setInt("pageCache", 2); // virtual textures (see virtual_texture.h)
+    planet.setInt("pageTable", 3);
+
+    // dome shader configuration (the same as their scene shaders)
+    domeSun.use();
+    domeSun.setInt("texture1", 0);
+    domePlanet.use();
+    domePlanet.setInt("material.diffuse", 0);
+    domePlanet.setInt("material.specular", 1);
+    terrain.use();
+    terrain.setInt("material.diffuse", 0); // the tile of each chunk (see terrain.h)
+    terrain.setInt("material.specular", 1);
+    domeWarp.use();
+    domeWarp.setInt("scene", 0);
+    domeWarp.setInt("skybox", 1);
+    domeWarp.setFloat("aperture", glm::radians(DOME_APERTURE));
+
+    // eclipses (occluders shared by every planet shader)
+    eclipseOccluders.create();
+    EclipseOccluders::bindBlock(planet.ID);
+    EclipseOccluders::bindBlock(domePlanet.ID);
+    EclipseOccluders::bindBlock(terrain.ID);
+    EclipseOccluders::bindBlock(impostorBake.ID);
+
+    // impostor shaders configuration (the bake reads the planet textures, the quads read the atlas)
+    impostors.create();
+    impostorBake.use();
+    impostorBake.setInt("material.diffuse", 0);
+    impostorBake.setInt("material.specular", 1);
+    impostor.use();
+    impostor.setInt("atlas", 0);
+    impostor.setBool("reversedDepth", reversedDepth);
+
+    // atmosphere shader configuration (its tables are bound to the units 0 to 2)
+    atmosphere.use();
+    atmosphere.setInt("transmittanceTexture", 0);
+    atmosphere.setInt("scatteringTexture", 1);
+    atmosphere.setInt("irradianceTexture", 2);
+    atmosphere.setFloat("atmosphere.bottomRadius", earthAir.bottomRadius);
+    atmosphere.setFloat("atmosphere.topRadius", earthAir.topRadius);
+    atmosphere.setVec3("atmosphere.rayleighScattering", earthAir.rayleighScattering);
+    atmosphere.setFloat("atmosphere.miePhaseG", earthAir.miePhaseG);
+    atmosphere.setFloat("atmosphere.muSMin", earthAir.muSMin);
+    atmosphere.setFloat("atmosphere.groundAlbedo", earthAir.groundAlbedo);
+    atmosphere.setFloat("exposure", ATMOSPHERE_EXPOSURE);
+
+    // atmosphere lookup tables: a few seconds on every core the first time, so the earth has no atmosphere until
+    // they are ready (a video worker waits for them, its frames must not depend on the timing)
+    atmosphereBuild = std::async(std::launch::async, [] {
+        AtmosphereTables tables;
+        tables.build(ATMOSPHERE_CACHE_PATH, earthAir);
+        return tables;
+    });
+    if (videoWorker) atmosphereTextures.create(atmosphereBuild.get());
 
     // phong lighting declaration
     glm::vec3 lightColor;
@@ -312,12 +721,13 @@ int main() {
     glm::vec3 ambientColor;
 
     // light properties (sun)
-    glm::vec3 sunPosition = glm::vec3(0.0f, 0.0f, 0.0f);
+    glm::dvec3 sunPosition = glm::dvec3(0.0, 0.0, 0.0);
     glm::vec3 sunLightColor = glm::vec3(1.0f, 1.0f, 1.0f);
-    glm::mat4 sunModel = glm::mat4(1.0f);
+    glm::dmat4 sunModel = glm::dmat4(1.0);
 
     // orbit properties
-    glm::mat4 orbitModel = glm::mat4(1.0f);
+    glm::dmat4 orbitModel = glm::dmat4(1.0);
+    glm::dvec3 moonPosition = glm::dvec3(0.0); // moon's position of the current frame (for its trail)
 
     // text properties
     std::string startText = "Solar System";
@@ -338,23 +748,150 @@ int main() {
 
     // NOTE: to render fixed text, projection matrix must be orthographic (2D) instead of perspective (3D)
     // in this case: 0 <= x <= WIDTH && 0 <= y <= HEIGHT
-    projection = glm::ortho(0.0f, static_cast<float>(WIDTH), 0.0f, static_cast<float>(HEIGHT));
+    setTextProjection(text, label, glm::ortho(0.0f, static_cast<float>(WIDTH), 0.0f, static_cast<float>(HEIGHT)));
+
+    label.use();
+    label.setInt("atlas", 0);
+
+    skybox.use();
+    skybox.setBool("reversedDepth", reversedDepth);
 
-    text.use();
-    text.setMat4("projection", projection);
+    star.use();
+    star.setMat3("equatorialToScene", equatorialToScene());
+    star.setFloat("magnitudeLimit", STAR_MAGNITUDE_LIMIT);
+    star.setFloat("pointScale", 1.2f);
 
+    domeStar.use();
+    domeStar.setMat3("equatorialToScene", equatorialToScene());
+    domeStar.setFloat("magnitudeLimit", STAR_MAGNITUDE_LIMIT);
+    domeStar.setFloat("pointScale", 1.2f);
+
+#ifdef _DEBUG
+    double lastReport = glfwGetTime(); // time of the last frame time report
+    unsigned int reportFrames = 0; // frames rendered since the last report
+#endif
+
+    lastFrame = glfwGetTime(); // the loading time above is not simulated
     while (!glfwWindowShouldClose(window)) {
         double currentFrame = glfwGetTime();
         deltaTime = currentFrame - lastFrame;
+        if (poster.active()) deltaTime = 0.0; // the view is frozen while a poster is rendered
         lastFrame = currentFrame;
+        if (videoShard.active()) { // the time and the camera of the frame come from the script
+            deltaTime = videoShard.frameTime();
+            frameRealTime = videoShard.frameSeconds(); // whatever frame the shard started from
+            videoShard.startFrame(simulationClock, camera);
+        } else {
+            frameRealTime += deltaTime;
+            simulationClock.tick(deltaTime); // every body reads this sample during the frame
+        }
+
+#ifdef _DEBUG
+        reportFrames++;
+        if (currentFrame - lastReport >= 1.0) {
+            std::cout << "Frame time: " << 1000.0 * (currentFrame - lastReport) / reportFrames << " ms ("
+                      << asteroidBelt.count << " asteroids)" << std::endl;
+            lastReport = currentFrame;
+            reportFrames = 0;
+        }
+#endif
 
         processInput(window);
 
+        if (poster.active()) { // one tile of the poster per frame
+            camera = posterCamera; // the mouse is not processed with the keys
+            pickRequested = false; // the cursor is not over the tile
+            poster.bindTile();
+            setTextProjection(text, label, poster.hudProjection((float) WIDTH, (float) HEIGHT));
+        } else if (depthTarget.FBO != 0) { // reversed depth or a video frame
+            depthTarget.bind();
+        }
         glClearColor(0.1f, 0.1f, 0.1f, 1.0f);
         glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT);
 
-        projection = glm::perspective(glm::radians(camera.Zoom), (float) WIDTH / (float) HEIGHT, 0.1f, 100.0f);
-        view = camera.GetViewMatrix();
+        // distances and sizes of the current scale mode
+        const planetProperties *bodyProp = trueScale ? trueScaleProp : planetProp;
+        const planetProperties &bodyMoonProp = trueScale ? trueScaleMoonProp : moonProp;
+        double sunScale = trueScale ? 696000.0 / TRUE_SCALE_KM : 1.0;
+
+        // bodies of the frame and the camera following them (the dome master is drawn from the same ones)
+        glm::dmat4 moonModel;
+        updateBodies(sunPosition, planetModel, planetCount, sunModel, moonModel);
+        moonPosition = glm::dvec3(moonModel[3]);
+
+        // NOTE: without reversed depth, true scale needs a far plane beyond neptune, which leaves little depth
+        // precision near the planets
+        if (reversedDepth) {
+            projection = reversedPerspective(glm::radians(camera.Zoom), (float) WIDTH / (float) HEIGHT,
+                                             trueScale ? 0.001f : 0.01f);
+        } else if (trueScale) {
+            projection = glm::perspective(glm::radians(camera.Zoom), (float) WIDTH / (float) HEIGHT, 0.01f, 2e5f);
+        } else {
+            projection = glm::perspective(glm::radians(camera.Zoom), (float) WIDTH / (float) HEIGHT, 0.1f, 100.0f);
+        }
+        glm::mat4 screenProjection = projection; // projection of the whole view (labels are placed on it)
+        if (poster.active()) projection = poster.tileProjection(projection);
+        view = camera.GetRotationMatrix(); // the camera's position is subtracted by cameraRelative
+
+        // only the cubemap shown is kept in memory (a 4096x4096 cubemap takes about 400 MB); it is decoded in
+        // background and the low resolution nebula is drawn meanwhile, except in frames that must be reproducible
+        bool waitSkybox = videoShard.active() || poster.active();
+        pNebulaComplexSkybox.update(skyboxMode == 0, waitSkybox);
+        gNebulaSkybox.update(skyboxMode == 1, waitSkybox);
+        unsigned int nebulaSkybox = skyboxMode == 0 ? pNebulaComplexSkybox.ID : skyboxMode == 1 ? gNebulaSkybox.ID : 0;
+        if ((skyboxMode == 0 || skyboxMode == 1) && nebulaSkybox == 0) nebulaSkybox = nebulaLowSkybox;
+
+        if (cameraMode == 10) { // the sky seen from the earth replaces the scene
+            pickRequested = false; // nothing to pick in the sky view
+            renderSkyView(sun, planet, star, orbit, text, sunTexture, planetTextures, moonTexture, textColor);
+            presentFrame(window);
+            continue;
+        }
+
+        if (domeMode) { // the fisheye around the camera replaces the scene
+            pickRequested = false; // the cursor does not map to the scene in the dome master
+            unsigned int domeSkybox = 0;
+            float domeSkyboxIntensity = 1.0f;
+            if (skyboxMode == 0 || skyboxMode == 1) {
+                domeSkybox = nebulaSkybox;
+            } else if (skyboxMode == 3) {
+                domeSkybox = nebulaLowSkybox;
+                domeSkyboxIntensity = NEBULA_INTENSITY;
+            }
+            renderDome(window, domeSun, domePlanet, domeStar, domeOrbit, domeWarp, domeSkybox, domeSkyboxIntensity,
+                       sunTexture, planetTextures, moonTexture, sunModel, planetModel, planetCount, moonModel);
+            presentFrame(window);
+            continue;
+        }
+
+        // render the streamed star catalog first, behind everything (stars are directions, they write no depth)
+        if (skyboxMode == 2) {
+            // observer in heliocentric equatorial parsecs (only true scale distances move it away from the sun)
+            glm::dvec3 offset = trueScale ? camera.Position - sunPosition : glm::dvec3(0.0);
+            glm::dvec3 observer = glm::transpose(glm::dmat3(equatorialToScene())) * offset /
+                                  (TRUE_SCALE_AU * AU_PER_PARSEC);
+            starCatalog.update(observer, (float) HEIGHT / glm::radians(camera.Zoom));
+            star.use();
+            star.setMat4("projection", projection);
+            star.setMat4("view", view);
+            star.setVec3("observer", glm::vec3(observer));
+            glDisable(GL_DEPTH_TEST);
+            starCatalog.draw();
+            glEnable(GL_DEPTH_TEST);
+        } else if (skyboxMode == 3) { // the dimmed nebula, then the bright stars over it
+            glDisable(GL_DEPTH_TEST);
+            skybox.use();
+            skybox.setMat4("projection", projection);
+            skybox.setMat4("view", view);
+            skybox.setFloat("intensity", NEBULA_INTENSITY);
+            renderSkybox(nebulaLowSkybox);
+            star.use();
+            star.setMat4("projection", projection);
+            star.setMat4("view", view);
+            star.setVec3("observer", glm::vec3(0.0f)); // the stars are only directions
+            brightStars.draw();
+            glEnable(GL_DEPTH_TEST);
+        }
 
         // sun properties (phong shading)
         lightColor = sunLightColor;
@@ -366,20 +903,25 @@ int main() {
         sun.setVec3("color", lightColor);
         sun.setMat4("projection", projection);
         sun.setMat4("view", view);
-        sunModel = glm::translate(glm::mat4(1.0f), sunPosition);
-        sunModel = glm::rotate(sunModel, (float) glfwGetTime() * 0.1f, glm::vec3(0.0f, 1.0f, 0.0f));
-        sun.setMat4("model", sunModel);
+        sun.setMat4("model", cameraRelative(glm::scale(sunModel, glm::dvec3(sunScale))));
         bindTexture(sunTexture);
         renderSphere();
-
-        // planet properties
-        planet.use();
-        planet.setVec3("light.position", sunPosition);
-        planet.setMat4("projection", projection);
-        planet.setMat4("view", view);
-        planet.setVec3("light.ambient", ambientColor);
-        planet.setVec3("light.diffuse", diffuseColor);
-        planet.setVec3("light.specular", lightColor);
+        updateEclipses(planetModel, planetCount, moonPosition);
+
+        // planet properties (the terrain of the focused planet is lit the same way)
+        for (Shader *shader: {&planet, &terrain, &impostorBake}) {
+            shader->use();
+            shader->setVec3("light.position", cameraRelative(sunPosition));
+            shader->setFloat("light.radius", (float) sunScale);
+            shader->setMat4("projection", projection);
+            shader->setMat4("view", view);
+            shader->setVec3("light.ambient", ambientColor);
+            shader->setVec3("light.diffuse", diffuseColor);
+            shader->setVec3("light.specular", lightColor);
+        }
+        updateTerrain(planetModel, planetCount);
+        renderVirtualFeedback(virtualFeedback, planetModel, planetCount);
+        updateImpostors(impostorBake, planetModel, planetCount, moonModel, planetTextures, moonTexture);
 
         // orbit properties
         orbit.use();
@@ -389,46 +931,228 @@ int main() {
 
         for (unsigned int i = 0; i < planetCount; i++) {
             // render planets
-            planetModel[i] = planetCreator(
-                    planetProp[i].translation, // translation around the sun (translation velocity)
-                    planetProp[i].distance, // distance from the sun
-                    planetProp[i].rotation, // rotation around its own axis (rotation velocity)
-                    planetProp[i].scale, // scale of the planet
-                    sunModel[3] // center of the model (contains the exact position of the sun)
-            );
-            planet.use();
-            planet.setMat4("model", planetModel[i]);
-            bindTexture(planetTextures[i]);
-            renderSphere();
+            if ((int) i == terrainPlanet && planetTerrain.isOpen()) { // close-up surface of the focused planet
+                terrain.use();
+                terrain.setInt("occluderMask", eclipseOccluders.mask(i));
+                terrain.setMat4("model", cameraRelative(planetModel[i]));
+                planetTerrain.draw(terrain.ID);
+            } else if (!impostors.isImpostor(i)) {
+                planet.use();
+                planet.setInt("occluderMask", eclipseOccluders.mask(i));
+                planet.setMat4("model", cameraRelative(planetModel[i]));
+                bindTexture(planetTextures[i]);
+                if (planetVirtualTexture[i] >= 0) virtualTextures.bind(planet.ID, planetVirtualTexture[i]);
+                renderSphere();
+                planet.setBool("virtualDiffuse", false); // the moon and the other views use whole textures
+            }
 
             // render planet's orbit
             orbit.use();
-            orbitModel = glm::translate(glm::mat4(1.0f), glm::vec3(sunModel[3]));
-            orbit.setMat4("model", orbitModel);
+            orbitModel = glm::translate(glm::dmat4(1.0), glm::dvec3(sunModel[3]));
+            orbitModel = glm::scale(orbitModel, glm::dvec3(bodyProp[i].distance / planetProp[i].distance));
+            orbit.setMat4("model", cameraRelative(orbitModel));
             renderOrbit(planetProp[i].distance, &orbitVAO[i]);
 
             if (planetInfo[i].name == "Earth") {
-                // render moon
-                glm::mat4 moonModel = planetCreator(
-                        moonProp.translation, // translation around the earth (translation velocity)
-                        moonProp.distance, // distance from the earth
-                        moonProp.rotation, // rotation around its own axis (rotation velocity)
-                        moonProp.scale, // scale of the planet
-                        planetModel[i][3] // center of the model (contains the exact position of the earth)
-                );
-                planet.use();
-                planet.setMat4("model", moonModel);
-                bindTexture(moonTexture);
-                renderSphere();
+                // render moon (the last body of the eclipses)
+                if (!impostors.isImpostor(planetCount)) {
+                    planet.use();
+                    planet.setInt("occluderMask", eclipseOccluders.mask(planetCount));
+                    planet.setMat4("model", cameraRelative(moonModel));
+                    bindTexture(moonTexture);
+                    renderSphere();
+                }
 
                 // render moon's orbit
                 orbit.use();
-                orbitModel = glm::translate(glm::mat4(1.0f), glm::vec3(planetModel[i][3]));
-                orbit.setMat4("model", orbitModel);
+                orbitModel = glm::translate(glm::dmat4(1.0), glm::dvec3(planetModel[i][3]));
+                orbitModel = glm::scale(orbitModel, glm::dvec3(bodyMoonProp.distance / moonProp.distance));
+                orbit.setMat4("model", cameraRelative(orbitModel));
                 renderOrbit(moonProp.distance, &moonOrbitVAO);
             }
         }
 
+        // the bodies too small for a sphere, one quad each
+        impostor.use();
+        impostor.setMat4("projection", projection);
+        impostor.setMat4("view", view);
+        impostors.draw();
+
+        // earth's atmosphere over the planets and the moon behind it
+        if (atmosphereBuild.valid() &&
+            atmosphereBuild.wait_for(std::chrono::seconds(0)) == std::future_status::ready) {
+            atmosphereTextures.create(atmosphereBuild.get());
+        }
+        if (atmosphereTextures.ready()) renderAtmosphere(atmosphere, planetModel[EARTH_INDEX], bodyProp[EARTH_INDEX].scale);
+
+        // render earth satellites around the earth (radius of the earth's sphere is its scale)
+        if (showSatellites) {
+            propagateSatellites(satelliteBatch, sceneTime() / SCENE_SECONDS_PER_DAY, satelliteStates);
+            satelliteLayer.update(satelliteStates);
+            glm::dmat4 satelliteModel = glm::translate(glm::dmat4(1.0), glm::dvec3(planetModel[EARTH_INDEX][3]));
+            satelliteModel = glm::scale(satelliteModel, glm::dvec3(bodyProp[EARTH_INDEX].scale));
+            satellite.use();
+            satellite.setMat4("projection", projection);
+            satellite.setMat4("view", view);
+            satellite.setMat4("model", cameraRelative(satelliteModel));
+            satellite.setVec3("color", glm::vec3(0.6f, 0.9f, 1.0f));
+            satellite.setFloat("pointScale", 3.0f);
+            satelliteLayer.draw();
+        }
+
+        // render the trails (only the newest sample of each body is uploaded per frame)
+        if (showTrails) {
+            float trailTime = (float) sceneTime();
+            bool moved = simulationClock.sceneDelta() != 0.0; // a paused clock adds no samples
+            // fade after a fixed number of real seconds whatever the warp (scene seconds per real second)
+            double sceneRate = simulationClock.warp() * SCENE_SECONDS_PER_DAY / 86400.0;
+            bodyTrails.begin();
+            for (unsigned int i = 0; i < planetCount && moved; i++) {
+                bodyTrails.push(i, glm::vec3(planetModel[i][3]), trailTime);
+            }
+            if (moved) bodyTrails.push(planetCount, glm::vec3(moonPosition), trailTime);
+            bodyTrails.end();
+
+            trail.use();
+            trail.setMat4("projection", projection);
+            trail.setMat4("view", view);
+            trail.setMat4("model", cameraRelative(glm::dmat4(1.0))); // samples are world positions
+            trail.setFloat("time", trailTime);
+            trail.setFloat("direction", simulationClock.isReversed() ? -1.0f : 1.0f);
+            trail.setFloat("fadeTime", (float) (TRAIL_BODY_SECONDS * sceneRate));
+            trail.setVec3("color", glm::vec3(0.5f, 0.8f, 1.0f));
+            bodyTrails.draw();
+
+            if (showSatellites) {
+                satelliteTrails.begin();
+                for (unsigned int i = 0; i < satelliteTrails.count() && i < satelliteStates.count() && moved; i++) {
+                    glm::vec3 position = glm::vec3(satelliteStates.x[i], satelliteStates.y[i], satelliteStates.z[i]);
+                    position /= SGP4_EARTH_RADIUS;
+                    float r2 = glm::dot(position, position);
+                    if (r2 >= 1.0f && r2 < 1e6f) satelliteTrails.push(i, position, trailTime); // also rejects NaN
+                }
+                satelliteTrails.end();
+
+                glm::dmat4 satelliteModel = glm::translate(glm::dmat4(1.0), glm::dvec3(planetModel[EARTH_INDEX][3]));
+                satelliteModel = glm::scale(satelliteModel, glm::dvec3(bodyProp[EARTH_INDEX].scale));
+                trail.setMat4("model", cameraRelative(satelliteModel));
+                trail.setFloat("fadeTime", (float) (TRAIL_SATELLITE_SECONDS * sceneRate));
+                trail.setVec3("color", glm::vec3(0.6f, 0.9f, 1.0f));
+                satelliteTrails.draw();
+            }
+        }
+
+        // pick the body under the cursor (bodies are gathered and the hierarchy refit only when a pick is requested)
+        if (pickRequested) {
+            pickRequested = false;
+            pickSpheres.clear();
+            pickSpheres.emplace_back(glm::vec3(sunModel[3]), (float) sunScale);
+            for (unsigned int i = 0; i < planetCount; i++) {
+                pickSpheres.emplace_back(glm::vec3(planetModel[i][3]), bodyProp[i].scale);
+            }
+            pickSpheres.emplace_back(glm::vec3(moonPosition), bodyMoonProp.scale);
+            for (unsigned int i = 0; i < cometElements.count() && showComets; i++) {
+                double position[3];
+                orbitPosition(cometElements, i, sceneTime(), position);
+                pickSpheres.emplace_back(glm::vec3(eclipticToScene(position, sunModel[3])), 0.02f);
+            }
+            size_t satelliteFirst = pickSpheres.size();
+            for (size_t i = 0; i < satelliteStates.count() && showSatellites; i++) {
+                double position[3] = {satelliteStates.x[i], satelliteStates.y[i], satelliteStates.z[i]};
+                if (!(std::fabs(position[0]) < 1e6)) position[0] = position[1] = position[2] = 0.0; // decayed
+                pickSpheres.emplace_back(glm::vec3(temeToScene(position, planetModel[EARTH_INDEX][3])), 0.0f);
+            }
+            size_t asteroidFirst = pickSpheres.size();
+            if (showAsteroids) {
+                propagateOrbits(asteroidElements, sceneTime(), asteroidStates);
+                pickSpheres.resize(asteroidFirst + asteroidStates.count());
+                glm::dvec3 sun = glm::dvec3(sunModel[3]);
+                parallelFor(asteroidStates.count(), [&](size_t begin, size_t end, unsigned int) {
+                    for (size_t i = begin; i < end; i++) {
+                        double position[3] = {asteroidStates.x[i], asteroidStates.y[i], asteroidStates.z[i]};
+                        pickSpheres[asteroidFirst + i] = glm::vec4(glm::vec3(eclipticToScene(position, sun)), 0.0f);
+                    }
+                });
+            }
+            pickBvh.refit(pickSpheres);
+
+            int hit = pickBody(pickCursor.x, pickCursor.y);
+            pickedText.clear();
+            if (hit == 0) {
+                pickedText = "Sun";
+            } else if (hit >= 1 && hit <= (int) planetCount + 1) {
+                cameraMode = hit <= (int) planetCount ? hit - 1 : EARTH_INDEX; // the moon focuses the earth
+                shownEvent = -1;
+            } else if (hit > (int) planetCount + 1 && hit < (int) satelliteFirst) {
+                pickedText = COMET_NAMES[hit - planetCount - 2];
+            } else if (hit >= (int) satelliteFirst && hit < (int) asteroidFirst) {
+                pickedText = satelliteElements.name[hit - satelliteFirst];
+            } else if (hit >= (int) asteroidFirst) {
+                size_t index = hit - asteroidFirst;
+                char line[128];
+                snprintf(line, sizeof(line), "Asteroid %zu: a = %.3f AU, e = %.3f, i = %.1f deg", index,
+                         asteroidElements.semiMajorAxis[index], asteroidElements.eccentricity[index],
+                         glm::degrees(asteroidElements.inclination[index]));
+                pickedText = line;
+            }
+        }
+
+        // render asteroid belts
+        if (showAsteroids) {
+            asteroid.use();
+            asteroid.setMat4("projection", projection);
+            asteroid.setMat4("view", view);
+            asteroid.setVec3("center", cameraRelative(glm::dvec3(sunModel[3])));
+            asteroid.setFloat("auScale", trueScale ? (float) TRUE_SCALE_AU : 0.0f);
+            asteroid.setVec3("color", glm::vec3(0.8f, 0.75f, 0.7f));
+            asteroid.setFloat("time", (float) sceneTime());
+            asteroid.setFloat("pointScale", 6.0f);
+            asteroidBelt.draw();
+        }
+
+        // collect the planetary event search once it is done
+        if (planetEventSearch.valid() &&
+            planetEventSearch.wait_for(std::chrono::seconds(0)) == std::future_status::ready) {
+            planetEvents = planetEventSearch.get();
+        }
+
+        // collect the close approach screening once it is done
+        if (closeApproachSearch.valid() &&
+            closeApproachSearch.wait_for(std::chrono::seconds(0)) == std::future_status::ready) {
+            closeApproaches = closeApproachSearch.get();
+        }
+
+        // highlight the asteroids of the next close approaches
+        orbit.use();
+        orbit.setVec3("color", glm::vec3(1.0f, 0.2f, 0.2f)); // red color
+        for (unsigned int i = 0; i < closeApproaches.size() && i < CLOSE_APPROACH_SHOWN; i++) {
+            double position[3];
+            orbitPosition(asteroidElements, closeApproaches[i].second - 1, sceneTime(), position);
+            orbitModel = glm::translate(glm::dmat4(1.0), eclipticToScene(position, sunModel[3]));
+            orbit.setMat4("model", cameraRelative(glm::scale(orbitModel, glm::dvec3(0.03))));
+            renderSphere();
+        }
+
+        // collect the satellite conjunction screening once it is done
+        if (conjunctionSearch.valid() &&
+            conjunctionSearch.wait_for(std::chrono::seconds(0)) == std::future_status::ready) {
+            conjunctions = conjunctionSearch.get();
+        }
+
+        // highlight both satellites of the next conjunctions
+        orbit.setVec3("color", glm::vec3(1.0f, 0.5f, 0.1f)); // orange color
+        for (unsigned int i = 0; i < conjunctions.size() && i < CONJUNCTION_SHOWN; i++) {
+            for (size_t index: {conjunctions[i].first, conjunctions[i].second}) {
+                double position[3], velocity[3];
+                if (!sgp4Reference(satelliteBatch, index, sceneTime() / SCENE_SECONDS_PER_DAY, position, velocity))
+                    continue;
+                orbitModel = glm::translate(glm::dmat4(1.0), temeToScene(position, planetModel[EARTH_INDEX][3]));
+                orbit.setMat4("model", cameraRelative(glm::scale(orbitModel, glm::dvec3(0.005))));
+                renderSphere();
+            }
+        }
+        orbit.setVec3("color", sunLightColor); // white color
+
         // render project's name text
         renderText(
                 text,
@@ -439,8 +1163,20 @@ int main() {
                 textColor
         );
 
+        // render simulation date and speed
+        char clockLine[96];
+        snprintf(clockLine, sizeof(clockLine), "%s  x%.3g%s%s", simulationClock.date().c_str(), simulationClock.warp(),
+                 simulationClock.isReversed() ? " reversed" : "", simulationClock.isPaused() ? " paused" : "");
+        renderText(text, clockLine, charWidthScaled(0.5f, strlen(clockLine), true), charHeightScaled(0.5f, true), 0.5f,
+                   textColor);
+
+        // render the description of the last picked body (below the simulation date)
+        if (!pickedText.empty()) {
+            renderText(text, pickedText, charWidthScaled(0.5f, pickedText.length(), true),
+                       charHeightScaled(0.5f, true) - 30.0f, 0.5f, glm::vec3(1.0f, 0.8f, 0.3f));
+        }
+
         if (cameraMode == 9) { // render top view camera mode
-            camera = upViewCamera;
             renderText(
                     text,
                     upViewText,
@@ -450,15 +1186,19 @@ int main() {
                     textColor
             );
         } else if (cameraMode != 8) { // render planet's information camera mode
-            camera = Camera(
-                    glm::vec3(planetModel[cameraMode][3]) + glm::vec3(0.0f, 1.2f, 1.0f), // position
-                    glm::vec3(0.0f, 1.0f, 0.0f), // up - default
-                    -90.0f, // yaw - default
-                    -50.0f // pitch (look down)
-            );
             showPlanetInfo(text, cameraMode, textColor, planetInfoTextScale);
+            if (shownEvent >= 0 && planetEvents[shownEvent].first == cameraMode) {
+                std::string eventText = describeEvent(planetEvents[shownEvent]);
+                renderText(
+                        text,
+                        eventText,
+                        charWidthScaled(planetInfoTextScale, eventText.length(), false),
+                        charHeightScaled(planetInfoTextScale, true) - 6.0f * 50.0f,
+                        planetInfoTextScale,
+                        glm::vec3(1.0f, 0.8f, 0.3f)
+                );
+            }
         } else { // render free camera mode
-            freeCamera = camera; // save current camera position
             renderText(
                     text,
                     freeModeText,
@@ -469,16 +1209,163 @@ int main() {
             );
         }
 
+        // render close approach list
+        if (closeApproachSearch.valid()) {
+            renderText(text, "Screening close approaches...", charWidthScaled(0.5f, 0, false),
+                       charHeightScaled(0.5f, false), 0.5f, textColor);
+        }
+        for (unsigned int i = 0; i < closeApproaches.size() && i < CLOSE_APPROACH_SHOWN; i++) {
+            const CloseApproach &event = closeApproaches[i];
+            char line[128];
+            snprintf(line, sizeof(line), "Asteroid %zu: %.4f AU from earth in %.0f days", event.second - 1,
+                     event.distance, (event.time - sceneTime()) / SCENE_SECONDS_PER_DAY);
+            renderText(text, line, charWidthScaled(0.5f, 0, false),
+                       charHeightScaled(0.5f, false) + (float) (CLOSE_APPROACH_SHOWN - i) * 30.0f, 0.5f, textColor);
+        }
+
+        // render satellite conjunction list (above the close approach list)
+        float conjunctionListY = charHeightScaled(0.5f, false) + (float) (CLOSE_APPROACH_SHOWN + 1) * 30.0f;
+        if (conjunctionSearch.valid()) {
+            renderText(text, "Screening satellite conjunctions...", charWidthScaled(0.5f, 0, false),
+                       conjunctionListY, 0.5f, textColor);
+        }
+        for (unsigned int i = 0; i < conjunctions.size() && i < CONJUNCTION_SHOWN; i++) {
+            const SatelliteConjunction &event = conjunctions[i];
+            char line[160];
+            snprintf(line, sizeof(line), "%s / %s: %.2f km at %.1f km/s in %.1f hours",
+                     satelliteElements.name[event.first].c_str(), satelliteElements.name[event.second].c_str(),
+                     event.distance, event.speed, (event.time - sceneTime() / SCENE_SECONDS_PER_DAY) * 24.0);
+            renderText(text, line, charWidthScaled(0.5f, 0, false),
+                       conjunctionListY + (float) (CONJUNCTION_SHOWN - i) * 30.0f, 0.5f, textColor);
+        }
+
         // render skybox
         skybox.use();
         skybox.setMat4("projection", projection);
         skybox.setMat4("view", glm::mat4(glm::mat3(camera.GetViewMatrix())));
-        if (skyboxMode == 0) renderSkybox(pNebulaComplexSkybox);
-        else renderSkybox(gNebulaSkybox);
+        skybox.setFloat("intensity", 1.0f);
+        if (skyboxMode == 0 || skyboxMode == 1) renderSkybox(nebulaSkybox);
+
+        // render comets after the skybox (their tails do not write depth, so the skybox would cover them)
+        if (showComets) {
+            comet.use();
+            comet.setMat4("projection", projection);
+            comet.setMat4("view", view);
+            comet.setMat4("model", cameraRelative(glm::dmat4(1.0))); // particles are world positions
+            orbit.use();
+            orbit.setVec3("color", sunLightColor); // white color
+            for (unsigned int i = 0; i < cometElements.count(); i++) {
+                // nucleus position and velocity (finite difference, the compressed distances have no simple form)
+                double position[3], later[3];
+                orbitPosition(cometElements, i, sceneTime(), position);
+                orbitPosition(cometElements, i, sceneTime() + 1e-3, later);
+                glm::dvec3 nucleus = eclipticToScene(position, sunModel[3]);
+                glm::dvec3 nucleusVelocity = (eclipticToScene(later, sunModel[3]) - nucleus) * 1e3;
+                double r = std::sqrt(position[0] * position[0] + position[1] * position[1] +
+                                     position[2] * position[2]); // heliocentric distance (AU)
+                std::string index = "[" + std::to_string(i) + "]";
+
+                cometUpdate.use();
+                cometUpdate.setVec3("nucleus" + index, glm::vec3(nucleus));
+                cometUpdate.setVec3("nucleusVelocity" + index, glm::vec3(nucleusVelocity));
+                comet.use();
+                comet.setFloat("activity" + index, (float) std::min(1.0, 2.25 / (r * r))); // bright within 1.5 AU
+
+                // render nucleus
+                orbit.use();
+                orbit.setMat4("model", cameraRelative(glm::scale(glm::translate(glm::dmat4(1.0), nucleus), glm::dvec3(0.02))));
+                renderSphere();
+            }
+
+            // one transform feedback pass moves, retires and respawns every particle
+            cometUpdate.use();
+            cometUpdate.setVec3("sunPosition", glm::vec3(sunModel[3]));
+            cometUpdate.setFloat("time", (float) sceneTime());
+            cometUpdate.setFloat("deltaTime", (float) simulationClock.sceneDelta());
+            cometUpdate.setInt("cometCount", (int) cometElements.count());
+            cometUpdate.setFloat("lifetime", 0.15f); // about nine days
+            // tails keep their look at true scale (about 1 AU is 4 units when compressed)
+            float tailScale = trueScale ? (float) TRUE_SCALE_AU / 4.0f : 1.0f;
+            cometUpdate.setFloat("dustPressure", 250.0f * tailScale * tailScale * tailScale);
+            cometUpdate.setFloat("ionPressure", 6000.0f * tailScale * tailScale * tailScale);
+            cometUpdate.setFloat("ejectionSpeed", 0.5f * tailScale);
+            cometTail.update();
+
+            comet.use();
+            comet.setFloat("time", (float) sceneTime());
+            comet.setInt("cometCount", (int) cometElements.count());
+            comet.setFloat("pointScale", 8.0f * (trueScale ? (float) TRUE_SCALE_AU / 4.0f : 1.0f));
+            cometTail.draw();
+        }
+
+        // render the labels of the bodies over everything (anchors are gathered in the order of labelNames)
+        if (showLabels) {
+            labelAnchors.clear();
+            // priority: focused planet, sun, planets, moon, comets, then satellites by closeness to the camera
+            labelAnchors.emplace_back(cameraRelative(glm::dvec3(sunModel[3])), 1e8f);
+            for (unsigned int i = 0; i < planetCount; i++) {
+                float priority = cameraMode == i ? 1e9f : 1e7f;
+                labelAnchors.emplace_back(cameraRelative(glm::dvec3(planetModel[i][3])), priority);
+            }
+            labelAnchors.emplace_back(cameraRelative(moonPosition), 1e6f);
+            for (unsigned int i = 0; i < cometElements.count(); i++) {
+                double position[3];
+                orbitPosition(cometElements, i, sceneTime(), position);
+                labelAnchors.emplace_back(cameraRelative(eclipticToScene(position, sunModel[3])),
+                                          showComets ? 1e5f : 0.0f);
+            }
+            for (size_t i = 0; i < satelliteElements.count(); i++) {
+                double position[3] = {satelliteStates.x[i], satelliteStates.y[i], satelliteStates.z[i]};
+                bool valid = showSatellites && i < satelliteStates.count() && std::fabs(position[0]) < 1e6;
+                if (!valid) position[0] = position[1] = position[2] = 0.0; // hidden or decayed
+                glm::vec3 anchor = cameraRelative(temeToScene(position, planetModel[EARTH_INDEX][3]));
+                labelAnchors.emplace_back(anchor, valid ? 1.0f / std::max(glm::length(anchor), 1e-4f) : 0.0f);
+            }
+
+            const std::vector<ScreenLabel> &shown = labelLayout.place(labelAnchors, screenProjection * view,
+                                                                      (float) deltaTime);
+            auto satelliteFirst = (unsigned int) (labelNames.size() - satelliteElements.count());
+            for (const ScreenLabel &shownLabel: shown) {
+                glm::vec3 color = shownLabel.label >= satelliteFirst ? glm::vec3(0.6f, 0.9f, 1.0f) : textColor;
+                labelText.add(labelNames[shownLabel.label], shownLabel.x, shownLabel.y + 12.0f * LABEL_TEXT_SCALE,
+                              LABEL_TEXT_SCALE, glm::vec4(color, shownLabel.alpha)); // baseline above descenders
+            }
+            glDisable(GL_DEPTH_TEST);
+            label.use();
+            labelText.draw();
+            glEnable(GL_DEPTH_TEST);
+        }
+
+        if (videoShard.active()) { // the frame is encoded instead of shown
+            bool encoded = true;
+            if (!videoShard.endFrame(depthTarget.FBO, encoded)) {
+                if (!encoded) {
+                    std::cerr << "Failed to encode the video shard of " << argv[2] << std::endl;
+                    exitStatus = -1;
+                }
+                break;
+            }
+            glfwPollEvents();
+            continue;
+        }
 
-        // swap buffers and poll IO events
-        glfwSwapBuffers(window);
-        glfwPollEvents();
+        if (poster.active()) { // the tile is read back instead of shown
+            bool written = false;
+            if (poster.endTile(written)) {
+                std::cout << (written ? "Poster written: " : "Failed to write the poster: ") << POSTER_PATH
+                          << std::endl;
+                int windowWidth, windowHeight;
+                glfwGetFramebufferSize(window, &windowWidth, &windowHeight);
+                glViewport(0, 0, windowWidth, windowHeight);
+                setTextProjection(text, label, glm::ortho(0.0f, static_cast<float>(WIDTH), 0.0f,
+                                                          static_cast<float>(HEIGHT)));
+                simulationClock.setPaused(posterWasPaused);
+            }
+            glfwPollEvents();
+            continue;
+        }
+
+        presentFrame(window);
     }
 
     // de-allocate all resources
@@ -490,19 +1377,37 @@ int main() {
     glDeleteVertexArrays(1, &textVAO);
     glDeleteBuffers(1, &textVBO);
     glDeleteVertexArrays(1, &skyboxVAO);
+    asteroidBelt.release();
+    satelliteLayer.release();
+    depthTarget.release();
+    bodyTrails.release();
+    cometTail.release();
+    labelText.release();
+    starCatalog.release();
+    brightStars.release();
+    horizonStars.release();
+    domeTarget.release();
+    poster.release();
+    eclipseOccluders.release();
+    atmosphereTextures.release();
+    planetTerrain.release();
+    virtualTextures.release();
+    impostors.release();
+    satelliteTrails.release();
 
     glDeleteTextures(1, &sunTexture);
     for (unsigned int &planetTexture: planetTextures) {
         glDeleteTextures(1, &planetTexture);
     }
     glDeleteTextures(1, &moonTexture);
-    glDeleteTextures(1, &gNebulaSkybox);
-    glDeleteTextures(1, &pNebulaComplexSkybox);
+    gNebulaSkybox.release();
+    pNebulaComplexSkybox.release();
+    glDeleteTextures(1, &nebulaLowSkybox);
 
     delete[] planetModel;
 
     glfwTerminate(); // clear all previously allocated GLFW resources
-    return 0;
+    return exitStatus;
 }
 
 /** Function to process input
@@ -512,18 +1417,22 @@ int main() {
  */
 void processInput(GLFWwindow *window) {
     if (glfwGetKey(window, GLFW_KEY_ESCAPE) == GLFW_PRESS) glfwSetWindowShouldClose(window, true);
+    if (poster.active() || videoShard.active()) return; // the view is frozen or follows a video script
 
-    if (glfwGetKey(window, GLFW_KEY_W) == GLFW_PRESS) camera.ProcessKeyboard(FORWARD, (float) deltaTime);
-    if (glfwGetKey(window, GLFW_KEY_S) == GLFW_PRESS) camera.ProcessKeyboard(BACKWARD, (float) deltaTime);
-    if (glfwGetKey(window, GLFW_KEY_A) == GLFW_PRESS) camera.ProcessKeyboard(LEFT, (float) deltaTime);
-    if (glfwGetKey(window, GLFW_KEY_D) == GLFW_PRESS) camera.ProcessKeyboard(RIGHT, (float) deltaTime);
-    if (glfwGetKey(window, GLFW_KEY_E) == GLFW_PRESS) camera.ProcessKeyboard(UPWARD, (float) deltaTime);
-    if (glfwGetKey(window, GLFW_KEY_Q) == GLFW_PRESS) camera.ProcessKeyboard(DOWNWARD, (float) deltaTime);
+    // the camera moves faster when the distances are true to scale
+    auto moveTime = (float) (trueScale ? deltaTime * TRUE_SCALE_AU / 4.0 : deltaTime);
+    if (glfwGetKey(window, GLFW_KEY_W) == GLFW_PRESS) camera.ProcessKeyboard(FORWARD, moveTime);
+    if (glfwGetKey(window, GLFW_KEY_S) == GLFW_PRESS) camera.ProcessKeyboard(BACKWARD, moveTime);
+    if (glfwGetKey(window, GLFW_KEY_A) == GLFW_PRESS) camera.ProcessKeyboard(LEFT, moveTime);
+    if (glfwGetKey(window, GLFW_KEY_D) == GLFW_PRESS) camera.ProcessKeyboard(RIGHT, moveTime);
+    if (glfwGetKey(window, GLFW_KEY_E) == GLFW_PRESS) camera.ProcessKeyboard(UPWARD, moveTime);
+    if (glfwGetKey(window, GLFW_KEY_Q) == GLFW_PRESS) camera.ProcessKeyboard(DOWNWARD, moveTime);
 
     // change camera mode
     if (glfwGetKey(window, GLFW_KEY_SPACE) == GLFW_PRESS) { // reset camera position to free camera mode
         camera = freeCamera;
         cameraMode = 8;
+        shownEvent = -1;
     }
     if (glfwGetKey(window, GLFW_KEY_1) == GLFW_PRESS || glfwGetKey(window, GLFW_KEY_KP_1) == GLFW_PRESS)
         cameraMode = 0; // mercury camera mode
@@ -544,9 +1453,147 @@ void processInput(GLFWwindow *window) {
     if (glfwGetKey(window, GLFW_KEY_0) == GLFW_PRESS || glfwGetKey(window, GLFW_KEY_KP_0) == GLFW_PRESS)
         cameraMode = 9; // top view camera mode
 
+    // switch between compressed and true scale (the free camera keeps its place relative to the planets)
+    if (keyPressed(window, GLFW_KEY_V)) {
+        trueScale = !trueScale;
+        double ratio = trueScale ? TRUE_SCALE_AU / 4.0 : 4.0 / TRUE_SCALE_AU;
+        if (cameraMode == 8) camera.Position *= ratio;
+        freeCamera.Position *= ratio;
+        bodyTrails.clear();
+        satelliteTrails.clear();
+    }
+
+    // free or capture the cursor
+    if (keyPressed(window, GLFW_KEY_M)) {
+        cursorFree = !cursorFree;
+        glfwSetInputMode(window, GLFW_CURSOR, cursorFree ? GLFW_CURSOR_NORMAL : GLFW_CURSOR_DISABLED);
+        firstMouse = true; // the cursor jumps when its mode changes
+    }
+
     // change skybox mode
     if (glfwGetKey(window, GLFW_KEY_F1) == GLFW_PRESS) skyboxMode = 0; // green nebula skybox
     if (glfwGetKey(window, GLFW_KEY_F2) == GLFW_PRESS) skyboxMode = 1; // purple nebula complex skybox
+    if (glfwGetKey(window, GLFW_KEY_F3) == GLFW_PRESS && starCatalog.isOpen()) skyboxMode = 2; // star catalog
+    if (glfwGetKey(window, GLFW_KEY_F4) == GLFW_PRESS) skyboxMode = 3; // bright stars
+
+    // sky view from the earth (facing south) and its observer
+    if (keyPressed(window, GLFW_KEY_H)) {
+        camera = Camera(glm::dvec3(0.0), glm::vec3(0.0f, 1.0f, 0.0f), 90.0f, 20.0f);
+        cameraMode = 10;
+        shownEvent = -1;
+    }
+    // render a poster of the view (one tile per frame, the clock is paused meanwhile)
+    if (keyPressed(window, GLFW_KEY_F9) && cameraMode != 10 && !domeMode) {
+        if (poster.begin(POSTER_PATH, WIDTH * POSTER_SCALE, HEIGHT * POSTER_SCALE)) {
+            posterCamera = camera;
+            posterWasPaused = simulationClock.isPaused();
+            simulationClock.setPaused(true);
+            std::cout << "Rendering a poster of " << poster.width << "x" << poster.height << " pixels in "
+                      << poster.tiles() << " tiles" << std::endl;
+        } else {
+            std::cerr << "Failed to start the poster: " << POSTER_PATH << std::endl;
+        }
+    }
+
+    // fulldome fisheye (its cube map is only allocated while it is shown)
+    if (keyPressed(window, GLFW_KEY_O)) {
+        if (domeMode) {
+            domeTarget.release();
+            domeMode = false;
+        } else if (domeTarget.create(DOME_FACE_SIZE)) {
+            domeMode = true;
+        } else {
+            std::cerr << "Failed to create the dome cube map" << std::endl;
+            domeTarget.release();
+        }
+    }
+
+    if (cameraMode == 10) {
+        if (keyPressed(window, GLFW_KEY_UP)) observerLatitude = std::min(observerLatitude + 1.0, 90.0);
+        if (keyPressed(window, GLFW_KEY_DOWN)) observerLatitude = std::max(observerLatitude - 1.0, -90.0);
+        if (keyPressed(window, GLFW_KEY_RIGHT)) observerLongitude = std::fmod(observerLongitude + 541.0, 360.0) - 180.0;
+        if (keyPressed(window, GLFW_KEY_LEFT)) observerLongitude = std::fmod(observerLongitude + 539.0, 360.0) - 180.0;
+    }
+
+    // toggle small bodies
+    if (keyPressed(window, GLFW_KEY_B)) showAsteroids = !showAsteroids;
+    if (keyPressed(window, GLFW_KEY_T)) {
+        showSatellites = !showSatellites;
+        satelliteTrails.clear(); // hidden satellites are not sampled
+    }
+    if (keyPressed(window, GLFW_KEY_K)) showComets = !showComets;
+    if (keyPressed(window, GLFW_KEY_G)) showLabels = !showLabels;
+    if (keyPressed(window, GLFW_KEY_L)) {
+        showTrails = !showTrails;
+        bodyTrails.clear();
+        satelliteTrails.clear();
+    }
+
+    // screen conjunctions between earth satellites over the next week (in background)
+    if (keyPressed(window, GLFW_KEY_X) && !conjunctionSearch.valid()) {
+        if (!conjunctions.empty()) conjunctions.clear();
+        else conjunctionSearch = std::async(std::launch::async, screenConjunctions, std::cref(satelliteBatch),
+                                            sceneTime() / SCENE_SECONDS_PER_DAY, CONJUNCTION_DAYS,
+                                            CONJUNCTION_DISTANCE, 30.0, 0u);
+    }
+
+    // simulation clock
+    if (keyPressed(window, GLFW_KEY_P)) simulationClock.setPaused(!simulationClock.isPaused());
+    if (keyPressed(window, GLFW_KEY_R)) {
+        simulationClock.setReversed(!simulationClock.isReversed());
+        bodyTrails.clear(); // trails are only drawn behind the direction of time
+        satelliteTrails.clear();
+    }
+    if (keyPressed(window, GLFW_KEY_EQUAL) || keyPressed(window, GLFW_KEY_KP_ADD)) simulationClock.stepWarp(1);
+    if (keyPressed(window, GLFW_KEY_MINUS) || keyPressed(window, GLFW_KEY_KP_SUBTRACT)) simulationClock.stepWarp(-1);
+    if (keyPressed(window, GLFW_KEY_HOME)) {
+        simulationClock.jumpToNow();
+        bodyTrails.clear();
+        satelliteTrails.clear();
+    }
+
+    // jump to the next planetary event and focus on its planet
+    if (keyPressed(window, GLFW_KEY_N) && !planetEvents.empty()) {
+        double now = sceneTime();
+        auto next = std::upper_bound(planetEvents.begin(), planetEvents.end(), now + 1e-3,
+                                     [](double time, const PlanetEvent &event) { return time < event.time; });
+        if (next != planetEvents.end()) {
+            simulationClock.jumpToScene(next->time);
+            bodyTrails.clear(); // the trails would join both times with a straight line
+            satelliteTrails.clear();
+            shownEvent = (int) (next - planetEvents.begin());
+            cameraMode = next->first;
+        }
+    }
+
+    // screen close approaches to the earth over the next year (in background)
+    if (keyPressed(window, GLFW_KEY_C) && !closeApproachSearch.valid()) {
+        if (!closeApproaches.empty()) closeApproaches.clear();
+        else closeApproachSearch = std::async(std::launch::async, screenEarthApproaches, sceneTime());
+    }
+
+#ifdef _DEBUG
+    // CPU propagation throughput of the loaded small bodies and satellites
+    if (keyPressed(window, GLFW_KEY_F12)) {
+        benchmarkPropagator(asteroidElements);
+        benchmarkSgp4(satelliteBatch, sceneTime() / SCENE_SECONDS_PER_DAY);
+    }
+#endif
+}
+
+/** Function to detect a key press (only true on the frame the key goes down)
+ *
+ * @param window: window to process input
+ * @param key: GLFW key code
+ * @return true if the key was pressed since the last call
+ *
+ */
+bool keyPressed(GLFWwindow *window, int key) {
+    static bool keyDown[GLFW_KEY_LAST + 1] = {false}; // key state in the previous call
+    bool down = glfwGetKey(window, key) == GLFW_PRESS;
+    bool pressed = down && !keyDown[key];
+    keyDown[key] = down;
+    return pressed;
 }
 
 /** Function to resize window size if changed (by OS or user resize)
@@ -558,6 +1605,8 @@ void processInput(GLFWwindow *window) {
  */
 void framebuffer_size_callback(GLFWwindow *window, int width, int height) {
     glViewport(0, 0, width, height);
+    // the off-screen target follows the window (a video frame keeps the script's size, a minimized window is 0 x 0)
+    if (depthTarget.FBO != 0 && !videoShard.active() && width > 0 && height > 0) depthTarget.resize(width, height);
 }
 
 /** Function to process mouse movement
@@ -580,7 +1629,28 @@ void mouse_callback(GLFWwindow *window, double x_pos, double y_pos) {
     lastX = x_pos;
     lastY = y_pos;
 
-    camera.ProcessMouseMovement((float) x_offset, (float) y_offset);
+    if (!cursorFree) camera.ProcessMouseMovement((float) x_offset, (float) y_offset);
+}
+
+/** Function to process mouse buttons
+ *
+ * @param window: window to process mouse buttons
+ * @param button: GLFW mouse button
+ * @param action: GLFW_PRESS or GLFW_RELEASE
+ * @param mods: modifier keys
+ *
+ */
+void mouse_button_callback(GLFWwindow *window, int button, int action, int mods) {
+    if (button != GLFW_MOUSE_BUTTON_LEFT || action != GLFW_PRESS) return;
+
+    // the pick is done in the next frame, once every body has been moved
+    int width, height;
+    glfwGetWindowSize(window, &width, &height);
+    if (cursorFree) glfwGetCursorPos(window, &pickCursor.x, &pickCursor.y);
+    else pickCursor = glm::dvec2(width / 2.0, height / 2.0); // the captured cursor aims at the screen's center
+    pickCursor.x *= (double) WIDTH / width; // the projection covers WIDTH x HEIGHT whatever the window size
+    pickCursor.y *= (double) HEIGHT / height;
+    pickRequested = true;
 }
 
 /**
@@ -915,7 +1985,8 @@ void renderSkybox(unsigned int skyboxCubeMap) {
         );
         glEnableVertexAttribArray(0);
     }
-    glDepthFunc(GL_LEQUAL); // set depth function to less than AND equal for skybox depth trick
+    // set depth function to less than AND equal for skybox depth trick (greater than AND equal when reversed)
+    glDepthFunc(reversedDepth ? GL_GEQUAL : GL_LEQUAL);
 
     glBindVertexArray(skyboxVAO);
     glActiveTexture(GL_TEXTURE0);
@@ -923,7 +1994,447 @@ void renderSkybox(unsigned int skyboxCubeMap) {
     glDrawArrays(GL_TRIANGLES, 0, 36);
     glBindVertexArray(0);
 
-    glDepthFunc(GL_LESS); // reset depth function to default
+    glDepthFunc(reversedDepth ? GL_GREATER : GL_LESS); // reset depth function to default
+}
+
+/** Function to render the sky seen by an observer on the earth (sky view camera mode)
+ *
+ * @param sunShader: shader of the sun
+ * @param planetShader: shader of the planets and the moon
+ * @param starShader: shader of the stars
+ * @param orbitShader: shader of the horizon line
+ * @param textShader: shader of the names and the observer's place
+ * @param sunTexture: texture of the sun
+ * @param planetTextures: textures of the planets (in the order of planetInfo)
+ * @param moonTexture: texture of the moon
+ * @param textColor: color of the text
+ *
+ */
+void renderSkyView(Shader &sunShader, Shader &planetShader, Shader &starShader, Shader &orbitShader,
+                   Shader &textShader, unsigned int sunTexture, const unsigned int *planetTextures,
+                   unsigned int moonTexture, glm::vec3 textColor) {
+    double days = simulationClock.days();
+    glm::dmat3 toHorizon = horizonMatrix(days, glm::radians(observerLatitude), glm::radians(observerLongitude));
+
+    // stars above the horizon (already in horizon coordinates, so the scene rotation is left out)
+    horizonStars.update(glm::mat3(toHorizon));
+    starShader.use();
+    starShader.setMat4("projection", projection);
+    starShader.setMat4("view", view);
+    starShader.setMat3("equatorialToScene", glm::mat3(1.0f));
+    starShader.setVec3("observer", glm::vec3(0.0f));
+    glDisable(GL_DEPTH_TEST);
+    horizonStars.draw();
+    glEnable(GL_DEPTH_TEST);
+    starShader.setMat3("equatorialToScene", equatorialToScene()); // for the other star backgrounds
+
+    // sun, planets and moon seen from the observer (J2000 equatorial km, the earth is body 3 and is skipped)
+    const unsigned int bodyCount = sizeof(planetInfo) / sizeof(planetInfo[0]) + 2;
+    double position[3];
+    orbitPosition(planetElements, EARTH_INDEX, days * SCENE_SECONDS_PER_DAY, position);
+    glm::dvec3 earth = eclipticToEquatorial(position) * KM_PER_AU;
+    glm::dvec3 observer = earth + glm::transpose(toHorizon) * glm::dvec3(0.0, EARTH_RADIUS_KM, 0.0); // zenith
+    glm::dvec3 moon = earth + lunarPosition(days);
+
+    float x[bodyCount], y[bodyCount], z[bodyCount]; // directions
+    float lightX[bodyCount], lightY[bodyCount], lightZ[bodyCount]; // direction of the sun from each body
+    double distance[bodyCount], radius[bodyCount]; // km
+    std::string names[bodyCount];
+    unsigned int textures[bodyCount];
+    for (unsigned int i = 0; i < bodyCount; i++) {
+        glm::dvec3 body;
+        if (i == 0) { // sun
+            body = glm::dvec3(0.0);
+            radius[i] = 696000.0;
+            names[i] = "Sun";
+            textures[i] = sunTexture;
+        } else if (i == bodyCount - 1) {
+            body = moon;
+            radius[i] = trueScaleMoonProp.scale * TRUE_SCALE_KM;
+            names[i] = "Moon";
+            textures[i] = moonTexture;
+        } else {
+            orbitPosition(planetElements, i - 1, days * SCENE_SECONDS_PER_DAY, position);
+            body = eclipticToEquatorial(position) * KM_PER_AU;
+            radius[i] = trueScaleProp[i - 1].scale * TRUE_SCALE_KM;
+            names[i] = planetInfo[i - 1].name;
+            textures[i] = planetTextures[i - 1];
+        }
+        glm::dvec3 direction = body - observer;
+        distance[i] = glm::length(direction);
+        x[i] = (float) (direction.x / distance[i]);
+        y[i] = (float) (direction.y / distance[i]);
+        z[i] = (float) (direction.z / distance[i]);
+        glm::dvec3 toSun = i == 0 ? glm::dvec3(0.0) : glm::normalize(-body); // so each body shows its own phase
+        lightX[i] = (float) toSun.x, lightY[i] = (float) toSun.y, lightZ[i] = (float) toSun.z;
+    }
+    transformDirections(glm::mat3(toHorizon), x, y, z, bodyCount, x, y, z);
+    transformDirections(glm::mat3(toHorizon), lightX, lightY, lightZ, bodyCount, lightX, lightY, lightZ);
+
+    // bodies keep their angular size (at least SKY_MIN_RADIUS pixels) and are placed in order of distance
+    float minAngle = SKY_MIN_RADIUS * 2.0f * std::tan(glm::radians(camera.Zoom) / 2.0f) / (float) HEIGHT;
+    glm::vec3 lightColor = glm::vec3(1.0f, 1.0f, 1.0f); // as in the scene
+    glm::vec3 diffuse = lightColor * glm::vec3(0.8f);
+    planetShader.use();
+    planetShader.setInt("occluderMask", 0); // the bodies are not at their true places
+    planetShader.setMat4("projection", projection);
+    planetShader.setMat4("view", view);
+    planetShader.setVec3("light.ambient", diffuse * glm::vec3(0.1f));
+    planetShader.setVec3("light.diffuse", diffuse);
+    planetShader.setVec3("light.specular", lightColor);
+    sunShader.use();
+    sunShader.setVec3("color", lightColor);
+    sunShader.setMat4("projection", projection);
+    sunShader.setMat4("view", view);
+
+    for (unsigned int i = 0; i < bodyCount; i++) {
+        if (i - 1 == EARTH_INDEX) continue;
+        auto angle = (float) std::max(radius[i] / distance[i], (double) minAngle);
+        if (y[i] < -angle) continue; // below the horizon
+        auto skyDistance = (float) (2.0 * std::log10(distance[i])); // from 11 (moon) to 20 (neptune)
+        glm::vec3 center = glm::vec3(x[i], y[i], z[i]) * skyDistance;
+        glm::mat4 model = glm::scale(glm::translate(glm::mat4(1.0f), center), glm::vec3(angle * skyDistance));
+        Shader &shader = i == 0 ? sunShader : planetShader;
+        shader.use();
+        shader.setMat4("model", model);
+        // far along the body's own direction of the sun (the bodies are not at their true places on the sky)
+        if (i != 0) shader.setVec3("light.position", center + glm::vec3(lightX[i], lightY[i], lightZ[i]) * 1e4f);
+        bindTexture(textures[i]);
+        renderSphere();
+
+        // name beside the body
+        glm::vec4 clip = projection * view * glm::vec4(center, 1.0f);
+        if (clip.w <= 0.0f) continue;
+        float screenX = (clip.x / clip.w + 1.0f) * 0.5f * WIDTH, screenY = (clip.y / clip.w + 1.0f) * 0.5f * HEIGHT;
+        renderText(textShader, names[i], screenX + 12.0f, screenY - 8.0f, 0.4f, textColor);
+    }
+
+    // horizon and cardinal points
+    orbitShader.use();
+    orbitShader.setMat4("projection", projection);
+    orbitShader.setMat4("view", view);
+    orbitShader.setVec3("color", glm::vec3(0.3f, 0.5f, 0.3f));
+    orbitShader.setMat4("model", glm::scale(glm::mat4(1.0f), glm::vec3(25.0f / planetProp[0].distance)));
+    renderOrbit(planetProp[0].distance, &orbitVAO[0]);
+    const char *cardinals[] = {"N", "E", "S", "W"};
+    const glm::vec3 cardinalDirections[] = {glm::vec3(0.0f, 0.0f, -1.0f), glm::vec3(1.0f, 0.0f, 0.0f),
+                                            glm::vec3(0.0f, 0.0f, 1.0f), glm::vec3(-1.0f, 0.0f, 0.0f)};
+    for (int i = 0; i < 4; i++) {
+        glm::vec4 clip = projection * view * glm::vec4(cardinalDirections[i] * 25.0f, 1.0f);
+        if (clip.w <= 0.0f) continue;
+        renderText(textShader, cardinals[i], (clip.x / clip.w + 1.0f) * 0.5f * WIDTH - 10.0f,
+                   (clip.y / clip.w + 1.0f) * 0.5f * HEIGHT + 10.0f, 0.6f, glm::vec3(0.5f, 0.8f, 0.5f));
+    }
+
+    // observer's place and the simulation date
+    renderText(textShader, "Sky View Mode", charWidthScaled(1.0f, 13, false), charHeightScaled(1.0f, true), 1.0f,
+               textColor);
+    char skyLine[128];
+    snprintf(skyLine, sizeof(skyLine), "%.0f %c %.0f %c  %s  x%.3g%s", std::fabs(observerLatitude),
+             observerLatitude >= 0.0 ? 'N' : 'S', std::fabs(observerLongitude), observerLongitude >= 0.0 ? 'E' : 'W',
+             simulationClock.date().c_str(), simulationClock.warp(), simulationClock.isPaused() ? " paused" : "");
+    renderText(textShader, skyLine, charWidthScaled(0.5f, strlen(skyLine), true), charHeightScaled(0.5f, true), 0.5f,
+               textColor);
+}
+
+/** Function to render the view around the camera as a fulldome fisheye (dome master, see dome.h)
+ *
+ * @param window: window the dome master is shown in (a centered square)
+ * @param sunShader: dome shader of the sun
+ * @param planetShader: dome shader of the planets and the moon
+ * @param starShader: dome shader of the stars
+ * @param orbitShader: dome shader of the orbits
+ * @param warpShader: shader of the warp from the cube map to the dome master
+ * @param skyboxCubeMap: skybox composited behind the scene (0 for none)
+ * @param skyboxIntensity: brightness of the skybox
+ * @param sunTexture: texture of the sun
+ * @param planetTextures: textures of the planets (in the order of planetInfo)
+ * @param moonTexture: texture of the moon
+ * @param sunModel: model matrix of the sun (see updateBodies)
+ * @param planetModel: model matrices of the planets
+ * @param planetCount: number of planets
+ * @param moonModel: model matrix of the moon
+ *
+ */
+void renderDome(GLFWwindow *window, Shader &sunShader, Shader &planetShader, Shader &starShader,
+                Shader &orbitShader, Shader &warpShader, unsigned int skyboxCubeMap, float skyboxIntensity,
+                unsigned int sunTexture, const unsigned int *planetTextures, unsigned int moonTexture,
+                const glm::dmat4 &sunModel, const glm::dmat4 *planetModel, unsigned int planetCount,
+                const glm::dmat4 &moonModel) {
+    const planetProperties *bodyProp = trueScale ? trueScaleProp : planetProp;
+    const planetProperties &bodyMoonProp = trueScale ? trueScaleMoonProp : moonProp;
+    double sunScale = trueScale ? 696000.0 / TRUE_SCALE_KM : 1.0;
+    updateEclipses(planetModel, planetCount, glm::dvec3(moonModel[3]));
+
+    // faces are 90 degree views from the camera, whose view matrix is applied before the geometry shaders
+    glm::mat4 faceProjection;
+    if (reversedDepth) {
+        faceProjection = reversedPerspective(glm::radians(90.0f), 1.0f, trueScale ? 0.001f : 0.01f);
+    } else if (trueScale) {
+        faceProjection = glm::perspective(glm::radians(90.0f), 1.0f, 0.01f, 2e5f);
+    } else {
+        faceProjection = glm::perspective(glm::radians(90.0f), 1.0f, 0.1f, 100.0f);
+    }
+    glm::mat4 faceMatrices[6];
+    domeFaceMatrices(faceProjection, faceMatrices);
+    for (Shader *shader: {&sunShader, &planetShader, &starShader, &orbitShader}) {
+        shader->use();
+        shader->setMat4("projection", glm::mat4(1.0f));
+        shader->setMat4("view", view);
+        shader->setInt("faceMask", DOME_ALL_FACES);
+        for (int face = 0; face < 6; face++) {
+            shader->setMat4("faceMatrices[" + std::to_string(face) + "]", faceMatrices[face]);
+        }
+    }
+    domeTarget.bind();
+
+    // stars first, behind everything (the skybox is composited by the warp where nothing was drawn)
+    if (skyboxMode == 2 || skyboxMode == 3) {
+        starShader.use();
+        if (skyboxMode == 2) {
+            glm::dvec3 offset = trueScale ? camera.Position : glm::dvec3(0.0); // the sun is at the origin
+            glm::dvec3 observer = glm::transpose(glm::dmat3(equatorialToScene())) * offset /
+                                  (TRUE_SCALE_AU * AU_PER_PARSEC);
+            starCatalog.update(observer, (float) DOME_FACE_SIZE / glm::radians(90.0f));
+            starShader.setVec3("observer", glm::vec3(observer));
+        } else {
+            starShader.setVec3("observer", glm::vec3(0.0f)); // the stars are only directions
+        }
+        glDisable(GL_DEPTH_TEST);
+        if (skyboxMode == 2) starCatalog.draw();
+        else brightStars.draw();
+        glEnable(GL_DEPTH_TEST);
+    }
+
+    // sun, planets, moon and orbits, each sent only to the faces its bounding sphere reaches
+    glm::vec3 lightColor = glm::vec3(1.0f, 1.0f, 1.0f); // as in the scene
+    glm::vec3 diffuse = lightColor * glm::vec3(0.8f);
+    planetShader.use();
+    planetShader.setVec3("light.position", cameraRelative(glm::dvec3(sunModel[3])));
+    planetShader.setFloat("light.radius", (float) sunScale);
+    planetShader.setVec3("light.ambient", diffuse * glm::vec3(0.1f));
+    planetShader.setVec3("light.diffuse", diffuse);
+    planetShader.setVec3("light.specular", lightColor);
+    orbitShader.use();
+    orbitShader.setVec3("color", lightColor);
+
+    auto faceMask = [](const glm::dvec3 &center, double radius) {
+        return domeFaceMask(glm::mat3(view) * cameraRelative(center), (float) radius);
+    };
+    sunShader.use();
+    sunShader.setVec3("color", lightColor);
+    sunShader.setInt("faceMask", faceMask(glm::dvec3(sunModel[3]), sunScale));
+    sunShader.setMat4("model", cameraRelative(glm::scale(sunModel, glm::dvec3(sunScale))));
+    bindTexture(sunTexture);
+    renderSphere();
+    for (unsigned int i = 0; i <= planetCount; i++) {
+        const glm::dmat4 &model = i < planetCount ? planetModel[i] : moonModel;
+        float radius = i < planetCount ? bodyProp[i].scale : bodyMoonProp.scale;
+        planetShader.use();
+        planetShader.setInt("faceMask", faceMask(glm::dvec3(model[3]), radius));
+        planetShader.setInt("occluderMask", eclipseOccluders.mask(i)); // the moon is the last body
+        planetShader.setMat4("model", cameraRelative(model));
+        bindTexture(i < planetCount ? planetTextures[i] : moonTexture);
+        renderSphere();
+
+        // orbit around the sun, or around the earth for the moon
+        glm::dvec3 center = glm::dvec3(i < planetCount ? sunModel[3] : planetModel[EARTH_INDEX][3]);
+        const planetProperties &prop = i < planetCount ? planetProp[i] : moonProp;
+        double scale = (i < planetCount ? bodyProp[i].distance : bodyMoonProp.distance) / prop.distance;
+        orbitShader.use();
+        orbitShader.setInt("faceMask", faceMask(center, scale * prop.distance));
+        orbitShader.setMat4("model", cameraRelative(glm::scale(glm::translate(glm::dmat4(1.0), center),
+                                                               glm::dvec3(scale))));
+        renderOrbit(prop.distance, i < planetCount ? &orbitVAO[i] : &moonOrbitVAO);
+    }
+
+    // warp the faces into a square in the middle of the frame
+    int width = depthTarget.width, height = depthTarget.height;
+    if (reversedDepth) {
+        depthTarget.bind();
+    } else {
+        glBindFramebuffer(GL_FRAMEBUFFER, 0);
+        glfwGetFramebufferSize(window, &width, &height);
+    }
+    glClearColor(0.0f, 0.0f, 0.0f, 1.0f);
+    glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT);
+    int side = std::min(width, height);
+    glViewport((width - side) / 2, (height - side) / 2, side, side);
+    glDisable(GL_DEPTH_TEST);
+    warpShader.use();
+    warpShader.setMat3("viewToWorld", glm::transpose(glm::mat3(view)));
+    warpShader.setFloat("skyboxIntensity", skyboxCubeMap != 0 ? skyboxIntensity : 0.0f);
+    warpShader.setVec3("background", glm::vec3(0.1f, 0.1f, 0.1f)); // the scene's clear color
+    glActiveTexture(GL_TEXTURE1);
+    glBindTexture(GL_TEXTURE_CUBE_MAP, skyboxCubeMap);
+    domeTarget.drawWarp();
+    glEnable(GL_DEPTH_TEST);
+    glViewport(0, 0, width, height);
+}
+
+/** Function to render the earth's atmosphere (precomputed scattering, see atmosphere.h)
+ *
+ * @param shader: shader of the atmosphere
+ * @param earthModel: model matrix of the earth
+ * @param earthScale: radius of the earth's sphere (the ground of the atmosphere)
+ *
+ */
+void renderAtmosphere(Shader &shader, const glm::dmat4 &earthModel, double earthScale) {
+    glm::dvec3 center = glm::dvec3(earthModel[3]);
+    glm::dmat4 model = glm::translate(glm::dmat4(1.0), center);
+    model = glm::scale(model, glm::dvec3(earthScale * earthAir.topRadius / earthAir.bottomRadius));
+
+    shader.use();
+    shader.setMat4("projection", projection);
+    shader.setMat4("view", view);
+    shader.setMat4("model", cameraRelative(model));
+    shader.setVec3("center", cameraRelative(center));
+    shader.setFloat("unitsPerKm", (float) (earthScale / earthAir.bottomRadius));
+    shader.setVec3("sunDirection", glm::vec3(glm::normalize(-center))); // the sun is at the origin
+    atmosphereTextures.bind(0);
+
+    // the scene behind is dimmed by the transmittance and the scattered light is added over it
+    glDepthMask(GL_FALSE);
+    glBlendFunc(GL_ONE, GL_SRC_ALPHA);
+    renderSphere();
+    glBlendFunc(GL_SRC_ALPHA, GL_ONE_MINUS_SRC_ALPHA);
+    glDepthMask(GL_TRUE);
+}
+
+/** Function to open the surface tiles of the focused planet and select its chunks seen this frame (see terrain.h)
+ *
+ * @param planetModel: model matrices of the planets
+ * @param planetCount: number of planets
+ *
+ */
+void updateTerrain(const glm::dmat4 *planetModel, unsigned int planetCount) {
+    int focused = cameraMode < planetCount ? (int) cameraMode : -1;
+    if (focused != terrainPlanet) { // the tiles are opened once per focus (planets without tiles keep their sphere)
+        planetTerrain.release();
+        terrainPlanet = focused;
+        if (focused >= 0) {
+            std::string name = planetInfo[focused].name;
+            std::transform(name.begin(), name.end(), name.begin(), ::tolower);
+            planetTerrain.open((TERRAIN_PATH + name + ".tiles").c_str());
+        }
+    }
+    if (!planetTerrain.isOpen()) return;
+
+    // screen-space error of the chunks in the pixels of the image rendered
+    float aspect = (float) WIDTH / (float) HEIGHT;
+    float viewAngle = std::atan(std::tan(glm::radians(camera.Zoom) / 2.0f) * std::sqrt(1.0f + aspect * aspect));
+    planetTerrain.update(planetModel[terrainPlanet], camera.Position, glm::dvec3(camera.Front), imagePixelsPerRadian(),
+                         viewAngle);
+}
+
+/** Function to select the bodies drawn as impostors this frame and bake their outdated tiles (see impostors.h)
+ *
+ * @param bakeShader: shader baking the tiles (its light is already set)
+ * @param planetModel: model matrices of the planets
+ * @param planetCount: number of planets
+ * @param moonModel: model matrix of the moon
+ * @param planetTextures: textures of the planets
+ * @param moonTexture: texture of the moon
+ *
+ */
+void updateImpostors(Shader &bakeShader, const glm::dmat4 *planetModel, unsigned int planetCount,
+                     const glm::dmat4 &moonModel, const unsigned int *planetTextures, unsigned int moonTexture) {
+    std::vector<ImpostorBody> bodies; // planets, then the moon (the same order as the eclipses)
+    for (unsigned int i = 0; i <= planetCount; i++) {
+        const glm::dmat4 &model = i < planetCount ? planetModel[i] : moonModel;
+        double radius = glm::length(glm::dvec3(model[0])); // the model's scale
+        glm::mat3 rotation = glm::mat3(glm::dmat3(model) / radius);
+        bool terrain = (int) i == terrainPlanet && planetTerrain.isOpen(); // its close-up surface is drawn
+        bodies.push_back({cameraRelative(glm::dvec3(model[3])), (float) radius, rotation,
+                          i < planetCount ? planetTextures[i] : moonTexture, eclipseOccluders.mask(i), !terrain});
+    }
+    glm::vec3 light = cameraRelative(glm::dvec3(0.0)); // the sun is at the origin
+    impostors.update(bodies, light, imagePixelsPerRadian(), frameRealTime, bakeShader.ID);
+}
+
+/** Function to get the pixels per radian of the image rendered (a poster is larger than the window)
+ *
+ * @return screen height in pixels divided by the vertical field of view
+ *
+ */
+float imagePixelsPerRadian() {
+    return (float) HEIGHT / glm::radians(camera.Zoom) * (poster.active() ? (float) POSTER_SCALE : 1.0f);
+}
+
+/** Function to render the pages of the virtual textures seen this frame and stream them (see virtual_texture.h)
+ *
+ * @param shader: shader of the feedback pass
+ * @param planetModel: model matrices of the planets
+ * @param planetCount: number of planets
+ *
+ */
+void renderVirtualFeedback(Shader &shader, const glm::dmat4 *planetModel, unsigned int planetCount) {
+    if (virtualTextures.empty()) return;
+    virtualTextures.beginFeedback();
+    shader.use();
+    shader.setMat4("projection", projection);
+    shader.setMat4("view", view);
+    for (unsigned int i = 0; i < planetCount; i++) {
+        if (planetVirtualTexture[i] < 0 || ((int) i == terrainPlanet && planetTerrain.isOpen())) continue;
+        shader.setMat4("model", cameraRelative(planetModel[i]));
+        virtualTextures.bindFeedback(shader.ID, planetVirtualTexture[i]);
+        renderSphere();
+    }
+    virtualTextures.endFeedback();
+    virtualTextures.update();
+}
+
+/** Function to select the bodies that may eclipse one another this frame (see eclipse.h)
+ *
+ * @param planetModel: model matrices of the planets
+ * @param planetCount: number of planets
+ * @param moonPosition: position of the moon
+ *
+ */
+void updateEclipses(const glm::dmat4 *planetModel, unsigned int planetCount, glm::dvec3 moonPosition) {
+    const planetProperties *bodyProp = trueScale ? trueScaleProp : planetProp;
+    const planetProperties &bodyMoonProp = trueScale ? trueScaleMoonProp : moonProp;
+    double sunScale = trueScale ? 696000.0 / TRUE_SCALE_KM : 1.0;
+
+    std::vector<glm::vec4> bodies; // planets, then the moon (radius of each sphere is its scale)
+    for (unsigned int i = 0; i < planetCount; i++) {
+        bodies.emplace_back(cameraRelative(glm::dvec3(planetModel[i][3])), bodyProp[i].scale);
+    }
+    bodies.emplace_back(cameraRelative(moonPosition), bodyMoonProp.scale);
+    eclipseOccluders.update(cameraRelative(glm::dvec3(0.0)), (float) sunScale, bodies); // the sun is at the origin
+}
+
+/** Function to set the projection of the text and the labels (screen pixels, origin at the bottom left)
+ *
+ * @param textShader: shader of the text
+ * @param labelShader: shader of the labels
+ * @param projection: orthographic projection of the screen (or of a part of it)
+ *
+ */
+void setTextProjection(Shader &textShader, Shader &labelShader, glm::mat4 projection) {
+    if (reversedDepth) projection[3][2] = 0.999f; // text depth is near 1, the nearest depth when reversed
+    textShader.use();
+    textShader.setMat4("projection", projection);
+    labelShader.use();
+    labelShader.setMat4("projection", projection);
+}
+
+/** Function to show the frame (copied from the off-screen target when there is one) and poll IO events
+ *
+ * @param window: window to show the frame in
+ *
+ */
+void presentFrame(GLFWwindow *window) {
+    // copy the off-screen frame to the window
+    if (reversedDepth) {
+        int windowWidth, windowHeight;
+        glfwGetFramebufferSize(window, &windowWidth, &windowHeight);
+        depthTarget.blit(windowWidth, windowHeight);
+    }
+
+    // swap buffers and poll IO events
+    glfwSwapBuffers(window);
+    glfwPollEvents();
 }
 
 /** Function to load 2D texture from file
@@ -969,49 +2480,14 @@ unsigned int loadTexture(char const *path) {
  *
  */
 unsigned int loadCubeMap(char const **path) {
-    unsigned int textureID;
-    glGenTextures(1, &textureID);
-    glBindTexture(GL_TEXTURE_CUBE_MAP, textureID);
-
-    int width, height, nrComponents;
-    stbi_set_flip_vertically_on_load(true);
-    for (unsigned int i = 0; i < 6; i++) {
-        unsigned char *data = stbi_load(path[i], &width, &height, &nrComponents, 0);
-        if (data) {
-            GLint format = GL_RGB;
-            if (nrComponents == 1) format = GL_RED;
-            else if (nrComponents == 3) format = GL_RGB; // JPG image requires GL_RGB
-            else if (nrComponents == 4) format = GL_RGBA; // PNG image requires GL_RGBA
-
-            // see more at: https://learnopengl.com/Advanced-OpenGL/Cubemaps
-            glTexImage2D(
-                    GL_TEXTURE_CUBE_MAP_POSITIVE_X + i, // target
-                    0, // level
-                    format, // internal format
-                    width, // width
-                    height, // height
-                    0, // border
-                    format, // format
-                    GL_UNSIGNED_BYTE, // type
-                    data // pixels
-            );
-            stbi_image_free(data);
+    CubeMapFaces faces = decodeCubeMap(path);
+    unsigned int textureID = uploadCubeMap(faces);
+    freeCubeMap(faces);
 
 #ifdef _DEBUG
-            std::cout << "CubeMap texture loaded successfully at path: " << path[i] << std::endl;
+    std::cout << "CubeMap texture loaded successfully at path: " << path[0] << " (and 5 other faces)" << std::endl;
 #endif
 
-        } else {
-            std::cerr << "CubeMap texture failed to load at path: " << path[i] << std::endl;
-            stbi_image_free(data);
-        }
-    }
-    glTexParameteri(GL_TEXTURE_CUBE_MAP, GL_TEXTURE_MIN_FILTER, GL_LINEAR);
-    glTexParameteri(GL_TEXTURE_CUBE_MAP, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
-    glTexParameteri(GL_TEXTURE_CUBE_MAP, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_EDGE);
-    glTexParameteri(GL_TEXTURE_CUBE_MAP, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_EDGE);
-    glTexParameteri(GL_TEXTURE_CUBE_MAP, GL_TEXTURE_WRAP_R, GL_CLAMP_TO_EDGE);
-
     return textureID;
 }
 
@@ -1025,6 +2501,58 @@ void bindTexture(unsigned int texture) {
     glBindTexture(GL_TEXTURE_2D, texture);
 }
 
+/** Function to place the bodies at the current scene time and the camera that follows them
+ *
+ * The scene and the dome master are drawn from the bodies placed here, so they cannot disagree. The camera of a
+ * video frame or of a poster tile is not moved.
+ *
+ * @param sunPosition: position of the sun
+ * @param planetModel: model matrices of the planets (set here)
+ * @param planetCount: number of planets
+ * @param sunModel: model matrix of the sun (set here)
+ * @param moonModel: model matrix of the moon (set here)
+ *
+ */
+void updateBodies(glm::dvec3 sunPosition, glm::dmat4 *planetModel, unsigned int planetCount, glm::dmat4 &sunModel,
+                  glm::dmat4 &moonModel) {
+    const planetProperties *bodyProp = trueScale ? trueScaleProp : planetProp;
+    const planetProperties &bodyMoonProp = trueScale ? trueScaleMoonProp : moonProp;
+
+    sunModel = glm::translate(glm::dmat4(1.0), sunPosition);
+    sunModel = glm::rotate(sunModel, std::fmod(sceneTime() * 0.1, 2.0 * ORBIT_PI), glm::dvec3(0.0, 1.0, 0.0));
+    for (unsigned int i = 0; i < planetCount; i++) {
+        planetModel[i] = planetCreator(
+                bodyProp[i].translation, // translation around the sun (translation velocity)
+                bodyProp[i].distance, // distance from the sun
+                bodyProp[i].rotation, // rotation around its own axis (rotation velocity)
+                bodyProp[i].scale, // scale of the planet
+                sunModel[3] // center of the model (contains the exact position of the sun)
+        );
+    }
+    moonModel = planetCreator(
+            bodyMoonProp.translation, // translation around the earth (translation velocity)
+            bodyMoonProp.distance, // distance from the earth
+            bodyMoonProp.rotation, // rotation around its own axis (rotation velocity)
+            bodyMoonProp.scale, // scale of the planet
+            planetModel[EARTH_INDEX][3] // center of the model (contains the exact position of the earth)
+    );
+
+    if (videoShard.active() || poster.active()) return;
+    if (cameraMode == 9) { // top view
+        camera = upViewCamera;
+        camera.Position *= bodyProp[7].distance / planetProp[7].distance; // frame neptune's orbit
+    } else if (cameraMode < planetCount) { // planet's information
+        camera = Camera(
+                glm::dvec3(planetModel[cameraMode][3]) + glm::dvec3(0.0, 1.2, 1.0), // position
+                glm::vec3(0.0f, 1.0f, 0.0f), // up - default
+                -90.0f, // yaw - default
+                -50.0f // pitch (look down)
+        );
+    } else if (cameraMode == 8) { // free camera
+        freeCamera = camera; // save current camera position
+    }
+}
+
 /** Function to create planet
  *
  * @param translation: translation around the sun/planet
@@ -1035,15 +2563,182 @@ void bindTexture(unsigned int texture) {
  * @return model matrix
  *
  */
-glm::mat4 planetCreator(float translation, float distance, float rotation, float scale, glm::vec3 centerModel) {
-    glm::mat4 model = glm::translate(glm::mat4(1.0f), centerModel); // move origin of rotation to the center of model
-    model = glm::rotate(model, (float) glfwGetTime() * translation, glm::vec3(0.0f, 1.0f, 0.0f));
-    model = glm::translate(model, glm::vec3(0.0f, 0.0f, distance));
-    model = glm::rotate(model, (float) glfwGetTime() * rotation, glm::vec3(0.0f, 1.0f, 0.0f));
-    model = glm::scale(model, glm::vec3(scale));
+glm::dmat4 planetCreator(float translation, float distance, float rotation, float scale, glm::dvec3 centerModel) {
+    glm::dmat4 model = glm::translate(glm::dmat4(1.0), centerModel); // move origin of rotation to the center of model
+    // angles are reduced in double precision so they stay accurate far from J2000
+    double translationAngle = std::fmod(sceneTime() * translation, 2.0 * ORBIT_PI);
+    double rotationAngle = std::fmod(sceneTime() * rotation, 2.0 * ORBIT_PI);
+    model = glm::rotate(model, translationAngle, glm::dvec3(0.0, 1.0, 0.0));
+    model = glm::translate(model, glm::dvec3(0.0, 0.0, distance));
+    model = glm::rotate(model, rotationAngle, glm::dvec3(0.0, 1.0, 0.0));
+    model = glm::scale(model, glm::dvec3(scale));
     return model; // center * translation * distance * rotation * scale
 }
 
+/** Function to convert a world model matrix into a float model matrix relative to the camera
+ *
+ * @param model: model matrix in world coordinates (double precision)
+ * @return model matrix with the camera at the origin (to use with the rotation only view matrix)
+ *
+ */
+glm::mat4 cameraRelative(const glm::dmat4 &model) {
+    glm::dmat4 relative = model;
+    relative[3] -= glm::dvec4(camera.Position, 0.0); // subtracted before the float conversion
+    return glm::mat4(relative);
+}
+
+/** Function to find the body under a point of the screen with a ray through the current projection and view
+ *
+ * @param x: x position on the screen (0 to WIDTH, from the left)
+ * @param y: y position on the screen (0 to HEIGHT, from the top)
+ * @return index of the nearest body in pickSpheres (sun, planets, moon, comets, satellites, asteroids) or -1
+ *
+ */
+int pickBody(double x, double y) {
+    // any point on the ray is enough, the view has the camera at the origin
+    glm::vec4 ndc = glm::vec4((float) (2.0 * x / WIDTH - 1.0), (float) (1.0 - 2.0 * y / HEIGHT),
+                              reversedDepth ? 0.5f : 0.0f, 1.0f);
+    glm::vec4 point = glm::inverse(projection * view) * ndc;
+    glm::vec3 direction = glm::normalize(glm::vec3(point) / point.w);
+
+    // points are drawn with a size in pixels, so they are hit within a cone of a few pixels around the ray
+    float coneTangent = PICK_TOLERANCE * 2.0f * std::tan(glm::radians(camera.Zoom) / 2.0f) / (float) HEIGHT;
+    float distance;
+    return pickBvh.intersect(pickSpheres, glm::vec3(camera.Position), direction, coneTangent, distance);
+}
+
+/** Function to convert a world position into a float position relative to the camera
+ *
+ * @param position: position in world coordinates (double precision)
+ * @return position with the camera at the origin
+ *
+ */
+glm::vec3 cameraRelative(const glm::dvec3 &position) {
+    return glm::vec3(position - camera.Position);
+}
+
+/** Function to get the scene time that drives every animation
+ *
+ * @return scene time (seconds, one earth year is 2 * PI)
+ *
+ */
+double sceneTime() {
+    return simulationClock.sceneTime();
+}
+
+/** Function to search the planetary events of the planets animated by planetCreator
+ *
+ * @param startTime: first scene time searched
+ * @param endTime: last scene time searched
+ * @return events sorted by time
+ *
+ */
+std::vector<PlanetEvent> searchPlanetEvents(double startTime, double endTime) {
+    std::vector<CircularOrbit> orbits;
+    for (const planetProperties &planet: planetProp) {
+        orbits.push_back({planet.translation, planet.distance});
+    }
+    return findPlanetEvents(orbits, EARTH_INDEX, startTime, endTime);
+}
+
+/** Function to describe a planetary event
+ *
+ * @param event: planetary event
+ * @return text to show
+ *
+ */
+std::string describeEvent(const PlanetEvent &event) {
+    std::string name = planetInfo[event.first].name;
+    char elongation[32];
+    snprintf(elongation, sizeof(elongation), " (%.1f degrees)", glm::degrees(event.angle));
+
+    switch (event.type) {
+        case EVENT_CONJUNCTION:
+            return name + " in conjunction with " + planetInfo[event.second].name;
+        case EVENT_OPPOSITION:
+            return name + " at opposition";
+        case EVENT_SOLAR_CONJUNCTION:
+            return name + " in conjunction with the Sun";
+        case EVENT_INFERIOR_CONJUNCTION:
+            return name + " at inferior conjunction";
+        case EVENT_SUPERIOR_CONJUNCTION:
+            return name + " at superior conjunction";
+        case EVENT_GREATEST_EAST_ELONGATION:
+            return name + " at greatest eastern elongation" + elongation;
+        case EVENT_GREATEST_WEST_ELONGATION:
+            return name + " at greatest western elongation" + elongation;
+    }
+    return name;
+}
+
+/** Function to convert a heliocentric ecliptic position into scene coordinates
+ *
+ * @param position: heliocentric ecliptic position (AU)
+ * @param center: position of the sun in the scene
+ * @return position in the scene (distance compressed like planetProp, unless at true scale)
+ *
+ */
+glm::dvec3 eclipticToScene(const double position[3], glm::dvec3 center) {
+    double r = std::sqrt(position[0] * position[0] + position[1] * position[1] + position[2] * position[2]);
+    if (r == 0.0) return center;
+    double scale = trueScale ? TRUE_SCALE_AU : sceneDistance((float) r) / r;
+    // ecliptic (X, Y, Z) is the scene's (z, x, y)
+    return center + glm::dvec3(position[1], position[2], position[0]) * scale;
+}
+
+/** Function to convert a geocentric TEME position into scene coordinates
+ *
+ * @param position: TEME position (km)
+ * @param center: scene position of the earth
+ * @return scene position (true scale relative to the earth's sphere)
+ *
+ */
+glm::dvec3 temeToScene(const double position[3], glm::dvec3 center) {
+    double scale = planetProp[EARTH_INDEX].scale / SGP4_EARTH_RADIUS; // the earth has the same size at true scale
+    // TEME (X, Y, Z) is the scene's (z, x, y): the pole along the earth's spin axis, as in satelliteVertex.glsl
+    return center + glm::dvec3(position[1], position[2], position[0]) * scale;
+}
+
+/** Function to screen close approaches of the small bodies to the earth
+ *
+ * @param startTime: scene time to start screening from (one year is screened)
+ * @return close approaches sorted by time (first body is the earth, second is the asteroid index + 1)
+ *
+ */
+std::vector<CloseApproach> screenEarthApproaches(double startTime) {
+    OrbitalElements elements;
+    elements.reserve(asteroidElements.count() + 1);
+    addPlanetElements(elements, EARTH_INDEX); // the same mean J2000 elements as the sky view, not the scene's circle
+    elements.append(asteroidElements);
+
+    double year = DAYS_PER_YEAR * SCENE_SECONDS_PER_DAY;
+    return screenCloseApproaches(elements, startTime, startTime + year, SCENE_SECONDS_PER_DAY, CLOSE_APPROACH_DISTANCE, 0);
+}
+
+/** Function to benchmark the CPU propagators without opening a window (solar_system.out --benchmark)
+ *
+ * @return 0 if successful
+ *
+ */
+int runBenchmark() {
+    // the same small bodies and satellites as the interactive window
+    if (!loadMpcorb(MPCORB_PATH, asteroidElements)) {
+        generateMainBelt(asteroidElements, MAIN_BELT_COUNT);
+        generateKuiperBelt(asteroidElements, KUIPER_BELT_COUNT);
+    }
+    benchmarkPropagator(asteroidElements);
+
+    double days = 0.0; // a real catalog is propagated from its epoch, like the interactive window
+    if (loadTle(TLE_PATH, satelliteElements)) {
+        days = *std::max_element(satelliteElements.epoch.begin(), satelliteElements.epoch.end());
+    } else {
+        generateSatellites(satelliteElements, SATELLITE_COUNT, 0.0);
+    }
+    sgp4Init(satelliteElements, satelliteBatch);
+    benchmarkSgp4(satelliteBatch, days);
+    return 0;
+}
+
 /** Function to scale char height
  *
  * @param scale: scale of char height
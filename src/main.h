@@ -14,8 +14,12 @@ void mouse_callback(GLFWwindow *window, double x_pos, double y_pos);
 
 void scroll_callback(GLFWwindow *window, double x_offset, double y_offset);
 
+void mouse_button_callback(GLFWwindow *window, int button, int action, int mods);
+
 void processInput(GLFWwindow *window);
 
+bool keyPressed(GLFWwindow *window, int key);
+
 unsigned int loadTexture(char const *path);
 
 unsigned int loadCubeMap(char const **path);
@@ -28,9 +32,59 @@ void renderText(Shader &shader, std::string text, float x, float y, float textSc
 
 void renderSkybox(unsigned int skyboxCubeMap);
 
+void renderSkyView(Shader &sunShader, Shader &planetShader, Shader &starShader, Shader &orbitShader,
+                   Shader &textShader, unsigned int sunTexture, const unsigned int *planetTextures,
+                   unsigned int moonTexture, glm::vec3 textColor);
+
+void renderDome(GLFWwindow *window, Shader &sunShader, Shader &planetShader, Shader &starShader,
+                Shader &orbitShader, Shader &warpShader, unsigned int skyboxCubeMap, float skyboxIntensity,
+                unsigned int sunTexture, const unsigned int *planetTextures, unsigned int moonTexture,
+                const glm::dmat4 &sunModel, const glm::dmat4 *planetModel, unsigned int planetCount,
+                const glm::dmat4 &moonModel);
+
+void renderAtmosphere(Shader &shader, const glm::dmat4 &earthModel, double earthScale);
+
+void updateTerrain(const glm::dmat4 *planetModel, unsigned int planetCount);
+
+void renderVirtualFeedback(Shader &shader, const glm::dmat4 *planetModel, unsigned int planetCount);
+
+void updateImpostors(Shader &bakeShader, const glm::dmat4 *planetModel, unsigned int planetCount,
+                     const glm::dmat4 &moonModel, const unsigned int *planetTextures, unsigned int moonTexture);
+
+float imagePixelsPerRadian();
+
+void updateEclipses(const glm::dmat4 *planetModel, unsigned int planetCount, glm::dvec3 moonPosition);
+
+void setTextProjection(Shader &textShader, Shader &labelShader, glm::mat4 projection);
+
+void presentFrame(GLFWwindow *window);
+
 void bindTexture(unsigned int texture);
 
-glm::mat4 planetCreator(float translation, float distance, float rotation, float scale, glm::vec3 centerModel);
+void updateBodies(glm::dvec3 sunPosition, glm::dmat4 *planetModel, unsigned int planetCount, glm::dmat4 &sunModel,
+                  glm::dmat4 &moonModel);
+
+glm::dmat4 planetCreator(float translation, float distance, float rotation, float scale, glm::dvec3 centerModel);
+
+glm::mat4 cameraRelative(const glm::dmat4 &model);
+
+glm::vec3 cameraRelative(const glm::dvec3 &position);
+
+int pickBody(double x, double y);
+
+double sceneTime();
+
+std::vector<PlanetEvent> searchPlanetEvents(double startTime, double endTime);
+
+std::string describeEvent(const PlanetEvent &event);
+
+glm::dvec3 eclipticToScene(const double position[3], glm::dvec3 center);
+
+glm::dvec3 temeToScene(const double position[3], glm::dvec3 center);
+
+std::vector<CloseApproach> screenEarthApproaches(double startTime);
+
+int runBenchmark();
 
 /// Store the properties of a planet
 struct planetProperties {
@@ -0,0 +1,80 @@
+/**
+ * @file propagator_avx2.cpp
+ * @brief AVX2 kernels of the batch two-body and SGP4 propagators
+ * @details Compiled with AVX2 and FMA enabled; only called when propagatorMaxWidth() reports support.
+ *
+ */
+
+#include <immintrin.h>
+
+#include <propagator_kernel.h>
+#include <sgp4_kernel.h>
+
+namespace { // internal linkage keeps these instantiations out of the other translation units
+
+/// Four doubles per lane group (AVX2)
+struct Avx2Lanes {
+    typedef __m256d Mask;
+    static const size_t width = 4;
+    __m256d v;
+
+    Avx2Lanes() = default;
+
+    Avx2Lanes(__m256d value) : v(value) {}
+
+    Avx2Lanes(double value) : v(_mm256_set1_pd(value)) {}
+
+    static Avx2Lanes load(const float *p) { return _mm256_cvtps_pd(_mm_loadu_ps(p)); }
+
+    static Avx2Lanes load(const double *p) { return _mm256_loadu_pd(p); }
+
+    void store(double *p) const { _mm256_storeu_pd(p, v); }
+
+    static Avx2Lanes sqrt(Avx2Lanes a) { return _mm256_sqrt_pd(a.v); }
+
+    static Avx2Lanes floor(Avx2Lanes a) { return _mm256_floor_pd(a.v); }
+
+    static Avx2Lanes round(Avx2Lanes a) { return _mm256_round_pd(a.v, _MM_FROUND_TO_NEAREST_INT | _MM_FROUND_NO_EXC); }
+
+    static Mask less(Avx2Lanes a, Avx2Lanes b) { return _mm256_cmp_pd(a.v, b.v, _CMP_LT_OQ); }
+
+    static Avx2Lanes select(Mask m, Avx2Lanes a, Avx2Lanes b) { return _mm256_blendv_pd(b.v, a.v, m); }
+
+    friend Avx2Lanes operator+(Avx2Lanes a, Avx2Lanes b) { return _mm256_add_pd(a.v, b.v); }
+
+    friend Avx2Lanes operator-(Avx2Lanes a, Avx2Lanes b) { return _mm256_sub_pd(a.v, b.v); }
+
+    friend Avx2Lanes operator*(Avx2Lanes a, Avx2Lanes b) { return _mm256_mul_pd(a.v, b.v); }
+
+    friend Avx2Lanes operator/(Avx2Lanes a, Avx2Lanes b) { return _mm256_div_pd(a.v, b.v); }
+};
+
+}
+
+/** Function to propagate a range of orbits with AVX2
+ *
+ * @param el: arrays of the orbital elements
+ * @param time: scene time
+ * @param out: arrays of the state vectors (already sized)
+ * @param begin: first orbit
+ * @param end: one past the last orbit
+ * @return first orbit left for the scalar kernel
+ *
+ */
+size_t propagateAvx2(const OrbitArrays &el, double time, const StateArrays &out, size_t begin, size_t end) {
+    return propagateLanes<Avx2Lanes>(el, time, out, begin, end);
+}
+
+/** Function to propagate a range of satellites with AVX2
+ *
+ * @param batch: arrays of the SGP4 coefficients
+ * @param days: time (days since J2000)
+ * @param out: arrays of the state vectors (already sized)
+ * @param begin: first satellite
+ * @param end: one past the last satellite
+ * @return first satellite left for the scalar kernel
+ *
+ */
+size_t sgp4Avx2(const Sgp4Arrays &batch, double days, const StateArrays &out, size_t begin, size_t end) {
+    return sgp4Lanes<Avx2Lanes>(batch, days, out, begin, end);
+}
@@ -0,0 +1,80 @@
+/**
+ * @file propagator_avx512.cpp
+ * @brief AVX-512 kernels of the batch two-body and SGP4 propagators
+ * @details Compiled with AVX-512F enabled; only called when propagatorMaxWidth() reports support.
+ *
+ */
+
+#include <immintrin.h>
+
+#include <propagator_kernel.h>
+#include <sgp4_kernel.h>
+
+namespace { // internal linkage keeps these instantiations out of the other translation units
+
+/// Eight doubles per lane group (AVX-512F)
+struct Avx512Lanes {
+    typedef __mmask8 Mask;
+    static const size_t width = 8;
+    __m512d v;
+
+    Avx512Lanes() = default;
+
+    Avx512Lanes(__m512d value) : v(value) {}
+
+    Avx512Lanes(double value) : v(_mm512_set1_pd(value)) {}
+
+    static Avx512Lanes load(const float *p) { return _mm512_cvtps_pd(_mm256_loadu_ps(p)); }
+
+    static Avx512Lanes load(const double *p) { return _mm512_loadu_pd(p); }
+
+    void store(double *p) const { _mm512_storeu_pd(p, v); }
+
+    static Avx512Lanes sqrt(Avx512Lanes a) { return _mm512_sqrt_pd(a.v); }
+
+    static Avx512Lanes floor(Avx512Lanes a) { return _mm512_roundscale_pd(a.v, _MM_FROUND_TO_NEG_INF | _MM_FROUND_NO_EXC); }
+
+    static Avx512Lanes round(Avx512Lanes a) { return _mm512_roundscale_pd(a.v, _MM_FROUND_TO_NEAREST_INT | _MM_FROUND_NO_EXC); }
+
+    static Mask less(Avx512Lanes a, Avx512Lanes b) { return _mm512_cmp_pd_mask(a.v, b.v, _CMP_LT_OQ); }
+
+    static Avx512Lanes select(Mask m, Avx512Lanes a, Avx512Lanes b) { return _mm512_mask_blend_pd(m, b.v, a.v); }
+
+    friend Avx512Lanes operator+(Avx512Lanes a, Avx512Lanes b) { return _mm512_add_pd(a.v, b.v); }
+
+    friend Avx512Lanes operator-(Avx512Lanes a, Avx512Lanes b) { return _mm512_sub_pd(a.v, b.v); }
+
+    friend Avx512Lanes operator*(Avx512Lanes a, Avx512Lanes b) { return _mm512_mul_pd(a.v, b.v); }
+
+    friend Avx512Lanes operator/(Avx512Lanes a, Avx512Lanes b) { return _mm512_div_pd(a.v, b.v); }
+};
+
+}
+
+/** Function to propagate a range of orbits with AVX-512
+ *
+ * @param el: arrays of the orbital elements
+ * @param time: scene time
+ * @param out: arrays of the state vectors (already sized)
+ * @param begin: first orbit
+ * @param end: one past the last orbit
+ * @return first orbit left for the scalar kernel
+ *
+ */
+size_t propagateAvx512(const OrbitArrays &el, double time, const StateArrays &out, size_t begin, size_t end) {
+    return propagateLanes<Avx512Lanes>(el, time, out, begin, end);
+}
+
+/** Function to propagate a range of satellites with AVX-512
+ *
+ * @param batch: arrays of the SGP4 coefficients
+ * @param days: time (days since J2000)
+ * @param out: arrays of the state vectors (already sized)
+ * @param begin: first satellite
+ * @param end: one past the last satellite
+ * @return first satellite left for the scalar kernel
+ *
+ */
+size_t sgp4Avx512(const Sgp4Arrays &batch, double days, const StateArrays &out, size_t begin, size_t end) {
+    return sgp4Lanes<Avx512Lanes>(batch, days, out, begin, end);
+}
@@ -0,0 +1,16 @@
+#version 330 core
+out vec4 FragColor;
+
+in float Brightness;
+
+uniform vec3 color;
+
+void main()
+{
+    // round point sprite with a soft edge
+    vec2 coord = gl_PointCoord * 2.0 - 1.0;
+    float radius = dot(coord, coord);
+    if (radius > 1.0) discard;
+
+    FragColor = vec4(color * Brightness, 1.0 - radius * radius);
+}
@@ -0,0 +1,61 @@
+#version 330 core
+layout (location = 0) in vec4 aShape; // semi-major axis (AU), eccentricity, inclination, mean motion
+layout (location = 1) in vec4 aOrientation; // ascending node, argument of perihelion, mean anomaly at epoch, size
+
+out float Brightness;
+
+uniform mat4 view;
+uniform mat4 projection;
+uniform vec3 center; // position of the sun relative to the camera
+uniform float time; // scene time
+uniform float pointScale; // point size in pixels at distance 1
+uniform float auScale; // scene units per AU at true scale (0 to compress the distances)
+
+const float TWO_PI = 6.28318530718;
+
+// NOTE: keep in sync with AU_KNOTS/SCENE_KNOTS in orbit.h
+const float auKnots[9] = float[9](0.0, 0.39, 0.72, 1.0, 1.52, 5.2, 9.54, 19.2, 30.1);
+const float sceneKnots[9] = float[9](1.0, 2.0, 3.0, 4.0, 5.0, 6.0, 7.0, 8.0, 9.0);
+
+// maps a heliocentric distance in AU to the compressed scene distance
+float sceneDistance(float au)
+{
+    int k = 1;
+    while (k < 8 && au >= auKnots[k]) k++;
+    float t = (au - auKnots[k - 1]) / (auKnots[k] - auKnots[k - 1]);
+    return mix(sceneKnots[k - 1], sceneKnots[k], t);
+}
+
+void main()
+{
+    float a = aShape.x;
+    float e = aShape.y;
+
+    // mean anomaly for the current time, then Kepler's equation with a fixed number of Newton-Raphson steps
+    float M = mod(aOrientation.z + aShape.w * time, TWO_PI);
+    float E = M + e * sin(M);
+    for (int k = 0; k < 4; k++) {
+        E -= (E - e * sin(E) - M) / (1.0 - e * cos(E));
+    }
+
+    // position in the orbital plane (perihelion along +x)
+    vec2 p = a * vec2(cos(E) - e, sqrt(1.0 - e * e) * sin(E));
+
+    // rotate by argument of perihelion, inclination and ascending node
+    float cw = cos(aOrientation.y), sw = sin(aOrientation.y);
+    float ci = cos(aShape.z), si = sin(aShape.z);
+    float cn = cos(aOrientation.x), sn = sin(aOrientation.x);
+    float x = p.x * cw - p.y * sw;
+    float y = p.x * sw + p.y * cw;
+    vec3 ecliptic = vec3(x * cn - y * ci * sn, x * sn + y * ci * cn, y * si);
+
+    // ecliptic (X, Y, Z) is the scene's (z, x, y)
+    float r = length(ecliptic);
+    vec3 worldPos = center + ecliptic.yzx * (auScale > 0.0 ? auScale : sceneDistance(r) / r);
+
+    gl_Position = projection * view * vec4(worldPos, 1.0);
+
+    // size attenuation with the distance to the camera
+    gl_PointSize = clamp(pointScale * aOrientation.w / gl_Position.w, 1.0, 6.0);
+    Brightness = clamp(pointScale * aOrientation.w / gl_Position.w, 0.25, 1.0);
+}
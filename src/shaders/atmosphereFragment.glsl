@@ -0,0 +1,165 @@
+#version 330 core
+out vec4 FragColor;
+
+// sizes of the lookup tables (same as atmosphere.h)
+#define TRANSMITTANCE_WIDTH 256.0
+#define TRANSMITTANCE_HEIGHT 64.0
+#define SCATTERING_R_SIZE 32.0
+#define SCATTERING_MU_SIZE 128.0
+#define SCATTERING_MU_S_SIZE 32.0
+#define SCATTERING_NU_SIZE 8.0
+#define IRRADIANCE_WIDTH 64.0
+#define IRRADIANCE_HEIGHT 16.0
+
+#define PI 3.14159265359
+
+struct Atmosphere {
+    float bottomRadius; // km
+    float topRadius;
+    vec3 rayleighScattering; // per km
+    float miePhaseG;
+    float muSMin;
+    float groundAlbedo;
+};
+
+in vec3 FragPos; // on the top of the atmosphere
+
+uniform sampler2D transmittanceTexture;
+uniform sampler3D scatteringTexture;
+uniform sampler2D irradianceTexture;
+uniform Atmosphere atmosphere;
+uniform vec3 center; // center of the planet (as FragPos)
+uniform float unitsPerKm; // the planet's sphere is the ground of the atmosphere
+uniform vec3 sunDirection; // from the planet towards the sun
+uniform float exposure;
+
+float safeSqrt(float a) {
+    return sqrt(max(a, 0.0));
+}
+
+// texture coordinate of x in [0, 1] that maps 0 and 1 to the centers of the first and last texels
+float coordFromUnit(float x, float size) {
+    return 0.5 / size + x * (1.0 - 1.0 / size);
+}
+
+// distance from a point at radius r to the top of the atmosphere, along a ray with zenith angle cosine mu
+float distanceToTop(float r, float mu) {
+    float top = atmosphere.topRadius;
+    return max(-r * mu + safeSqrt(r * r * (mu * mu - 1.0) + top * top), 0.0);
+}
+
+bool intersectsGround(float r, float mu) {
+    float bottom = atmosphere.bottomRadius;
+    return mu < 0.0 && r * r * (mu * mu - 1.0) + bottom * bottom >= 0.0;
+}
+
+vec3 transmittanceToTop(float r, float mu) {
+    float bottom = atmosphere.bottomRadius, top = atmosphere.topRadius;
+    float horizon = sqrt(top * top - bottom * bottom);
+    float rho = safeSqrt(r * r - bottom * bottom);
+    float d = distanceToTop(r, mu), dMin = top - r, dMax = rho + horizon;
+    vec2 uv = vec2(coordFromUnit((d - dMin) / (dMax - dMin), TRANSMITTANCE_WIDTH),
+                   coordFromUnit(rho / horizon, TRANSMITTANCE_HEIGHT));
+    return texture(transmittanceTexture, uv).rgb;
+}
+
+// transmittance between a point and the ground at distance d along the ray (ratio of two upward lookups)
+vec3 transmittanceToGround(float r, float mu, float d) {
+    float rd = clamp(sqrt(d * d + 2.0 * r * mu * d + r * r), atmosphere.bottomRadius, atmosphere.topRadius);
+    float muD = clamp((r * mu + d) / rd, -1.0, 1.0);
+    return min(transmittanceToTop(rd, -muD) / transmittanceToTop(r, -mu), vec3(1.0));
+}
+
+float rayleighPhase(float nu) {
+    return 3.0 / (16.0 * PI) * (1.0 + nu * nu);
+}
+
+float miePhase(float nu) {
+    float g = atmosphere.miePhaseG;
+    float k = 3.0 / (8.0 * PI) * (1.0 - g * g) / (2.0 + g * g);
+    return k * (1.0 + nu * nu) / pow(1.0 + g * g - 2.0 * g * nu, 1.5);
+}
+
+// light scattered towards a point by the whole ray: rayleigh (multiple scattering included) and the single mie,
+// whose color is extrapolated from the rayleigh one
+vec3 scattering(float r, float mu, float muS, float nu, bool ground, out vec3 mie) {
+    float bottom = atmosphere.bottomRadius, top = atmosphere.topRadius;
+    float horizon = sqrt(top * top - bottom * bottom);
+    float rho = safeSqrt(r * r - bottom * bottom);
+    float uR = coordFromUnit(rho / horizon, SCATTERING_R_SIZE);
+
+    // rays towards the ground in the lower half of the texture, towards the sky in the upper half
+    float rMu = r * mu;
+    float discriminant = rMu * rMu - r * r + bottom * bottom;
+    float uMu;
+    if (ground) {
+        float d = -rMu - safeSqrt(discriminant), dMin = r - bottom, dMax = rho;
+        uMu = 0.5 - 0.5 * coordFromUnit(dMax == dMin ? 0.0 : (d - dMin) / (dMax - dMin), SCATTERING_MU_SIZE / 2.0);
+    } else {
+        float d = -rMu + safeSqrt(discriminant + horizon * horizon), dMin = top - r, dMax = rho + horizon;
+        uMu = 0.5 + 0.5 * coordFromUnit((d - dMin) / (dMax - dMin), SCATTERING_MU_SIZE / 2.0);
+    }
+
+    float dMin = top - bottom, dMax = horizon;
+    float a = (distanceToTop(bottom, muS) - dMin) / (dMax - dMin);
+    float limit = (distanceToTop(bottom, atmosphere.muSMin) - dMin) / (dMax - dMin);
+    float uMuS = coordFromUnit(max(1.0 - a / limit, 0.0) / (1.0 + a), SCATTERING_MU_S_SIZE);
+
+    // the angle between the view and the sun selects two slices of the texture
+    float slice = (nu + 1.0) / 2.0 * (SCATTERING_NU_SIZE - 1.0);
+    float first = floor(slice);
+    vec4 scattered = mix(texture(scatteringTexture, vec3((first + uMuS) / SCATTERING_NU_SIZE, uMu, uR)),
+                         texture(scatteringTexture, vec3((first + 1.0 + uMuS) / SCATTERING_NU_SIZE, uMu, uR)),
+                         slice - first);
+
+    mie = scattered.r > 0.0 ?
+          scattered.rgb * (scattered.a / scattered.r) * (atmosphere.rayleighScattering.r / atmosphere.rayleighScattering) :
+          vec3(0.0);
+    return scattered.rgb;
+}
+
+vec3 skyIrradiance(float r, float muS) {
+    vec2 uv = vec2(coordFromUnit(muS * 0.5 + 0.5, IRRADIANCE_WIDTH),
+                   coordFromUnit((r - atmosphere.bottomRadius) / (atmosphere.topRadius - atmosphere.bottomRadius),
+                                 IRRADIANCE_HEIGHT));
+    return texture(irradianceTexture, uv).rgb;
+}
+
+void main()
+{
+    vec3 viewRay = normalize(FragPos);
+    vec3 camera = -center / unitsPerKm; // planet centered, in km
+    float r = length(camera);
+    if (r < atmosphere.bottomRadius) discard;
+    if (r > atmosphere.topRadius) {
+        // from space, the ray starts where it enters the atmosphere: at this fragment if it is on the near side
+        if (dot(FragPos, viewRay) > dot(center, viewRay)) discard;
+        camera = normalize(FragPos - center) * atmosphere.topRadius;
+        r = atmosphere.topRadius;
+    }
+
+    float rMu = dot(camera, viewRay);
+    float mu = rMu / r;
+    float muS = dot(camera, sunDirection) / r;
+    float nu = dot(viewRay, sunDirection);
+    bool ground = intersectsGround(r, mu);
+
+    vec3 mie;
+    vec3 rayleigh = scattering(r, mu, muS, nu, ground, mie);
+    vec3 radiance = rayleigh * rayleighPhase(nu) + mie * miePhase(nu);
+    vec3 transmittance;
+    if (ground) {
+        // the planet behind is dimmed by the air, and lit by the sky where the sun has set
+        float bottom = atmosphere.bottomRadius;
+        float d = -rMu - safeSqrt(rMu * rMu - r * r + bottom * bottom);
+        float muSGround = clamp((r * muS + d * nu) / bottom, -1.0, 1.0);
+        transmittance = transmittanceToGround(r, mu, d);
+        radiance += transmittance * atmosphere.groundAlbedo / PI * skyIrradiance(bottom, muSGround);
+    } else {
+        transmittance = transmittanceToTop(r, mu);
+    }
+
+    // the scattered light is added over the scene behind, which is dimmed by the transmittance (blended with
+    // GL_ONE, GL_SRC_ALPHA)
+    FragColor = vec4(vec3(1.0) - exp(-radiance * exposure), dot(transmittance, vec3(1.0 / 3.0)));
+}
@@ -0,0 +1,15 @@
+#version 330 core
+out vec4 FragColor;
+
+in vec3 Color;
+in float Alpha;
+
+void main()
+{
+    // round point sprite with a soft edge
+    vec2 coord = gl_PointCoord * 2.0 - 1.0;
+    float radius = dot(coord, coord);
+    if (radius > 1.0 || Alpha <= 0.0) discard;
+
+    FragColor = vec4(Color, Alpha * (1.0 - radius));
+}
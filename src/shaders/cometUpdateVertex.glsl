@@ -0,0 +1,73 @@
+#version 330 core
+layout (location = 0) in vec4 aPosition; // position, birth time
+layout (location = 1) in vec4 aVelocity; // velocity, lifetime
+
+// captured by transform feedback into the other buffer
+out vec4 Position;
+out vec4 Velocity;
+
+uniform vec3 sunPosition;
+uniform float time; // scene time
+uniform float deltaTime; // scene time since the last update
+uniform int cometCount;
+uniform vec3 nucleus[4]; // NOTE: keep the size in sync with COMET_MAX in comet_tail.h
+uniform vec3 nucleusVelocity[4]; // scene units per scene second
+uniform float lifetime; // longest lifetime of a dust particle
+uniform float dustPressure; // radiation pressure at distance 1 from the sun
+uniform float ionPressure;
+uniform float ejectionSpeed; // speed of the dust leaving the nucleus
+
+// integer hash (lowbias32)
+uint hash(uint x)
+{
+    x ^= x >> 16;
+    x *= 0x7feb352du;
+    x ^= x >> 15;
+    x *= 0x846ca68bu;
+    x ^= x >> 16;
+    return x;
+}
+
+float random(uint seed)
+{
+    return float(hash(seed)) * (1.0 / 4294967296.0);
+}
+
+void main()
+{
+    uint id = uint(gl_VertexID);
+    int comet = gl_VertexID % cometCount;
+    bool ion = (id / uint(cometCount)) % 4u == 0u; // a quarter of the particles feed the ion tail
+
+    // every particle is reborn periodically with its own lifetime and phase, so the emission rate is constant
+    float life = lifetime * (ion ? 0.3 : 1.0) * (0.5 + 0.5 * random(2u * id));
+    float phase = life * random(2u * id + 1u);
+    float birth = phase + floor((time - phase) / life) * life;
+
+    vec3 position = aPosition.xyz;
+    vec3 velocity = aVelocity.xyz;
+    float dt = clamp(deltaTime, -life, life);
+    if (abs(birth - aPosition.w) > 0.5 * life) {
+        // spawn at the nucleus where it was at the birth time, moving with it plus a random ejection
+        float age = time - birth;
+        uint seed = hash(id ^ floatBitsToUint(birth));
+        vec3 direction = vec3(random(seed), random(seed + 1u), random(seed + 2u)) * 2.0 - 1.0;
+        direction *= inversesqrt(max(dot(direction, direction), 1e-6));
+        velocity = nucleusVelocity[comet] + direction * ejectionSpeed * (ion ? 0.2 : 1.0);
+        position = nucleus[comet] - nucleusVelocity[comet] * age;
+        dt = age;
+    } else {
+        birth = aPosition.w;
+    }
+
+    // radiation pressure pushes away from the sun with the inverse square of the distance; the dust grains
+    // have a spread of sizes (pressure to gravity ratios), which fans the dust tail out
+    float pressure = ion ? ionPressure : dustPressure * (0.2 + 0.8 * random(hash(id ^ floatBitsToUint(birth)) + 3u));
+    vec3 fromSun = position - sunPosition;
+    float r2 = max(dot(fromSun, fromSun), 0.01);
+    velocity += pressure * fromSun * (inversesqrt(r2) / r2) * dt;
+    position += velocity * dt;
+
+    Position = vec4(position, birth);
+    Velocity = vec4(velocity, life);
+}
@@ -0,0 +1,27 @@
+#version 330 core
+layout (location = 0) in vec4 aPosition; // position, birth time
+layout (location = 1) in vec4 aVelocity; // velocity, lifetime
+
+out vec3 Color;
+out float Alpha;
+
+uniform mat4 model; // moves the world positions relative to the camera
+uniform mat4 view;
+uniform mat4 projection;
+uniform float time; // scene time
+uniform int cometCount;
+uniform float activity[4]; // brightness of each comet (grows near the sun)
+uniform float pointScale; // point size in pixels at distance 1
+
+void main()
+{
+    int comet = gl_VertexID % cometCount;
+    bool ion = (gl_VertexID / cometCount) % 4 == 0; // same split as cometUpdateVertex.glsl
+
+    float age = clamp((time - aPosition.w) / aVelocity.w, 0.0, 1.0);
+    Color = ion ? vec3(0.45, 0.65, 1.0) : vec3(1.0, 0.9, 0.7);
+    Alpha = activity[comet] * (1.0 - age) * (ion ? 0.6 : 0.35);
+
+    gl_Position = projection * view * model * vec4(aPosition.xyz, 1.0);
+    gl_PointSize = clamp(pointScale / gl_Position.w, 1.0, 4.0);
+}
@@ -0,0 +1,28 @@
+#version 330 core
+out vec4 FragColor;
+
+in vec2 Position; // [-1, 1] across the square dome master
+
+uniform samplerCube scene; // faces rendered in the camera's view space (alpha 0 where nothing was drawn)
+uniform samplerCube skybox;
+uniform mat3 viewToWorld; // camera rotation, to look the skybox up in world directions
+uniform float skyboxIntensity; // 0 when the skybox is not shown
+uniform vec3 background; // color behind the scene without a skybox
+uniform float aperture; // field of view of the dome (radians)
+
+void main()
+{
+    // equidistant fisheye: the distance from the center is the angle from the camera's forward direction
+    float r = length(Position);
+    if (r > 1.0) {
+        FragColor = vec4(0.0, 0.0, 0.0, 1.0); // outside the dome
+        return;
+    }
+    float theta = r * aperture * 0.5;
+    vec2 around = r > 0.0 ? Position / r : vec2(0.0);
+    vec3 direction = vec3(sin(theta) * around, -cos(theta)); // up on the master is the camera's up
+
+    vec4 color = texture(scene, direction);
+    vec3 sky = skyboxIntensity > 0.0 ? texture(skybox, viewToWorld * direction).rgb * skyboxIntensity : background;
+    FragColor = vec4(color.rgb + (1.0 - color.a) * sky, 1.0);
+}
@@ -0,0 +1,45 @@
+#version 330 core
+layout (points) in;
+layout (points, max_vertices = 6) out;
+
+in VS_OUT {
+    vec3 Color;
+    float Brightness;
+} gs_in[];
+
+out VS_OUT {
+    vec3 Color;
+    float Brightness;
+} gs_out;
+
+uniform mat4 faceMatrices[6]; // projection * view of each cube face, from the camera's view space
+uniform int faceMask; // faces the object may cover (bit i: layer i of the cube map)
+
+// checks if a primitive is outside one of the side planes of a face (clip space coordinates)
+bool outside(vec4 p[1]) {
+    vec4 count = vec4(0.0); // vertices outside the left, right, bottom and top planes
+    for (int i = 0; i < 1; i++) {
+        count += vec4(lessThan(vec4(p[i].x, -p[i].x, p[i].y, -p[i].y), vec4(-p[i].w)));
+    }
+    return any(equal(count, vec4(1.0)));
+}
+
+// each primitive is submitted once and copied into every cube face it covers (see dome.h)
+void main()
+{
+    for (int face = 0; face < 6; face++) {
+        if ((faceMask & (1 << face)) == 0) continue;
+        vec4 p[1];
+        for (int i = 0; i < 1; i++) p[i] = faceMatrices[face] * gl_in[i].gl_Position;
+        if (outside(p)) continue;
+        for (int i = 0; i < 1; i++) {
+            gl_Layer = face;
+            gl_Position = p[i];
+            gl_PointSize = gl_in[i].gl_PointSize;
+            gs_out.Color = gs_in[i].Color;
+            gs_out.Brightness = gs_in[i].Brightness;
+            EmitVertex();
+        }
+        EndPrimitive();
+    }
+}
@@ -0,0 +1,93 @@
+#version 330 core
+out vec4 FragColor;
+
+#define MAX_OCCLUDERS 8 // same as eclipse.h
+#define TILE_SIZE 64.0 // texels on the side of a tile (same as impostors.h)
+#define PI 3.14159265359
+
+struct Material {
+    sampler2D diffuse;
+    sampler2D specular;
+};
+
+struct Light {
+    vec3 position;
+    float radius; // the light is a sphere (for the penumbra of the eclipses)
+
+    vec3 ambient;
+    vec3 diffuse;
+    vec3 specular;
+};
+
+uniform Material material;
+uniform Light light;
+
+uniform vec2 tileOrigin; // lower left pixel of the tile in the atlas
+uniform vec3 center; // center of the body (relative to the camera, see cameraRelative)
+uniform float radius;
+uniform mat3 toBody; // from world directions to the frame of the body's texture
+
+layout (std140) uniform Occluders {
+    vec4 occluders[MAX_OCCLUDERS]; // bodies that may cast a shadow this frame: center and radius
+};
+uniform int occluderMask; // occluders that may shadow this body (bit i: occluders[i])
+
+// angle between two directions (precise for the tiny angles of a far light)
+float angleBetween(vec3 a, vec3 b) {
+    return atan(length(cross(a, b)), dot(a, b));
+}
+
+// part of the light's disc hidden from a point by the occluders (same as planetFragment.glsl)
+float eclipse(vec3 position) {
+    vec3 toLight = light.position - position;
+    float lightAngle = asin(min(light.radius / length(toLight), 1.0));
+    float hidden = 0.0;
+    for (int i = 0; i < MAX_OCCLUDERS; i++) {
+        if ((occluderMask & (1 << i)) == 0) continue;
+        vec3 toOccluder = occluders[i].xyz - position;
+        float occluderAngle = asin(min(occluders[i].w / length(toOccluder), 1.0));
+        float separation = angleBetween(toLight, toOccluder);
+        float inside = abs(lightAngle - occluderAngle), touching = lightAngle + occluderAngle;
+        float maxHidden = min(occluderAngle * occluderAngle / (lightAngle * lightAngle), 1.0);
+        hidden = max(hidden, maxHidden * (1.0 - smoothstep(inside, touching, separation)));
+    }
+    return hidden;
+}
+
+// direction of a point of the octahedral map (-1 to 1 on both axes): the upper half of the octahedron is the
+// diamond in the middle, the lower half is folded over the corners
+vec3 octahedralDirection(vec2 e) {
+    vec3 n = vec3(e, 1.0 - abs(e.x) - abs(e.y));
+    float fold = max(-n.z, 0.0);
+    n.x += n.x >= 0.0 ? -fold : fold;
+    n.y += n.y >= 0.0 ? -fold : fold;
+    return normalize(n);
+}
+
+void main()
+{
+    // the edge texels lie on the edges of the map (see impostorFragment.glsl)
+    vec2 e = (gl_FragCoord.xy - tileOrigin - 0.5) / (TILE_SIZE - 1.0) * 2.0 - 1.0;
+    vec3 norm = octahedralDirection(e);
+    vec3 position = center + radius * norm;
+
+    // texture coordinates of the sphere of renderSphere, with the level of detail of a tile texel (the equator of
+    // the map spans about 2 * sqrt(2) tile sides; derivatives would break on the seam of the texture)
+    vec3 local = toBody * norm;
+    vec2 texCoords = vec2(fract(atan(local.y, local.x) / (2.0 * PI)), acos(clamp(local.z, -1.0, 1.0)) / PI);
+    float lod = max(log2(float(textureSize(material.diffuse, 0).x) / (2.83 * TILE_SIZE)), 0.0);
+    vec3 color = textureLod(material.diffuse, texCoords, lod).rgb;
+
+    // lighting of planetFragment.glsl, seen from the camera at the time of baking
+    vec3 lightDir = normalize(light.position - position);
+    float diff = max(dot(norm, lightDir), 0.0);
+    vec3 viewDir = normalize(-position);
+    vec3 reflectDir = reflect(-lightDir, norm);
+    float spec = max(dot(viewDir, reflectDir), 0.0);
+    vec3 ambient = light.ambient * color;
+    vec3 diffuse = light.diffuse * diff * color;
+    vec3 specular = light.specular * spec * textureLod(material.specular, texCoords, lod).rgb;
+
+    float lit = occluderMask != 0 ? 1.0 - eclipse(position) : 1.0;
+    FragColor = vec4(ambient + (diffuse + specular) * lit, 1.0);
+}
@@ -0,0 +1,41 @@
+#version 330 core
+out vec4 FragColor;
+
+in vec2 Offset;
+flat in vec4 Sphere;
+flat in vec3 Right;
+flat in vec3 Up;
+flat in vec3 Forward;
+flat in vec2 TileOrigin;
+
+#define TILE_SIZE 64.0 // texels on the side of a tile (same as impostors.h)
+#define ATLAS_TILES 16.0
+
+uniform sampler2D atlas;
+uniform mat4 view;
+uniform mat4 projection;
+uniform bool reversedDepth; // depth is in [0, 1] instead of [-1, 1] (see reversed_depth.h)
+
+// point of the octahedral map (-1 to 1 on both axes) of a direction (see impostorBakeFragment.glsl)
+vec2 octahedralPoint(vec3 n) {
+    n /= abs(n.x) + abs(n.y) + abs(n.z);
+    vec2 e = n.xy;
+    if (n.z < 0.0) e = (1.0 - abs(e.yx)) * vec2(e.x >= 0.0 ? 1.0 : -1.0, e.y >= 0.0 ? 1.0 : -1.0);
+    return e;
+}
+
+void main()
+{
+    // normal of the sphere under the pixel
+    float across = dot(Offset, Offset);
+    if (across > 1.0) discard;
+    vec3 norm = Offset.x * Right + Offset.y * Up - sqrt(1.0 - across) * Forward;
+
+    vec2 texel = TileOrigin * TILE_SIZE + 0.5 + (octahedralPoint(norm) * 0.5 + 0.5) * (TILE_SIZE - 1.0);
+    FragColor = vec4(texture(atlas, texel / (ATLAS_TILES * TILE_SIZE)).rgb, 1.0);
+
+    // depth of the sphere's surface (not of the quad), so the impostor hides and is hidden like the sphere
+    vec4 clip = projection * view * vec4(Sphere.xyz + norm * Sphere.w, 1.0);
+    float depth = clip.z / clip.w;
+    gl_FragDepth = reversedDepth ? depth : depth * 0.5 + 0.5;
+}
@@ -0,0 +1,31 @@
+#version 330 core
+layout (location = 0) in vec4 aSphere; // center (relative to the camera) and radius of the body
+layout (location = 1) in float aTile; // tile of the body in the atlas
+
+out vec2 Offset; // position on the quad (the body's disc is the unit disc)
+flat out vec4 Sphere;
+flat out vec3 Right;
+flat out vec3 Up;
+flat out vec3 Forward;
+flat out vec2 TileOrigin;
+
+#define ATLAS_TILES 16 // tiles on the side of the atlas (same as impostors.h)
+
+uniform mat4 view;
+uniform mat4 projection;
+
+void main()
+{
+    // square around the body's disc, facing the camera (at the origin); a far body is seen almost orthographically
+    Forward = normalize(aSphere.xyz);
+    vec3 cameraRight = vec3(view[0][0], view[1][0], view[2][0]);
+    Up = normalize(cross(cameraRight, Forward));
+    Right = cross(Forward, Up);
+    Offset = vec2(gl_VertexID & 1, gl_VertexID >> 1) * 2.0 - 1.0; // triangle strip
+    Sphere = aSphere;
+    int tile = int(aTile + 0.5);
+    TileOrigin = vec2(tile % ATLAS_TILES, tile / ATLAS_TILES);
+
+    vec3 position = aSphere.xyz + (Offset.x * Right + Offset.y * Up) * aSphere.w;
+    gl_Position = projection * view * vec4(position, 1.0);
+}
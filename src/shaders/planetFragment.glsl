@@ -1,6 +1,10 @@
 #version 330 core
 out vec4 FragColor;
 
+#define MAX_OCCLUDERS 8 // same as eclipse.h
+#define PAGE_SIZE 128.0 // texels on the side of a page of a virtual texture (same as virtual_texture_pages.h)
+#define PAGE_BORDER 4.0
+
 struct Material {
     sampler2D diffuse;
     sampler2D specular;
@@ -8,6 +12,7 @@ struct Material {
 
 struct Light {
     vec3 position;
+    float radius; // the light is a sphere (for the penumbra of the eclipses)
 
     vec3 ambient;
     vec3 diffuse;
@@ -18,31 +23,87 @@ struct Light {
     float quadratic;
 };
 
-in vec3 FragPos;
-in vec3 Normal;
-in vec2 TexCoords;
+in VS_OUT {
+    vec3 FragPos;
+    vec3 Normal;
+    vec2 TexCoords;
+} fs_in;
 
 uniform vec3 viewPos;
 uniform Material material;
 uniform Light light;
 
+layout (std140) uniform Occluders {
+    vec4 occluders[MAX_OCCLUDERS]; // bodies that may cast a shadow this frame: center (as FragPos) and radius
+};
+uniform int occluderMask; // occluders that may shadow this body (bit i: occluders[i])
+
+// virtual texture replacing material.diffuse (see virtual_texture.h)
+uniform bool virtualDiffuse;
+uniform sampler2D pageCache; // resident pages of every virtual texture
+uniform sampler2D pageTable; // slot and level of the page shown for each page of each level (mipmaps)
+uniform int virtualLevels;
+uniform float cacheSide; // pages on the side of the cache
+
+// angle between two directions (precise for the tiny angles of a far light)
+float angleBetween(vec3 a, vec3 b) {
+    return atan(length(cross(a, b)), dot(a, b));
+}
+
+// part of the light's disc hidden from a point by the occluders (analytic sphere shadows, see eclipse.h)
+float eclipse(vec3 position) {
+    vec3 toLight = light.position - position;
+    float lightAngle = asin(min(light.radius / length(toLight), 1.0)); // angular radius of the light's disc
+    float hidden = 0.0;
+    for (int i = 0; i < MAX_OCCLUDERS; i++) {
+        if ((occluderMask & (1 << i)) == 0) continue;
+        vec3 toOccluder = occluders[i].xyz - position;
+        float occluderAngle = asin(min(occluders[i].w / length(toOccluder), 1.0));
+        float separation = angleBetween(toLight, toOccluder);
+
+        // the hidden part goes from its maximum when one disc is inside the other to none when they only touch
+        float inside = abs(lightAngle - occluderAngle), touching = lightAngle + occluderAngle;
+        float maxHidden = min(occluderAngle * occluderAngle / (lightAngle * lightAngle), 1.0);
+        hidden = max(hidden, maxHidden * (1.0 - smoothstep(inside, touching, separation)));
+    }
+    return hidden;
+}
+
+// color of the virtual texture: the page of the level of detail of the fragment, or its nearest resident ancestor
+vec3 virtualColor(vec2 texCoords) {
+    float content = PAGE_SIZE - 2.0 * PAGE_BORDER;
+    vec2 texel = texCoords * vec2(textureSize(pageTable, 0)) * content;
+    vec2 dx = dFdx(texel), dy = dFdy(texel);
+    float lod = 0.5 * log2(max(max(dot(dx, dx), dot(dy, dy)), 1e-8)); // same as virtualFeedbackFragment.glsl
+    int level = clamp(int(floor(lod)), 0, virtualLevels - 1);
+
+    vec2 uv = vec2(fract(texCoords.x), clamp(texCoords.y, 0.0, 0.999999));
+    vec4 entry = texelFetch(pageTable, ivec2(uv * vec2(textureSize(pageTable, level))), level) * 255.0;
+    vec2 within = fract(uv * vec2(textureSize(pageTable, int(entry.b + 0.5)))); // in the page shown
+    vec2 cache = (floor(entry.rg + 0.5) * PAGE_SIZE + PAGE_BORDER + within * content) / (cacheSide * PAGE_SIZE);
+    return textureLod(pageCache, cache, 0.0).rgb;
+}
+
 void main()
 {
+    vec3 color = virtualDiffuse ? virtualColor(fs_in.TexCoords) : texture(material.diffuse, fs_in.TexCoords).rgb;
+
     // ambient
-    vec3 ambient = light.ambient * texture(material.diffuse, TexCoords).rgb;
+    vec3 ambient = light.ambient * color;
 
     // diffuse 
-    vec3 norm = normalize(Normal);
-    vec3 lightDir = normalize(light.position - FragPos);
+    vec3 norm = normalize(fs_in.Normal);
+    vec3 lightDir = normalize(light.position - fs_in.FragPos);
     float diff = max(dot(norm, lightDir), 0.0);
-    vec3 diffuse = light.diffuse * diff * texture(material.diffuse, TexCoords).rgb;
+    vec3 diffuse = light.diffuse * diff * color;
 
     // specular
-    vec3 viewDir = normalize(viewPos - FragPos);
+    vec3 viewDir = normalize(viewPos - fs_in.FragPos);
     vec3 reflectDir = reflect(-lightDir, norm);
     float spec = max(dot(viewDir, reflectDir), 0.0);
-    vec3 specular = light.specular * spec * texture(material.specular, TexCoords).rgb;
+    vec3 specular = light.specular * spec * texture(material.specular, fs_in.TexCoords).rgb;
 
-    vec3 result = ambient + diffuse + specular;
+    float lit = occluderMask != 0 ? 1.0 - eclipse(fs_in.FragPos) : 1.0;
+    vec3 result = ambient + (diffuse + specular) * lit;
     FragColor = vec4(result, 1.0);
 }
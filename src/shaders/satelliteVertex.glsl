@@ -0,0 +1,21 @@
+#version 330 core
+layout (location = 0) in vec3 aPos; // TEME position in earth radii
+
+out float Brightness;
+
+uniform mat4 model; // earth's center and radius
+uniform mat4 view;
+uniform mat4 projection;
+uniform float pointScale; // point size in pixels at distance 1
+
+void main()
+{
+    // TEME's pole (Z) goes along the axis the earth spins about in planetCreator (the scene's y, without axial
+    // tilt), so TEME (X, Y, Z) is the scene's (z, x, y); the textured sphere has its poles on model z instead, so
+    // the orbits follow the spin, not the continents of the texture
+    gl_Position = projection * view * model * vec4(aPos.yzx, 1.0);
+
+    // size attenuation with the distance to the camera
+    gl_PointSize = clamp(pointScale / gl_Position.w, 1.0, 4.0);
+    Brightness = clamp(pointScale / gl_Position.w, 0.4, 1.0);
+}
@@ -4,8 +4,9 @@ out vec4 FragColor;
 in vec3 TexCoords;
 
 uniform samplerCube skybox;
+uniform float intensity; // dims the nebula drawn under the bright stars
 
 void main()
 {
-    FragColor = texture(skybox, TexCoords);
+    FragColor = vec4(texture(skybox, TexCoords).rgb * intensity, 1.0);
 }
@@ -5,11 +5,13 @@ out vec3 TexCoords;
 
 uniform mat4 view;
 uniform mat4 projection;
+uniform bool reversedDepth; // far plane at depth 0 instead of 1
 
 void main()
 {
     TexCoords = aPos;
     vec4 pos = projection * view * vec4(aPos, 1.0);
 
-    gl_Position = pos.xyww;
+    // place the skybox on the far plane (z / w = 1, or depth 0 with reversed depth)
+    gl_Position = reversedDepth ? vec4(pos.xy, 0.0, pos.w) : pos.xyww;
 }
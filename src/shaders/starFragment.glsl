@@ -0,0 +1,15 @@
+#version 330 core
+out vec4 FragColor;
+
+in VS_OUT {
+    vec3 Color;
+    float Brightness;
+} fs_in;
+
+void main()
+{
+    // round sprite with a soft edge
+    float r = length(gl_PointCoord - vec2(0.5)) * 2.0;
+    if (r > 1.0) discard;
+    FragColor = vec4(fs_in.Color, fs_in.Brightness * (1.0 - r * r));
+}
@@ -0,0 +1,37 @@
+#version 330 core
+layout (location = 0) in vec3 position; // heliocentric equatorial (parsecs)
+layout (location = 1) in vec2 magnitudeColor; // absolute magnitude and B-V color index (thousandths)
+
+out VS_OUT {
+    vec3 Color;
+    float Brightness;
+} vs_out;
+
+uniform mat4 projection;
+uniform mat4 view;
+uniform mat3 equatorialToScene;
+uniform vec3 observer; // heliocentric equatorial (parsecs)
+uniform float magnitudeLimit; // apparent magnitude drawn as a faint single pixel
+uniform float pointScale; // pixels per magnitude brighter than the limit
+
+// approximate color of a star from its B-V color index (blue O stars to red M stars)
+vec3 starColor(float bv) {
+    vec3 color = mix(vec3(0.62, 0.72, 1.0), vec3(0.85, 0.9, 1.0), smoothstep(-0.4, 0.0, bv));
+    color = mix(color, vec3(1.0, 0.96, 0.9), smoothstep(0.0, 0.6, bv));
+    color = mix(color, vec3(1.0, 0.82, 0.6), smoothstep(0.6, 1.2, bv));
+    return mix(color, vec3(1.0, 0.65, 0.4), smoothstep(1.2, 2.0, bv));
+}
+
+void main()
+{
+    vec3 offset = position - observer;
+    float distance = max(length(offset), 1e-6);
+    float apparent = magnitudeColor.x / 1000.0 + 5.0 * log2(distance / 10.0) / log2(10.0);
+
+    vs_out.Color = starColor(magnitudeColor.y / 1000.0);
+    vs_out.Brightness = clamp(pow(10.0, -0.4 * (apparent - magnitudeLimit)), 0.0, 1.0); // fainter than the limit fade
+    gl_PointSize = clamp(1.0 + (magnitudeLimit - apparent) * pointScale, 1.0, 12.0);
+
+    // stars are directions: drawn on a unit sphere around the camera, behind everything else
+    gl_Position = projection * view * vec4(equatorialToScene * (offset / distance), 1.0);
+}
@@ -2,7 +2,9 @@
 layout (location = 0) in vec3 aPos;
 layout (location = 2) in vec2 aTexCoords;
 
-out vec2 TexCoords;
+out VS_OUT {
+    vec2 TexCoords;
+} vs_out;
 
 uniform mat4 model;
 uniform mat4 view;
@@ -10,7 +12,7 @@ uniform mat4 projection;
 
 void main()
 {
-    TexCoords = aTexCoords;
+    vs_out.TexCoords = aTexCoords;
 
     gl_Position = projection * view * model * vec4(aPos, 1.0);
 }
@@ -0,0 +1,52 @@
+#version 330 core
+layout (location = 0) in vec3 aGrid; // position in the chunk (0 to 1), 1 on the lower edge of the skirts
+
+out VS_OUT {
+    vec3 FragPos;
+    vec3 Normal;
+    vec2 TexCoords;
+} vs_out;
+
+#define TERRAIN_GRID 32.0 // same as terrain.h
+#define TILE_SIZE 256.0 // same as terrain_tiles.h
+
+uniform mat4 model;
+uniform mat4 view;
+uniform mat4 projection;
+
+uniform vec3 faceNormal; // cube face of the chunk (see terrain_tiles.h)
+uniform vec3 faceU;
+uniform vec3 faceV;
+uniform vec3 chunk; // corner of the chunk on its face (0 to 1) and its size
+uniform vec3 tile; // corner of the chunk in its tile (0 to 1) and its size
+uniform sampler2D tileTexture; // tile of the chunk (height in alpha), the same unit as material.diffuse
+uniform float relief; // height of an alpha of 1 (the planet's radius is 1)
+uniform float skirt; // depth of the skirts
+
+// point of the surface at a position of the grid, and its coordinates in the tile
+vec3 surface(vec2 grid, out vec2 texCoords) {
+    vec2 face = chunk.xy + grid * chunk.z;
+    vec3 direction = normalize(faceNormal + (2.0 * face.x - 1.0) * faceU + (2.0 * face.y - 1.0) * faceV);
+    // the edge texels of a tile lie on its edges
+    texCoords = (0.5 + (tile.xy + grid * tile.z) * (TILE_SIZE - 1.0)) / TILE_SIZE;
+    return direction * (1.0 + relief * textureLod(tileTexture, texCoords, 0.0).a);
+}
+
+void main()
+{
+    vec2 texCoords, neighbor;
+    vec3 position = surface(aGrid.xy, texCoords);
+
+    // normal of the displaced surface, from the neighbors on the grid
+    float step = 1.0 / TERRAIN_GRID;
+    vec3 alongU = surface(aGrid.xy + vec2(step, 0.0), neighbor) - surface(aGrid.xy - vec2(step, 0.0), neighbor);
+    vec3 alongV = surface(aGrid.xy + vec2(0.0, step), neighbor) - surface(aGrid.xy - vec2(0.0, step), neighbor);
+    vec3 normal = normalize(cross(alongU, alongV));
+
+    position -= normalize(position) * skirt * aGrid.z;
+    vs_out.FragPos = vec3(model * vec4(position, 1.0));
+    vs_out.Normal = mat3(transpose(inverse(model))) * normal;
+    vs_out.TexCoords = texCoords;
+
+    gl_Position = projection * view * vec4(vs_out.FragPos, 1.0);
+}
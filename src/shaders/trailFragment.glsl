@@ -0,0 +1,15 @@
+#version 330 core
+out vec4 FragColor;
+
+in float Age;
+
+uniform vec3 color;
+uniform float fadeTime; // age at which the trail has faded out completely
+
+void main()
+{
+    float alpha = 1.0 - Age / fadeTime;
+    if (Age < 0.0 || alpha <= 0.0) discard; // samples ahead of the direction of time are not drawn
+
+    FragColor = vec4(color, alpha * alpha);
+}
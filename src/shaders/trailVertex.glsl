@@ -0,0 +1,16 @@
+#version 330 core
+layout (location = 0) in vec4 aSample; // position, time stamp
+
+out float Age;
+
+uniform mat4 model;
+uniform mat4 view;
+uniform mat4 projection;
+uniform float time; // current scene time
+uniform float direction; // direction of time (1, or -1 when the clock runs backwards)
+
+void main()
+{
+    Age = (time - aSample.w) * direction; // positive behind the direction of time
+    gl_Position = projection * view * model * vec4(aSample.xyz, 1.0);
+}
@@ -0,0 +1,27 @@
+#version 330 core
+layout (location = 0) out uvec2 FragPage; // page (column, row << 16) and tag (1, level << 8, texture << 16)
+
+#define PAGE_CONTENT 120.0 // texels of a page without its borders (same as virtual_texture_pages.h)
+
+in VS_OUT {
+    vec3 FragPos;
+    vec3 Normal;
+    vec2 TexCoords;
+} fs_in;
+
+uniform int virtualTexture; // index of the texture in the cache
+uniform int virtualLevels;
+uniform ivec2 virtualPages; // pages of level 0
+uniform float lodBias; // log2 of the size of the feedback over the size of the image
+
+void main()
+{
+    vec2 texel = fs_in.TexCoords * vec2(virtualPages) * PAGE_CONTENT;
+    vec2 dx = dFdx(texel), dy = dFdy(texel);
+    float lod = 0.5 * log2(max(max(dot(dx, dx), dot(dy, dy)), 1e-8)) + lodBias; // same as planetFragment.glsl
+    int level = clamp(int(floor(lod)), 0, virtualLevels - 1);
+
+    vec2 uv = vec2(fract(fs_in.TexCoords.x), clamp(fs_in.TexCoords.y, 0.0, 0.999999));
+    uvec2 page = uvec2(uv * vec2(virtualPages >> level));
+    FragPage = uvec2(page.x | (page.y << 16), 1u | (uint(level) << 8) | (uint(virtualTexture) << 16));
+}
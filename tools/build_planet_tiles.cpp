@@ -0,0 +1,163 @@
+/**
+ * @file build_planet_tiles.cpp
+ * @brief Offline builder of the surface tiles streamed by the planet terrain (see terrain_tiles.h)
+ *
+ * Usage: build_planet_tiles <color image> <output.tiles> [levels] [height image] [relief]
+ *
+ * The images are equirectangular maps of the whole planet, in the layout of resources/textures/planets (any size;
+ * the height image is read as grey levels, black for the lowest point). The relief is the height of white in planet
+ * radii (default 0.005) and levels the depth of the pyramid (default: enough levels for the resolution of the color
+ * image). Copy the output to resources/tiles/<planet>.tiles, named like the planet's texture (earth.tiles, ...).
+ *
+ * Each level is written one row of tiles of a face at a time, so memory stays bounded for any depth; the texels of
+ * a row are resampled on every core.
+ *
+ * @author joelvaz0x01
+ * @author BrunoFG1
+ *
+ */
+
+#include <algorithm>
+#include <cmath>
+#include <cstdlib>
+#include <fstream>
+#include <iostream>
+#include <string>
+#include <vector>
+
+#define STB_IMAGE_IMPLEMENTATION ///< to avoid linker errors
+
+#include <stb_image.h>
+#include <parallel.h>
+#include <terrain_tiles.h>
+
+#define DEFAULT_RELIEF 0.005f ///< height of white in the height image (planet radii)
+
+/// equirectangular image read in memory
+struct Image {
+    int width = 0;
+    int height = 0;
+    int channels = 0;
+    unsigned char *data = nullptr;
+};
+
+/** Function to sample an equirectangular image with bilinear filtering
+ *
+ * @param image: image sampled
+ * @param texCoords: texture coordinates as used by the application (v = 0 on the last row, see loadTexture)
+ * @param channel: channel sampled
+ * @return value of the channel (0 to 255)
+ *
+ */
+float sampleImage(const Image &image, glm::dvec2 texCoords, int channel) {
+    double x = texCoords.x * image.width - 0.5;
+    double y = (1.0 - texCoords.y) * image.height - 0.5; // the application flips the images on load
+    double fx = std::floor(x), fy = std::floor(y);
+    double tx = x - fx, ty = y - fy;
+    int x0 = ((int) fx % image.width + image.width) % image.width, x1 = (x0 + 1) % image.width; // wraps around
+    int y0 = std::clamp((int) fy, 0, image.height - 1), y1 = std::clamp((int) fy + 1, 0, image.height - 1);
+    auto texel = [&](int i, int j) {
+        return (double) image.data[((size_t) j * image.width + i) * image.channels + channel];
+    };
+    return (float) ((texel(x0, y0) * (1.0 - tx) + texel(x1, y0) * tx) * (1.0 - ty) +
+                    (texel(x0, y1) * (1.0 - tx) + texel(x1, y1) * tx) * ty);
+}
+
+/** Function to resample one row of tiles of a face
+ *
+ * @param color: color image
+ * @param height: height image (no data for a flat planet)
+ * @param face: face of the cube
+ * @param level: level of the tiles
+ * @param row: row of the tiles on the face
+ * @param tiles: RGBA texels of every tile of the row, one after the other
+ *
+ */
+void resampleRow(const Image &color, const Image &height, int face, int level, uint32_t row,
+                 std::vector<unsigned char> &tiles) {
+    uint32_t side = 1u << level;
+    tiles.resize(side * TERRAIN_TILE_BYTES);
+    parallelFor(TERRAIN_TILE_SIZE, [&](size_t begin, size_t end, unsigned int) {
+        for (size_t j = begin; j < end; j++) {
+            // the edge texels lie on the edges of the tile (shared with the neighbors)
+            double t = (row + (double) j / (TERRAIN_TILE_SIZE - 1)) / side;
+            for (uint32_t x = 0; x < side; x++) {
+                unsigned char *texel = &tiles[x * TERRAIN_TILE_BYTES + j * TERRAIN_TILE_SIZE * 4];
+                for (int i = 0; i < TERRAIN_TILE_SIZE; i++, texel += 4) {
+                    double s = (x + (double) i / (TERRAIN_TILE_SIZE - 1)) / side;
+                    glm::dvec2 texCoords = terrainTexCoords(terrainDirection(face, s, t));
+                    for (int k = 0; k < 3; k++) {
+                        texel[k] = (unsigned char) std::lround(sampleImage(color, texCoords, std::min(k, color.channels - 1)));
+                    }
+                    texel[3] = height.data ? (unsigned char) std::lround(sampleImage(height, texCoords, 0)) : 0;
+                }
+            }
+        }
+    });
+}
+
+/** Main function of the tile builder
+ *
+ * @param argc: number of arguments
+ * @param argv: arguments (see the usage above)
+ * @return 0 if successful, -1 otherwise
+ *
+ */
+int main(int argc, char *argv[]) {
+    if (argc < 3 || argc > 6) {
+        std::cerr << "Usage: build_planet_tiles <color image> <output.tiles> [levels] [height image] [relief]"
+                  << std::endl;
+        return -1;
+    }
+
+    Image color, height;
+    color.data = stbi_load(argv[1], &color.width, &color.height, &color.channels, 0);
+    if (color.data == nullptr) {
+        std::cerr << "ERROR::TILES: Failed to read " << argv[1] << std::endl;
+        return -1;
+    }
+    if (argc >= 5) {
+        height.data = stbi_load(argv[4], &height.width, &height.height, &height.channels, 1);
+        height.channels = 1;
+        if (height.data == nullptr) {
+            std::cerr << "ERROR::TILES: Failed to read " << argv[4] << std::endl;
+            stbi_image_free(color.data);
+            return -1;
+        }
+    }
+
+    // by default, the last level has about the resolution of the image (4 faces around the equator)
+    int levels = 1;
+    while (4.0 * TERRAIN_TILE_SIZE * (1 << (levels - 1)) < color.width) levels++;
+    if (argc >= 4) levels = std::clamp(std::atoi(argv[3]), 1, 12);
+
+    std::ofstream output(argv[2], std::ios::binary | std::ios::trunc);
+    if (!output) {
+        std::cerr << "ERROR::TILES: Failed to write " << argv[2] << std::endl;
+        stbi_image_free(color.data);
+        stbi_image_free(height.data);
+        return -1;
+    }
+    TerrainTilesHeader header = {TERRAIN_TILES_MAGIC, TERRAIN_TILES_VERSION, (uint32_t) levels,
+                                 argc >= 6 ? (float) std::atof(argv[5]) : DEFAULT_RELIEF};
+    output.write((const char *) &header, sizeof(header));
+
+    std::vector<unsigned char> tiles;
+    for (int level = 0; level < levels; level++) {
+        for (int face = 0; face < 6; face++) {
+            for (uint32_t row = 0; row < (1u << level); row++) {
+                resampleRow(color, height, face, level, row, tiles);
+                output.write((const char *) tiles.data(), (std::streamsize) tiles.size());
+            }
+        }
+        std::cout << "Level " << level << ": " << terrainLevelStart(level + 1) << " tiles" << std::endl;
+    }
+
+    stbi_image_free(color.data);
+    stbi_image_free(height.data);
+    if (!output) {
+        std::cerr << "ERROR::TILES: Failed to write " << argv[2] << std::endl;
+        return -1;
+    }
+    return 0;
+}
@@ -0,0 +1,589 @@
+/**
+ * @file build_star_octree.cpp
+ * @brief Offline builder of the star octree streamed by the solar system (see star_octree.h)
+ *
+ * Usage: build_star_octree <catalog.csv> <output.oct>
+ *        build_star_octree --bright <catalog.csv> <output.bin>
+ *
+ * The catalog is a CSV file whose first line names its columns: x, y and z (heliocentric equatorial, parsecs),
+ * absmag (absolute magnitude) and ci (B-V color index) are read, as in the HYG database; larger catalogs (Gaia
+ * subsets) only need to be exported with the same columns. Copy the output to resources/catalogs/stars.oct.
+ *
+ * With --bright, the compact catalog of the bright star background is written instead (see
+ * bright_star_catalog.h): the direction of every star down to BRIGHT_LIMIT, with its apparent magnitude (mag
+ * column) and color index. Copy it to resources/catalogs/bright_stars.bin.
+ *
+ * The catalog never has to fit in memory:
+ * - the CSV is converted once to a temporary file of binary stars, measuring the bounding cube
+ * - the stars are streamed through the upper levels of the tree, where every node keeps a bounded heap of its
+ *   brightest stars and passes the fainter ones down, and the stars falling below them are appended to one
+ *   bucket per cell of the first level that would be deep enough for a bucket to fit in memory if the stars
+ *   were spread evenly
+ * - each bucket is then loaded on its own and its subtree built in memory; a bucket of a dense region with more
+ *   than BUCKET_STARS stars is first streamed through the heap of its node into one bucket per octant (appended
+ *   to the bucket file), recursively, so only the dense parts of the catalog get split deeper
+ *
+ * @author joelvaz0x01
+ * @author BrunoFG1
+ *
+ */
+
+#include <algorithm>
+#include <charconv>
+#include <cmath>
+#include <cstdio>
+#include <cstring>
+#include <fstream>
+#include <iostream>
+#include <string>
+#include <vector>
+
+#include <bright_star_catalog.h>
+#include <mapped_file.h>
+#include <star_octree.h>
+
+#define BUCKET_STARS 4000000 ///< stars expected per bucket at most (about 64 MB in memory)
+#define BUCKET_CHUNK 1024 ///< stars buffered per bucket before they are written to the bucket file
+#define BRIGHT_LIMIT 9.0 ///< faintest apparent magnitude written with --bright
+
+/// range of stars of one bucket in the bucket file
+struct BucketChunk {
+    uint64_t first; ///< index of the first star in the bucket file
+    uint32_t count; ///< number of stars
+};
+
+std::ofstream output; ///< octree being written
+uint64_t writtenStars = 0; ///< stars written to the octree so far
+std::vector<StarOctreeNode> nodes; ///< node table (written at the end)
+
+int bucketLevel = 0; ///< depth of the buckets (levels above keep their stars in heaps)
+double rootMin[3]; ///< lowest corner of the root cube
+double rootSize; ///< side of the root cube
+std::vector<std::vector<StarPoint>> heaps; ///< brightest stars of each upper node (faintest on top)
+std::vector<size_t> levelOffset; ///< index in heaps of the first node of each upper level
+std::vector<std::vector<BucketChunk>> bucketChunks; ///< chunks of each bucket in the bucket file
+std::fstream bucketFile; ///< stars of every bucket, in chunks
+uint64_t bucketStars = 0; ///< stars written to the bucket file so far
+
+/** Function to compare stars by brightness (the brighter one has the lower magnitude)
+ *
+ * @param a: first star
+ * @param b: second star
+ * @return true if a is brighter than b
+ *
+ */
+bool brighter(const StarPoint &a, const StarPoint &b) {
+    return a.magnitude < b.magnitude;
+}
+
+/** Function to find the index of a column in the header line of the catalog
+ *
+ * @param header: first line of the catalog
+ * @param name: name of the column
+ * @return index of the column, -1 if missing
+ *
+ */
+int columnIndex(const std::string &header, const std::string &name) {
+    int index = 0;
+    size_t begin = 0;
+    while (begin <= header.size()) {
+        size_t end = header.find(',', begin);
+        if (end == std::string::npos) end = header.size();
+        std::string column = header.substr(begin, end - begin);
+        column.erase(std::remove_if(column.begin(), column.end(), [](char c) {
+            return c == '"' || c == ' ' || c == '\r' || c == '\n';
+        }), column.end());
+        if (column == name) return index;
+        begin = end + 1;
+        index++;
+    }
+    return -1;
+}
+
+/** Function to read the numeric fields of five columns from a line of the catalog
+ *
+ * @param line: start of the line
+ * @param length: length of the line
+ * @param columns: index of each column read (-1 if missing)
+ * @param values: value of each column (kept if the field is not a number)
+ * @param valid: check if each column was read
+ *
+ */
+void readFields(const char *line, size_t length, const int columns[5], double values[5], bool valid[5]) {
+    // quotes are not expected around numbers, but skipped anyway
+    const char *field = line, *end = line + length;
+    for (int index = 0; field <= end; index++) {
+        const char *comma = (const char *) std::memchr(field, ',', end - field);
+        const char *fieldEnd = comma ? comma : end;
+        for (int k = 0; k < 5; k++) {
+            if (columns[k] != index) continue;
+            const char *begin = field;
+            while (begin < fieldEnd && (*begin == ' ' || *begin == '"')) begin++;
+            valid[k] = std::from_chars(begin, fieldEnd, values[k]).ec == std::errc();
+        }
+        if (comma == nullptr) break;
+        field = comma + 1;
+    }
+}
+
+/** Function to write the compact catalog of the bright star background
+ *
+ * @param path: path of the CSV catalog
+ * @param outputPath: path of the catalog written
+ * @return 0 if successful, -1 otherwise
+ *
+ */
+int writeBrightStars(const char *path, const char *outputPath) {
+    MappedFile catalog(path);
+    if (catalog.size() == 0) {
+        std::cerr << "ERROR::STARS: Failed to read " << path << std::endl;
+        return -1;
+    }
+    const char *data = catalog.data();
+    size_t size = catalog.size();
+    const char *eol = (const char *) std::memchr(data, '\n', size);
+    size_t position = eol ? (size_t) (eol - data) + 1 : size;
+
+    std::string header(data, position);
+    int columns[5] = {columnIndex(header, "x"), columnIndex(header, "y"), columnIndex(header, "z"),
+                      columnIndex(header, "mag"), columnIndex(header, "ci")};
+    if (*std::min_element(columns, columns + 4) < 0) {
+        std::cerr << "ERROR::STARS: The catalog needs the x, y, z and mag columns" << std::endl;
+        return -1;
+    }
+
+    std::vector<BrightStar> stars;
+    while (position < size) {
+        const char *line = data + position;
+        eol = (const char *) std::memchr(line, '\n', size - position);
+        size_t length = eol ? (size_t) (eol - line) : size - position;
+        position += length + 1;
+
+        double values[5] = {0.0, 0.0, 0.0, 0.0, 0.65};
+        bool valid[5] = {false, false, false, false, false};
+        readFields(line, length, columns, values, valid);
+        double distance = std::sqrt(values[0] * values[0] + values[1] * values[1] + values[2] * values[2]);
+        if (!valid[0] || !valid[1] || !valid[2] || !valid[3] || distance <= 0.0 || values[3] > BRIGHT_LIMIT)
+            continue; // the sun is at the origin
+
+        BrightStar star{};
+        for (int k = 0; k < 3; k++) star.direction[k] = (int16_t) std::lround(values[k] / distance * 32767.0);
+        star.magnitude = (int8_t) std::lround(std::fmin(std::fmax(values[3], -12.0), 12.0) * 10.0);
+        star.color = (int8_t) std::lround(std::fmin(std::fmax(values[4], -1.0), 2.5) * 50.0);
+        stars.push_back(star);
+    }
+
+    std::ofstream out(outputPath, std::ios::binary | std::ios::trunc);
+    if (!out || stars.empty()) {
+        std::cerr << "ERROR::STARS: No star written to " << outputPath << std::endl;
+        return -1;
+    }
+    BrightStarsHeader brightHeader = {BRIGHT_STARS_MAGIC, BRIGHT_STARS_VERSION, stars.size()};
+    out.write((const char *) &brightHeader, sizeof(brightHeader));
+    out.write((const char *) stars.data(), (std::streamsize) (stars.size() * sizeof(BrightStar)));
+    std::cout << "Bright stars: " << stars.size() << " stars" << std::endl;
+    return 0;
+}
+
+/** Function to convert the CSV catalog into a temporary file of binary stars
+ *
+ * @param path: path of the CSV catalog
+ * @param starsPath: path of the binary file written
+ * @param bounds: lowest and highest coordinates of the stars (6 values)
+ * @return number of stars, 0 if the catalog cannot be read
+ *
+ */
+uint64_t convertCatalog(const char *path, const std::string &starsPath, double bounds[6]) {
+    MappedFile catalog;
+    if (!catalog.open(path, false) || catalog.size() == 0) {
+        std::cerr << "ERROR::STARS: Failed to read " << path << std::endl;
+        return 0;
+    }
+    const char *data = catalog.data();
+    size_t size = catalog.size();
+    const char *eol = (const char *) std::memchr(data, '\n', size);
+    size_t position = eol ? (size_t) (eol - data) + 1 : size;
+
+    std::string header(data, position);
+    int columns[5] = {columnIndex(header, "x"), columnIndex(header, "y"), columnIndex(header, "z"),
+                      columnIndex(header, "absmag"), columnIndex(header, "ci")};
+    if (*std::min_element(columns, columns + 4) < 0) {
+        std::cerr << "ERROR::STARS: The catalog needs the x, y, z and absmag columns" << std::endl;
+        return 0;
+    }
+
+    std::FILE *stars = std::fopen(starsPath.c_str(), "wb");
+    if (stars == nullptr) return 0;
+    std::vector<StarPoint> buffer;
+    uint64_t count = 0;
+    for (int k = 0; k < 3; k++) {
+        bounds[k] = HUGE_VAL;
+        bounds[k + 3] = -HUGE_VAL;
+    }
+
+    while (position < size) {
+        const char *line = data + position;
+        eol = (const char *) std::memchr(line, '\n', size - position);
+        size_t length = eol ? (size_t) (eol - line) : size - position;
+        position += length + 1;
+
+        double values[5] = {0.0, 0.0, 0.0, 0.0, 0.65}; // stars without a color index are drawn like the sun
+        bool valid[5] = {false, false, false, false, false};
+        readFields(line, length, columns, values, valid);
+        if (!valid[0] || !valid[1] || !valid[2] || !valid[3]) continue;
+
+        StarPoint star = {(float) values[0], (float) values[1], (float) values[2],
+                          (int16_t) std::lround(std::fmin(std::fmax(values[3], -30.0), 30.0) * 1000.0),
+                          (int16_t) std::lround(std::fmin(std::fmax(values[4], -1.0), 5.0) * 1000.0)};
+        for (int k = 0; k < 3; k++) {
+            bounds[k] = std::min(bounds[k], values[k]);
+            bounds[k + 3] = std::max(bounds[k + 3], values[k]);
+        }
+        buffer.push_back(star);
+        if (buffer.size() == 65536) {
+            std::fwrite(buffer.data(), sizeof(StarPoint), buffer.size(), stars);
+            buffer.clear();
+        }
+        count++;
+    }
+    std::fwrite(buffer.data(), sizeof(StarPoint), buffer.size(), stars);
+    std::fclose(stars);
+    return count;
+}
+
+/** Function to find the cell of a star at a level of the tree
+ *
+ * @param star: star
+ * @param level: depth of the cells (2^level cells per side)
+ * @return index of the cell (x + y * side + z * side * side)
+ *
+ */
+size_t cellIndex(const StarPoint &star, int level) {
+    auto side = (int64_t) 1 << level;
+    double position[3] = {star.x, star.y, star.z};
+    size_t index = 0;
+    for (int k = 2; k >= 0; k--) {
+        auto cell = (int64_t) std::floor((position[k] - rootMin[k]) / rootSize * (double) side);
+        index = index * side + (size_t) std::min(std::max(cell, (int64_t) 0), side - 1);
+    }
+    return index;
+}
+
+/** Function to append the buffered stars of a bucket to the bucket file
+ *
+ * @param chunks: chunks of the bucket
+ * @param buffer: stars of the bucket not written yet (emptied)
+ *
+ */
+void writeChunk(std::vector<BucketChunk> &chunks, std::vector<StarPoint> &buffer) {
+    bucketFile.seekp((std::streamoff) (bucketStars * sizeof(StarPoint))); // buckets are also read while split
+    bucketFile.write((const char *) buffer.data(), (std::streamsize) (buffer.size() * sizeof(StarPoint)));
+    chunks.push_back({bucketStars, (uint32_t) buffer.size()});
+    bucketStars += buffer.size();
+    buffer.clear();
+}
+
+/** Function to append a star to the file of its bucket
+ *
+ * @param star: star
+ * @param buffers: stars of each bucket not written yet
+ *
+ */
+void addToBucket(const StarPoint &star, std::vector<std::vector<StarPoint>> &buffers) {
+    size_t bucket = cellIndex(star, bucketLevel);
+    std::vector<StarPoint> &buffer = buffers[bucket];
+    buffer.push_back(star);
+    if (buffer.size() < BUCKET_CHUNK) return;
+
+    writeChunk(bucketChunks[bucket], buffer);
+}
+
+/** Function to stream the stars through the heaps of the upper levels into the buckets
+ *
+ * @param starsPath: binary file of every star
+ *
+ */
+void distributeStars(const std::string &starsPath) {
+    std::vector<std::vector<StarPoint>> buffers((size_t) 1 << (3 * bucketLevel));
+    bucketChunks.assign(buffers.size(), {});
+
+    std::FILE *stars = std::fopen(starsPath.c_str(), "rb");
+    std::vector<StarPoint> block(65536);
+    size_t read;
+    while (stars && (read = std::fread(block.data(), sizeof(StarPoint), block.size(), stars)) > 0) {
+        for (size_t i = 0; i < read; i++) {
+            StarPoint star = block[i];
+            bool kept = false;
+            for (int level = 0; level < bucketLevel && !kept; level++) {
+                std::vector<StarPoint> &heap = heaps[levelOffset[level] + cellIndex(star, level)];
+                if (heap.size() < STAR_NODE_CAPACITY) {
+                    heap.push_back(star);
+                    std::push_heap(heap.begin(), heap.end(), brighter);
+                    kept = true;
+                } else if (brighter(star, heap.front())) {
+                    // the star takes the place of the faintest one, which goes on down
+                    std::pop_heap(heap.begin(), heap.end(), brighter);
+                    std::swap(star, heap.back());
+                    std::push_heap(heap.begin(), heap.end(), brighter);
+                }
+            }
+            if (!kept) addToBucket(star, buffers);
+        }
+    }
+    if (stars) std::fclose(stars);
+
+    // the remaining stars of every bucket
+    for (size_t bucket = 0; bucket < buffers.size(); bucket++) {
+        if (buffers[bucket].empty()) continue;
+        writeChunk(bucketChunks[bucket], buffers[bucket]);
+    }
+    bucketFile.flush();
+}
+
+/** Function to append a node with its stars (already sorted from the brightest) to the octree
+ *
+ * @param stars: stars of the node
+ * @param count: number of stars
+ * @param center: center of the node's cube
+ * @param halfSize: half the side of the node's cube
+ * @return index of the node
+ *
+ */
+uint32_t writeNode(const StarPoint *stars, size_t count, const double center[3], double halfSize) {
+    StarOctreeNode node{};
+    for (int k = 0; k < 3; k++) node.center[k] = (float) center[k];
+    node.halfSize = (float) halfSize;
+    node.firstStar = writtenStars;
+    node.starCount = (uint32_t) count;
+    node.brightest = (float) stars[0].magnitude / 1000.0f;
+    output.write((const char *) stars, (std::streamsize) (count * sizeof(StarPoint)));
+    writtenStars += count;
+    nodes.push_back(node);
+    return (uint32_t) nodes.size() - 1;
+}
+
+/** Function to build the subtree of a range of stars in memory
+ *
+ * @param stars: stars of the subtree (reordered)
+ * @param begin: first star of the range
+ * @param end: end of the range
+ * @param center: center of the subtree's cube
+ * @param halfSize: half the side of the subtree's cube
+ * @param depth: depth of the subtree's root
+ * @return index of the subtree's root, 0 if the range is empty
+ *
+ */
+uint32_t buildSubtree(std::vector<StarPoint> &stars, size_t begin, size_t end, const double center[3],
+                      double halfSize, int depth) {
+    if (begin == end) return 0;
+    size_t keep = depth >= STAR_OCTREE_MAX_DEPTH ? end - begin : std::min<size_t>(end - begin, STAR_NODE_CAPACITY);
+    std::nth_element(stars.begin() + (long) begin, stars.begin() + (long) (begin + keep - 1),
+                     stars.begin() + (long) end, brighter);
+    std::sort(stars.begin() + (long) begin, stars.begin() + (long) (begin + keep), brighter);
+    uint32_t index = writeNode(stars.data() + begin, keep, center, halfSize);
+
+    // split the other stars by octant (z, then y, then x), so octant o is the o-th range
+    float centerf[3] = {(float) center[0], (float) center[1], (float) center[2]};
+    size_t bounds[9];
+    bounds[0] = begin + keep;
+    bounds[8] = end;
+    auto split = [&](size_t first, size_t last, int bit) {
+        return (size_t) (std::partition(stars.begin() + (long) first, stars.begin() + (long) last,
+                                        [&](const StarPoint &star) {
+                                            return (starOctant(centerf, star.x, star.y, star.z) & bit) == 0;
+                                        }) - stars.begin());
+    };
+    bounds[4] = split(bounds[0], bounds[8], 4);
+    for (int k = 0; k < 8; k += 4) bounds[k + 2] = split(bounds[k], bounds[k + 4], 2);
+    for (int k = 0; k < 8; k += 2) bounds[k + 1] = split(bounds[k], bounds[k + 2], 1);
+
+    for (int octant = 0; octant < 8; octant++) {
+        double childCenter[3];
+        for (int k = 0; k < 3; k++) childCenter[k] = center[k] + ((octant >> k) & 1 ? 0.5 : -0.5) * halfSize;
+        uint32_t child = buildSubtree(stars, bounds[octant], bounds[octant + 1], childCenter, halfSize / 2.0,
+                                      depth + 1);
+        nodes[index].children[octant] = child;
+    }
+    return index;
+}
+
+/** Function to read a chunk of a bucket from the bucket file
+ *
+ * @param chunk: chunk read
+ * @param stars: stars of the chunk (resized)
+ * @return true if the chunk was read
+ *
+ */
+bool readChunk(const BucketChunk &chunk, std::vector<StarPoint> &stars) {
+    stars.resize(chunk.count);
+    bucketFile.seekg((std::streamoff) (chunk.first * sizeof(StarPoint)));
+    bucketFile.read((char *) stars.data(), (std::streamsize) (chunk.count * sizeof(StarPoint)));
+    if (bucketFile) return true;
+    bucketFile.clear();
+    return false;
+}
+
+/** Function to write the subtree of a bucket, split by octant first while it has too many stars to fit in memory
+ *
+ * @param chunks: chunks of the bucket in the bucket file
+ * @param center: center of the bucket's cube
+ * @param halfSize: half the side of the bucket's cube
+ * @param depth: depth of the bucket's node
+ * @return index of the subtree's root, 0 if the bucket is empty
+ *
+ */
+uint32_t writeBucket(const std::vector<BucketChunk> &chunks, const double center[3], double halfSize, int depth) {
+    uint64_t count = 0;
+    for (const BucketChunk &chunk: chunks) count += chunk.count;
+
+    std::vector<StarPoint> block;
+    if (count <= BUCKET_STARS || depth >= STAR_OCTREE_MAX_DEPTH) {
+        // load the bucket and build its subtree in memory
+        std::vector<StarPoint> stars;
+        stars.reserve(count);
+        for (const BucketChunk &chunk: chunks) {
+            if (readChunk(chunk, block)) stars.insert(stars.end(), block.begin(), block.end());
+        }
+        return buildSubtree(stars, 0, stars.size(), center, halfSize, depth);
+    }
+
+    // a dense region: the node keeps the brightest stars in a heap and passes the others to one bucket per octant
+    float centerf[3] = {(float) center[0], (float) center[1], (float) center[2]};
+    std::vector<StarPoint> heap, buffers[8];
+    std::vector<BucketChunk> octantChunks[8];
+    for (const BucketChunk &chunk: chunks) {
+        if (!readChunk(chunk, block)) continue;
+        for (StarPoint star: block) {
+            if (heap.size() < STAR_NODE_CAPACITY) {
+                heap.push_back(star);
+                std::push_heap(heap.begin(), heap.end(), brighter);
+                continue;
+            }
+            if (brighter(star, heap.front())) {
+                std::pop_heap(heap.begin(), heap.end(), brighter);
+                std::swap(star, heap.back());
+                std::push_heap(heap.begin(), heap.end(), brighter);
+            }
+            int octant = starOctant(centerf, star.x, star.y, star.z);
+            buffers[octant].push_back(star);
+            if (buffers[octant].size() == BUCKET_CHUNK) writeChunk(octantChunks[octant], buffers[octant]);
+        }
+    }
+    for (int octant = 0; octant < 8; octant++) {
+        if (!buffers[octant].empty()) writeChunk(octantChunks[octant], buffers[octant]);
+    }
+    if (heap.empty()) return 0;
+
+    std::sort(heap.begin(), heap.end(), brighter);
+    uint32_t node = writeNode(heap.data(), heap.size(), center, halfSize);
+    for (int octant = 0; octant < 8; octant++) {
+        double childCenter[3];
+        for (int k = 0; k < 3; k++) childCenter[k] = center[k] + ((octant >> k) & 1 ? 0.5 : -0.5) * halfSize;
+        uint32_t child = writeBucket(octantChunks[octant], childCenter, halfSize / 2.0, depth + 1);
+        nodes[node].children[octant] = child;
+    }
+    return node;
+}
+
+/** Function to write the node of an upper cell and everything below it
+ *
+ * @param level: depth of the cell
+ * @param cell: coordinates of the cell at its level
+ * @return index of the node, 0 if the cell is empty
+ *
+ */
+uint32_t writeCell(int level, const size_t cell[3]) {
+    auto side = (size_t) 1 << level;
+    double halfSize = rootSize / (double) side / 2.0;
+    double center[3];
+    for (int k = 0; k < 3; k++) center[k] = rootMin[k] + ((double) cell[k] + 0.5) * 2.0 * halfSize;
+    size_t index = cell[0] + (cell[1] + cell[2] * side) * side;
+
+    if (level == bucketLevel) return writeBucket(bucketChunks[index], center, halfSize, level);
+
+    std::vector<StarPoint> &heap = heaps[levelOffset[level] + index];
+    if (heap.empty()) return 0; // heaps fill before passing stars down, so nothing is below
+    std::sort(heap.begin(), heap.end(), brighter);
+    uint32_t node = writeNode(heap.data(), heap.size(), center, halfSize);
+    std::vector<StarPoint>().swap(heap);
+
+    for (int octant = 0; octant < 8; octant++) {
+        size_t child[3] = {2 * cell[0] + (octant & 1), 2 * cell[1] + (octant >> 1 & 1), 2 * cell[2] + (octant >> 2)};
+        uint32_t childNode = writeCell(level + 1, child);
+        nodes[node].children[octant] = childNode;
+    }
+    return node;
+}
+
+/** Main function that builds the octree of a star catalog
+ *
+ * @param argc: number of arguments
+ * @param argv: arguments (optional --bright, catalog and output paths)
+ * @return 0 if successful, -1 otherwise
+ *
+ */
+int main(int argc, char *argv[]) {
+    if (argc == 4 && std::string(argv[1]) == "--bright") return writeBrightStars(argv[2], argv[3]);
+    if (argc != 3) {
+        std::cerr << "Usage: build_star_octree [--bright] <catalog.csv> <output>" << std::endl;
+        return -1;
+    }
+    std::string starsPath = std::string(argv[2]) + ".stars.tmp";
+    std::string bucketPath = std::string(argv[2]) + ".buckets.tmp";
+
+    double bounds[6];
+    uint64_t count = convertCatalog(argv[1], starsPath, bounds);
+    if (count == 0) {
+        std::remove(starsPath.c_str());
+        std::cerr << "ERROR::STARS: No star found in " << argv[1] << std::endl;
+        return -1;
+    }
+
+    // root cube around every star (slightly larger, so no star lies on its highest faces)
+    rootSize = std::max(std::max(bounds[3] - bounds[0], bounds[4] - bounds[1]), bounds[5] - bounds[2]);
+    rootSize = rootSize * 1.001 + 1e-3;
+    for (int k = 0; k < 3; k++) rootMin[k] = (bounds[k] + bounds[k + 3]) / 2.0 - rootSize / 2.0;
+
+    // buckets one level deeper per factor 8 of stars (a uniform catalog then has BUCKET_STARS per bucket at most,
+    // the buckets of denser regions are split again by writeBucket)
+    bucketLevel = 0;
+    while ((count >> (3 * bucketLevel)) > BUCKET_STARS) bucketLevel++;
+    size_t upperNodes = 0;
+    for (int level = 0; level < bucketLevel; level++) {
+        levelOffset.push_back(upperNodes);
+        upperNodes += (size_t) 1 << (3 * level);
+    }
+    heaps.resize(upperNodes);
+
+    bucketFile.open(bucketPath, std::ios::in | std::ios::out | std::ios::binary | std::ios::trunc);
+    output.open(argv[2], std::ios::binary | std::ios::trunc);
+    if (!bucketFile || !output) {
+        std::cerr << "ERROR::STARS: Failed to write " << argv[2] << std::endl;
+        return -1;
+    }
+    distributeStars(starsPath);
+    std::remove(starsPath.c_str());
+
+    StarOctreeHeader header{};
+    output.write((const char *) &header, sizeof(header)); // written again once complete
+    size_t root[3] = {0, 0, 0};
+    writeCell(0, root);
+    bucketFile.close();
+    std::remove(bucketPath.c_str());
+
+    header.magic = STAR_OCTREE_MAGIC;
+    header.version = STAR_OCTREE_VERSION;
+    header.starCount = writtenStars;
+    header.nodeCount = nodes.size();
+    header.nodeOffset = sizeof(header) + writtenStars * sizeof(StarPoint);
+    for (int k = 0; k < 3; k++) header.center[k] = (float) (rootMin[k] + rootSize / 2.0);
+    header.halfSize = (float) (rootSize / 2.0);
+    output.write((const char *) nodes.data(), (std::streamsize) (nodes.size() * sizeof(StarOctreeNode)));
+    output.seekp(0);
+    output.write((const char *) &header, sizeof(header));
+    output.close();
+
+    std::cout << "Star octree: " << writtenStars << " stars in " << nodes.size() << " nodes (" << bucketLevel
+              << " streamed levels)" << std::endl;
+    return 0;
+}
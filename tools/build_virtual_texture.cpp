@@ -0,0 +1,356 @@
+/**
+ * @file build_virtual_texture.cpp
+ * @brief Offline builder of the paged mip pyramid of a virtual planet texture (see virtual_texture_pages.h)
+ *
+ * Usage: build_virtual_texture [--columns n] [--levels n] <image>... <output.pages>
+ *
+ * The images are the tiles of an equirectangular map of the whole planet, in the layout of
+ * resources/textures/planets, listed row by row from the north and from the west; columns is the number of tiles on
+ * a row (default: every image, so a single image is the whole map). Every tile has the same size and must be
+ * readable by stb_image (less than 2 GB of texels): a 64k x 32k map is split into 8 x 4 tiles of 8192 x 8192, like
+ * the tiles of NASA's Blue Marble. Levels is the depth of the pyramid (default: the deepest whose level 0 is not
+ * wider than the map). Copy the output to resources/textures/virtual/<planet>.pages, named like the planet's texture
+ * (earth.pages, ...).
+ *
+ * The pyramid is written one row of pages at a time: level 0 is resampled from the tiles, which are decoded a row
+ * of tiles at a time, and every other level is the average of 2 x 2 texels of the one below, read back from the
+ * output. The tool thus needs about the memory of two rows of tiles, whatever the size of the map; the texels are
+ * resampled and the tiles decoded on every core.
+ *
+ * @author joelvaz0x01
+ * @author BrunoFG1
+ *
+ */
+
+#include <algorithm>
+#include <cmath>
+#include <cstdlib>
+#include <cstring>
+#include <fstream>
+#include <iostream>
+#include <string>
+#include <vector>
+
+#define STB_IMAGE_IMPLEMENTATION ///< to avoid linker errors
+
+#include <stb_image.h>
+#include <parallel.h>
+#include <virtual_texture_pages.h>
+
+/// RGB texels of the rows [first, first + height) of a level of the pyramid (the row 0 at the bottom)
+struct Strip {
+    int width = 0;
+    int first = 0;
+    int height = 0;
+    std::vector<unsigned char> texels;
+
+    // texel at a column and a row of the level (the columns wrap around, the rows are clamped to the strip)
+    const unsigned char *at(int i, int j) const {
+        i = (i % width + width) % width;
+        j = std::clamp(j, first, first + height - 1) - first;
+        return &texels[((size_t) j * width + i) * 3];
+    }
+};
+
+/// equirectangular map split into tiles of the same size, decoded a row of tiles at a time
+struct Mosaic {
+    int columns = 0;
+    int rows = 0;
+    int tileWidth = 0;
+    int tileHeight = 0;
+    std::vector<const char *> paths; // row by row from the north
+    std::vector<unsigned char *> tiles; // decoded tiles (row by row from the south, null if not decoded)
+
+    int width() const {
+        return columns * tileWidth;
+    }
+
+    int height() const {
+        return rows * tileHeight;
+    }
+
+    // RGB texel at a column and a row of the map (the row 0 at the bottom), whose row of tiles is decoded
+    const unsigned char *at(int x, int y) const {
+        const unsigned char *tile = tiles[(size_t) (y / tileHeight) * columns + x / tileWidth];
+        return &tile[((size_t) (y % tileHeight) * tileWidth + x % tileWidth) * 3];
+    }
+};
+
+/** Function to read the size of the tiles of a mosaic
+ *
+ * @param mosaic: mosaic whose columns and paths are set
+ * @return true if every tile can be read and has the same size, false otherwise
+ *
+ */
+bool openMosaic(Mosaic &mosaic) {
+    mosaic.rows = (int) mosaic.paths.size() / mosaic.columns;
+    mosaic.tiles.assign(mosaic.paths.size(), nullptr);
+    for (const char *path: mosaic.paths) {
+        int width, height, channels;
+        if (!stbi_info(path, &width, &height, &channels)) {
+            std::cerr << "ERROR::VIRTUAL_TEXTURE: Failed to read " << path << std::endl;
+            return false;
+        }
+        if (mosaic.tileWidth == 0) {
+            mosaic.tileWidth = width;
+            mosaic.tileHeight = height;
+        } else if (width != mosaic.tileWidth || height != mosaic.tileHeight) {
+            std::cerr << "ERROR::VIRTUAL_TEXTURE: " << path << " is not " << mosaic.tileWidth << " x "
+                      << mosaic.tileHeight << " like the first tile" << std::endl;
+            return false;
+        }
+    }
+    return true;
+}
+
+/** Function to decode the rows of tiles holding some rows of the map and to free the others
+ *
+ * @param mosaic: mosaic
+ * @param low: lowest row of the map needed
+ * @param high: highest row of the map needed
+ * @return true if successful, false if a tile failed to load
+ *
+ */
+bool loadMosaicRows(Mosaic &mosaic, int low, int high) {
+    int lowTiles = low / mosaic.tileHeight, highTiles = high / mosaic.tileHeight;
+    for (int r = 0; r < mosaic.rows; r++) {
+        if (r >= lowTiles && r <= highTiles) continue;
+        for (int c = 0; c < mosaic.columns; c++) {
+            stbi_image_free(mosaic.tiles[(size_t) r * mosaic.columns + c]);
+            mosaic.tiles[(size_t) r * mosaic.columns + c] = nullptr;
+        }
+    }
+
+    bool loaded = true;
+    for (int r = lowTiles; r <= highTiles; r++) {
+        if (mosaic.tiles[(size_t) r * mosaic.columns] != nullptr) continue;
+        size_t listed = (size_t) (mosaic.rows - 1 - r) * mosaic.columns; // the paths start at the north
+        std::cout << "Decoding the row " << mosaic.rows - r << " of " << mosaic.rows << " of tiles" << std::endl;
+        parallelFor((size_t) mosaic.columns, [&](size_t begin, size_t end, unsigned int) {
+            for (size_t c = begin; c < end; c++) {
+                int width, height, channels;
+                mosaic.tiles[(size_t) r * mosaic.columns + c] =
+                        stbi_load(mosaic.paths[listed + c], &width, &height, &channels, 3);
+            }
+        });
+        for (int c = 0; c < mosaic.columns; c++) {
+            if (mosaic.tiles[(size_t) r * mosaic.columns + c] != nullptr) continue;
+            std::cerr << "ERROR::VIRTUAL_TEXTURE: Failed to read " << mosaic.paths[listed + c] << std::endl;
+            loaded = false;
+        }
+    }
+    return loaded;
+}
+
+/** Function to resample some rows of level 0 from the map with bilinear filtering
+ *
+ * @param mosaic: map (the rows of tiles needed are decoded here)
+ * @param strip: rows of level 0 (its width, first row and height are already set)
+ * @param levelHeight: rows of level 0
+ * @return true if successful, false if a tile failed to load
+ *
+ */
+bool resampleStrip(Mosaic &mosaic, Strip &strip, int levelHeight) {
+    int mapWidth = mosaic.width(), mapHeight = mosaic.height();
+    auto mapRow = [&](int j) {
+        return ((double) j + 0.5) / levelHeight * mapHeight - 0.5;
+    };
+    int low = std::clamp((int) std::floor(mapRow(strip.first)), 0, mapHeight - 1);
+    int high = std::clamp((int) std::floor(mapRow(strip.first + strip.height - 1)) + 1, 0, mapHeight - 1);
+    if (!loadMosaicRows(mosaic, low, high)) return false;
+
+    strip.texels.resize((size_t) strip.width * strip.height * 3);
+    parallelFor((size_t) strip.height, [&](size_t begin, size_t end, unsigned int) {
+        for (size_t j = begin; j < end; j++) {
+            double y = mapRow(strip.first + (int) j);
+            double fy = std::floor(y), ty = y - fy;
+            int y0 = std::clamp((int) fy, 0, mapHeight - 1), y1 = std::clamp((int) fy + 1, 0, mapHeight - 1);
+            for (int i = 0; i < strip.width; i++) {
+                double x = ((double) i + 0.5) / strip.width * mapWidth - 0.5;
+                double fx = std::floor(x), tx = x - fx;
+                int x0 = ((int) fx % mapWidth + mapWidth) % mapWidth, x1 = (x0 + 1) % mapWidth; // wraps around
+                const unsigned char *t00 = mosaic.at(x0, y0), *t10 = mosaic.at(x1, y0);
+                const unsigned char *t01 = mosaic.at(x0, y1), *t11 = mosaic.at(x1, y1);
+                for (int k = 0; k < 3; k++) {
+                    double value = (t00[k] * (1.0 - tx) + t10[k] * tx) * (1.0 - ty) +
+                                   (t01[k] * (1.0 - tx) + t11[k] * tx) * ty;
+                    strip.texels[(j * strip.width + i) * 3 + k] = (unsigned char) std::lround(value);
+                }
+            }
+        }
+    });
+    return true;
+}
+
+/** Function to read some rows of a level back from the pages already written
+ *
+ * @param output: pages file
+ * @param levels: levels of the pyramid
+ * @param level: level read
+ * @param strip: rows read (their width, first row and height are already set)
+ *
+ */
+void readStrip(std::fstream &output, int levels, int level, Strip &strip) {
+    int wide = (int) virtualPagesWide(levels, level);
+    std::vector<unsigned char> pages((size_t) wide * VIRTUAL_PAGE_BYTES);
+    strip.texels.resize((size_t) strip.width * strip.height * 3);
+    int lowPages = strip.first / VIRTUAL_PAGE_CONTENT;
+    int highPages = (strip.first + strip.height - 1) / VIRTUAL_PAGE_CONTENT;
+    for (int y = lowPages; y <= highPages; y++) {
+        output.seekg((std::streamoff) (sizeof(VirtualPagesHeader) + virtualPageIndex(levels, level, 0, y) *
+                                                                    VIRTUAL_PAGE_BYTES));
+        output.read((char *) pages.data(), (std::streamsize) pages.size());
+        int low = std::max(strip.first, y * VIRTUAL_PAGE_CONTENT);
+        int high = std::min(strip.first + strip.height, (y + 1) * VIRTUAL_PAGE_CONTENT);
+        for (int j = low; j < high; j++) {
+            int row = j - y * VIRTUAL_PAGE_CONTENT + VIRTUAL_PAGE_BORDER; // row in the page, past the border
+            for (int x = 0; x < wide; x++) {
+                const unsigned char *page = &pages[(size_t) x * VIRTUAL_PAGE_BYTES];
+                std::memcpy(&strip.texels[((size_t) (j - strip.first) * strip.width + x * VIRTUAL_PAGE_CONTENT) * 3],
+                            &page[((size_t) row * VIRTUAL_PAGE_SIZE + VIRTUAL_PAGE_BORDER) * 3],
+                            (size_t) VIRTUAL_PAGE_CONTENT * 3);
+            }
+        }
+    }
+}
+
+/** Function to compute some rows of a level from the level below (the average of 2 x 2 texels)
+ *
+ * @param below: rows of the level below, twice as many from twice the first row
+ * @param strip: rows computed (their width, first row and height are already set)
+ *
+ */
+void halveStrip(const Strip &below, Strip &strip) {
+    strip.texels.resize((size_t) strip.width * strip.height * 3);
+    parallelFor((size_t) strip.height, [&](size_t begin, size_t end, unsigned int) {
+        for (size_t j = begin; j < end; j++) {
+            int y = 2 * (strip.first + (int) j);
+            for (int i = 0; i < strip.width; i++) {
+                for (int k = 0; k < 3; k++) {
+                    int sum = below.at(2 * i, y)[k] + below.at(2 * i + 1, y)[k] +
+                              below.at(2 * i, y + 1)[k] + below.at(2 * i + 1, y + 1)[k];
+                    strip.texels[(j * strip.width + i) * 3 + k] = (unsigned char) ((sum + 2) / 4);
+                }
+            }
+        }
+    });
+}
+
+/** Function to write a row of pages of a level, with the borders copied from their neighbors
+ *
+ * @param strip: rows of the level around the row of pages (its borders included)
+ * @param levels: levels of the pyramid
+ * @param level: level written
+ * @param y: row of pages
+ * @param output: pages file
+ *
+ */
+void writePages(const Strip &strip, int levels, int level, int y, std::fstream &output) {
+    int wide = (int) virtualPagesWide(levels, level);
+    std::vector<unsigned char> pages((size_t) wide * VIRTUAL_PAGE_BYTES);
+    for (int x = 0; x < wide; x++) {
+        unsigned char *page = &pages[(size_t) x * VIRTUAL_PAGE_BYTES];
+        for (int j = 0; j < VIRTUAL_PAGE_SIZE; j++) {
+            for (int i = 0; i < VIRTUAL_PAGE_SIZE; i++) {
+                const unsigned char *texel = strip.at(x * VIRTUAL_PAGE_CONTENT + i - VIRTUAL_PAGE_BORDER,
+                                                      y * VIRTUAL_PAGE_CONTENT + j - VIRTUAL_PAGE_BORDER);
+                std::memcpy(&page[((size_t) j * VIRTUAL_PAGE_SIZE + i) * 3], texel, 3);
+            }
+        }
+    }
+    output.seekp((std::streamoff) (sizeof(VirtualPagesHeader) + virtualPageIndex(levels, level, 0, y) *
+                                                                VIRTUAL_PAGE_BYTES));
+    output.write((const char *) pages.data(), (std::streamsize) pages.size());
+}
+
+/** Function to write every page of a level, a row of pages at a time
+ *
+ * @param mosaic: map (for level 0)
+ * @param levels: levels of the pyramid
+ * @param level: level written
+ * @param output: pages file (with the levels below already written)
+ * @return true if successful, false if a tile failed to load
+ *
+ */
+bool writeLevel(Mosaic &mosaic, int levels, int level, std::fstream &output) {
+    int width = (int) virtualPagesWide(levels, level) * VIRTUAL_PAGE_CONTENT, height = width / 2;
+    for (int y = 0; y < height / VIRTUAL_PAGE_CONTENT; y++) {
+        // the rows of pages and their borders, clamped to the level
+        Strip strip;
+        strip.width = width;
+        strip.first = std::max(0, y * VIRTUAL_PAGE_CONTENT - VIRTUAL_PAGE_BORDER);
+        strip.height = std::min(height, (y + 1) * VIRTUAL_PAGE_CONTENT + VIRTUAL_PAGE_BORDER) - strip.first;
+        if (level == 0) {
+            if (!resampleStrip(mosaic, strip, height)) return false;
+        } else {
+            Strip below;
+            below.width = 2 * width;
+            below.first = 2 * strip.first;
+            below.height = 2 * strip.height;
+            readStrip(output, levels, level - 1, below);
+            halveStrip(below, strip);
+        }
+        writePages(strip, levels, level, y, output);
+    }
+    std::cout << "Level " << level << ": " << width << " x " << height << " texels" << std::endl;
+    return true;
+}
+
+/** Main function of the virtual texture builder
+ *
+ * @param argc: number of arguments
+ * @param argv: arguments (see the usage above)
+ * @return 0 if successful, -1 otherwise
+ *
+ */
+int main(int argc, char *argv[]) {
+    Mosaic mosaic;
+    int levels = 0;
+    for (int a = 1; a < argc; a++) {
+        std::string argument = argv[a];
+        if (argument == "--columns" && a + 1 < argc) mosaic.columns = std::atoi(argv[++a]);
+        else if (argument == "--levels" && a + 1 < argc) levels = std::atoi(argv[++a]);
+        else mosaic.paths.push_back(argv[a]);
+    }
+    if (mosaic.paths.size() < 2) {
+        std::cerr << "Usage: build_virtual_texture [--columns n] [--levels n] <image>... <output.pages>" << std::endl;
+        return -1;
+    }
+    const char *outputPath = mosaic.paths.back();
+    mosaic.paths.pop_back();
+    if (levels != 0) levels = std::clamp(levels, 1, VIRTUAL_MAX_LEVELS);
+    if (mosaic.columns <= 0) mosaic.columns = (int) mosaic.paths.size();
+    if (mosaic.paths.size() % mosaic.columns != 0) {
+        std::cerr << "ERROR::VIRTUAL_TEXTURE: " << mosaic.paths.size() << " tiles do not make rows of "
+                  << mosaic.columns << std::endl;
+        return -1;
+    }
+    stbi_set_flip_vertically_on_load(true); // the same orientation as loadTexture
+    if (!openMosaic(mosaic)) return -1;
+
+    // level 0 is not wider than the map (a wider one would only be interpolated)
+    if (levels == 0) {
+        levels = 1;
+        while (levels < VIRTUAL_MAX_LEVELS && ((long long) VIRTUAL_PAGE_CONTENT << (levels + 1)) <= mosaic.width()) {
+            levels++;
+        }
+    }
+
+    std::fstream output(outputPath, std::ios::binary | std::ios::in | std::ios::out | std::ios::trunc);
+    if (!output) {
+        std::cerr << "ERROR::VIRTUAL_TEXTURE: Failed to write " << outputPath << std::endl;
+        return -1;
+    }
+    VirtualPagesHeader header = {VIRTUAL_PAGES_MAGIC, VIRTUAL_PAGES_VERSION, (uint32_t) levels};
+    output.write((const char *) &header, sizeof(header));
+
+    bool built = true;
+    for (int l = 0; l < levels && built && output; l++) built = writeLevel(mosaic, levels, l, output);
+    for (unsigned char *tile: mosaic.tiles) stbi_image_free(tile);
+
+    if (!built || !output) {
+        std::cerr << "ERROR::VIRTUAL_TEXTURE: Failed to write " << outputPath << std::endl;
+        return -1;
+    }
+    return 0;
+}